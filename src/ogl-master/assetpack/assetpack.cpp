@@ -0,0 +1,80 @@
+// assetpack : packs the files listed in a manifest into one asset archive (see common/assetarchive.hpp).
+//
+// Usage : assetpack manifest.txt output.pak [directory...]
+//   The manifest lists one path per line, relative to its own directory ; empty lines and
+//   lines starting with # are skipped. The files are packed under these exact paths, which
+//   are the ones the program opens. A missing file fails the bake, so it fails the build too.
+//   A file that isn't next to the manifest is looked for in the directories, in order : the
+//   build generates some assets in its own directory rather than in the sources.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <common/assetarchive.hpp>
+
+static void printUsage(){
+	printf("Usage : assetpack manifest.txt output.pak [directory...]\n");
+}
+
+static bool fileExists(const std::string & path){
+	FILE * file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+		return false;
+	fclose(file);
+	return true;
+}
+
+// Reads the paths of the manifest, without the surrounding spaces
+static bool readManifest(const char * path, std::vector<std::string> & out_names){
+	FILE * file = fopen(path, "r");
+	if (file == NULL){
+		printf("%s could not be opened\n", path);
+		return false;
+	}
+	char line[1024];
+	while (fgets(line, sizeof(line), file) != NULL){
+		std::string name = line;
+		size_t first = name.find_first_not_of(" \t\r\n");
+		if (first == std::string::npos || name[first] == '#')
+			continue;
+		size_t last = name.find_last_not_of(" \t\r\n");
+		out_names.push_back(name.substr(first, last - first + 1));
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char ** argv){
+	if (argc < 3){
+		printUsage();
+		return 1;
+	}
+
+	std::vector<std::string> names;
+	if (!readManifest(argv[1], names))
+		return 1;
+
+	std::string directory = argv[1];
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+	std::vector<std::string> files;
+	for (unsigned int i = 0; i < names.size(); i++){
+		std::string file = directory + names[i];
+		for (int d = 3; d < argc && !fileExists(file); d++){
+			std::string generated = std::string(argv[d]) + "/" + names[i];
+			if (fileExists(generated))
+				file = generated;
+		}
+		files.push_back(file);
+	}
+
+	if (!writeAssetArchive(argv[2], names, files)){
+		printf("%s was not written\n", argv[2]);
+		return 1;
+	}
+	printf("Packed %u files in %s\n", (unsigned int)names.size(), argv[2]);
+	return 0;
+}
@@ -0,0 +1,54 @@
+# Turns the files listed in a manifest into constexpr byte arrays, compiled into the executable.
+# Run in script mode :
+#   cmake -DMANIFEST=embedded.txt -DOUTPUT=embedded.cpp -DSYMBOL=PlaygroundEmbeddedAssets -P embedassets.cmake
+# The manifest lists one path per line, relative to its own directory (# starts a comment).
+# The generated file defines SYMBOL, an array of EmbeddedAsset, and SYMBOLCount (see common/assetarchive.hpp).
+
+get_filename_component(MANIFEST_DIRECTORY "${MANIFEST}" PATH)
+file(STRINGS "${MANIFEST}" ASSET_NAMES REGEX "^[^#]")
+
+# The hexadecimal digits of 16 bytes
+set(LINE_HEX "")
+foreach(DIGIT RANGE 1 32)
+	set(LINE_HEX "${LINE_HEX}[0-9a-f]")
+endforeach()
+
+set(ARRAYS "")
+set(ENTRIES "")
+set(INDEX 0)
+foreach(ASSET_NAME ${ASSET_NAMES})
+	string(STRIP "${ASSET_NAME}" ASSET_NAME)
+	if(NOT ASSET_NAME STREQUAL "")
+		set(ASSET_PATH "${MANIFEST_DIRECTORY}/${ASSET_NAME}")
+		if(NOT EXISTS "${ASSET_PATH}")
+			message(FATAL_ERROR "${ASSET_PATH} does not exist (listed in ${MANIFEST})")
+		endif()
+		file(READ "${ASSET_PATH}" ASSET_HEX HEX)
+		string(LENGTH "${ASSET_HEX}" ASSET_SIZE)
+		math(EXPR ASSET_SIZE "${ASSET_SIZE} / 2")
+		# 16 bytes per line (the regular expressions of CMake have no {n}) ; a 0 is appended so that
+		# the array is never empty, and text stays terminated
+		string(REGEX REPLACE "(${LINE_HEX})" "\\1\n\t" ASSET_LINES "${ASSET_HEX}")
+		string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," ASSET_BYTES "${ASSET_LINES}")
+		set(ARRAYS "${ARRAYS}// ${ASSET_NAME}\nstatic constexpr unsigned char EmbeddedAsset${INDEX}[] = {\n\t${ASSET_BYTES}0x00\n};\n\n")
+		set(ENTRIES "${ENTRIES}\t{ \"${ASSET_NAME}\", EmbeddedAsset${INDEX}, ${ASSET_SIZE} },\n")
+		math(EXPR INDEX "${INDEX} + 1")
+	endif()
+endforeach()
+
+if(INDEX EQUAL 0)
+	message(FATAL_ERROR "${MANIFEST} lists no file")
+endif()
+
+set(CONTENT "// Generated by assetpack/embedassets.cmake from ${MANIFEST}, do not edit\n\n")
+set(CONTENT "${CONTENT}#include <stddef.h>\n\n#include <string>\n#include <vector>\n\n#include <common/assetarchive.hpp>\n\n")
+set(CONTENT "${CONTENT}${ARRAYS}extern const EmbeddedAsset ${SYMBOL}[] = {\n${ENTRIES}};\n")
+set(CONTENT "${CONTENT}extern const unsigned int ${SYMBOL}Count = ${INDEX};\n")
+
+# Only rewritten when it changes, so that an unrelated bake doesn't recompile it
+if(EXISTS "${OUTPUT}")
+	file(READ "${OUTPUT}" OLD_CONTENT)
+endif()
+if(NOT OLD_CONTENT STREQUAL CONTENT)
+	file(WRITE "${OUTPUT}" "${CONTENT}")
+endif()
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+
+#include "mappedfile.hpp"
+#include "assetarchive.hpp"
+
+#define ASSET_ARCHIVE_VERSION 1
+#define ASSET_ALIGNMENT 4096
+
+// Layout : header, slots, entries, paths, then the files at multiples of ASSET_ALIGNMENT
+struct AssetArchiveHeader {
+	char magic[4];              // "APAK"
+	unsigned int version;
+	unsigned int entryCount;
+	unsigned int slotCount;     // power of two, at least twice entryCount
+};
+
+struct AssetArchiveEntry {
+	unsigned long long hash;
+	unsigned long long offset;  // from the start of the archive
+	unsigned long long size;
+	unsigned int pathOffset;    // from the start of the archive
+	unsigned int pathLength;
+};
+
+// Open addressing : slot (hash & (slotCount-1)) and the following ones hold entry index + 1, 0 ends the search
+static MappedFile Archive;
+static const unsigned int * ArchiveSlots = NULL;
+static const AssetArchiveEntry * ArchiveEntries = NULL;
+static unsigned int ArchiveSlotCount = 0;
+
+static std::vector<EmbeddedAsset> EmbeddedAssets;
+static bool LooseAssets = false;
+
+// The paths already reported as missing from the archive
+static std::mutex MissMutex;
+static std::vector<std::string> Misses;
+
+// 64 bits FNV-1a
+static unsigned long long hashPath(const char * path, size_t length){
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++){
+		hash ^= (unsigned char)path[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool invalidArchive(const char * path, const char * reason){
+	printf("%s is not a valid asset archive : %s\n", path, reason);
+	closeAssetArchive();
+	return false;
+}
+
+void registerEmbeddedAssets(const EmbeddedAsset * assets, unsigned int count){
+	EmbeddedAssets.insert(EmbeddedAssets.end(), assets, assets + count);
+}
+
+void setLooseAssets(bool loose){
+	LooseAssets = loose;
+}
+
+bool openAssetArchive(const char * path){
+	closeAssetArchive();
+	MappedFile file;
+	if (!mapFile(path, file)){
+		printf("%s could not be opened\n", path);
+		return false;
+	}
+	Archive = file;
+
+	const AssetArchiveHeader * header = (const AssetArchiveHeader *)Archive.data;
+	if (Archive.size < sizeof(AssetArchiveHeader) || strncmp(header->magic, "APAK", 4) != 0)
+		return invalidArchive(path, "bad header");
+	if (header->version != ASSET_ARCHIVE_VERSION)
+		return invalidArchive(path, "baked by another version");
+	if (header->slotCount == 0 || (header->slotCount & (header->slotCount - 1)) != 0 || header->slotCount <= header->entryCount)
+		return invalidArchive(path, "bad index");
+	size_t indexEnd = sizeof(AssetArchiveHeader) + header->slotCount * sizeof(unsigned int) + header->entryCount * sizeof(AssetArchiveEntry);
+	if (indexEnd > Archive.size)
+		return invalidArchive(path, "truncated index");
+
+	// Checked once here, so that findAsset() can trust the index
+	const unsigned int * slots = (const unsigned int *)(Archive.data + sizeof(AssetArchiveHeader));
+	const AssetArchiveEntry * entries = (const AssetArchiveEntry *)(slots + header->slotCount);
+	for (unsigned int i = 0; i < header->slotCount; i++)
+		if (slots[i] > header->entryCount)
+			return invalidArchive(path, "bad index");
+	for (unsigned int i = 0; i < header->entryCount; i++){
+		const AssetArchiveEntry & entry = entries[i];
+		if ((unsigned long long)entry.pathOffset + entry.pathLength > Archive.size ||
+			entry.offset > Archive.size || entry.size > Archive.size - entry.offset)
+			return invalidArchive(path, "truncated file");
+	}
+
+	ArchiveSlots = slots;
+	ArchiveEntries = entries;
+	ArchiveSlotCount = header->slotCount;
+	printf("Opened asset archive %s : %u files\n", path, header->entryCount);
+	return true;
+}
+
+void closeAssetArchive(){
+	unmapFile(Archive);
+	ArchiveSlots = NULL;
+	ArchiveEntries = NULL;
+	ArchiveSlotCount = 0;
+}
+
+bool findAsset(const char * path, const unsigned char ** out_data, size_t * out_size){
+	if (LooseAssets)
+		return false;
+	// A handful of shaders : no index needed
+	for (unsigned int i = 0; i < EmbeddedAssets.size(); i++){
+		if (strcmp(EmbeddedAssets[i].path, path) == 0){
+			*out_data = EmbeddedAssets[i].data;
+			*out_size = EmbeddedAssets[i].size;
+			return true;
+		}
+	}
+	if (ArchiveSlotCount == 0)
+		return false;
+	size_t length = strlen(path);
+	unsigned long long hash = hashPath(path, length);
+	for (unsigned int slot = (unsigned int)hash & (ArchiveSlotCount - 1); ArchiveSlots[slot] != 0; slot = (slot + 1) & (ArchiveSlotCount - 1)){
+		const AssetArchiveEntry & entry = ArchiveEntries[ArchiveSlots[slot] - 1];
+		if (entry.hash == hash && entry.pathLength == length && memcmp(Archive.data + entry.pathOffset, path, length) == 0){
+			*out_data = Archive.data + entry.offset;
+			*out_size = (size_t)entry.size;
+			return true;
+		}
+	}
+
+	// The loader threads look files up too
+	std::lock_guard<std::mutex> lock(MissMutex);
+	if (std::find(Misses.begin(), Misses.end(), path) == Misses.end()){
+		Misses.push_back(path);
+		printf("%s is not in the asset archive, reading it from the disk\n", path);
+	}
+	return false;
+}
+
+static unsigned long long alignOffset(unsigned long long offset){
+	return (offset + ASSET_ALIGNMENT - 1) / ASSET_ALIGNMENT * ASSET_ALIGNMENT;
+}
+
+bool writeAssetArchive(const char * archivePath, const std::vector<std::string> & names, const std::vector<std::string> & files){
+	unsigned int count = (unsigned int)names.size();
+
+	// Read everything first : a missing file must not leave a partial archive
+	std::vector<MappedFile> contents(count);
+	bool ok = true;
+	for (unsigned int i = 0; i < count; i++){
+		if (!mapFile(files[i].c_str(), contents[i])){
+			printf("%s could not be opened (packed as %s)\n", files[i].c_str(), names[i].c_str());
+			ok = false;
+		}
+	}
+
+	AssetArchiveHeader header;
+	memcpy(header.magic, "APAK", 4);
+	header.version = ASSET_ARCHIVE_VERSION;
+	header.entryCount = count;
+	header.slotCount = 1;
+	while (header.slotCount < count * 2)
+		header.slotCount *= 2;
+
+	std::vector<unsigned int> slots(header.slotCount, 0);
+	std::vector<AssetArchiveEntry> entries(count);
+	std::string paths;
+	unsigned long long pathStart = sizeof(AssetArchiveHeader) + slots.size() * sizeof(unsigned int) + entries.size() * sizeof(AssetArchiveEntry);
+	for (unsigned int i = 0; ok && i < count; i++){
+		AssetArchiveEntry & entry = entries[i];
+		entry.hash = hashPath(names[i].c_str(), names[i].size());
+		entry.pathOffset = (unsigned int)(pathStart + paths.size());
+		entry.pathLength = (unsigned int)names[i].size();
+		paths += names[i];
+		unsigned int slot = (unsigned int)entry.hash & (header.slotCount - 1);
+		while (slots[slot] != 0){
+			const AssetArchiveEntry & other = entries[slots[slot] - 1];
+			if (other.hash == entry.hash && names[slots[slot] - 1] == names[i]){
+				printf("%s is packed twice\n", names[i].c_str());
+				ok = false;
+			}
+			slot = (slot + 1) & (header.slotCount - 1);
+		}
+		slots[slot] = i + 1;
+	}
+
+	unsigned long long offset = pathStart + paths.size();
+	for (unsigned int i = 0; ok && i < count; i++){
+		offset = alignOffset(offset);
+		entries[i].offset = offset;
+		entries[i].size = contents[i].size;
+		offset += contents[i].size;
+	}
+
+	// Written aside then renamed, so that a failed bake never leaves a truncated archive
+	std::string temporaryPath = std::string(archivePath) + ".tmp";
+	FILE * file = ok ? fopen(temporaryPath.c_str(), "wb") : NULL;
+	if (ok && file == NULL){
+		printf("Impossible to open %s\n", temporaryPath.c_str());
+		ok = false;
+	}
+	if (ok){
+		static const char padding[ASSET_ALIGNMENT] = { 0 };
+		ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(&slots[0], slots.size() * sizeof(unsigned int), 1, file) == 1 &&
+			(count == 0 || fwrite(&entries[0], entries.size() * sizeof(AssetArchiveEntry), 1, file) == 1) &&
+			(paths.empty() || fwrite(paths.data(), paths.size(), 1, file) == 1);
+		unsigned long long written = pathStart + paths.size();
+		for (unsigned int i = 0; ok && i < count; i++){
+			ok = fwrite(padding, 1, (size_t)(entries[i].offset - written), file) == entries[i].offset - written &&
+				fwrite(contents[i].data, 1, contents[i].size, file) == contents[i].size;
+			written = entries[i].offset + entries[i].size;
+		}
+		ok = fclose(file) == 0 && ok;
+		remove(archivePath);
+		if (!ok || rename(temporaryPath.c_str(), archivePath) != 0){
+			printf("Error while writing %s\n", archivePath);
+			remove(temporaryPath.c_str());
+			ok = false;
+		}
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+		unmapFile(contents[i]);
+	return ok;
+}
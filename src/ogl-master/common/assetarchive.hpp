@@ -0,0 +1,43 @@
+#ifndef ASSETARCHIVE_HPP
+#define ASSETARCHIVE_HPP
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+// All the assets of a program in one file, baked by the assetpack tool : a hashed index of
+// the paths, then the files one after the other, each one aligned on a 4KB page.
+// The archive is mapped once ; with findAsset as their lookup (setMappedFileLookup, setShaderFileLookup),
+// mapFile() and the shader loader look the paths up in it before trying the disk, so every loader
+// reads from it without knowing.
+
+// A file compiled into the executable (see assetpack/embedassets.cmake)
+struct EmbeddedAsset {
+	const char * path;
+	const unsigned char * data;   // followed by a 0, not counted in size
+	size_t size;
+};
+
+// Adds files compiled into the executable ; they are looked up before the archive.
+// The array must stay valid (the generated ones are constants).
+void registerEmbeddedAssets(const EmbeddedAsset * assets, unsigned int count);
+
+// true : findAsset() finds nothing, so every file is read from the disk, to try changes without rebuilding
+void setLooseAssets(bool loose);
+
+// Maps the archive. The paths are then looked up in it first, until closeAssetArchive().
+// Open it before starting the asset loader threads.
+bool openAssetArchive(const char * path);
+void closeAssetArchive();
+
+// Finds a file among the embedded ones, then in the open archive, by its path exactly as it was
+// packed (case included). The data stays valid until the archive is closed.
+// While an archive is open, the first miss of each path is printed : the file is read from the disk,
+// either because the program wrote it (a cache) or because it is missing from the manifest.
+bool findAsset(const char * path, const unsigned char ** out_data, size_t * out_size);
+
+// Packs files[i] under the path names[i]. Fails, without writing anything, if one is missing.
+bool writeAssetArchive(const char * archivePath, const std::vector<std::string> & names, const std::vector<std::string> & files);
+
+#endif
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "profiler.hpp"
+#include "assetloader.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+enum AssetType {
+	ASSET_MESH,
+	ASSET_CUSTOM
+};
+
+// A mesh goes through the workers twice : once to build it, then once more to copy it
+// into its buffers, which the OpenGL thread has mapped in between
+enum AssetStage {
+	STAGE_BUILD,
+	STAGE_COPY
+};
+
+struct AssetJob {
+	AssetType type;
+	AssetStage stage;
+	bool ok;
+
+	// ASSET_MESH
+	std::function<bool(MeshData &)> build;
+	Mesh * target;
+	MeshData mesh;
+	Mesh staging;                 // its buffers, mapped during STAGE_COPY
+	void * mappedVertices;
+	void * mappedIndices;
+
+	// ASSET_CUSTOM
+	std::function<void()> work;
+	std::function<void()> finish;
+};
+
+// Jobs go from queued (main thread -> workers) to done (workers -> main thread)
+static std::vector<std::thread> workers;
+static std::mutex jobMutex;
+static std::condition_variable jobAvailable;
+static std::condition_variable jobDone;
+static std::deque<AssetJob *> queuedJobs;
+static std::deque<AssetJob *> doneJobs;
+static unsigned int pendingJobs = 0;
+static bool stopping = false;
+
+// By the last updateAssetLoader()
+static size_t uploadedBytes = 0;
+
+static void runJob(AssetJob * job){
+	switch (job->type){
+	case ASSET_MESH:
+		if (job->stage == STAGE_BUILD)
+			job->ok = job->build(job->mesh);
+		else{
+			if (!job->mesh.vertexData.empty())
+				memcpy(job->mappedVertices, &job->mesh.vertexData[0], job->mesh.vertexData.size());
+			if (!job->mesh.indices.empty())
+				memcpy(job->mappedIndices, &job->mesh.indices[0], job->mesh.indices.size() * sizeof(unsigned short));
+		}
+		break;
+	case ASSET_CUSTOM:
+		job->work();
+		job->ok = true;
+		break;
+	}
+}
+
+static void workerLoop(){
+	setProfilerThreadName("Asset loader");
+	for (;;){
+		AssetJob * job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			while (!stopping && queuedJobs.empty())
+				jobAvailable.wait(lock);
+			if (stopping)
+				return;
+			job = queuedJobs.front();
+			queuedJobs.pop_front();
+		}
+
+		{
+			PROFILE_SCOPE("Load asset");
+			runJob(job);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			doneJobs.push_back(job);
+		}
+		jobDone.notify_all();
+	}
+}
+
+void startAssetLoader(unsigned int threadCount){
+	if (threadCount == 0){
+		threadCount = std::thread::hardware_concurrency();
+		threadCount = threadCount > 1 ? threadCount - 1 : 1;
+	}
+	stopping = false;
+	for (unsigned int i=0; i<threadCount; i++)
+		workers.push_back(std::thread(workerLoop));
+}
+
+static bool unmapStagingBuffer(GLuint buffer, void * mapped){
+	if (mapped == NULL)
+		return true;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	return glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+}
+
+// False when the contents were lost while mapped (e.g. on a display mode switch)
+static bool unmapStagingBuffers(AssetJob * job){
+	bool ok = unmapStagingBuffer(job->staging.vertexbuffer, job->mappedVertices);
+	ok = unmapStagingBuffer(job->staging.elementbuffer, job->mappedIndices) && ok;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return ok;
+}
+
+static void dropStagingBuffers(AssetJob * job){
+	unmapStagingBuffers(job);
+	glDeleteBuffers(1, &job->staging.vertexbuffer);
+	glDeleteBuffers(1, &job->staging.elementbuffer);
+}
+
+void stopAssetLoader(){
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (unsigned int i=0; i<workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	// The finish callbacks may free what their work used : dropping them would leak it
+	for (unsigned int i=0; i<doneJobs.size(); i++){
+		if (doneJobs[i]->type == ASSET_CUSTOM)
+			doneJobs[i]->finish();
+		else if (doneJobs[i]->stage == STAGE_COPY)
+			dropStagingBuffers(doneJobs[i]);
+		delete doneJobs[i];
+	}
+	for (unsigned int i=0; i<queuedJobs.size(); i++){
+		if (queuedJobs[i]->type == ASSET_CUSTOM){
+			queuedJobs[i]->work();
+			queuedJobs[i]->finish();
+		}
+		else if (queuedJobs[i]->stage == STAGE_COPY)
+			dropStagingBuffers(queuedJobs[i]);
+		delete queuedJobs[i];
+	}
+	queuedJobs.clear();
+	doneJobs.clear();
+	pendingJobs = 0;
+}
+
+static void queueJob(AssetJob * job){
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		queuedJobs.push_back(job);
+		pendingJobs++;
+	}
+	jobAvailable.notify_one();
+}
+
+void loadMeshAsync(std::function<bool(MeshData &)> build, Mesh * target){
+	AssetJob * job = new AssetJob();
+	job->type = ASSET_MESH;
+	job->stage = STAGE_BUILD;
+	job->build = build;
+	job->target = target;
+	queueJob(job);
+}
+
+void runAsync(std::function<void()> work, std::function<void()> finish){
+	AssetJob * job = new AssetJob();
+	job->type = ASSET_CUSTOM;
+	job->work = work;
+	job->finish = finish;
+	queueJob(job);
+}
+
+static void * mapStagingBuffer(GLuint buffer, size_t size){
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+	// A zero-sized range can't be mapped, and there is nothing to copy
+	if (size == 0)
+		return NULL;
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+// Allocates and maps the buffers of a built mesh, and sends it back to the workers to fill them.
+// False when they can't be mapped : the mesh is then uploaded from memory, by uploadMeshJob.
+static bool stageMeshJob(AssetJob * job){
+	size_t vertexBytes = job->mesh.vertexData.size();
+	size_t indexBytes = job->mesh.indices.size() * sizeof(unsigned short);
+	glGenBuffers(1, &job->staging.vertexbuffer);
+	glGenBuffers(1, &job->staging.elementbuffer);
+	job->mappedVertices = mapStagingBuffer(job->staging.vertexbuffer, vertexBytes);
+	job->mappedIndices = mapStagingBuffer(job->staging.elementbuffer, indexBytes);
+	if ((vertexBytes > 0 && job->mappedVertices == NULL) || (indexBytes > 0 && job->mappedIndices == NULL)){
+		dropStagingBuffers(job);
+		return false;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	job->stage = STAGE_COPY;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		queuedJobs.push_back(job);
+	}
+	jobAvailable.notify_one();
+	return true;
+}
+
+static void uploadMeshJob(AssetJob * job){
+	Mesh mesh;
+	if (job->stage == STAGE_COPY){
+		// The buffers are filled : the vertex array is all that is left
+		bool ok = unmapStagingBuffers(job);
+		mesh.vertexbuffer = job->staging.vertexbuffer;
+		mesh.elementbuffer = job->staging.elementbuffer;
+		if (!ok){
+			// Lost while mapped : upload them again
+			glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexbuffer);
+			glBufferData(GL_ARRAY_BUFFER, job->mesh.vertexData.size(), job->mesh.vertexData.empty() ? NULL : &job->mesh.vertexData[0], GL_STATIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, mesh.elementbuffer);
+			glBufferData(GL_ARRAY_BUFFER, job->mesh.indices.size() * sizeof(unsigned short), job->mesh.indices.empty() ? NULL : &job->mesh.indices[0], GL_STATIC_DRAW);
+		}
+		setupMeshVertexArray(job->mesh, mesh);
+	}
+	else
+		uploadMesh(job->mesh, mesh);
+	glBindVertexArray(0);
+	deleteMesh(*job->target);
+	*job->target = mesh;
+}
+
+void updateAssetLoader(double budgetSeconds){
+	PROFILE_SCOPE("Upload assets");
+	uploadedBytes = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (;;){
+		AssetJob * job;
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			if (doneJobs.empty())
+				return;
+			job = doneJobs.front();
+			doneJobs.pop_front();
+		}
+
+		if (job->type == ASSET_MESH && job->stage == STAGE_BUILD && job->ok && stageMeshJob(job))
+			continue;
+
+		if (job->type == ASSET_MESH && job->ok){
+			uploadedBytes += job->mesh.vertexData.size() + job->mesh.indices.size() * sizeof(unsigned short);
+			uploadMeshJob(job);
+		}
+		else if (job->type == ASSET_CUSTOM)
+			job->finish();
+		delete job;
+
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			pendingJobs--;
+		}
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= budgetSeconds)
+			return;
+	}
+}
+
+void waitForAssets(){
+	for (;;){
+		updateAssetLoader(1.0);
+		std::unique_lock<std::mutex> lock(jobMutex);
+		if (pendingJobs == 0)
+			return;
+		while (doneJobs.empty())
+			jobDone.wait(lock);
+	}
+}
+
+size_t assetUploadedBytes(){
+	return uploadedBytes;
+}
+
+unsigned int pendingAssets(){
+	std::lock_guard<std::mutex> lock(jobMutex);
+	return pendingJobs;
+}
@@ -0,0 +1,36 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <functional>
+
+// Asynchronous asset loading : worker threads read and decode the files,
+// the OpenGL thread uploads the results in updateAssetLoader(), within a time budget per frame.
+// The meshes are copied by the workers too, into buffers that updateAssetLoader() maps for them.
+// Until then the assets are replaced by placeholders, so the first frame comes up immediately.
+
+// threadCount 0 uses one thread less than the hardware has (at least one)
+void startAssetLoader(unsigned int threadCount);
+// Waits for the workers; the meshes that are not uploaded yet keep their placeholders.
+// The runAsync jobs still run, and their finish too, so that whatever they hold is released.
+void stopAssetLoader();
+
+// Runs build on a worker thread, then uploads the result in target, replacing
+// (and deleting) the mesh already there. target must stay valid until then.
+void loadMeshAsync(std::function<bool(MeshData &)> build, Mesh * target);
+
+// Runs work on a worker thread, then finish on the OpenGL thread in updateAssetLoader()
+void runAsync(std::function<void()> work, std::function<void()> finish);
+
+// Call once per frame from the OpenGL thread. Uploads the finished assets until budgetSeconds
+// is spent; at least one asset is uploaded per call, so that loading always progresses.
+void updateAssetLoader(double budgetSeconds);
+
+// Uploads all the assets, sleeping while the workers load them
+void waitForAssets();
+
+// Number of assets queued, loading or waiting for upload
+unsigned int pendingAssets();
+// Bytes of meshes uploaded by the last updateAssetLoader()
+size_t assetUploadedBytes();
+
+#endif
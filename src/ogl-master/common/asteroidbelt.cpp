@@ -0,0 +1,137 @@
+#include <vector>
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+#include "mesh.hpp"
+#include "frustum.hpp"
+#include "streambuffer.hpp"
+#include "randomhash.hpp"
+#include "asteroidbelt.hpp"
+
+// Seconds of one orbit at the inner radius, which sets the gravity of the central body
+#define ASTEROID_BELT_INNER_PERIOD 300.0f
+#define ASTEROID_BELT_PI 3.14159265358979f
+
+// The instances of the last ASTEROID_BELT_SECTIONS frames stay in the buffer until the GPU read them
+#define ASTEROID_BELT_SECTIONS 3
+
+float asteroidBeltGravity(){
+	float omega = 2.0f * ASTEROID_BELT_PI / ASTEROID_BELT_INNER_PERIOD;
+	return omega * omega * ASTEROID_BELT_INNER_RADIUS * ASTEROID_BELT_INNER_RADIUS * ASTEROID_BELT_INNER_RADIUS;
+}
+
+bool initAsteroidBelt(unsigned int seed, AsteroidBelt & out_belt){
+	out_belt.seed = seed;
+	out_belt.positions.clear();
+	out_belt.velocities.clear();
+
+	// Initialize Shader
+	out_belt.programID = LoadShaders( "Asteroid.vertexshader", "Asteroid.fragmentshader" );
+	if (out_belt.programID == 0)
+		return false;
+
+	// Initialize uniforms' IDs
+	out_belt.ViewProjectionID = glGetUniformLocation( out_belt.programID, "VP" );
+	out_belt.MeshUniformIDs = getMeshUniforms(out_belt.programID);
+
+	createStreamBuffer(GL_ARRAY_BUFFER, ASTEROID_BELT_MAX_COUNT * sizeof(glm::vec4), ASTEROID_BELT_SECTIONS, out_belt.instances);
+	return true;
+}
+
+void deleteAsteroidBelt(AsteroidBelt & belt){
+	deleteStreamBuffer(belt.instances);
+	glDeleteProgram(belt.programID);
+	belt.positions.clear();
+	belt.velocities.clear();
+}
+
+void resizeAsteroidBelt(AsteroidBelt & belt, unsigned int count){
+	if (count > ASTEROID_BELT_MAX_COUNT)
+		count = ASTEROID_BELT_MAX_COUNT;
+	unsigned int previousCount = belt.positions.size();
+	belt.positions.resize(count);
+	belt.velocities.resize(count);
+
+	float gravity = asteroidBeltGravity();
+	for (unsigned int i = previousCount; i < count; i++){
+		unsigned int state = hashRandom(belt.seed, i);
+		float angle = 2.0f * ASTEROID_BELT_PI * randomUnit(state);
+		float radius = ASTEROID_BELT_INNER_RADIUS + (ASTEROID_BELT_OUTER_RADIUS - ASTEROID_BELT_INNER_RADIUS) * randomUnit(state);
+		float height = ASTEROID_BELT_THICKNESS * (randomUnit(state) - 0.5f);
+		float scale = ASTEROID_MIN_SCALE + (ASTEROID_MAX_SCALE - ASTEROID_MIN_SCALE) * randomUnit(state) * randomUnit(state);
+		glm::vec3 position(radius * cosf(angle), height, radius * sinf(angle));
+
+		// Nearly circular, counterclockwise seen from above, with some eccentricity and inclination
+		float speed = sqrtf(gravity / radius) * (0.97f + 0.06f * randomUnit(state));
+		glm::vec3 tangent(sinf(angle), 0.0f, -cosf(angle));
+		glm::vec3 velocity = speed * tangent + glm::vec3(0.0f, 0.02f * speed * (randomUnit(state) - 0.5f), 0.0f);
+
+		belt.positions[i] = glm::vec4(position, scale);
+		belt.velocities[i] = velocity;
+	}
+}
+
+void stepAsteroidBelt(AsteroidBelt & belt, float seconds, unsigned int substeps){
+	if (substeps == 0 || seconds == 0.0f)
+		return;
+	float gravity = asteroidBeltGravity();
+	float step = seconds / substeps;
+	for (unsigned int i = 0; i < belt.positions.size(); i++){
+		glm::vec3 position(belt.positions[i]);
+		glm::vec3 velocity = belt.velocities[i];
+		for (unsigned int s = 0; s < substeps; s++){
+			float distanceSquared = glm::dot(position, position);
+			glm::vec3 acceleration = position * (-gravity / (distanceSquared * sqrtf(distanceSquared)));
+			velocity += acceleration * step;
+			position += velocity * step;
+		}
+		belt.positions[i] = glm::vec4(position, belt.positions[i].w);
+		belt.velocities[i] = velocity;
+	}
+}
+
+unsigned int drawAsteroidBelt(AsteroidBelt & belt, const Mesh & mesh, int lod, const glm::mat4 & ViewProjection, const Frustum * frustum){
+
+	// The visible asteroids, in this frame's section of the stream buffer. The bounding box of the
+	// quantized positions bounds the mesh.
+	float meshRadius = glm::length(glm::abs(mesh.positionScale) + glm::abs(mesh.positionOffset));
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < belt.positions.size(); i++){
+		const glm::vec4 & asteroid = belt.positions[i];
+		if (frustum != NULL && !sphereInFrustum(*frustum, glm::vec3(asteroid), asteroid.w * meshRadius))
+			continue;
+		glm::vec4 * instance = (glm::vec4 *)writeStreamBuffer(belt.instances, sizeof(glm::vec4));
+		if (instance == NULL)
+			break;
+		*instance = asteroid;
+		count++;
+	}
+	size_t offset;
+	commitStreamBuffer(belt.instances, offset);
+
+	if (count > 0){
+		glUseProgram(belt.programID);
+		glUniformMatrix4fv(belt.ViewProjectionID, 1, GL_FALSE, &ViewProjection[0][0]);
+
+		// The instances in attribute 3 of the mesh's vertex array, only for this draw, from this
+		// frame's first one (see commitStreamBuffer)
+		glBindVertexArray(mesh.vertexArrayID);
+		glBindBuffer(GL_ARRAY_BUFFER, belt.instances.buffer);
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)offset);
+		glVertexAttribDivisor(3, 1);
+
+		drawMeshInstanced(mesh, belt.MeshUniformIDs, lod, count);
+
+		glVertexAttribDivisor(3, 0);
+		glDisableVertexAttribArray(3);
+	}
+
+	// The next frame writes in the next section, once the GPU is done with it
+	nextStreamBufferSection(belt.instances);
+	return count;
+}
@@ -0,0 +1,46 @@
+#ifndef ASTEROIDBELT_HPP
+#define ASTEROIDBELT_HPP
+
+// Synthetic asteroid belt, to load the simulation and the renderer : point masses orbiting the
+// origin, integrated on the CPU in substeps, drawn as instances of one mesh with a single draw call.
+// The instances are written in a stream buffer each frame, the ones outside the frustum skipped.
+
+#define ASTEROID_BELT_MAX_COUNT 131072
+
+// The belt, in model units around the origin, and the scale of the asteroids' mesh
+#define ASTEROID_BELT_INNER_RADIUS 320.0f
+#define ASTEROID_BELT_OUTER_RADIUS 400.0f
+#define ASTEROID_BELT_THICKNESS 6.0f
+#define ASTEROID_MIN_SCALE 0.05f
+#define ASTEROID_MAX_SCALE 0.3f
+
+struct AsteroidBelt {
+	std::vector<glm::vec4> positions;   // xyz, and the scale of the mesh in w
+	std::vector<glm::vec3> velocities;
+	unsigned int seed;
+	StreamBuffer instances;
+	GLuint programID;
+	GLuint ViewProjectionID;
+	MeshUniforms MeshUniformIDs;
+};
+
+// G times the mass of the body at the origin, in model units cubed per second squared : anything
+// orbiting it at radius r goes around in 2 pi sqrt(r^3 / asteroidBeltGravity()) seconds
+float asteroidBeltGravity();
+
+// false when the shader could not be loaded
+bool initAsteroidBelt(unsigned int seed, AsteroidBelt & out_belt);
+void deleteAsteroidBelt(AsteroidBelt & belt);
+
+// Adds or removes asteroids, up to ASTEROID_BELT_MAX_COUNT. The i-th asteroid only depends on the
+// seed and on i : the ones already there keep moving, and the same seed makes the same belt.
+void resizeAsteroidBelt(AsteroidBelt & belt, unsigned int count);
+
+// Advances the orbits by seconds, in substeps steps of semi-implicit Euler
+void stepAsteroidBelt(AsteroidBelt & belt, float seconds, unsigned int substeps);
+
+// Draws the asteroids with the given level of detail of the mesh, lit by the Sun at the origin.
+// With a frustum, only the ones inside it. Returns the number of asteroids drawn.
+unsigned int drawAsteroidBelt(AsteroidBelt & belt, const Mesh & mesh, int lod, const glm::mat4 & ViewProjection, const Frustum * frustum);
+
+#endif
@@ -0,0 +1,291 @@
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "bcencoder.hpp"
+
+// Weights of the two endpoints in the 4 colors of a BC1 block
+static const float endpointWeight0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+static const float endpointWeight1[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static int quantize(float value, int levels){
+	int q = (int)(value * levels / 255.0f + 0.5f);
+	return q < 0 ? 0 : (q > levels ? levels : q);
+}
+
+static unsigned short packRGB565(const float * color){
+	return (unsigned short)((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) | quantize(color[2], 31));
+}
+
+// Expands the 5 and 6 bit channels the way the GPU does, by replicating their high bits
+static void unpackRGB565(unsigned short packed, float * out_color){
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	out_color[0] = (float)((r << 3) | (r >> 2));
+	out_color[1] = (float)((g << 2) | (g >> 4));
+	out_color[2] = (float)((b << 3) | (b >> 2));
+}
+
+// Chooses the closest of the 4 palette colors for each pixel, and returns the squared error of the block.
+// pixels : the 16 pixels as planes of R, G and B
+static float selectIndices(const float pixels[3][16], const float palette[4][3], unsigned char * out_indices){
+	float error = 0.0f;
+#ifdef BC_SSE2
+	for (int i = 0; i < 16; i += 4){
+		__m128 r = _mm_loadu_ps(pixels[0] + i);
+		__m128 g = _mm_loadu_ps(pixels[1] + i);
+		__m128 b = _mm_loadu_ps(pixels[2] + i);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int p = 0; p < 4; p++){
+			__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+			__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+			__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(distance, best);
+			bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(p)));
+		}
+		float distances[4];
+		int indices[4];
+		_mm_storeu_ps(distances, best);
+		_mm_storeu_si128((__m128i *)indices, bestIndex);
+		for (int j = 0; j < 4; j++){
+			out_indices[i + j] = (unsigned char)indices[j];
+			error += distances[j];
+		}
+	}
+#else
+	for (int i = 0; i < 16; i++){
+		float best = FLT_MAX;
+		for (int p = 0; p < 4; p++){
+			float dr = pixels[0][i] - palette[p][0];
+			float dg = pixels[1][i] - palette[p][1];
+			float db = pixels[2][i] - palette[p][2];
+			float distance = dr*dr + dg*dg + db*db;
+			if (distance < best){
+				best = distance;
+				out_indices[i] = (unsigned char)p;
+			}
+		}
+		error += best;
+	}
+#endif
+	return error;
+}
+
+// Quantizes the endpoints, sorts them for the 4 colors mode (c0 > c1), and picks the indices
+static float fitEndpoints(const float pixels[3][16], const float * endpoint0, const float * endpoint1,
+	unsigned short & out_c0, unsigned short & out_c1, unsigned char * out_indices){
+	out_c0 = packRGB565(endpoint0);
+	out_c1 = packRGB565(endpoint1);
+	if (out_c0 < out_c1){
+		unsigned short swap = out_c0;
+		out_c0 = out_c1;
+		out_c1 = swap;
+	}
+
+	float palette[4][3];
+	unpackRGB565(out_c0, palette[0]);
+	unpackRGB565(out_c1, palette[1]);
+	for (int c = 0; c < 3; c++){
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+	}
+	// A single color : c0 == c1 is the 3 colors mode, where only index 0 is that color
+	if (out_c0 == out_c1)
+		palette[2][0] = palette[2][1] = palette[2][2] = palette[3][0] = palette[3][1] = palette[3][2] = FLT_MAX / 4.0f;
+	return selectIndices(pixels, palette, out_indices);
+}
+
+// Extremities of the pixels along their principal axis
+static void principalEndpoints(const float pixels[3][16], float * out_endpoint0, float * out_endpoint1){
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int c = 0; c < 3; c++){
+		for (int i = 0; i < 16; i++)
+			mean[c] += pixels[c][i];
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[3][3] = { { 0.0f } };
+	for (int i = 0; i < 16; i++){
+		float d[3] = { pixels[0][i] - mean[0], pixels[1][i] - mean[1], pixels[2][i] - mean[2] };
+		for (int a = 0; a < 3; a++)
+			for (int b = 0; b < 3; b++)
+				covariance[a][b] += d[a] * d[b];
+	}
+
+	// Power iteration, from the diagonal of the luminance
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++){
+		float next[3];
+		for (int a = 0; a < 3; a++)
+			next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+		float length = sqrtf(next[0]*next[0] + next[1]*next[1] + next[2]*next[2]);
+		if (length < 1e-6f)
+			break;
+		for (int a = 0; a < 3; a++)
+			axis[a] = next[a] / length;
+	}
+	float length = sqrtf(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+	for (int a = 0; a < 3; a++)
+		axis[a] /= length;
+
+	float minT = FLT_MAX, maxT = -FLT_MAX;
+	for (int i = 0; i < 16; i++){
+		float t = (pixels[0][i] - mean[0]) * axis[0] + (pixels[1][i] - mean[1]) * axis[1] + (pixels[2][i] - mean[2]) * axis[2];
+		if (t < minT) minT = t;
+		if (t > maxT) maxT = t;
+	}
+	for (int c = 0; c < 3; c++){
+		out_endpoint0[c] = mean[c] + maxT * axis[c];
+		out_endpoint1[c] = mean[c] + minT * axis[c];
+	}
+}
+
+// Least squares endpoints for the given indices. Returns false if they are all the same.
+static bool refineEndpoints(const float pixels[3][16], const unsigned char * indices, float * out_endpoint0, float * out_endpoint1){
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[3] = { 0.0f, 0.0f, 0.0f };
+	float bx[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++){
+		float a = endpointWeight0[indices[i]];
+		float b = endpointWeight1[indices[i]];
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int c = 0; c < 3; c++){
+			ax[c] += a * pixels[c][i];
+			bx[c] += b * pixels[c][i];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+	for (int c = 0; c < 3; c++){
+		out_endpoint0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+		out_endpoint1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+	}
+	return true;
+}
+
+static void compressColorBlock(const unsigned char * rgba, unsigned char * out_block){
+	float pixels[3][16];
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			pixels[c][i] = rgba[i * 4 + c];
+
+	float endpoint0[3], endpoint1[3];
+	principalEndpoints(pixels, endpoint0, endpoint1);
+	unsigned short c0, c1;
+	unsigned char indices[16];
+	float error = fitEndpoints(pixels, endpoint0, endpoint1, c0, c1, indices);
+
+	// Two passes of refinement, kept only when they lower the error
+	for (int pass = 0; pass < 2 && error > 0.0f; pass++){
+		if (!refineEndpoints(pixels, indices, endpoint0, endpoint1))
+			break;
+		unsigned short refinedC0, refinedC1;
+		unsigned char refinedIndices[16];
+		float refinedError = fitEndpoints(pixels, endpoint0, endpoint1, refinedC0, refinedC1, refinedIndices);
+		if (refinedError >= error)
+			break;
+		error = refinedError;
+		c0 = refinedC0;
+		c1 = refinedC1;
+		memcpy(indices, refinedIndices, 16);
+	}
+
+	unsigned int bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (unsigned int)indices[i] << (2 * i);
+	out_block[0] = c0 & 0xff;
+	out_block[1] = c0 >> 8;
+	out_block[2] = c1 & 0xff;
+	out_block[3] = c1 >> 8;
+	out_block[4] = bits & 0xff;
+	out_block[5] = (bits >> 8) & 0xff;
+	out_block[6] = (bits >> 16) & 0xff;
+	out_block[7] = bits >> 24;
+}
+
+// 8 alphas mode : the maximum, the minimum, and 6 interpolated values
+// values : 16 8 bit values, stride bytes apart. The same block is the alpha of BC3 and the red of BC4.
+static void compressAlphaBlock(const unsigned char * values, int stride, unsigned char * out_block){
+	int minAlpha = 255, maxAlpha = 0;
+	for (int i = 0; i < 16; i++){
+		int alpha = values[i * stride];
+		if (alpha < minAlpha) minAlpha = alpha;
+		if (alpha > maxAlpha) maxAlpha = alpha;
+	}
+
+	int palette[8];
+	palette[0] = maxAlpha;
+	palette[1] = minAlpha;
+	for (int i = 2; i < 8; i++)
+		palette[i] = ((8 - i) * maxAlpha + (i - 1) * minAlpha) / 7;
+
+	unsigned long long bits = 0;
+	if (maxAlpha != minAlpha){
+		for (int i = 0; i < 16; i++){
+			int alpha = values[i * stride];
+			int best = 0;
+			for (int p = 1; p < 8; p++)
+				if (abs(alpha - palette[p]) < abs(alpha - palette[best]))
+					best = p;
+			bits |= (unsigned long long)best << (3 * i);
+		}
+	}
+
+	out_block[0] = (unsigned char)maxAlpha;
+	out_block[1] = (unsigned char)minAlpha;
+	for (int i = 0; i < 6; i++)
+		out_block[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+void compressBC1Block(const unsigned char * pixels, unsigned char * out_block){
+	compressColorBlock(pixels, out_block);
+}
+
+void compressBC3Block(const unsigned char * pixels, unsigned char * out_block){
+	compressAlphaBlock(pixels + 3, 4, out_block);
+	compressColorBlock(pixels, out_block + 8);
+}
+
+void compressBC4Block(const unsigned char * values, unsigned char * out_block){
+	compressAlphaBlock(values, 1, out_block);
+}
+
+size_t compressedSizeBC(unsigned int width, unsigned int height, bool bc3){
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * (bc3 ? 16 : 8);
+}
+
+void compressImageBC(const unsigned char * rgba, unsigned int width, unsigned int height, bool bc3,
+	unsigned int firstRow, unsigned int lastRow, unsigned char * out_data){
+	unsigned int blocksWide = (width + 3) / 4;
+	unsigned int blockSize = bc3 ? 16 : 8;
+	unsigned char pixels[16 * 4];
+	for (unsigned int by = firstRow; by < lastRow; by++){
+		for (unsigned int bx = 0; bx < blocksWide; bx++){
+			for (unsigned int y = 0; y < 4; y++){
+				unsigned int py = by * 4 + y < height ? by * 4 + y : height - 1;
+				for (unsigned int x = 0; x < 4; x++){
+					unsigned int px = bx * 4 + x < width ? bx * 4 + x : width - 1;
+					memcpy(pixels + (y * 4 + x) * 4, rgba + ((size_t)py * width + px) * 4, 4);
+				}
+			}
+			unsigned char * block = out_data + ((size_t)by * blocksWide + bx) * blockSize;
+			if (bc3)
+				compressBC3Block(pixels, block);
+			else
+				compressBC1Block(pixels, block);
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef BCENCODER_HPP
+#define BCENCODER_HPP
+
+#include <stddef.h>
+
+// Block compression of 8 bit RGBA images into the formats loadDDS reads :
+// BC1 (DXT1, 8 bytes per 4x4 block, opaque) and BC3 (DXT5, 16 bytes per block, BC1 color + 8 bit alpha),
+// and BC4 (8 bytes per block, one 8 bit channel) for the single channel textures.
+// The color endpoints are fitted on the principal axis of the block, then refined by least squares ;
+// the index search uses SSE2 where the compiler has it.
+
+// pixels : 16 RGBA pixels, row by row
+void compressBC1Block(const unsigned char * pixels, unsigned char * out_block);
+void compressBC3Block(const unsigned char * pixels, unsigned char * out_block);
+// values : 16 8 bit values, row by row
+void compressBC4Block(const unsigned char * values, unsigned char * out_block);
+
+// Size in bytes of a compressed image
+size_t compressedSizeBC(unsigned int width, unsigned int height, bool bc3);
+
+// Compresses the block rows [firstRow, lastRow) of a width x height RGBA image, first row at the top.
+// The borders of the images whose sizes are not multiples of 4 are padded with their last pixels.
+void compressImageBC(const unsigned char * rgba, unsigned int width, unsigned int height, bool bc3,
+	unsigned int firstRow, unsigned int lastRow, unsigned char * out_data);
+
+#endif
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "bench.hpp"
+
+bool loadCameraPath(const char * path, std::vector<CameraKey> & out_keys){
+	out_keys.clear();
+	FILE * file = fopen(path, "r");
+	if (file == NULL){
+		printf("%s could not be opened\n", path);
+		return false;
+	}
+	char line[256];
+	unsigned int lineNumber = 0;
+	bool ok = true;
+	while (ok && fgets(line, sizeof(line), file) != NULL){
+		lineNumber++;
+		char first[2];
+		if (sscanf(line, " %1s", first) != 1 || first[0] == '#')
+			continue;
+		CameraKey key;
+		if (sscanf(line, "%f %f %f %f %f %f", &key.time, &key.position.x, &key.position.y, &key.position.z,
+			&key.horizontalAngle, &key.verticalAngle) != 6){
+			printf("%s:%u : expected \"time x y z horizontalAngle verticalAngle\"\n", path, lineNumber);
+			ok = false;
+		}else if (!out_keys.empty() && key.time < out_keys.back().time){
+			printf("%s:%u : the times must increase\n", path, lineNumber);
+			ok = false;
+		}else{
+			out_keys.push_back(key);
+		}
+	}
+	fclose(file);
+	if (ok && out_keys.empty()){
+		printf("%s has no camera key\n", path);
+		ok = false;
+	}
+	return ok;
+}
+
+void sampleCameraPath(const std::vector<CameraKey> & keys, float time,
+	glm::vec3 & out_position, float & out_horizontalAngle, float & out_verticalAngle){
+	unsigned int next = 0;
+	while (next < keys.size() && keys[next].time <= time)
+		next++;
+	const CameraKey & a = keys[next > 0 ? next - 1 : 0];
+	const CameraKey & b = keys[next < keys.size() ? next : keys.size() - 1];
+	float t = b.time > a.time ? glm::clamp((time - a.time) / (b.time - a.time), 0.0f, 1.0f) : 0.0f;
+	out_position = glm::mix(a.position, b.position, t);
+	out_horizontalAngle = glm::mix(a.horizontalAngle, b.horizontalAngle, t);
+	out_verticalAngle = glm::mix(a.verticalAngle, b.verticalAngle, t);
+}
+
+void initBenchRecorder(unsigned int frameCount, unsigned int warmupFrames, BenchRecorder & out_recorder){
+	out_recorder.cpuMilliseconds.assign(frameCount, 0.0);
+	out_recorder.gpuMilliseconds.assign(frameCount, 0.0);
+	glGenQueries(BENCH_QUERY_LATENCY, out_recorder.queries);
+	for (unsigned int i = 0; i < BENCH_QUERY_LATENCY; i++)
+		out_recorder.queryFrames[i] = -1;
+	out_recorder.warmupFrames = warmupFrames;
+	out_recorder.frame = 0;
+	out_recorder.totalSeconds = 0.0;
+	out_recorder.start = std::chrono::steady_clock::now();
+}
+
+bool benchFinished(const BenchRecorder & recorder){
+	return recorder.frame >= recorder.warmupFrames + recorder.cpuMilliseconds.size();
+}
+
+// Reads the result of a query, waiting for it if wait, and frees it for another frame
+static bool readQuery(BenchRecorder & recorder, unsigned int index, bool wait){
+	int frame = recorder.queryFrames[index];
+	if (frame < 0)
+		return true;
+	GLint available = GL_FALSE;
+	if (!wait){
+		glGetQueryObjectiv(recorder.queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != GL_TRUE)
+			return false;
+	}
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(recorder.queries[index], GL_QUERY_RESULT, &nanoseconds);
+	if (frame >= (int)recorder.warmupFrames)
+		recorder.gpuMilliseconds[frame - recorder.warmupFrames] = nanoseconds / 1.0e6;
+	recorder.queryFrames[index] = -1;
+	return true;
+}
+
+void beginBenchFrame(BenchRecorder & recorder){
+	unsigned int index = recorder.frame % BENCH_QUERY_LATENCY;
+	// The query of BENCH_QUERY_LATENCY frames ago : only waits when the GPU is that far behind
+	readQuery(recorder, index, true);
+	recorder.frameStart = std::chrono::steady_clock::now();
+	if (recorder.frame == recorder.warmupFrames)
+		recorder.start = recorder.frameStart;
+	glBeginQuery(GL_TIME_ELAPSED, recorder.queries[index]);
+	recorder.queryFrames[index] = recorder.frame;
+}
+
+void endBenchFrame(BenchRecorder & recorder){
+	glEndQuery(GL_TIME_ELAPSED);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	if (recorder.frame >= recorder.warmupFrames)
+		recorder.cpuMilliseconds[recorder.frame - recorder.warmupFrames] = std::chrono::duration<double, std::milli>(end - recorder.frameStart).count();
+	recorder.frame++;
+	// Collect the timings that are already there
+	for (unsigned int i = 0; i < BENCH_QUERY_LATENCY; i++)
+		readQuery(recorder, i, false);
+}
+
+void finishBenchRecorder(BenchRecorder & recorder){
+	for (unsigned int i = 0; i < BENCH_QUERY_LATENCY; i++)
+		readQuery(recorder, i, true);
+	glDeleteQueries(BENCH_QUERY_LATENCY, recorder.queries);
+	recorder.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - recorder.start).count();
+	// Frames that were not run
+	unsigned int measured = recorder.frame > recorder.warmupFrames ? recorder.frame - recorder.warmupFrames : 0;
+	recorder.cpuMilliseconds.resize(std::min((size_t)measured, recorder.cpuMilliseconds.size()));
+	recorder.gpuMilliseconds.resize(recorder.cpuMilliseconds.size());
+}
+
+// Nearest rank percentile of sorted values
+static double percentile(const std::vector<double> & sorted, double p){
+	if (sorted.empty())
+		return 0.0;
+	size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+static void writeStatistics(FILE * file, const char * name, const std::vector<double> & values){
+	std::vector<double> sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+		sum += sorted[i];
+	fprintf(file, "  \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		name, sorted.empty() ? 0.0 : sum / sorted.size(), sorted.empty() ? 0.0 : sorted.front(),
+		percentile(sorted, 50), percentile(sorted, 95), percentile(sorted, 99), sorted.empty() ? 0.0 : sorted.back());
+}
+
+static void writeValues(FILE * file, const char * name, const std::vector<double> & values, bool last){
+	fprintf(file, "  \"%s\": [", name);
+	for (size_t i = 0; i < values.size(); i++)
+		fprintf(file, "%s%.4f", i > 0 ? ", " : "", values[i]);
+	fprintf(file, "]%s\n", last ? "" : ",");
+}
+
+// The renderer strings may hold quotes or backslashes
+static std::string jsonString(const char * text){
+	std::string out = "\"";
+	for (const char * c = text != NULL ? text : ""; *c != 0; c++){
+		if (*c == '"' || *c == '\\')
+			out += '\\';
+		if ((unsigned char)*c >= 0x20)
+			out += *c;
+	}
+	return out + "\"";
+}
+
+bool writeBenchReport(const char * path, const BenchRecorder & recorder, const char * cameraPath, const char * scene, int width, int height){
+	FILE * file = fopen(path, "w");
+	if (file == NULL){
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"camera_path\": %s,\n", jsonString(cameraPath).c_str());
+	fprintf(file, "  \"scene\": %s,\n", jsonString(scene).c_str());
+	fprintf(file, "  \"frames\": %u,\n", (unsigned int)recorder.cpuMilliseconds.size());
+	fprintf(file, "  \"warmup_frames\": %u,\n", recorder.warmupFrames);
+	fprintf(file, "  \"width\": %d,\n", width);
+	fprintf(file, "  \"height\": %d,\n", height);
+	fprintf(file, "  \"renderer\": %s,\n", jsonString((const char *)glGetString(GL_RENDERER)).c_str());
+	fprintf(file, "  \"version\": %s,\n", jsonString((const char *)glGetString(GL_VERSION)).c_str());
+	fprintf(file, "  \"total_seconds\": %.4f,\n", recorder.totalSeconds);
+	writeStatistics(file, "cpu_ms", recorder.cpuMilliseconds);
+	writeStatistics(file, "gpu_ms", recorder.gpuMilliseconds);
+	writeValues(file, "cpu_frames_ms", recorder.cpuMilliseconds, false);
+	writeValues(file, "gpu_frames_ms", recorder.gpuMilliseconds, true);
+	fprintf(file, "}\n");
+	bool ok = fclose(file) == 0;
+	if (!ok)
+		printf("Error while writing %s\n", path);
+	return ok;
+}
@@ -0,0 +1,52 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+
+// Scripted benchmarks : a camera path replayed frame after frame, the CPU and GPU time of
+// each frame, and a JSON report of their statistics, to compare one build with the next.
+
+// One point of a camera path, at a time in seconds of simulation
+struct CameraKey {
+	float time;
+	glm::vec3 position;
+	float horizontalAngle;   // radians, as in controls.cpp
+	float verticalAngle;
+};
+
+// Text file, one key per line : "time x y z horizontalAngle verticalAngle", in increasing time.
+// Empty lines and lines starting with # are skipped.
+bool loadCameraPath(const char * path, std::vector<CameraKey> & out_keys);
+
+// Linear interpolation between the keys around time, the first and last keys hold before and after
+void sampleCameraPath(const std::vector<CameraKey> & keys, float time,
+	glm::vec3 & out_position, float & out_horizontalAngle, float & out_verticalAngle);
+
+// GPU timings are read this many frames later, so that the CPU never waits for them
+#define BENCH_QUERY_LATENCY 4
+
+struct BenchRecorder {
+	std::vector<double> cpuMilliseconds;   // from beginBenchFrame to endBenchFrame, after the warmup
+	std::vector<double> gpuMilliseconds;   // GL_TIME_ELAPSED of the same commands
+	GLuint queries[BENCH_QUERY_LATENCY];
+	int queryFrames[BENCH_QUERY_LATENCY];  // frame measured by each query, -1 if none
+	unsigned int warmupFrames;             // run first, and not measured
+	unsigned int frame;                    // warmup included
+	std::chrono::steady_clock::time_point frameStart;
+	std::chrono::steady_clock::time_point start;
+	double totalSeconds;
+};
+
+void initBenchRecorder(unsigned int frameCount, unsigned int warmupFrames, BenchRecorder & out_recorder);
+// True once the warmup and frameCount measured frames are done
+bool benchFinished(const BenchRecorder & recorder);
+void beginBenchFrame(BenchRecorder & recorder);
+void endBenchFrame(BenchRecorder & recorder);
+// Waits for the GPU timings still pending, and frees the queries
+void finishBenchRecorder(BenchRecorder & recorder);
+
+// Writes the scene, the frame count, the resolution, the renderer and the mean, min, p50, p95, p99
+// and max of the CPU and GPU times, then every frame's times
+bool writeBenchReport(const char * path, const BenchRecorder & recorder, const char * cameraPath, const char * scene, int width, int height);
+
+#endif
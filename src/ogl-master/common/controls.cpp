@@ -102,6 +102,28 @@ void computeMatricesFromInputs(){
 	lastTime = currentTime;
 }
 
+void setCameraView(glm::vec3 newPosition, float newHorizontalAngle, float newVerticalAngle, float aspectRatio){
+	position = newPosition;
+	horizontalAngle = newHorizontalAngle;
+	verticalAngle = newVerticalAngle;
+
+	// Same camera as computeMatricesFromInputs, without the inputs
+	glm::vec3 direction(
+		cos(verticalAngle) * sin(horizontalAngle), 
+		sin(verticalAngle),
+		cos(verticalAngle) * cos(horizontalAngle)
+	);
+	glm::vec3 right = glm::vec3(
+		sin(horizontalAngle - 3.14f/2.0f), 
+		0,
+		cos(horizontalAngle - 3.14f/2.0f)
+	);
+	glm::vec3 up = glm::cross( right, direction );
+
+	ProjectionMatrix = glm::perspective(glm::radians(initialFoV), aspectRatio, 0.1f, 400.0f);
+	ViewMatrix       = glm::lookAt(position, position+direction, up);
+}
+
 vec3 getCameraPos() {
 	return position;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef CONTROLS_HPP
 #define CONTROLS_HPP
 void computeMatricesFromInputs();
+// Places the camera without reading the inputs (scripted camera paths)
+void setCameraView(glm::vec3 position, float horizontalAngle, float verticalAngle, float aspectRatio);
 glm::mat4 getViewMatrix();
 glm::mat4 getProjectionMatrix();
 vec3 getCameraPos();
@@ -0,0 +1,25 @@
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+void extractFrustum(const glm::mat4 & ViewProjection, Frustum & out_frustum){
+	// The planes are sums of the rows of the matrix
+	glm::mat4 rows = glm::transpose(ViewProjection);
+	out_frustum.planes[0] = rows[3] + rows[0];
+	out_frustum.planes[1] = rows[3] - rows[0];
+	out_frustum.planes[2] = rows[3] + rows[1];
+	out_frustum.planes[3] = rows[3] - rows[1];
+	out_frustum.planes[4] = rows[3] + rows[2];
+	out_frustum.planes[5] = rows[3] - rows[2];
+	// Normalized, so that the distances compare to the radius directly
+	for (int p = 0; p < 6; p++)
+		out_frustum.planes[p] /= glm::length(glm::vec3(out_frustum.planes[p]));
+}
+
+bool sphereInFrustum(const Frustum & frustum, glm::vec3 center, float radius){
+	for (int p = 0; p < 6; p++){
+		if (glm::dot(glm::vec3(frustum.planes[p]), center) + frustum.planes[p].w < -radius)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,15 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+// View frustum culling of bounding spheres
+struct Frustum {
+	glm::vec4 planes[6];   // left, right, bottom, top, near, far, pointing inside
+};
+
+// The planes of the frustum of a projection * view matrix : the objects' positions are then in the world
+void extractFrustum(const glm::mat4 & ViewProjection, Frustum & out_frustum);
+
+// false when the sphere is completely outside of one of the planes
+bool sphereInFrustum(const Frustum & frustum, glm::vec3 center, float radius);
+
+#endif
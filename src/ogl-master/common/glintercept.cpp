@@ -0,0 +1,18 @@
+#include <GL/glew.h>
+
+#include "glintercept.hpp"
+
+// The real entry points, in this file
+#undef glBindTexture
+#undef glGenTextures
+#undef glDeleteTextures
+#undef glTexImage2D
+#undef glDrawArrays
+#undef glDrawElements
+
+GLInterceptBindTextureProc glInterceptBindTexture = glBindTexture;
+GLInterceptGenTexturesProc glInterceptGenTextures = glGenTextures;
+GLInterceptDeleteTexturesProc glInterceptDeleteTextures = glDeleteTextures;
+GLInterceptTexImage2DProc glInterceptTexImage2D = glTexImage2D;
+GLInterceptDrawArraysProc glInterceptDrawArrays = glDrawArrays;
+GLInterceptDrawElementsProc glInterceptDrawElements = glDrawElements;
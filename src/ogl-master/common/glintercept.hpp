@@ -0,0 +1,32 @@
+#ifndef GLINTERCEPT_HPP
+#define GLINTERCEPT_HPP
+
+// The OpenGL 1.1 entry points are linked directly : GLEW doesn't load them. In the files that
+// include this header, they go through pointers instead, that the debug layers (glstats.hpp,
+// gpuresources.hpp) replace the way they replace GLEW's. The pointers start on the real entry points.
+//
+// The common/ files shared with the tutorials only include it when GL_INTERCEPT is defined.
+
+typedef void (GLAPIENTRY * GLInterceptBindTextureProc)(GLenum target, GLuint texture);
+typedef void (GLAPIENTRY * GLInterceptGenTexturesProc)(GLsizei n, GLuint * textures);
+typedef void (GLAPIENTRY * GLInterceptDeleteTexturesProc)(GLsizei n, const GLuint * textures);
+typedef void (GLAPIENTRY * GLInterceptTexImage2DProc)(GLenum target, GLint level, GLint internalformat,
+	GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void * pixels);
+typedef void (GLAPIENTRY * GLInterceptDrawArraysProc)(GLenum mode, GLint first, GLsizei count);
+typedef void (GLAPIENTRY * GLInterceptDrawElementsProc)(GLenum mode, GLsizei count, GLenum type, const void * indices);
+
+extern GLInterceptBindTextureProc glInterceptBindTexture;
+extern GLInterceptGenTexturesProc glInterceptGenTextures;
+extern GLInterceptDeleteTexturesProc glInterceptDeleteTextures;
+extern GLInterceptTexImage2DProc glInterceptTexImage2D;
+extern GLInterceptDrawArraysProc glInterceptDrawArrays;
+extern GLInterceptDrawElementsProc glInterceptDrawElements;
+
+#define glBindTexture glInterceptBindTexture
+#define glGenTextures glInterceptGenTextures
+#define glDeleteTextures glInterceptDeleteTextures
+#define glTexImage2D glInterceptTexImage2D
+#define glDrawArrays glInterceptDrawArrays
+#define glDrawElements glInterceptDrawElements
+
+#endif
@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "glintercept.hpp"
+#include "glstats.hpp"
+
+// Enough for the attributes of any implementation the tutorials run on
+#define GL_STATS_MAX_ATTRIBS 16
+
+struct VertexAttribState {
+	bool set;
+	GLuint buffer;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	const void * pointer;
+	GLuint divisor;
+};
+
+// What a vertex array object holds
+struct VertexArrayState {
+	GLuint elementBuffer;
+	unsigned int enabledAttribs;   // bit i : attribute i is enabled
+	VertexAttribState attribs[GL_STATS_MAX_ATTRIBS];
+};
+
+static bool Installed = false;
+static bool Counting = true;
+static FILE * Log = NULL;
+static unsigned int FrameIndex = 0;
+static GLStats Frame;
+
+// Shadowed state
+static GLuint CurrentProgram = 0;
+static GLuint CurrentVertexArray = 0;
+static GLuint ActiveTextureUnit = 0;
+static GLuint DrawFramebuffer = 0;
+static GLuint ReadFramebuffer = 0;
+static std::map<GLenum, GLuint> BufferBindings;                        // GL_ELEMENT_ARRAY_BUFFER is in the vertex arrays
+static std::map<std::pair<GLuint, GLenum>, GLuint> TextureBindings;    // (unit, target)
+static std::unordered_map<GLuint, VertexArrayState> VertexArrays;
+static std::unordered_map<unsigned long long, std::vector<unsigned char> > UniformValues;   // program << 32 | location
+
+static const char * CategoryNames[GL_STATS_CATEGORY_COUNT] = {
+	"program", "buffer", "vertex_array", "texture", "framebuffer", "uniform", "vertex_attrib", "draw"
+};
+
+const char * glStatsCategoryName(GLStatsCategory category){
+	return CategoryNames[category];
+}
+
+static void count(GLStatsCategory category, bool redundant){
+	if (!Counting)
+		return;
+	Frame.calls++;
+	Frame.categoryCalls[category]++;
+	if (redundant){
+		Frame.redundantCalls++;
+		Frame.categoryRedundantCalls[category]++;
+	}
+	if (category == GL_STATS_DRAW)
+		Frame.drawCalls++;
+}
+
+static VertexArrayState & currentVertexArray(){
+	std::unordered_map<GLuint, VertexArrayState>::iterator it = VertexArrays.find(CurrentVertexArray);
+	if (it != VertexArrays.end())
+		return it->second;
+	VertexArrayState & state = VertexArrays[CurrentVertexArray];
+	memset(&state, 0, sizeof(state));
+	return state;
+}
+
+// The values of a program's uniforms are lost when it is linked again or deleted
+static void forgetUniforms(GLuint program){
+	std::unordered_map<unsigned long long, std::vector<unsigned char> >::iterator it = UniformValues.begin();
+	while (it != UniformValues.end()){
+		if ((GLuint)(it->first >> 32) == program)
+			it = UniformValues.erase(it);
+		else
+			++it;
+	}
+}
+
+// True if the uniform already has this value. Location -1 is ignored by OpenGL : always redundant.
+static bool uniformUnchanged(GLint location, const void * data, size_t size){
+	if (location < 0)
+		return true;
+	std::vector<unsigned char> & value = UniformValues[((unsigned long long)CurrentProgram << 32) | (unsigned int)location];
+	if (value.size() == size && memcmp(&value[0], data, size) == 0)
+		return true;
+	value.assign((const unsigned char *)data, (const unsigned char *)data + size);
+	return false;
+}
+
+// The entry points before installGLStats(), from GLEW or glintercept.hpp
+#define GL_STATS_REAL(name) static decltype(__glew##name) Real##name = NULL
+#define GL_STATS_REAL_11(name) static decltype(glIntercept##name) Real##name = NULL
+GL_STATS_REAL(UseProgram);
+GL_STATS_REAL(LinkProgram);
+GL_STATS_REAL(ProgramBinary);
+GL_STATS_REAL(DeleteProgram);
+GL_STATS_REAL(BindBuffer);
+GL_STATS_REAL(DeleteBuffers);
+GL_STATS_REAL(BindVertexArray);
+GL_STATS_REAL(DeleteVertexArrays);
+GL_STATS_REAL(ActiveTexture);
+GL_STATS_REAL(BindFramebuffer);
+GL_STATS_REAL(DeleteFramebuffers);
+GL_STATS_REAL(Uniform1i);
+GL_STATS_REAL(Uniform1ui);
+GL_STATS_REAL(Uniform1f);
+GL_STATS_REAL(Uniform2f);
+GL_STATS_REAL(Uniform3f);
+GL_STATS_REAL(Uniform4f);
+GL_STATS_REAL(Uniform1fv);
+GL_STATS_REAL(Uniform3fv);
+GL_STATS_REAL(Uniform4fv);
+GL_STATS_REAL(UniformMatrix3fv);
+GL_STATS_REAL(UniformMatrix4fv);
+GL_STATS_REAL(VertexAttribPointer);
+GL_STATS_REAL(EnableVertexAttribArray);
+GL_STATS_REAL(DisableVertexAttribArray);
+GL_STATS_REAL(VertexAttribDivisor);
+GL_STATS_REAL(DrawElementsBaseVertex);
+GL_STATS_REAL(DrawRangeElements);
+GL_STATS_REAL(DrawArraysInstanced);
+GL_STATS_REAL(DrawElementsInstanced);
+GL_STATS_REAL_11(BindTexture);
+GL_STATS_REAL_11(DeleteTextures);
+GL_STATS_REAL_11(DrawArrays);
+GL_STATS_REAL_11(DrawElements);
+
+static void GLAPIENTRY statsUseProgram(GLuint program){
+	count(GL_STATS_PROGRAM, program == CurrentProgram);
+	CurrentProgram = program;
+	RealUseProgram(program);
+}
+
+static void GLAPIENTRY statsLinkProgram(GLuint program){
+	forgetUniforms(program);
+	RealLinkProgram(program);
+}
+
+static void GLAPIENTRY statsProgramBinary(GLuint program, GLenum binaryFormat, const void * binary, GLsizei length){
+	forgetUniforms(program);
+	RealProgramBinary(program, binaryFormat, binary, length);
+}
+
+static void GLAPIENTRY statsDeleteProgram(GLuint program){
+	forgetUniforms(program);
+	RealDeleteProgram(program);
+}
+
+static void GLAPIENTRY statsBindBuffer(GLenum target, GLuint buffer){
+	GLuint & bound = target == GL_ELEMENT_ARRAY_BUFFER ? currentVertexArray().elementBuffer : BufferBindings[target];
+	count(GL_STATS_BUFFER, bound == buffer);
+	bound = buffer;
+	RealBindBuffer(target, buffer);
+}
+
+// A deleted buffer is unbound from the context, and from the attributes of the bound vertex array
+static void GLAPIENTRY statsDeleteBuffers(GLsizei n, const GLuint * buffers){
+	VertexArrayState & vertexArray = currentVertexArray();
+	for (GLsizei i = 0; i < n; i++){
+		for (std::map<GLenum, GLuint>::iterator it = BufferBindings.begin(); it != BufferBindings.end(); ++it)
+			if (it->second == buffers[i])
+				it->second = 0;
+		if (vertexArray.elementBuffer == buffers[i])
+			vertexArray.elementBuffer = 0;
+		for (unsigned int a = 0; a < GL_STATS_MAX_ATTRIBS; a++)
+			if (vertexArray.attribs[a].buffer == buffers[i])
+				vertexArray.attribs[a].set = false;
+	}
+	RealDeleteBuffers(n, buffers);
+}
+
+static void GLAPIENTRY statsBindVertexArray(GLuint array){
+	count(GL_STATS_VERTEX_ARRAY, array == CurrentVertexArray);
+	CurrentVertexArray = array;
+	RealBindVertexArray(array);
+}
+
+static void GLAPIENTRY statsDeleteVertexArrays(GLsizei n, const GLuint * arrays){
+	for (GLsizei i = 0; i < n; i++){
+		if (arrays[i] == 0)
+			continue;
+		VertexArrays.erase(arrays[i]);
+		if (arrays[i] == CurrentVertexArray)
+			CurrentVertexArray = 0;
+	}
+	RealDeleteVertexArrays(n, arrays);
+}
+
+static void GLAPIENTRY statsActiveTexture(GLenum texture){
+	GLuint unit = texture - GL_TEXTURE0;
+	count(GL_STATS_TEXTURE, unit == ActiveTextureUnit);
+	ActiveTextureUnit = unit;
+	RealActiveTexture(texture);
+}
+
+static void GLAPIENTRY statsBindFramebuffer(GLenum target, GLuint framebuffer){
+	bool redundant;
+	if (target == GL_DRAW_FRAMEBUFFER){
+		redundant = DrawFramebuffer == framebuffer;
+		DrawFramebuffer = framebuffer;
+	}else if (target == GL_READ_FRAMEBUFFER){
+		redundant = ReadFramebuffer == framebuffer;
+		ReadFramebuffer = framebuffer;
+	}else{
+		redundant = DrawFramebuffer == framebuffer && ReadFramebuffer == framebuffer;
+		DrawFramebuffer = ReadFramebuffer = framebuffer;
+	}
+	count(GL_STATS_FRAMEBUFFER, redundant);
+	RealBindFramebuffer(target, framebuffer);
+}
+
+static void GLAPIENTRY statsDeleteFramebuffers(GLsizei n, const GLuint * framebuffers){
+	for (GLsizei i = 0; i < n; i++){
+		if (DrawFramebuffer == framebuffers[i])
+			DrawFramebuffer = 0;
+		if (ReadFramebuffer == framebuffers[i])
+			ReadFramebuffer = 0;
+	}
+	RealDeleteFramebuffers(n, framebuffers);
+}
+
+static void GLAPIENTRY statsUniform1i(GLint location, GLint v0){
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, &v0, sizeof(v0)));
+	RealUniform1i(location, v0);
+}
+
+static void GLAPIENTRY statsUniform1ui(GLint location, GLuint v0){
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, &v0, sizeof(v0)));
+	RealUniform1ui(location, v0);
+}
+
+static void GLAPIENTRY statsUniform1f(GLint location, GLfloat v0){
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, &v0, sizeof(v0)));
+	RealUniform1f(location, v0);
+}
+
+static void GLAPIENTRY statsUniform2f(GLint location, GLfloat v0, GLfloat v1){
+	GLfloat v[2] = { v0, v1 };
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, v, sizeof(v)));
+	RealUniform2f(location, v0, v1);
+}
+
+static void GLAPIENTRY statsUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2){
+	GLfloat v[3] = { v0, v1, v2 };
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, v, sizeof(v)));
+	RealUniform3f(location, v0, v1, v2);
+}
+
+static void GLAPIENTRY statsUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3){
+	GLfloat v[4] = { v0, v1, v2, v3 };
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, v, sizeof(v)));
+	RealUniform4f(location, v0, v1, v2, v3);
+}
+
+static void GLAPIENTRY statsUniform1fv(GLint location, GLsizei n, const GLfloat * value){
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, value, n * sizeof(GLfloat)));
+	RealUniform1fv(location, n, value);
+}
+
+static void GLAPIENTRY statsUniform3fv(GLint location, GLsizei n, const GLfloat * value){
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, value, n * 3 * sizeof(GLfloat)));
+	RealUniform3fv(location, n, value);
+}
+
+static void GLAPIENTRY statsUniform4fv(GLint location, GLsizei n, const GLfloat * value){
+	count(GL_STATS_UNIFORM, uniformUnchanged(location, value, n * 4 * sizeof(GLfloat)));
+	RealUniform4fv(location, n, value);
+}
+
+// A transposed matrix is another value : the flag is part of it
+static bool matrixUnchanged(GLint location, GLsizei n, GLboolean transpose, const GLfloat * value, unsigned int floats){
+	std::vector<GLfloat> data(value, value + n * floats);
+	data.push_back(transpose ? 1.0f : 0.0f);
+	return uniformUnchanged(location, &data[0], data.size() * sizeof(GLfloat));
+}
+
+static void GLAPIENTRY statsUniformMatrix3fv(GLint location, GLsizei n, GLboolean transpose, const GLfloat * value){
+	count(GL_STATS_UNIFORM, matrixUnchanged(location, n, transpose, value, 9));
+	RealUniformMatrix3fv(location, n, transpose, value);
+}
+
+static void GLAPIENTRY statsUniformMatrix4fv(GLint location, GLsizei n, GLboolean transpose, const GLfloat * value){
+	count(GL_STATS_UNIFORM, matrixUnchanged(location, n, transpose, value, 16));
+	RealUniformMatrix4fv(location, n, transpose, value);
+}
+
+static void GLAPIENTRY statsVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void * pointer){
+	bool redundant = false;
+	if (index < GL_STATS_MAX_ATTRIBS){
+		VertexAttribState & attrib = currentVertexArray().attribs[index];
+		GLuint buffer = BufferBindings[GL_ARRAY_BUFFER];
+		redundant = attrib.set && attrib.buffer == buffer && attrib.size == size && attrib.type == type
+			&& attrib.normalized == normalized && attrib.stride == stride && attrib.pointer == pointer;
+		attrib.set = true;
+		attrib.buffer = buffer;
+		attrib.size = size;
+		attrib.type = type;
+		attrib.normalized = normalized;
+		attrib.stride = stride;
+		attrib.pointer = pointer;
+	}
+	count(GL_STATS_VERTEX_ATTRIB, redundant);
+	RealVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static void GLAPIENTRY statsEnableVertexAttribArray(GLuint index){
+	bool redundant = false;
+	if (index < GL_STATS_MAX_ATTRIBS){
+		unsigned int & enabled = currentVertexArray().enabledAttribs;
+		redundant = (enabled & (1u << index)) != 0;
+		enabled |= 1u << index;
+	}
+	count(GL_STATS_VERTEX_ATTRIB, redundant);
+	RealEnableVertexAttribArray(index);
+}
+
+static void GLAPIENTRY statsDisableVertexAttribArray(GLuint index){
+	bool redundant = false;
+	if (index < GL_STATS_MAX_ATTRIBS){
+		unsigned int & enabled = currentVertexArray().enabledAttribs;
+		redundant = (enabled & (1u << index)) == 0;
+		enabled &= ~(1u << index);
+	}
+	count(GL_STATS_VERTEX_ATTRIB, redundant);
+	RealDisableVertexAttribArray(index);
+}
+
+static void GLAPIENTRY statsVertexAttribDivisor(GLuint index, GLuint divisor){
+	bool redundant = false;
+	if (index < GL_STATS_MAX_ATTRIBS){
+		VertexAttribState & attrib = currentVertexArray().attribs[index];
+		redundant = attrib.divisor == divisor;
+		attrib.divisor = divisor;
+	}
+	count(GL_STATS_VERTEX_ATTRIB, redundant);
+	RealVertexAttribDivisor(index, divisor);
+}
+
+static void GLAPIENTRY statsDrawElementsBaseVertex(GLenum mode, GLsizei n, GLenum type, const void * indices, GLint basevertex){
+	count(GL_STATS_DRAW, false);
+	RealDrawElementsBaseVertex(mode, n, type, indices, basevertex);
+}
+
+static void GLAPIENTRY statsDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei n, GLenum type, const void * indices){
+	count(GL_STATS_DRAW, false);
+	RealDrawRangeElements(mode, start, end, n, type, indices);
+}
+
+static void GLAPIENTRY statsDrawArraysInstanced(GLenum mode, GLint first, GLsizei n, GLsizei primcount){
+	count(GL_STATS_DRAW, false);
+	RealDrawArraysInstanced(mode, first, n, primcount);
+}
+
+static void GLAPIENTRY statsDrawElementsInstanced(GLenum mode, GLsizei n, GLenum type, const void * indices, GLsizei primcount){
+	count(GL_STATS_DRAW, false);
+	RealDrawElementsInstanced(mode, n, type, indices, primcount);
+}
+
+static void GLAPIENTRY statsBindTexture(GLenum target, GLuint texture){
+	GLuint & bound = TextureBindings[std::make_pair(ActiveTextureUnit, target)];
+	count(GL_STATS_TEXTURE, bound == texture);
+	bound = texture;
+	RealBindTexture(target, texture);
+}
+
+// A deleted texture is unbound from every unit
+static void GLAPIENTRY statsDeleteTextures(GLsizei n, const GLuint * textures){
+	for (GLsizei i = 0; i < n; i++)
+		for (std::map<std::pair<GLuint, GLenum>, GLuint>::iterator it = TextureBindings.begin(); it != TextureBindings.end(); ++it)
+			if (it->second == textures[i])
+				it->second = 0;
+	RealDeleteTextures(n, textures);
+}
+
+static void GLAPIENTRY statsDrawArrays(GLenum mode, GLint first, GLsizei n){
+	count(GL_STATS_DRAW, false);
+	RealDrawArrays(mode, first, n);
+}
+
+static void GLAPIENTRY statsDrawElements(GLenum mode, GLsizei n, GLenum type, const void * indices){
+	count(GL_STATS_DRAW, false);
+	RealDrawElements(mode, n, type, indices);
+}
+
+// Unsupported entry points stay NULL, as the code may test them
+#define GL_STATS_HOOK(prefix, name) if (prefix##name != NULL){ Real##name = prefix##name; prefix##name = stats##name; }
+#define GL_STATS_UNHOOK(prefix, name) if (Real##name != NULL){ prefix##name = Real##name; Real##name = NULL; }
+#define GL_STATS_ENTRY_POINTS(X) \
+	X(glIntercept, BindTexture) X(glIntercept, DeleteTextures) X(glIntercept, DrawArrays) X(glIntercept, DrawElements) \
+	X(__glew, UseProgram) X(__glew, LinkProgram) X(__glew, ProgramBinary) X(__glew, DeleteProgram) \
+	X(__glew, BindBuffer) X(__glew, DeleteBuffers) X(__glew, BindVertexArray) X(__glew, DeleteVertexArrays) \
+	X(__glew, ActiveTexture) X(__glew, BindFramebuffer) X(__glew, DeleteFramebuffers) \
+	X(__glew, Uniform1i) X(__glew, Uniform1ui) X(__glew, Uniform1f) X(__glew, Uniform2f) X(__glew, Uniform3f) X(__glew, Uniform4f) \
+	X(__glew, Uniform1fv) X(__glew, Uniform3fv) X(__glew, Uniform4fv) X(__glew, UniformMatrix3fv) X(__glew, UniformMatrix4fv) \
+	X(__glew, VertexAttribPointer) X(__glew, EnableVertexAttribArray) X(__glew, DisableVertexAttribArray) X(__glew, VertexAttribDivisor) \
+	X(__glew, DrawElementsBaseVertex) X(__glew, DrawRangeElements) X(__glew, DrawArraysInstanced) X(__glew, DrawElementsInstanced)
+
+bool installGLStats(const char * logPath){
+	if (Installed)
+		return true;
+	if (logPath != NULL){
+		Log = fopen(logPath, "w");
+		if (Log == NULL){
+			printf("Impossible to open %s\n", logPath);
+			return false;
+		}
+		fprintf(Log, "frame,calls,redundant,draws");
+		for (unsigned int c = 0; c < GL_STATS_CATEGORY_COUNT; c++)
+			fprintf(Log, ",%s,%s_redundant", CategoryNames[c], CategoryNames[c]);
+		fprintf(Log, "\n");
+	}
+	// The bindings made before, e.g. the framebuffer of a headless context. The other state is the default one.
+	GLint binding;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &binding);
+	CurrentProgram = binding;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &binding);
+	CurrentVertexArray = binding;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &binding);
+	ActiveTextureUnit = binding - GL_TEXTURE0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &binding);
+	DrawFramebuffer = binding;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &binding);
+	ReadFramebuffer = binding;
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &binding);
+	BufferBindings[GL_ARRAY_BUFFER] = binding;
+
+	GL_STATS_ENTRY_POINTS(GL_STATS_HOOK)
+	memset(&Frame, 0, sizeof(Frame));
+	FrameIndex = 0;
+	Counting = true;
+	Installed = true;
+	printf("Counting the OpenGL calls%s%s\n", logPath != NULL ? ", logged to " : "", logPath != NULL ? logPath : "");
+	return true;
+}
+
+void uninstallGLStats(){
+	if (!Installed)
+		return;
+	GL_STATS_ENTRY_POINTS(GL_STATS_UNHOOK)
+	if (Log != NULL)
+		fclose(Log);
+	Log = NULL;
+	Installed = false;
+	BufferBindings.clear();
+	TextureBindings.clear();
+	VertexArrays.clear();
+	UniformValues.clear();
+}
+
+bool glStatsInstalled(){
+	return Installed;
+}
+
+GLStats glStatsFrame(){
+	GLStats stats = Frame;
+	if (Log != NULL){
+		fprintf(Log, "%u,%u,%u,%u", FrameIndex, stats.calls, stats.redundantCalls, stats.drawCalls);
+		for (unsigned int c = 0; c < GL_STATS_CATEGORY_COUNT; c++)
+			fprintf(Log, ",%u,%u", stats.categoryCalls[c], stats.categoryRedundantCalls[c]);
+		fprintf(Log, "\n");
+	}
+	memset(&Frame, 0, sizeof(Frame));
+	FrameIndex++;
+	return stats;
+}
+
+void setGLStatsCounting(bool counting){
+	Counting = counting;
+}
@@ -0,0 +1,51 @@
+#ifndef GLSTATS_HPP
+#define GLSTATS_HPP
+
+// Debug layer over the OpenGL entry points : counts the calls of each frame, the draw calls, and
+// the redundant calls - binding what is already bound, uploading a uniform value it already has,
+// setting an attribute pointer to what it already is. The bindings, uniform values and
+// attribute pointers are shadowed on the CPU to find them.
+//
+// The entry points loaded by GLEW, and the OpenGL 1.1 ones of glintercept.hpp, are replaced by
+// the counting ones in installGLStats(). Layers installed after it must be uninstalled before it.
+//
+// Only the state and the entry points the playground uses are shadowed : calls and draws count the
+// intercepted entry points, not every OpenGL call.
+
+enum GLStatsCategory {
+	GL_STATS_PROGRAM,         // glUseProgram
+	GL_STATS_BUFFER,          // glBindBuffer
+	GL_STATS_VERTEX_ARRAY,    // glBindVertexArray
+	GL_STATS_TEXTURE,         // glActiveTexture, glBindTexture
+	GL_STATS_FRAMEBUFFER,     // glBindFramebuffer
+	GL_STATS_UNIFORM,         // glUniform*
+	GL_STATS_VERTEX_ATTRIB,   // glVertexAttribPointer, glEnable/DisableVertexAttribArray, glVertexAttribDivisor
+	GL_STATS_DRAW,            // glDraw*
+	GL_STATS_CATEGORY_COUNT
+};
+
+struct GLStats {
+	unsigned int calls;
+	unsigned int redundantCalls;
+	unsigned int drawCalls;
+	unsigned int categoryCalls[GL_STATS_CATEGORY_COUNT];
+	unsigned int categoryRedundantCalls[GL_STATS_CATEGORY_COUNT];
+};
+
+// Call after glewInit(), before creating any object : the bindings are read from the context, the rest
+// of the state is assumed to be the default one. logPath, if not NULL, receives one CSV line per frame.
+bool installGLStats(const char * logPath);
+// Puts the original entry points back, and closes the log
+void uninstallGLStats();
+bool glStatsInstalled();
+
+// Ends the frame : its counts are returned, and written to the log
+GLStats glStatsFrame();
+
+// The calls made while counting is off (e.g. the HUD showing the counts) still update the shadowed
+// state, but are not counted
+void setGLStatsCounting(bool counting);
+
+const char * glStatsCategoryName(GLStatsCategory category);
+
+#endif
@@ -0,0 +1,400 @@
+#include <stdio.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "glintercept.hpp"
+#include "gpuresources.hpp"
+
+// One image of a texture : a level of a face, or of all the layers of an array
+struct TextureImage {
+	GLenum face;        // the target of the call : a cube map face, or the texture's target
+	GLint level;
+	GLsizei width, height, depth;
+	size_t bytes;
+};
+
+struct GpuResource {
+	const char * owner;
+	size_t bytes;
+	std::vector<TextureImage> images;   // textures only
+};
+
+static bool Installed = false;
+static const char * CurrentOwner = "Other";
+static std::map<GLuint, GpuResource> Resources[GPU_RESOURCE_TYPE_COUNT];
+static size_t TypeBytes[GPU_RESOURCE_TYPE_COUNT];
+static size_t Budget = 0;
+static bool OverBudget = false;
+
+static const char * TypeNames[GPU_RESOURCE_TYPE_COUNT] = {
+	"buffer", "texture", "renderbuffer", "vertex array", "program"
+};
+
+const char * gpuResourceTypeName(GpuResourceType type){
+	return TypeNames[type];
+}
+
+static size_t totalBytes(){
+	size_t total = 0;
+	for (unsigned int t = 0; t < GPU_RESOURCE_TYPE_COUNT; t++)
+		total += TypeBytes[t];
+	return total;
+}
+
+static void checkBudget(){
+	bool over = Budget != 0 && totalBytes() > Budget;
+	if (over && !OverBudget)
+		printf("GPU memory over budget : %.1f MB for %.1f MB\n", totalBytes() / 1048576.0, Budget / 1048576.0);
+	OverBudget = over;
+}
+
+static void createResources(GpuResourceType type, GLsizei n, const GLuint * ids){
+	for (GLsizei i = 0; i < n; i++){
+		if (ids[i] == 0)
+			continue;
+		GpuResource & resource = Resources[type][ids[i]];
+		resource.owner = CurrentOwner;
+		resource.bytes = 0;
+		resource.images.clear();
+	}
+}
+
+static void deleteResources(GpuResourceType type, GLsizei n, const GLuint * ids){
+	for (GLsizei i = 0; i < n; i++){
+		std::map<GLuint, GpuResource>::iterator it = Resources[type].find(ids[i]);
+		if (it == Resources[type].end())
+			continue;
+		TypeBytes[type] -= it->second.bytes;
+		Resources[type].erase(it);
+	}
+	checkBudget();
+}
+
+// The objects made before installGpuResources() are not tracked
+static GpuResource * findResource(GpuResourceType type, GLuint id){
+	std::map<GLuint, GpuResource>::iterator it = Resources[type].find(id);
+	return it != Resources[type].end() ? &it->second : NULL;
+}
+
+static void setResourceBytes(GpuResourceType type, GpuResource & resource, size_t bytes){
+	TypeBytes[type] += bytes - resource.bytes;
+	resource.bytes = bytes;
+	checkBudget();
+}
+
+static GLuint binding(GLenum bindingQuery){
+	GLint id = 0;
+	glGetIntegerv(bindingQuery, &id);
+	return (GLuint)id;
+}
+
+static GLuint boundBuffer(GLenum target){
+	switch (target){
+	case GL_ARRAY_BUFFER:         return binding(GL_ARRAY_BUFFER_BINDING);
+	case GL_ELEMENT_ARRAY_BUFFER: return binding(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+	case GL_PIXEL_PACK_BUFFER:    return binding(GL_PIXEL_PACK_BUFFER_BINDING);
+	case GL_PIXEL_UNPACK_BUFFER:  return binding(GL_PIXEL_UNPACK_BUFFER_BINDING);
+	case GL_UNIFORM_BUFFER:       return binding(GL_UNIFORM_BUFFER_BINDING);
+	case GL_COPY_READ_BUFFER:     return binding(GL_COPY_READ_BUFFER_BINDING);
+	case GL_COPY_WRITE_BUFFER:    return binding(GL_COPY_WRITE_BUFFER_BINDING);
+	case GL_TEXTURE_BUFFER:       return binding(GL_TEXTURE_BINDING_BUFFER);
+	default:                      return 0;
+	}
+}
+
+static GLuint boundTexture(GLenum target){
+	if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+		target = GL_TEXTURE_CUBE_MAP;
+	switch (target){
+	case GL_TEXTURE_2D:             return binding(GL_TEXTURE_BINDING_2D);
+	case GL_TEXTURE_2D_ARRAY:       return binding(GL_TEXTURE_BINDING_2D_ARRAY);
+	case GL_TEXTURE_3D:             return binding(GL_TEXTURE_BINDING_3D);
+	case GL_TEXTURE_CUBE_MAP:       return binding(GL_TEXTURE_BINDING_CUBE_MAP);
+	case GL_TEXTURE_CUBE_MAP_ARRAY: return binding(GL_TEXTURE_BINDING_CUBE_MAP_ARRAY);
+	case GL_TEXTURE_RECTANGLE:      return binding(GL_TEXTURE_BINDING_RECTANGLE);
+	default:                        return 0;
+	}
+}
+
+// Bytes per texel of the uncompressed formats the tutorials use, 4 for the others
+static size_t texelBytes(GLint internalformat){
+	switch (internalformat){
+	case GL_R8: case GL_RED: case GL_ALPHA: case GL_LUMINANCE:
+		return 1;
+	case GL_RG8: case GL_R16F: case GL_R16UI: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGB: case GL_RGB8: case GL_SRGB8: case GL_DEPTH_COMPONENT24:
+		return 3;
+	case GL_RGBA16F: case GL_RGBA16UI: case GL_RGBA16: case GL_RG32F:
+		return 8;
+	case GL_RGB32F:
+		return 12;
+	case GL_RGBA32F: case GL_RGBA32UI:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+// A new image replaces the one of the same face and level ; a 0x0 one frees it
+static void setTextureImage(GLenum target, GLint level, GLsizei width, GLsizei height, GLsizei depth, size_t bytes){
+	GpuResource * texture = findResource(GPU_RESOURCE_TEXTURE, boundTexture(target));
+	if (texture == NULL)
+		return;
+	TextureImage image = { target, level, width, height, depth, bytes };
+	size_t i = 0;
+	while (i < texture->images.size() && !(texture->images[i].face == target && texture->images[i].level == level))
+		i++;
+	if (i == texture->images.size())
+		texture->images.push_back(image);
+	else
+		texture->images[i] = image;
+	size_t total = 0;
+	for (i = 0; i < texture->images.size(); i++)
+		total += texture->images[i].bytes;
+	setResourceBytes(GPU_RESOURCE_TEXTURE, *texture, total);
+}
+
+// The entry points before installGpuResources(), from GLEW or glintercept.hpp
+#define GPU_RESOURCES_REAL(prefix, name) static decltype(prefix##name) Real##name = NULL;
+#define GPU_RESOURCES_ENTRY_POINTS(X) \
+	X(glIntercept, GenTextures) X(glIntercept, DeleteTextures) X(glIntercept, TexImage2D) \
+	X(__glew, GenBuffers) X(__glew, DeleteBuffers) X(__glew, BufferData) X(__glew, BufferStorage) \
+	X(__glew, TexImage3D) X(__glew, CompressedTexImage2D) X(__glew, CompressedTexImage3D) X(__glew, GenerateMipmap) \
+	X(__glew, GenRenderbuffers) X(__glew, DeleteRenderbuffers) X(__glew, RenderbufferStorage) X(__glew, RenderbufferStorageMultisample) \
+	X(__glew, GenVertexArrays) X(__glew, DeleteVertexArrays) \
+	X(__glew, CreateProgram) X(__glew, DeleteProgram)
+GPU_RESOURCES_ENTRY_POINTS(GPU_RESOURCES_REAL)
+
+static void GLAPIENTRY trackGenTextures(GLsizei n, GLuint * textures){
+	RealGenTextures(n, textures);
+	createResources(GPU_RESOURCE_TEXTURE, n, textures);
+}
+
+static void GLAPIENTRY trackDeleteTextures(GLsizei n, const GLuint * textures){
+	deleteResources(GPU_RESOURCE_TEXTURE, n, textures);
+	RealDeleteTextures(n, textures);
+}
+
+static void GLAPIENTRY trackTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+	GLint border, GLenum format, GLenum type, const void * pixels){
+	RealTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	setTextureImage(target, level, width, height, 1, (size_t)width * height * texelBytes(internalformat));
+}
+
+static void GLAPIENTRY trackTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+	GLint border, GLenum format, GLenum type, const void * pixels){
+	RealTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	setTextureImage(target, level, width, height, depth, (size_t)width * height * depth * texelBytes(internalformat));
+}
+
+static void GLAPIENTRY trackCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+	GLint border, GLsizei imageSize, const void * data){
+	RealCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+	setTextureImage(target, level, width, height, 1, width > 0 && height > 0 ? (size_t)imageSize : 0);
+}
+
+static void GLAPIENTRY trackCompressedTexImage3D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth,
+	GLint border, GLsizei imageSize, const void * data){
+	RealCompressedTexImage3D(target, level, internalformat, width, height, depth, border, imageSize, data);
+	setTextureImage(target, level, width, height, depth, width > 0 && height > 0 && depth > 0 ? (size_t)imageSize : 0);
+}
+
+// The mipmaps of each face, from level 0 down to 1x1, with the bytes per texel of level 0
+static void GLAPIENTRY trackGenerateMipmap(GLenum target){
+	RealGenerateMipmap(target);
+	GpuResource * texture = findResource(GPU_RESOURCE_TEXTURE, boundTexture(target));
+	if (texture == NULL)
+		return;
+	std::vector<TextureImage> bases;
+	for (size_t i = 0; i < texture->images.size(); i++)
+		if (texture->images[i].level == 0 && texture->images[i].width > 0)
+			bases.push_back(texture->images[i]);
+	for (size_t i = 0; i < bases.size(); i++){
+		const TextureImage & base = bases[i];
+		double bytesPerTexel = (double)base.bytes / ((double)base.width * base.height * base.depth);
+		GLsizei width = base.width, height = base.height, depth = base.depth;
+		for (GLint level = 1; width > 1 || height > 1 || (target == GL_TEXTURE_3D && depth > 1); level++){
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+			if (target == GL_TEXTURE_3D)
+				depth = std::max(depth / 2, 1);
+			setTextureImage(base.face, level, width, height, depth, (size_t)(bytesPerTexel * width * height * depth + 0.5));
+		}
+	}
+}
+
+static void GLAPIENTRY trackGenBuffers(GLsizei n, GLuint * buffers){
+	RealGenBuffers(n, buffers);
+	createResources(GPU_RESOURCE_BUFFER, n, buffers);
+}
+
+static void GLAPIENTRY trackDeleteBuffers(GLsizei n, const GLuint * buffers){
+	deleteResources(GPU_RESOURCE_BUFFER, n, buffers);
+	RealDeleteBuffers(n, buffers);
+}
+
+static void GLAPIENTRY trackBufferData(GLenum target, GLsizeiptr size, const void * data, GLenum usage){
+	RealBufferData(target, size, data, usage);
+	GpuResource * buffer = findResource(GPU_RESOURCE_BUFFER, boundBuffer(target));
+	if (buffer != NULL)
+		setResourceBytes(GPU_RESOURCE_BUFFER, *buffer, (size_t)size);
+}
+
+static void GLAPIENTRY trackBufferStorage(GLenum target, GLsizeiptr size, const void * data, GLbitfield flags){
+	RealBufferStorage(target, size, data, flags);
+	GpuResource * buffer = findResource(GPU_RESOURCE_BUFFER, boundBuffer(target));
+	if (buffer != NULL)
+		setResourceBytes(GPU_RESOURCE_BUFFER, *buffer, (size_t)size);
+}
+
+static void GLAPIENTRY trackGenRenderbuffers(GLsizei n, GLuint * renderbuffers){
+	RealGenRenderbuffers(n, renderbuffers);
+	createResources(GPU_RESOURCE_RENDERBUFFER, n, renderbuffers);
+}
+
+static void GLAPIENTRY trackDeleteRenderbuffers(GLsizei n, const GLuint * renderbuffers){
+	deleteResources(GPU_RESOURCE_RENDERBUFFER, n, renderbuffers);
+	RealDeleteRenderbuffers(n, renderbuffers);
+}
+
+static void setRenderbufferBytes(size_t bytes){
+	GpuResource * renderbuffer = findResource(GPU_RESOURCE_RENDERBUFFER, binding(GL_RENDERBUFFER_BINDING));
+	if (renderbuffer != NULL)
+		setResourceBytes(GPU_RESOURCE_RENDERBUFFER, *renderbuffer, bytes);
+}
+
+static void GLAPIENTRY trackRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height){
+	RealRenderbufferStorage(target, internalformat, width, height);
+	setRenderbufferBytes((size_t)width * height * texelBytes(internalformat));
+}
+
+static void GLAPIENTRY trackRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height){
+	RealRenderbufferStorageMultisample(target, samples, internalformat, width, height);
+	setRenderbufferBytes((size_t)width * height * std::max(samples, 1) * texelBytes(internalformat));
+}
+
+static void GLAPIENTRY trackGenVertexArrays(GLsizei n, GLuint * arrays){
+	RealGenVertexArrays(n, arrays);
+	createResources(GPU_RESOURCE_VERTEX_ARRAY, n, arrays);
+}
+
+static void GLAPIENTRY trackDeleteVertexArrays(GLsizei n, const GLuint * arrays){
+	deleteResources(GPU_RESOURCE_VERTEX_ARRAY, n, arrays);
+	RealDeleteVertexArrays(n, arrays);
+}
+
+static GLuint GLAPIENTRY trackCreateProgram(){
+	GLuint program = RealCreateProgram();
+	createResources(GPU_RESOURCE_PROGRAM, 1, &program);
+	return program;
+}
+
+static void GLAPIENTRY trackDeleteProgram(GLuint program){
+	deleteResources(GPU_RESOURCE_PROGRAM, 1, &program);
+	RealDeleteProgram(program);
+}
+
+// Unsupported entry points stay NULL, as the code may test them
+#define GPU_RESOURCES_HOOK(prefix, name) if (prefix##name != NULL){ Real##name = prefix##name; prefix##name = track##name; }
+#define GPU_RESOURCES_UNHOOK(prefix, name) if (Real##name != NULL){ prefix##name = Real##name; Real##name = NULL; }
+
+bool installGpuResources(){
+	if (Installed)
+		return true;
+	GPU_RESOURCES_ENTRY_POINTS(GPU_RESOURCES_HOOK)
+	Installed = true;
+	return true;
+}
+
+void uninstallGpuResources(){
+	if (!Installed)
+		return;
+	GPU_RESOURCES_ENTRY_POINTS(GPU_RESOURCES_UNHOOK)
+	for (unsigned int t = 0; t < GPU_RESOURCE_TYPE_COUNT; t++){
+		Resources[t].clear();
+		TypeBytes[t] = 0;
+	}
+	OverBudget = false;
+	Installed = false;
+}
+
+GpuResourceTotals gpuResourceTotals(){
+	GpuResourceTotals totals;
+	totals.totalCount = 0;
+	for (unsigned int t = 0; t < GPU_RESOURCE_TYPE_COUNT; t++){
+		totals.count[t] = (unsigned int)Resources[t].size();
+		totals.bytes[t] = TypeBytes[t];
+		totals.totalCount += totals.count[t];
+	}
+	totals.totalBytes = totalBytes();
+	return totals;
+}
+
+static bool largerOwner(const GpuResourceOwnerTotal & a, const GpuResourceOwnerTotal & b){
+	return a.bytes != b.bytes ? a.bytes > b.bytes : a.count > b.count;
+}
+
+void gpuResourceOwnerTotals(std::vector<GpuResourceOwnerTotal> & out_owners){
+	// The owners are literals : the same owner has the same pointer, or at least the same text
+	std::map<std::string, GpuResourceOwnerTotal> owners;
+	for (unsigned int t = 0; t < GPU_RESOURCE_TYPE_COUNT; t++){
+		for (std::map<GLuint, GpuResource>::const_iterator it = Resources[t].begin(); it != Resources[t].end(); ++it){
+			GpuResourceOwnerTotal & owner = owners[it->second.owner];
+			owner.owner = it->second.owner;
+			owner.count++;
+			owner.bytes += it->second.bytes;
+		}
+	}
+	out_owners.clear();
+	for (std::map<std::string, GpuResourceOwnerTotal>::const_iterator it = owners.begin(); it != owners.end(); ++it)
+		out_owners.push_back(it->second);
+	std::sort(out_owners.begin(), out_owners.end(), largerOwner);
+}
+
+unsigned int reportGpuResourceLeaks(){
+	std::vector<GpuResourceOwnerTotal> owners;
+	gpuResourceOwnerTotals(owners);
+	GpuResourceTotals totals = gpuResourceTotals();
+	if (totals.totalCount == 0){
+		printf("No OpenGL object leaked\n");
+		return 0;
+	}
+	printf("%u OpenGL objects leaked, %.1f KB :\n", totals.totalCount, totals.totalBytes / 1024.0);
+	for (size_t o = 0; o < owners.size(); o++){
+		printf("  %s : %u objects, %.1f KB\n", owners[o].owner, owners[o].count, owners[o].bytes / 1024.0);
+		for (unsigned int t = 0; t < GPU_RESOURCE_TYPE_COUNT; t++)
+			for (std::map<GLuint, GpuResource>::const_iterator it = Resources[t].begin(); it != Resources[t].end(); ++it)
+				if (std::string(it->second.owner) == owners[o].owner)
+					printf("    %s %u, %lu bytes\n", TypeNames[t], it->first, (unsigned long)it->second.bytes);
+	}
+	return totals.totalCount;
+}
+
+void setGpuMemoryBudget(size_t bytes){
+	Budget = bytes;
+	OverBudget = false;
+	checkBudget();
+}
+
+size_t gpuMemoryBudget(){
+	return Budget;
+}
+
+bool gpuMemoryOverBudget(){
+	return OverBudget;
+}
+
+GpuResourceOwner::GpuResourceOwner(const char * owner){
+	previous = CurrentOwner;
+	CurrentOwner = owner;
+}
+
+GpuResourceOwner::~GpuResourceOwner(){
+	CurrentOwner = previous;
+}
@@ -0,0 +1,61 @@
+#ifndef GPURESOURCES_HPP
+#define GPURESOURCES_HPP
+
+// Registry of the OpenGL objects alive : buffers, textures, renderbuffers, vertex arrays and programs,
+// with an estimate of their memory and the owner that created them. The creation, storage and
+// deletion entry points of GLEW and glintercept.hpp are replaced in installGpuResources(), so that
+// the code creating the objects doesn't change.
+//
+// The bytes are those the application asked for : texel size times texels, compressed sizes,
+// buffer sizes. Drivers add padding, mipmap alignment and their own copies. Programs and vertex
+// arrays are counted, without bytes.
+
+enum GpuResourceType {
+	GPU_RESOURCE_BUFFER,
+	GPU_RESOURCE_TEXTURE,
+	GPU_RESOURCE_RENDERBUFFER,
+	GPU_RESOURCE_VERTEX_ARRAY,
+	GPU_RESOURCE_PROGRAM,
+	GPU_RESOURCE_TYPE_COUNT
+};
+
+struct GpuResourceTotals {
+	unsigned int count[GPU_RESOURCE_TYPE_COUNT];
+	size_t bytes[GPU_RESOURCE_TYPE_COUNT];
+	unsigned int totalCount;
+	size_t totalBytes;
+};
+
+struct GpuResourceOwnerTotal {
+	const char * owner;
+	unsigned int count;
+	size_t bytes;
+};
+
+// Call after glewInit(). The objects made before are not seen. Layers installed after it must be uninstalled before it.
+bool installGpuResources();
+void uninstallGpuResources();
+
+GpuResourceTotals gpuResourceTotals();
+// Largest first
+void gpuResourceOwnerTotals(std::vector<GpuResourceOwnerTotal> & out_owners);
+const char * gpuResourceTypeName(GpuResourceType type);
+
+// Prints every object still alive, by owner : call at shutdown, once everything was deleted.
+// Returns their number.
+unsigned int reportGpuResourceLeaks();
+
+// A warning is printed each time the total goes over the budget. 0 : no budget.
+void setGpuMemoryBudget(size_t bytes);
+size_t gpuMemoryBudget();
+bool gpuMemoryOverBudget();
+
+// The objects created while it exists belong to owner, which must stay valid (a literal).
+// The objects created outside of any scope belong to "Other".
+struct GpuResourceOwner {
+	const char * previous;
+	GpuResourceOwner(const char * owner);
+	~GpuResourceOwner();
+};
+
+#endif
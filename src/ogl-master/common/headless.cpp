@@ -0,0 +1,147 @@
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "headless.hpp"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+static GLuint Framebuffer = 0;
+static GLuint ColorRenderbuffer = 0;
+static GLuint DepthRenderbuffer = 0;
+
+#ifdef HAVE_EGL
+
+static EGLDisplay Display = EGL_NO_DISPLAY;
+static EGLContext Context = EGL_NO_CONTEXT;
+
+// The surfaceless platform needs no display server ; without it, the default display may still work
+static EGLDisplay openDisplay(){
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != NULL){
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display != EGL_NO_DISPLAY)
+			return display;
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+static bool createContext(){
+	Display = openDisplay();
+	EGLint major, minor;
+	if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &major, &minor)){
+		printf("No EGL display\n");
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)){
+		printf("EGL %d.%d can't create OpenGL contexts\n", major, minor);
+		return false;
+	}
+
+	const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint configCount = 0;
+	eglChooseConfig(Display, configAttributes, &config, 1, &configCount);
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	// Surfaceless contexts don't need a config (EGL_KHR_no_config_context)
+	Context = eglCreateContext(Display, configCount > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (Context == EGL_NO_CONTEXT){
+		printf("Failed to create an OpenGL 3.3 core context with EGL (error 0x%x)\n", eglGetError());
+		return false;
+	}
+	if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Context)){
+		printf("Failed to make the context current without surface (error 0x%x)\n", eglGetError());
+		return false;
+	}
+	return true;
+}
+
+static void deleteContext(){
+	if (Display == EGL_NO_DISPLAY)
+		return;
+	eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (Context != EGL_NO_CONTEXT)
+		eglDestroyContext(Display, Context);
+	eglTerminate(Display);
+	Display = EGL_NO_DISPLAY;
+	Context = EGL_NO_CONTEXT;
+}
+
+#else
+
+static bool createContext(){
+	printf("Headless rendering needs EGL, which this build doesn't have\n");
+	return false;
+}
+
+static void deleteContext(){
+}
+
+#endif
+
+bool createHeadlessContext(int width, int height){
+	if (!createContext()){
+		deleteContext();
+		return false;
+	}
+
+	// Initialize GLEW : the framebuffer functions are loaded by it
+	glewExperimental = true; // Needed for core profile
+	if (glewInit() != GLEW_OK){
+		printf("Failed to initialize GLEW\n");
+		deleteContext();
+		return false;
+	}
+	// GLEW queries GL_EXTENSIONS, which is an error in core profile
+	glGetError();
+
+	glGenRenderbuffers(1, &ColorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, ColorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &DepthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, DepthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &Framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRenderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+		printf("The %dx%d headless framebuffer is incomplete\n", width, height);
+		destroyHeadlessContext();
+		return false;
+	}
+	glViewport(0, 0, width, height);
+
+	printf("Headless context : %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+	return true;
+}
+
+void destroyHeadlessContext(){
+	if (Framebuffer != 0){
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &Framebuffer);
+		glDeleteRenderbuffers(1, &ColorRenderbuffer);
+		glDeleteRenderbuffers(1, &DepthRenderbuffer);
+	}
+	Framebuffer = ColorRenderbuffer = DepthRenderbuffer = 0;
+	deleteContext();
+}
+
+GLuint headlessFramebuffer(){
+	return Framebuffer;
+}
@@ -0,0 +1,15 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+// An OpenGL 3.3 core context without any window, for the benchmarks : EGL on Mesa's surfaceless
+// platform (llvmpipe when there is no GPU, so it runs on machines without a display).
+// There is no default framebuffer : the context renders into a framebuffer object of the
+// given size, bound on creation, which stands in for it.
+// Only available when built with EGL (HAVE_EGL), otherwise createHeadlessContext() fails.
+bool createHeadlessContext(int width, int height);
+void destroyHeadlessContext();
+
+// The framebuffer object standing in for the window, 0 without headless context
+GLuint headlessFramebuffer();
+
+#endif
@@ -0,0 +1,118 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "profiler.hpp"
+#include "jobsystem.hpp"
+
+static std::vector<std::thread> workers;
+static std::mutex jobMutex;
+static std::condition_variable jobStarted;
+static std::condition_variable jobFinished;
+static bool stopping = false;
+
+// The parallelFor in progress : a new generation wakes the workers up
+static const std::function<void(unsigned int, unsigned int)> * currentJob = NULL;
+static unsigned int jobCount = 0;
+static unsigned int jobChunkSize = 1;
+static std::atomic<unsigned int> nextChunk(0);
+static unsigned int generation = 0;
+static unsigned int busyWorkers = 0;
+
+// Takes the chunks left until there is none
+static void runChunks(const std::function<void(unsigned int, unsigned int)> & job, unsigned int count, unsigned int chunkSize){
+	for (;;){
+		unsigned int begin = nextChunk.fetch_add(1) * chunkSize;
+		if (begin >= count)
+			return;
+		unsigned int end = count - begin > chunkSize ? begin + chunkSize : count;
+		job(begin, end);
+	}
+}
+
+static void workerLoop(){
+	setProfilerThreadName("Jobs");
+	unsigned int seenGeneration = 0;
+	for (;;){
+		const std::function<void(unsigned int, unsigned int)> * job;
+		unsigned int count, chunkSize;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			while (!stopping && generation == seenGeneration)
+				jobStarted.wait(lock);
+			if (stopping)
+				return;
+			seenGeneration = generation;
+			job = currentJob;
+			count = jobCount;
+			chunkSize = jobChunkSize;
+		}
+
+		{
+			PROFILE_SCOPE("Job");
+			runChunks(*job, count, chunkSize);
+		}
+
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (--busyWorkers == 0)
+			jobFinished.notify_one();
+	}
+}
+
+void startJobSystem(unsigned int threadCount){
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	stopping = false;
+	for (unsigned int i=1; i<threadCount; i++)
+		workers.push_back(std::thread(workerLoop));
+}
+
+void stopJobSystem(){
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobStarted.notify_all();
+	for (unsigned int i=0; i<workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+void parallelFor(unsigned int count, unsigned int chunkSize, const std::function<void(unsigned int, unsigned int)> & job){
+	if (count == 0)
+		return;
+	if (chunkSize == 0)
+		chunkSize = 1;
+	// Not worth waking the workers up. Still chunk by chunk : the jobs may keep results per chunk.
+	if (workers.empty() || count <= chunkSize){
+		for (unsigned int begin = 0; begin < count; begin += chunkSize)
+			job(begin, count - begin > chunkSize ? begin + chunkSize : count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		currentJob = &job;
+		jobCount = count;
+		jobChunkSize = chunkSize;
+		nextChunk = 0;
+		busyWorkers = workers.size();
+		generation++;
+	}
+	jobStarted.notify_all();
+
+	runChunks(job, count, chunkSize);
+
+	// The workers may still be in their last chunk
+	std::unique_lock<std::mutex> lock(jobMutex);
+	while (busyWorkers != 0)
+		jobFinished.wait(lock);
+	currentJob = NULL;
+}
+
+unsigned int jobSystemThreads(){
+	return workers.size() + 1;
+}
@@ -0,0 +1,23 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <functional>
+
+// Data parallel jobs within a frame : parallelFor splits a range in chunks, which the workers and
+// the calling thread take in turn until none is left, and returns when all are done.
+// Unlike the asset loader's jobs, which take many frames, these take a fraction of one.
+
+// threadCount 0 uses one thread less than the hardware has : the calling thread is the last one.
+// Without workers, or before startJobSystem, parallelFor runs everything on the calling thread.
+void startJobSystem(unsigned int threadCount);
+void stopJobSystem();
+
+// Calls job(begin, end) on consecutive chunks of [0, count), of chunkSize items but the last.
+// The chunks run at the same time : job must only write what belongs to its own chunk.
+// One parallelFor at a time, from one thread.
+void parallelFor(unsigned int count, unsigned int chunkSize, const std::function<void(unsigned int, unsigned int)> & job);
+
+// The threads that run the chunks, the calling one included
+unsigned int jobSystemThreads();
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.hpp"
+
+static bool (*Lookup)(const char * path, const unsigned char ** out_data, size_t * out_size) = NULL;
+
+void setMappedFileLookup(bool (*lookup)(const char * path, const unsigned char ** out_data, size_t * out_size)){
+	Lookup = lookup;
+}
+
+#ifdef _WIN32
+
+bool mapFile(const char * path, MappedFile & out_file){
+	out_file.data = NULL;
+	out_file.size = 0;
+	out_file.handle = NULL;
+	out_file.inArchive = false;
+	if (Lookup != NULL && Lookup(path, &out_file.data, &out_file.size)){
+		out_file.inArchive = true;
+		return true;
+	}
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0){
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return false;
+
+	void * data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL){
+		CloseHandle(mapping);
+		return false;
+	}
+
+	out_file.data = (const unsigned char *)data;
+	out_file.size = (size_t)size.QuadPart;
+	out_file.handle = mapping;
+	return true;
+}
+
+void unmapFile(MappedFile & file){
+	if (file.data != NULL && !file.inArchive){
+		UnmapViewOfFile(file.data);
+		CloseHandle((HANDLE)file.handle);
+	}
+	file.data = NULL;
+	file.size = 0;
+	file.handle = NULL;
+	file.inArchive = false;
+}
+
+#else
+
+bool mapFile(const char * path, MappedFile & out_file){
+	out_file.data = NULL;
+	out_file.size = 0;
+	out_file.handle = NULL;
+	out_file.inArchive = false;
+	if (Lookup != NULL && Lookup(path, &out_file.data, &out_file.size)){
+		out_file.inArchive = true;
+		return true;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0){
+		close(fd);
+		return false;
+	}
+
+	// The mapping stays valid once the descriptor is closed
+	void * data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	out_file.data = (const unsigned char *)data;
+	out_file.size = st.st_size;
+	return true;
+}
+
+void unmapFile(MappedFile & file){
+	if (file.data != NULL && !file.inArchive)
+		munmap((void *)file.data, file.size);
+	file.data = NULL;
+	file.size = 0;
+	file.handle = NULL;
+	file.inArchive = false;
+}
+
+#endif
+
+void prefetchMapped(const unsigned char * data, size_t size){
+	const volatile unsigned char * bytes = data;
+	unsigned char sum = 0;
+	for (size_t i = 0; i < size; i += 4096)
+		sum += bytes[i];
+	if (size > 0)
+		sum += bytes[size - 1];
+	(void)sum;
+}
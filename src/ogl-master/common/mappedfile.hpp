@@ -0,0 +1,27 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <stddef.h>
+
+// A whole file mapped read-only in memory : the pages are read by the OS
+// when they are first touched, and nothing is copied in a buffer of ours.
+struct MappedFile {
+	const unsigned char * data;
+	size_t size;
+	void * handle;   // platform specific
+	bool inArchive;  // data points in the open asset archive, which stays mapped
+};
+
+// Looks the path up with the lookup function first, then on the disk
+bool mapFile(const char * path, MappedFile & out_file);
+void unmapFile(MappedFile & file);
+
+// Touches every memory page of the range, so that the OS reads it from the disk now (call it
+// from a worker thread) rather than when the data is used
+void prefetchMapped(const unsigned char * data, size_t size);
+
+// Where mapFile looks for the files before the disk, e.g. findAsset (see assetarchive.hpp).
+// NULL, the default : the disk only. The data found must stay valid while it is mapped.
+void setMappedFileLookup(bool (*lookup)(const char * path, const unsigned char ** out_data, size_t * out_size));
+
+#endif
@@ -0,0 +1,422 @@
+#include <vector>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.hpp"
+#include "mesh.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+unsigned int vertexFormatSize(VertexFormat format){
+	return format == VERTEX_FORMAT_COMPACT ? sizeof(CompactVertex) : sizeof(FloatVertex);
+}
+
+// Quantizes a value in [-1,1] to a normalized short, and back
+static short quantizeSnorm16(float v){
+	v = glm::clamp(v, -1.0f, 1.0f);
+	return (short)floorf(v * 32767.0f + (v >= 0.0f ? 0.5f : -0.5f));
+}
+static float dequantizeSnorm16(short v){
+	return glm::max(v / 32767.0f, -1.0f);
+}
+
+// Quantizes a value in [0,1] to a normalized unsigned short, and back
+static unsigned short quantizeUnorm16(float v){
+	v = glm::clamp(v, 0.0f, 1.0f);
+	return (unsigned short)floorf(v * 65535.0f + 0.5f);
+}
+static float dequantizeUnorm16(unsigned short v){
+	return v / 65535.0f;
+}
+
+static glm::vec2 signNotZero(glm::vec2 v){
+	return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Octahedral normal encoding : project on the octahedron |x|+|y|+|z|=1,
+// then fold the lower hemisphere over the diagonals.
+static glm::vec2 octEncode(glm::vec3 n){
+	n /= (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f)
+		e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+	return e;
+}
+
+// Must match octDecode() in StandardShading.vertexshader
+static glm::vec3 octDecode(glm::vec2 e){
+	glm::vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+	if (n.z < 0.0f){
+		glm::vec2 xy = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+		n.x = xy.x;
+		n.y = xy.y;
+	}
+	return glm::normalize(n);
+}
+
+void buildMeshData(
+	std::vector<unsigned short> & in_indices,
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	VertexFormat format,
+	MeshData & out_mesh,
+	QuantizationError * error
+){
+	unsigned int count = in_vertices.size();
+
+	out_mesh.format = format;
+	out_mesh.vertexCount = count;
+	out_mesh.indices = in_indices;
+	out_mesh.lods.clear();
+	MeshLOD full = { 0, (GLsizei)in_indices.size(), 0.0f };
+	out_mesh.lods.push_back(full);
+	out_mesh.vertexData.resize(count * vertexFormatSize(format));
+	out_mesh.positionScale = glm::vec3(1.0f);
+	out_mesh.positionOffset = glm::vec3(0.0f);
+	out_mesh.uvScale = glm::vec2(1.0f);
+	out_mesh.uvOffset = glm::vec2(0.0f);
+
+	if (error){
+		error->maxPosition = 0.0f;
+		error->maxUV = 0.0f;
+		error->maxNormalDegrees = 0.0f;
+	}
+
+	if (format == VERTEX_FORMAT_FLOAT){
+		FloatVertex * out = (FloatVertex*)&out_mesh.vertexData[0];
+		for (unsigned int i=0; i<count; i++){
+			memcpy(out[i].position, &in_vertices[i][0], sizeof(out[i].position));
+			memcpy(out[i].uv,       &in_uvs[i][0],      sizeof(out[i].uv));
+			memcpy(out[i].normal,   &in_normals[i][0],  sizeof(out[i].normal));
+		}
+		return;
+	}
+
+	if (count == 0)
+		return;
+
+	// Per-mesh bounds, so that the whole 16 bits range is used
+	glm::vec3 minPosition = in_vertices[0], maxPosition = in_vertices[0];
+	glm::vec2 minUV = in_uvs[0], maxUV = in_uvs[0];
+	for (unsigned int i=1; i<count; i++){
+		minPosition = glm::min(minPosition, in_vertices[i]);
+		maxPosition = glm::max(maxPosition, in_vertices[i]);
+		minUV = glm::min(minUV, in_uvs[i]);
+		maxUV = glm::max(maxUV, in_uvs[i]);
+	}
+	out_mesh.positionOffset = (minPosition + maxPosition) * 0.5f;
+	out_mesh.positionScale = glm::max((maxPosition - minPosition) * 0.5f, glm::vec3(1e-8f));
+	out_mesh.uvOffset = minUV;
+	out_mesh.uvScale = glm::max(maxUV - minUV, glm::vec2(1e-8f));
+
+	CompactVertex * out = (CompactVertex*)&out_mesh.vertexData[0];
+	for (unsigned int i=0; i<count; i++){
+		glm::vec3 p = (in_vertices[i] - out_mesh.positionOffset) / out_mesh.positionScale;
+		glm::vec2 uv = (in_uvs[i] - out_mesh.uvOffset) / out_mesh.uvScale;
+		glm::vec2 n = octEncode(in_normals[i]);
+
+		out[i].position[0] = quantizeSnorm16(p.x);
+		out[i].position[1] = quantizeSnorm16(p.y);
+		out[i].position[2] = quantizeSnorm16(p.z);
+		out[i].position[3] = 0;
+		out[i].normal[0] = quantizeSnorm16(n.x);
+		out[i].normal[1] = quantizeSnorm16(n.y);
+		out[i].uv[0] = quantizeUnorm16(uv.x);
+		out[i].uv[1] = quantizeUnorm16(uv.y);
+
+		if (error){
+			glm::vec3 decodedPosition = glm::vec3(
+				dequantizeSnorm16(out[i].position[0]),
+				dequantizeSnorm16(out[i].position[1]),
+				dequantizeSnorm16(out[i].position[2])
+			) * out_mesh.positionScale + out_mesh.positionOffset;
+			glm::vec2 decodedUV = glm::vec2(
+				dequantizeUnorm16(out[i].uv[0]),
+				dequantizeUnorm16(out[i].uv[1])
+			) * out_mesh.uvScale + out_mesh.uvOffset;
+			glm::vec3 decodedNormal = octDecode(glm::vec2(
+				dequantizeSnorm16(out[i].normal[0]),
+				dequantizeSnorm16(out[i].normal[1])
+			));
+
+			float cosAngle = glm::clamp(glm::dot(decodedNormal, glm::normalize(in_normals[i])), -1.0f, 1.0f);
+			error->maxPosition = glm::max(error->maxPosition, glm::length(decodedPosition - in_vertices[i]));
+			error->maxUV = glm::max(error->maxUV, glm::length(decodedUV - in_uvs[i]));
+			error->maxNormalDegrees = glm::max(error->maxNormalDegrees, glm::degrees(acosf(cosAngle)));
+		}
+	}
+}
+
+void printQuantizationError(const char * name, const MeshData & mesh, const QuantizationError & error){
+	printf("%s : %u vertices, %u bytes per vertex (%u bytes), max error : position %g, UV %g, normal %g degrees\n",
+		name, mesh.vertexCount, vertexFormatSize(mesh.format), (unsigned int)mesh.vertexData.size(),
+		error.maxPosition, error.maxUV, error.maxNormalDegrees);
+}
+
+
+struct MeshFileHeader {
+	char magic[4];           // "MESH"
+	unsigned int version;
+	unsigned int format;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	float positionScale[3];
+	float positionOffset[3];
+	float uvScale[2];
+	float uvOffset[2];
+	unsigned int lodCount;   // followed by lodCount MeshLOD
+};
+
+#define MESH_FILE_VERSION 2
+
+bool saveMeshData(const char * path, const MeshData & mesh){
+	FILE * file = fopen(path, "wb");
+	if (file == NULL){
+		printf("Impossible to write %s\n", path);
+		return false;
+	}
+
+	MeshFileHeader header;
+	memcpy(header.magic, "MESH", 4);
+	header.version = MESH_FILE_VERSION;
+	header.format = mesh.format;
+	header.vertexCount = mesh.vertexCount;
+	header.indexCount = mesh.indices.size();
+	memcpy(header.positionScale, &mesh.positionScale[0], sizeof(header.positionScale));
+	memcpy(header.positionOffset, &mesh.positionOffset[0], sizeof(header.positionOffset));
+	memcpy(header.uvScale, &mesh.uvScale[0], sizeof(header.uvScale));
+	memcpy(header.uvOffset, &mesh.uvOffset[0], sizeof(header.uvOffset));
+	header.lodCount = mesh.lods.size();
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (ok && !mesh.lods.empty())
+		ok = fwrite(&mesh.lods[0], mesh.lods.size() * sizeof(MeshLOD), 1, file) == 1;
+	if (ok && !mesh.vertexData.empty())
+		ok = fwrite(&mesh.vertexData[0], mesh.vertexData.size(), 1, file) == 1;
+	if (ok && !mesh.indices.empty())
+		ok = fwrite(&mesh.indices[0], mesh.indices.size() * sizeof(unsigned short), 1, file) == 1;
+	fclose(file);
+
+	if (!ok)
+		printf("Error while writing %s\n", path);
+	return ok;
+}
+
+// Copies size bytes at offset, if the file has them
+static bool readMapped(const MappedFile & file, size_t & offset, void * out, size_t size){
+	if (size > file.size - offset)
+		return false;
+	memcpy(out, file.data + offset, size);
+	offset += size;
+	return true;
+}
+
+bool loadMeshData(const char * path, MeshData & out_mesh){
+	printf("Loading baked mesh %s...\n", path);
+
+	MappedFile file;
+	if (!mapFile(path, file)){
+		printf("%s could not be opened. Are you in the right directory ?\n", path);
+		return false;
+	}
+
+	MeshFileHeader header;
+	size_t offset = 0;
+	if (!readMapped(file, offset, &header, sizeof(header)) || strncmp(header.magic, "MESH", 4) != 0 ||
+		header.version != MESH_FILE_VERSION ||
+		(header.format != VERTEX_FORMAT_FLOAT && header.format != VERTEX_FORMAT_COMPACT)){
+		printf("%s is not a baked mesh, or was baked by another version\n", path);
+		unmapFile(file);
+		return false;
+	}
+
+	// The counts come from the file : check them against its size before allocating anything.
+	// 64 bits products, which 32 bits counts can't overflow.
+	VertexFormat format = (VertexFormat)header.format;
+	unsigned long long expectedSize = sizeof(header) +
+		(unsigned long long)header.lodCount * sizeof(MeshLOD) +
+		(unsigned long long)header.vertexCount * vertexFormatSize(format) +
+		(unsigned long long)header.indexCount * sizeof(unsigned short);
+	if (header.vertexCount > 65536 || header.indexCount % 3 != 0 || header.lodCount == 0 || expectedSize != file.size){
+		printf("%s is truncated or corrupt\n", path);
+		unmapFile(file);
+		return false;
+	}
+
+	out_mesh.format = format;
+	out_mesh.vertexCount = header.vertexCount;
+	out_mesh.vertexData.resize(header.vertexCount * vertexFormatSize(out_mesh.format));
+	out_mesh.indices.resize(header.indexCount);
+	out_mesh.positionScale = glm::vec3(header.positionScale[0], header.positionScale[1], header.positionScale[2]);
+	out_mesh.positionOffset = glm::vec3(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+	out_mesh.uvScale = glm::vec2(header.uvScale[0], header.uvScale[1]);
+	out_mesh.uvOffset = glm::vec2(header.uvOffset[0], header.uvOffset[1]);
+	out_mesh.lods.resize(header.lodCount);
+
+	readMapped(file, offset, &out_mesh.lods[0], out_mesh.lods.size() * sizeof(MeshLOD));
+	if (!out_mesh.vertexData.empty())
+		readMapped(file, offset, &out_mesh.vertexData[0], out_mesh.vertexData.size());
+	if (!out_mesh.indices.empty())
+		readMapped(file, offset, &out_mesh.indices[0], out_mesh.indices.size() * sizeof(unsigned short));
+	unmapFile(file);
+
+	// Every level within the index buffer, every index within the vertices
+	bool ok = true;
+	for (unsigned int i = 0; i < out_mesh.lods.size(); i++){
+		const MeshLOD & lod = out_mesh.lods[i];
+		if (lod.indexOffset < 0 || lod.indexCount < 0 || lod.indexCount % 3 != 0 ||
+			(unsigned int)lod.indexOffset > header.indexCount || (unsigned int)lod.indexCount > header.indexCount - lod.indexOffset)
+			ok = false;
+	}
+	for (unsigned int i = 0; i < out_mesh.indices.size(); i++){
+		if (out_mesh.indices[i] >= header.vertexCount)
+			ok = false;
+	}
+	if (!ok){
+		printf("%s is corrupt\n", path);
+		out_mesh.vertexData.clear();
+		out_mesh.indices.clear();
+		out_mesh.lods.clear();
+	}
+	return ok;
+}
+
+void uploadMesh(const MeshData & mesh, Mesh & out_mesh){
+	glGenBuffers(1, &out_mesh.vertexbuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, out_mesh.vertexbuffer);
+	glBufferData(GL_ARRAY_BUFFER, mesh.vertexData.size(), mesh.vertexData.empty() ? NULL : &mesh.vertexData[0], GL_STATIC_DRAW);
+
+	// Buffers have no type : the indices go through GL_ARRAY_BUFFER too, no vertex array is bound yet
+	glGenBuffers(1, &out_mesh.elementbuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, out_mesh.elementbuffer);
+	glBufferData(GL_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned short), mesh.indices.empty() ? NULL : &mesh.indices[0], GL_STATIC_DRAW);
+
+	setupMeshVertexArray(mesh, out_mesh);
+}
+
+void setupMeshVertexArray(const MeshData & mesh, Mesh & out_mesh){
+	out_mesh.format = mesh.format;
+	out_mesh.indexCount = mesh.indices.size();
+	out_mesh.lods = mesh.lods;
+	out_mesh.positionScale = mesh.positionScale;
+	out_mesh.positionOffset = mesh.positionOffset;
+	out_mesh.uvScale = mesh.uvScale;
+	out_mesh.uvOffset = mesh.uvOffset;
+
+	glGenVertexArrays(1, &out_mesh.vertexArrayID);
+	glBindVertexArray(out_mesh.vertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, out_mesh.vertexbuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out_mesh.elementbuffer);
+
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	if (mesh.format == VERTEX_FORMAT_COMPACT){
+		GLsizei stride = sizeof(CompactVertex);
+		glVertexAttribPointer(0, 3, GL_SHORT,          GL_TRUE, stride, (void*)offsetof(CompactVertex, position));
+		glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, uv));
+		// Only 2 components : the shader decodes the octahedral normal from .xy
+		glVertexAttribPointer(2, 2, GL_SHORT,          GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+	}else{
+		GLsizei stride = sizeof(FloatVertex);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, position));
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, uv));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FloatVertex, normal));
+	}
+}
+
+void deleteMesh(Mesh & mesh){
+	glDeleteBuffers(1, &mesh.vertexbuffer);
+	glDeleteBuffers(1, &mesh.elementbuffer);
+	glDeleteVertexArrays(1, &mesh.vertexArrayID);
+	mesh.vertexbuffer = 0;
+	mesh.elementbuffer = 0;
+	mesh.vertexArrayID = 0;
+	mesh.indexCount = 0;
+	mesh.lods.clear();
+}
+
+MeshUniforms getMeshUniforms(GLuint programID){
+	MeshUniforms uniforms;
+	uniforms.positionScale     = glGetUniformLocation(programID, "PositionScale");
+	uniforms.positionOffset    = glGetUniformLocation(programID, "PositionOffset");
+	uniforms.uvScaleOffset     = glGetUniformLocation(programID, "UVScaleOffset");
+	uniforms.octahedralNormals = glGetUniformLocation(programID, "OctahedralNormals");
+	return uniforms;
+}
+
+static MeshDrawCounters DrawCounters = { 0, 0 };
+
+MeshDrawCounters takeMeshDrawCounters(){
+	MeshDrawCounters counters = DrawCounters;
+	DrawCounters.draws = 0;
+	DrawCounters.triangles = 0;
+	return counters;
+}
+
+static void setMeshUniforms(const Mesh & mesh, const MeshUniforms & uniforms){
+	glUniform3fv(uniforms.positionScale, 1, &mesh.positionScale[0]);
+	glUniform3fv(uniforms.positionOffset, 1, &mesh.positionOffset[0]);
+	glUniform4f(uniforms.uvScaleOffset, mesh.uvScale.x, mesh.uvScale.y, mesh.uvOffset.x, mesh.uvOffset.y);
+	glUniform1i(uniforms.octahedralNormals, mesh.format == VERTEX_FORMAT_COMPACT);
+}
+
+void drawMesh(const Mesh & mesh, const MeshUniforms & uniforms, int lod){
+	setMeshUniforms(mesh, uniforms);
+
+	glBindVertexArray(mesh.vertexArrayID);
+	DrawCounters.draws++;
+	if (mesh.lods.empty()){
+		DrawCounters.triangles += mesh.indexCount / 3;
+		glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, (void*)0);
+		return;
+	}
+	const MeshLOD & level = mesh.lods[glm::clamp(lod, 0, (int)mesh.lods.size() - 1)];
+	DrawCounters.triangles += level.indexCount / 3;
+	glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_SHORT, (void*)(level.indexOffset * sizeof(unsigned short)));
+}
+
+void drawMeshInstanced(const Mesh & mesh, const MeshUniforms & uniforms, int lod, GLsizei instanceCount){
+	setMeshUniforms(mesh, uniforms);
+
+	glBindVertexArray(mesh.vertexArrayID);
+	DrawCounters.draws++;
+	GLsizei indexCount = mesh.indexCount;
+	size_t indexOffset = 0;
+	if (!mesh.lods.empty()){
+		const MeshLOD & level = mesh.lods[glm::clamp(lod, 0, (int)mesh.lods.size() - 1)];
+		indexCount = level.indexCount;
+		indexOffset = level.indexOffset;
+	}
+	DrawCounters.triangles += indexCount / 3 * instanceCount;
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, (void*)(indexOffset * sizeof(unsigned short)), instanceCount);
+}
+
+int selectMeshLOD(const Mesh & mesh, int currentLOD, float pixelsPerUnit, float maxErrorPixels, float hysteresis){
+	int lodCount = mesh.lods.size();
+	if (lodCount <= 1)
+		return 0;
+	currentLOD = glm::clamp(currentLOD, 0, lodCount - 1);
+
+	// Refine while the current level is too coarse
+	int lod = currentLOD;
+	while (lod > 0 && mesh.lods[lod].error * pixelsPerUnit > maxErrorPixels)
+		lod--;
+	if (lod != currentLOD)
+		return lod;
+
+	// Coarsen only with some margin
+	float coarsenThreshold = (1.0f - hysteresis) * maxErrorPixels;
+	while (lod + 1 < lodCount && mesh.lods[lod + 1].error * pixelsPerUnit < coarsenThreshold)
+		lod++;
+	return lod;
+}
@@ -0,0 +1,120 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+// Layout of the vertices stored in a mesh's vertex buffer
+enum VertexFormat {
+	VERTEX_FORMAT_FLOAT   = 0, // vec3 position, vec2 UV, vec3 normal : 32 bytes per vertex
+	VERTEX_FORMAT_COMPACT = 1  // snorm16 position, unorm16 UV, snorm16 octahedral normal : 16 bytes per vertex
+};
+
+struct FloatVertex {
+	float position[3];
+	float uv[2];
+	float normal[3];
+};
+
+struct CompactVertex {
+	short position[4];       // xyz relative to the mesh's positionOffset/positionScale, w unused
+	short normal[2];         // octahedral encoding
+	unsigned short uv[2];    // relative to the mesh's uvOffset/uvScale
+};
+
+// Worst-case difference between the original attributes and the decoded compact ones
+struct QuantizationError {
+	float maxPosition;       // in model units
+	float maxUV;
+	float maxNormalDegrees;
+};
+
+// Level of detail : a range of the index buffer, and the geometric error
+// (in model units) made by drawing it instead of the full mesh
+struct MeshLOD {
+	GLsizei indexOffset;
+	GLsizei indexCount;
+	float error;
+};
+
+// Indexed mesh, ready to be uploaded or baked to disk
+struct MeshData {
+	VertexFormat format;
+	unsigned int vertexCount;
+	std::vector<unsigned char> vertexData;
+	std::vector<unsigned short> indices;
+	std::vector<MeshLOD> lods;       // lods[0] is the full mesh
+	// Dequantization, applied in the vertex shader. Identity for VERTEX_FORMAT_FLOAT.
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	glm::vec2 uvScale;
+	glm::vec2 uvOffset;
+};
+
+// Mesh living on the GPU
+struct Mesh {
+	GLuint vertexArrayID;
+	GLuint vertexbuffer;
+	GLuint elementbuffer;
+	GLsizei indexCount;
+	std::vector<MeshLOD> lods;
+	VertexFormat format;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	glm::vec2 uvScale;
+	glm::vec2 uvOffset;
+};
+
+// Uniform locations used to decode the vertex formats in the shader
+struct MeshUniforms {
+	GLint positionScale;
+	GLint positionOffset;
+	GLint uvScaleOffset;
+	GLint octahedralNormals;
+};
+
+unsigned int vertexFormatSize(VertexFormat format);
+
+// Packs an indexed mesh (as produced by indexVBO) in the given format, with a single LOD.
+// When error is not NULL, it receives the quantization error of the compact format.
+void buildMeshData(
+	std::vector<unsigned short> & in_indices,
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	VertexFormat format,
+	MeshData & out_mesh,
+	QuantizationError * error
+);
+
+void printQuantizationError(const char * name, const MeshData & mesh, const QuantizationError & error);
+
+// Baked meshes : a small header followed by the raw vertex and index data.
+// loadMeshData checks every count and range against the file, false when it is truncated or corrupt.
+bool saveMeshData(const char * path, const MeshData & mesh);
+bool loadMeshData(const char * path, MeshData & out_mesh);
+
+// The vertex array object is left bound
+void uploadMesh(const MeshData & mesh, Mesh & out_mesh);
+// The second half of uploadMesh, when the buffers of out_mesh are already filled (see assetloader.cpp) :
+// creates the vertex array object on them. It is left bound.
+void setupMeshVertexArray(const MeshData & mesh, Mesh & out_mesh);
+void deleteMesh(Mesh & mesh);
+
+MeshUniforms getMeshUniforms(GLuint programID);
+// Binds the mesh, sets its dequantization uniforms and draws the given level of detail
+void drawMesh(const Mesh & mesh, const MeshUniforms & uniforms, int lod = 0);
+// The same, instanceCount times : the per instance attributes are set in the mesh's vertex array by the caller
+void drawMeshInstanced(const Mesh & mesh, const MeshUniforms & uniforms, int lod, GLsizei instanceCount);
+
+// Draws and triangles of drawMesh and drawMeshInstanced since the last call
+struct MeshDrawCounters {
+	unsigned int draws;
+	unsigned int triangles;
+};
+MeshDrawCounters takeMeshDrawCounters();
+
+// Picks the coarsest LOD whose error, projected on screen, stays below maxErrorPixels.
+// pixelsPerUnit is the size on screen of one model unit at the mesh's distance.
+// A LOD is only left for a coarser one once its error drops below
+// (1 - hysteresis) * maxErrorPixels, so that meshes don't flicker between two levels.
+int selectMeshLOD(const Mesh & mesh, int currentLOD, float pixelsPerUnit, float maxErrorPixels, float hysteresis);
+
+#endif
@@ -2,9 +2,11 @@
 #include <stdio.h>
 #include <string>
 #include <cstring>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 
+#include "mappedfile.hpp"
 #include "objloader.hpp"
 
 // Very, VERY simple OBJ loader.
@@ -15,7 +17,6 @@
 // - All attributes should be optional, not "forced"
 // - More stable. Change a line in the OBJ file and it crashes.
 // - More secure. Change another line and you can inject code.
-// - Loading from memory, stream, etc
 
 bool loadOBJ(
 	const char * path, 
@@ -25,49 +26,69 @@ bool loadOBJ(
 ){
 	printf("Loading OBJ file %s...\n", path);
 
+	MappedFile file;
+	if( !mapFile(path, file) ){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		getchar();
+		return false;
+	}
+	bool ok = loadOBJFromMemory((const char *)file.data, file.size, out_vertices, out_uvs, out_normals);
+	unmapFile(file);
+	return ok;
+}
+
+bool loadOBJFromMemory(
+	const char * data,
+	size_t size,
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
 	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
 	std::vector<glm::vec3> temp_vertices; 
 	std::vector<glm::vec2> temp_uvs;
 	std::vector<glm::vec3> temp_normals;
 
+	const char * end = data + size;
+	while( data < end ){
 
-	FILE * file = fopen(path, "r");
-	if( file == NULL ){
-		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
-		getchar();
-		return false;
-	}
-
-	while( 1 ){
+		// copy the line, sscanf needs it null terminated
+		const char * lineEnd = (const char *)memchr(data, '\n', end - data);
+		if (lineEnd == NULL)
+			lineEnd = end;
+		char line[1024];
+		size_t length = std::min((size_t)(lineEnd - data), sizeof(line) - 1);
+		memcpy(line, data, length);
+		line[length] = 0;
+		data = lineEnd + 1;
 
 		char lineHeader[128];
 		// read the first word of the line
-		int res = fscanf(file, "%s", lineHeader);
-		if (res == EOF)
-			break; // EOF = End Of File. Quit the loop.
+		int offset = 0;
+		if (sscanf(line, "%127s%n", lineHeader, &offset) != 1)
+			continue; // empty line
+		const char * rest = line + offset;
 
 		// else : parse lineHeader
 		
 		if ( strcmp( lineHeader, "v" ) == 0 ){
 			glm::vec3 vertex;
-			fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z );
+			sscanf(rest, "%f %f %f", &vertex.x, &vertex.y, &vertex.z );
 			temp_vertices.push_back(vertex);
 		}else if ( strcmp( lineHeader, "vt" ) == 0 ){
 			glm::vec2 uv;
-			fscanf(file, "%f %f\n", &uv.x, &uv.y );
+			sscanf(rest, "%f %f", &uv.x, &uv.y );
 			uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
 			temp_uvs.push_back(uv);
 		}else if ( strcmp( lineHeader, "vn" ) == 0 ){
 			glm::vec3 normal;
-			fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z );
+			sscanf(rest, "%f %f %f", &normal.x, &normal.y, &normal.z );
 			temp_normals.push_back(normal);
 		}else if ( strcmp( lineHeader, "f" ) == 0 ){
-			std::string vertex1, vertex2, vertex3;
 			unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-			int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2] );
+			int matches = sscanf(rest, "%d/%d/%d %d/%d/%d %d/%d/%d", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2] );
 			if (matches != 9){
 				printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-				fclose(file);
 				return false;
 			}
 			vertexIndices.push_back(vertexIndex[0]);
@@ -79,11 +100,8 @@ bool loadOBJ(
 			normalIndices.push_back(normalIndex[0]);
 			normalIndices.push_back(normalIndex[1]);
 			normalIndices.push_back(normalIndex[2]);
-		}else{
-			// Probably a comment, eat up the rest of the line
-			char stupidBuffer[1000];
-			fgets(stupidBuffer, 1000, file);
 		}
+		// else probably a comment : the rest of the line is skipped anyway
 
 	}
 
@@ -106,7 +124,6 @@ bool loadOBJ(
 		out_normals .push_back(normal);
 	
 	}
-	fclose(file);
 	return true;
 }
 
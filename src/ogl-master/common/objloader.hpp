@@ -8,6 +8,15 @@ bool loadOBJ(
 	std::vector<glm::vec3> & out_normals
 );
 
+// Same, from an OBJ file already in memory (e.g. in the asset archive)
+bool loadOBJFromMemory(
+	const char * data,
+	size_t size,
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs, 
+	std::vector<glm::vec3> & out_normals
+);
+
 
 
 bool loadAssImp(
@@ -0,0 +1,400 @@
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <cfloat>
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "shader.hpp"
+#include "profiler.hpp"
+#include "jobsystem.hpp"
+#include "streambuffer.hpp"
+#include "randomhash.hpp"
+#include "particles.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+// The particles of one job, a multiple of 4 for SSE2
+#define PARTICLES_CHUNK 16384
+// The instances of the last PARTICLES_SECTIONS frames stay in the buffer until the GPU read them
+#define PARTICLES_SECTIONS 3
+#define PARTICLES_PI 3.14159265358979f
+
+// One instance : the 4 vertices of the billboard are made by the vertex shader
+struct ParticleInstance {
+	float position[3];
+	float size;
+	unsigned char color[4];
+};
+
+bool initParticleSystem(unsigned int capacity, bool additive, ParticleSystem & out_system){
+	if (capacity > PARTICLES_MAX_COUNT)
+		capacity = PARTICLES_MAX_COUNT;
+	out_system.capacity = capacity;
+	out_system.count = 0;
+	out_system.random = 1;
+	out_system.radialAcceleration = 0.0f;
+	out_system.drag = 0.0f;
+	out_system.fadeSeconds = 1.0f;
+	out_system.additive = additive;
+
+	std::vector<float> * floats[] = { &out_system.positionX, &out_system.positionY, &out_system.positionZ,
+		&out_system.velocityX, &out_system.velocityY, &out_system.velocityZ, &out_system.life, &out_system.size, &out_system.depth };
+	for (unsigned int i = 0; i < sizeof(floats) / sizeof(floats[0]); i++)
+		floats[i]->resize(capacity);
+	out_system.color.resize(capacity);
+	out_system.keys.resize(capacity);
+	out_system.order.resize(capacity);
+	out_system.sortScratch.resize(capacity);
+	out_system.keysScratch.resize(capacity);
+
+	// Initialize Shader
+	out_system.programID = LoadShaders( "Particle.vertexshader", "Particle.fragmentshader" );
+	if (out_system.programID == 0)
+		return false;
+
+	// Initialize uniforms' IDs
+	out_system.ViewProjectionID = glGetUniformLocation( out_system.programID, "VP" );
+	out_system.CameraRightID = glGetUniformLocation( out_system.programID, "CameraRight_worldspace" );
+	out_system.CameraUpID = glGetUniformLocation( out_system.programID, "CameraUp_worldspace" );
+
+	// Initialize VAO : one instance per particle, no vertex attribute
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glGenVertexArrays(1, &out_system.vertexArrayID);
+	glBindVertexArray(out_system.vertexArrayID);
+	createStreamBuffer(GL_ARRAY_BUFFER, (capacity > 0 ? capacity : 1) * sizeof(ParticleInstance), PARTICLES_SECTIONS, out_system.instances);
+	for (GLuint i = 0; i < 2; i++){
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	glBindVertexArray(previousVertexArrayID);
+	return true;
+}
+
+void deleteParticleSystem(ParticleSystem & system){
+	deleteStreamBuffer(system.instances);
+	glDeleteVertexArrays(1, &system.vertexArrayID);
+	glDeleteProgram(system.programID);
+	system.count = 0;
+}
+
+void emitParticles(ParticleSystem & system, ParticleEmitter & emitter, float seconds){
+	float emitted = emitter.pending + emitter.rate * seconds;
+	unsigned int newCount = (unsigned int)emitted;
+	emitter.pending = emitted - newCount;
+	if (newCount > system.capacity - system.count)
+		newCount = system.capacity - system.count;
+
+	unsigned char color[4];
+	for (int c = 0; c < 4; c++)
+		color[c] = (unsigned char)(glm::clamp(emitter.color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+	unsigned int packedColor;
+	memcpy(&packedColor, color, 4);
+
+	for (unsigned int n = 0; n < newCount; n++){
+		unsigned int i = system.count++;
+		unsigned int state = system.random = hashRandom(system.random, i);
+
+		// Uniform on the sphere
+		float z = 2.0f * randomUnit(state) - 1.0f;
+		float angle = 2.0f * PARTICLES_PI * randomUnit(state);
+		float r = sqrtf(1.0f - z * z);
+		glm::vec3 direction(r * cosf(angle), r * sinf(angle), z);
+
+		glm::vec3 position = emitter.position + emitter.radius * direction;
+		glm::vec3 velocity = emitter.velocity + emitter.speed * direction;
+		system.positionX[i] = position.x;
+		system.positionY[i] = position.y;
+		system.positionZ[i] = position.z;
+		system.velocityX[i] = velocity.x;
+		system.velocityY[i] = velocity.y;
+		system.velocityZ[i] = velocity.z;
+		system.life[i] = emitter.life * (0.5f + 0.5f * randomUnit(state));
+		system.size[i] = emitter.size * (0.5f + 0.5f * randomUnit(state));
+		system.color[i] = packedColor;
+	}
+}
+
+// Semi-implicit Euler on [begin, end) : the velocity first, then the position with the new velocity
+static void integrateParticles(ParticleSystem & system, unsigned int begin, unsigned int end, float seconds){
+	float * px = &system.positionX[0], * py = &system.positionY[0], * pz = &system.positionZ[0];
+	float * vx = &system.velocityX[0], * vy = &system.velocityY[0], * vz = &system.velocityZ[0];
+	float * life = &system.life[0];
+	float radial = system.radialAcceleration * seconds;
+	float damping = 1.0f / (1.0f + system.drag * seconds);
+	unsigned int i = begin;
+#ifdef PARTICLES_SSE2
+	__m128 radial4 = _mm_set1_ps(radial);
+	__m128 damping4 = _mm_set1_ps(damping);
+	__m128 seconds4 = _mm_set1_ps(seconds);
+	__m128 nearest4 = _mm_set1_ps(1e-6f);
+	for (; i + 4 <= end; i += 4){
+		__m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+		__m128 distanceSquared = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), nearest4);
+		// The direction from the origin divided by the distance squared : position / distance^3
+		__m128 s = _mm_div_ps(radial4, _mm_mul_ps(distanceSquared, _mm_sqrt_ps(distanceSquared)));
+		__m128 u = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), _mm_mul_ps(x, s)), damping4);
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), _mm_mul_ps(y, s)), damping4);
+		__m128 w = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vz + i), _mm_mul_ps(z, s)), damping4);
+		_mm_storeu_ps(vx + i, u);
+		_mm_storeu_ps(vy + i, v);
+		_mm_storeu_ps(vz + i, w);
+		_mm_storeu_ps(px + i, _mm_add_ps(x, _mm_mul_ps(u, seconds4)));
+		_mm_storeu_ps(py + i, _mm_add_ps(y, _mm_mul_ps(v, seconds4)));
+		_mm_storeu_ps(pz + i, _mm_add_ps(z, _mm_mul_ps(w, seconds4)));
+		_mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), seconds4));
+	}
+#endif
+	for (; i < end; i++){
+		float distanceSquared = glm::max(px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i], 1e-6f);
+		float s = radial / (distanceSquared * sqrtf(distanceSquared));
+		vx[i] = (vx[i] + px[i] * s) * damping;
+		vy[i] = (vy[i] + py[i] * s) * damping;
+		vz[i] = (vz[i] + pz[i] * s) * damping;
+		px[i] += vx[i] * seconds;
+		py[i] += vy[i] * seconds;
+		pz[i] += vz[i] * seconds;
+		life[i] -= seconds;
+	}
+}
+
+static void moveParticle(ParticleSystem & system, unsigned int from, unsigned int to){
+	system.positionX[to] = system.positionX[from];
+	system.positionY[to] = system.positionY[from];
+	system.positionZ[to] = system.positionZ[from];
+	system.velocityX[to] = system.velocityX[from];
+	system.velocityY[to] = system.velocityY[from];
+	system.velocityZ[to] = system.velocityZ[from];
+	system.life[to] = system.life[from];
+	system.size[to] = system.size[from];
+	system.color[to] = system.color[from];
+}
+
+void updateParticleSystem(ParticleSystem & system, float seconds){
+	if (seconds != 0.0f){
+		PROFILE_SCOPE("Integrate particles");
+		parallelFor(system.count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+			integrateParticles(system, begin, end, seconds);
+		});
+	}
+
+	// In each chunk, the last live particle takes the place of each dead one, which is checked again
+	PROFILE_SCOPE("Remove particles");
+	unsigned int count = system.count;
+	unsigned int chunks = (count + PARTICLES_CHUNK - 1) / PARTICLES_CHUNK;
+	std::vector<unsigned int> chunkLive(chunks);
+	parallelFor(count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+		unsigned int i = begin;
+		while (i < end){
+			if (system.life[i] > 0.0f)
+				i++;
+			else
+				moveParticle(system, --end, i);
+		}
+		chunkLive[begin / PARTICLES_CHUNK] = end - begin;
+	});
+
+	// Then the live particles past the new count fill the holes before it, the last ones first.
+	// Only the dead particles are visited.
+	unsigned int live = 0;
+	for (unsigned int c = 0; c < chunks; c++)
+		live += chunkLive[c];
+	unsigned int source = count;
+	for (unsigned int c = 0; c < chunks && c * PARTICLES_CHUNK < live; c++){
+		unsigned int end = glm::min((c + 1) * PARTICLES_CHUNK, live);
+		for (unsigned int hole = c * PARTICLES_CHUNK + chunkLive[c]; hole < end; hole++){
+			do
+				source--;
+			while (source % PARTICLES_CHUNK >= chunkLive[source / PARTICLES_CHUNK]);
+			moveParticle(system, source, hole);
+		}
+	}
+	system.count = live;
+}
+
+// One pass of counting sort on the byte at shift of keys[j], the key of particle in[j] (of j when in is NULL).
+// The particles go to out, their keys to outKeys unless it is NULL. Each chunk counts its own bytes,
+// then scatters to the offsets the chunks before it left free : the result is the same as on one thread.
+static void radixPass(const unsigned short * keys, const unsigned int * in, unsigned short * outKeys, unsigned int * out,
+	unsigned int count, unsigned int shift){
+	unsigned int chunks = (count + PARTICLES_CHUNK - 1) / PARTICLES_CHUNK;
+	std::vector<unsigned int> offsets(chunks * 256, 0);
+	parallelFor(count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+		unsigned int * histogram = &offsets[begin / PARTICLES_CHUNK * 256];
+		for (unsigned int j = begin; j < end; j++)
+			histogram[(keys[j] >> shift) & 0xFF]++;
+	});
+
+	// A byte of a chunk goes after the smaller bytes, and after the same byte in the chunks before
+	unsigned int offset = 0;
+	for (unsigned int b = 0; b < 256; b++){
+		for (unsigned int c = 0; c < chunks; c++){
+			unsigned int n = offsets[c * 256 + b];
+			offsets[c * 256 + b] = offset;
+			offset += n;
+		}
+	}
+
+	parallelFor(count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+		unsigned int * histogram = &offsets[begin / PARTICLES_CHUNK * 256];
+		for (unsigned int j = begin; j < end; j++){
+			unsigned int position = histogram[(keys[j] >> shift) & 0xFF]++;
+			out[position] = in != NULL ? in[j] : j;
+			if (outKeys != NULL)
+				outKeys[position] = keys[j];
+		}
+	});
+}
+
+// system.order : the live particles, the farthest from the camera first
+static void sortParticles(ParticleSystem & system, glm::vec3 camera, glm::vec3 forward){
+	unsigned int count = system.count;
+	unsigned int chunks = (count + PARTICLES_CHUNK - 1) / PARTICLES_CHUNK;
+
+	// The depths, and their range in each chunk
+	std::vector<float> chunkNearest(chunks), chunkFarthest(chunks);
+	parallelFor(count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+		const float * px = &system.positionX[0], * py = &system.positionY[0], * pz = &system.positionZ[0];
+		float * depth = &system.depth[0];
+		float nearest = FLT_MAX, farthest = -FLT_MAX;
+		for (unsigned int i = begin; i < end; i++){
+			depth[i] = (px[i] - camera.x) * forward.x + (py[i] - camera.y) * forward.y + (pz[i] - camera.z) * forward.z;
+			nearest = glm::min(nearest, depth[i]);
+			farthest = glm::max(farthest, depth[i]);
+		}
+		chunkNearest[begin / PARTICLES_CHUNK] = nearest;
+		chunkFarthest[begin / PARTICLES_CHUNK] = farthest;
+	});
+	float nearest = FLT_MAX, farthest = -FLT_MAX;
+	for (unsigned int c = 0; c < chunks; c++){
+		nearest = glm::min(nearest, chunkNearest[c]);
+		farthest = glm::max(farthest, chunkFarthest[c]);
+	}
+
+	// 16 bits keys over that range, 0 for the farthest
+	float scale = farthest > nearest ? 65535.0f / (farthest - nearest) : 0.0f;
+	parallelFor(count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+		for (unsigned int i = begin; i < end; i++)
+			system.keys[i] = (unsigned short)((farthest - system.depth[i]) * scale);
+	});
+
+	// Two passes of counting sort, the low byte then the high one. Each pass keeps the order of the
+	// previous one for equal bytes, so the particles end up sorted on the whole key.
+	if (jobSystemThreads() > 1){
+		radixPass(&system.keys[0], NULL, &system.keysScratch[0], &system.sortScratch[0], count, 0);
+		radixPass(&system.keysScratch[0], &system.sortScratch[0], NULL, &system.order[0], count, 8);
+		return;
+	}
+
+	// Alone, count both bytes at once : the histograms of the chunks would only cost a pass more
+	unsigned int histograms[2][256] = {};
+	for (unsigned int i = 0; i < count; i++){
+		histograms[0][system.keys[i] & 0xFF]++;
+		histograms[1][system.keys[i] >> 8]++;
+	}
+	for (int pass = 0; pass < 2; pass++){
+		unsigned int offset = 0;
+		for (int b = 0; b < 256; b++){
+			unsigned int n = histograms[pass][b];
+			histograms[pass][b] = offset;
+			offset += n;
+		}
+	}
+	for (unsigned int i = 0; i < count; i++)
+		system.sortScratch[histograms[0][system.keys[i] & 0xFF]++] = i;
+	for (unsigned int i = 0; i < count; i++){
+		unsigned int particle = system.sortScratch[i];
+		system.order[histograms[1][system.keys[particle] >> 8]++] = particle;
+	}
+}
+
+static inline void writeInstance(const ParticleSystem & system, unsigned int i, float fade, ParticleInstance & instance){
+	instance.position[0] = system.positionX[i];
+	instance.position[1] = system.positionY[i];
+	instance.position[2] = system.positionZ[i];
+	instance.size = system.size[i];
+	memcpy(instance.color, &system.color[i], 4);
+	instance.color[3] = (unsigned char)(instance.color[3] * glm::min(system.life[i] * fade, 1.0f));
+}
+
+unsigned int drawParticleSystem(ParticleSystem & system, const glm::mat4 & ViewMatrix, const glm::mat4 & ProjectionMatrix){
+	unsigned int count = system.count;
+	if (count == 0)
+		return 0;
+
+	// The camera's axes are the rows of the view matrix
+	glm::vec3 right(ViewMatrix[0][0], ViewMatrix[1][0], ViewMatrix[2][0]);
+	glm::vec3 up(ViewMatrix[0][1], ViewMatrix[1][1], ViewMatrix[2][1]);
+	glm::vec3 forward(-ViewMatrix[0][2], -ViewMatrix[1][2], -ViewMatrix[2][2]);
+	glm::vec3 camera = -glm::transpose(glm::mat3(ViewMatrix)) * glm::vec3(ViewMatrix[3]);
+
+	if (!system.additive){
+		PROFILE_SCOPE("Sort particles");
+		sortParticles(system, camera, forward);
+	}
+
+	// All the instances at once in this frame's section, each job writes its own
+	ParticleInstance * instances = (ParticleInstance *)writeStreamBuffer(system.instances, count * sizeof(ParticleInstance));
+	if (instances == NULL)
+		return 0;
+	{
+	PROFILE_SCOPE("Write particles");
+	parallelFor(count, PARTICLES_CHUNK, [&](unsigned int begin, unsigned int end){
+		float fade = system.fadeSeconds > 0.0f ? 1.0f / system.fadeSeconds : FLT_MAX;
+		// The additive particles in their own order : the arrays are read straight through
+		if (system.additive){
+			for (unsigned int j = begin; j < end; j++)
+				writeInstance(system, j, fade, instances[j]);
+		}else{
+			for (unsigned int j = begin; j < end; j++)
+				writeInstance(system, system.order[j], fade, instances[j]);
+		}
+	});
+	}
+	size_t offset;
+	commitStreamBuffer(system.instances, offset);
+
+	// Bind shader
+	glm::mat4 ViewProjection = ProjectionMatrix * ViewMatrix;
+	glUseProgram(system.programID);
+	glUniformMatrix4fv(system.ViewProjectionID, 1, GL_FALSE, &ViewProjection[0][0]);
+	glUniform3f(system.CameraRightID, right.x, right.y, right.z);
+	glUniform3f(system.CameraUpID, up.x, up.y, up.z);
+
+	// Our own vertex array, the caller's is bound back at the end. The attributes start at this
+	// frame's first instance (see commitStreamBuffer).
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glBindVertexArray(system.vertexArrayID);
+	glBindBuffer(GL_ARRAY_BUFFER, system.instances.buffer);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(offset + offsetof(ParticleInstance, position)) );
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (void*)(offset + offsetof(ParticleInstance, color)) );
+
+	// Tested against the scene, but not in front of each other
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, system.additive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+
+	// Draw call
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+
+	glBindVertexArray(previousVertexArrayID);
+
+	// The next frame writes in the next section, once the GPU is done with it
+	nextStreamBufferSection(system.instances);
+	return count;
+}
@@ -0,0 +1,76 @@
+#ifndef PARTICLES_HPP
+#define PARTICLES_HPP
+
+// Particle systems, for many more particles than tutorial 18 :
+// - the particles are a structure of arrays, the live ones first : the update goes through
+//   contiguous floats, 4 particles at a time with SSE2, in chunks across the job system
+// - a particle that dies takes the place of the last live one, the new ones go after it :
+//   no search for a free slot, and nothing to skip afterwards
+// - only the live particles are sorted, back to front, by a radix sort of their depth quantized
+//   to 16 bits, then drawn as billboards facing the camera with a single instanced draw call
+
+#define PARTICLES_MAX_COUNT (1 << 20)
+
+// Where and how fast the new particles go. Each starts on the sphere of radius around position,
+// at velocity plus speed away from the center, and lives between half of life and life.
+struct ParticleEmitter {
+	glm::vec3 position;
+	float radius;
+	glm::vec3 velocity;
+	float speed;
+	float rate;          // particles per second
+	float life;          // in seconds
+	float size;          // width of the billboards, in world units, between half of it and all of it
+	glm::vec4 color;
+	float pending;       // the fraction of a particle left from the last emitParticles
+};
+
+struct ParticleSystem {
+	// The live particles are the first count of each array
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> velocityX, velocityY, velocityZ;
+	std::vector<float> life;                 // seconds left
+	std::vector<float> size;
+	std::vector<unsigned int> color;         // RGBA8
+	unsigned int count;
+	unsigned int capacity;
+	unsigned int random;                     // state of the emitters' random numbers
+
+	// The forces : radialAcceleration / distance^2 away from the origin (towards it when negative),
+	// as the Sun's wind or its gravity, and a drag which slows the particles by drag per second
+	float radialAcceleration;
+	float drag;
+	// The particles fade out in their last fadeSeconds
+	float fadeSeconds;
+	// Added to the scene in any order, as light ; otherwise blended back to front, as smoke
+	bool additive;
+
+	// The sort : depth and key of each live particle, and the particles back to front
+	std::vector<float> depth;
+	std::vector<unsigned short> keys;
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> sortScratch;   // the particles after the first pass
+	std::vector<unsigned short> keysScratch; // and their keys
+
+	StreamBuffer instances;
+	GLuint vertexArrayID;
+	GLuint programID;
+	GLuint ViewProjectionID;
+	GLuint CameraRightID;
+	GLuint CameraUpID;
+};
+
+// Room for capacity particles, up to PARTICLES_MAX_COUNT. false when the shader could not be loaded.
+bool initParticleSystem(unsigned int capacity, bool additive, ParticleSystem & out_system);
+void deleteParticleSystem(ParticleSystem & system);
+
+// Emits the particles of seconds at the emitter's rate, as long as there is room
+void emitParticles(ParticleSystem & system, ParticleEmitter & emitter, float seconds);
+
+// Advances the live particles by seconds, then removes the dead ones
+void updateParticleSystem(ParticleSystem & system, float seconds);
+
+// Draws the live particles, without writing the depth. Returns the number of particles drawn.
+unsigned int drawParticleSystem(ParticleSystem & system, const glm::mat4 & ViewMatrix, const glm::mat4 & ProjectionMatrix);
+
+#endif
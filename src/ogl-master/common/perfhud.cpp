@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+using namespace glm;
+
+#include "shader.hpp"
+#include "text2D.hpp"
+#include "perfhud.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+// The graph, in the 800x600 space : one unit per frame, the top at PERF_HUD_GRAPH_MILLISECONDS
+#define PERF_HUD_GRAPH_WIDTH 240
+#define PERF_HUD_GRAPH_HEIGHT 60
+#define PERF_HUD_GRAPH_MILLISECONDS 33.3f
+// The 60 Hz frame time, drawn across the graph
+#define PERF_HUD_TARGET_MILLISECONDS 16.7f
+// A frame is a spike when it takes more than PERF_HUD_SPIKE times the median of the graph
+#define PERF_HUD_SPIKE 1.5f
+
+PerfHUDFrame PerfHUDFrames[PERF_HUD_FRAMES];
+unsigned int PerfHUDFrameCount;     // recorded since the start, the last PERF_HUD_FRAMES are kept
+
+// Timestamps at the beginning and at the end of the last PERF_HUD_GPU_LATENCY frames
+GLuint PerfHUDQueries[PERF_HUD_GPU_LATENCY][2];
+float PerfHUDGpuMilliseconds;
+std::chrono::steady_clock::time_point PerfHUDFrameStart;
+
+unsigned int PerfHUDVertexArrayID;
+unsigned int PerfHUDShaderID;
+unsigned int PerfHUDGraphRectID;
+unsigned int PerfHUDOldestID;
+unsigned int PerfHUDSpikeID;
+// The uniform array is a ring like PerfHUDFrames : element i holds the frames whose number is i
+// modulo PERF_HUD_FRAMES, and the frames before PerfHUDUploadedFrames are already there
+GLint PerfHUDBarIDs[PERF_HUD_FRAMES];
+unsigned int PerfHUDUploadedFrames;
+
+// The text, and the spike threshold, as of the last time they were formatted
+char PerfHUDLines[4][64];
+unsigned int PerfHUDTextFrame;
+
+void initPerfHUD(){
+
+	PerfHUDFrameCount = 0;
+	PerfHUDUploadedFrames = 0;
+	PerfHUDTextFrame = 0;
+	PerfHUDGpuMilliseconds = 0.0f;
+	glGenQueries(2 * PERF_HUD_GPU_LATENCY, &PerfHUDQueries[0][0]);
+
+	// Initialize VAO : empty, the graph is a quad whose fragments read their bar's time in a uniform array.
+	// A few floats of uniforms per frame don't make the CPU wait for the GPU as a buffer written every frame can.
+	glGenVertexArrays(1, &PerfHUDVertexArrayID);
+
+	// Initialize Shader
+	PerfHUDShaderID = LoadShaders( "PerfGraph.vertexshader", "PerfGraph.fragmentshader" );
+
+	// Initialize uniforms' IDs
+	PerfHUDGraphRectID = glGetUniformLocation( PerfHUDShaderID, "GraphRect" );
+	PerfHUDOldestID = glGetUniformLocation( PerfHUDShaderID, "Oldest" );
+	PerfHUDSpikeID = glGetUniformLocation( PerfHUDShaderID, "SpikeMilliseconds" );
+	// OpenGL 3.3 doesn't promise that the elements of an array have consecutive locations
+	for (unsigned int i = 0; i < PERF_HUD_FRAMES; i++){
+		char name[32];
+		sprintf(name, "Bars[%u]", i);
+		PerfHUDBarIDs[i] = glGetUniformLocation( PerfHUDShaderID, name );
+	}
+
+	// The scale of the graph, once
+	GLint previousProgramID;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgramID);
+	glUseProgram(PerfHUDShaderID);
+	glUniform1f(glGetUniformLocation( PerfHUDShaderID, "GraphMilliseconds" ), PERF_HUD_GRAPH_MILLISECONDS);
+	glUniform1f(glGetUniformLocation( PerfHUDShaderID, "TargetMilliseconds" ), PERF_HUD_TARGET_MILLISECONDS);
+	glUniform1i(glGetUniformLocation( PerfHUDShaderID, "BarCount" ), PERF_HUD_FRAMES);
+	glUseProgram(previousProgramID);
+}
+
+void cleanupPerfHUD(){
+	glDeleteQueries(2 * PERF_HUD_GPU_LATENCY, &PerfHUDQueries[0][0]);
+	glDeleteVertexArrays(1, &PerfHUDVertexArrayID);
+	glDeleteProgram(PerfHUDShaderID);
+}
+
+void beginPerfHUDFrame(){
+	PerfHUDFrameStart = std::chrono::steady_clock::now();
+
+	// The oldest timestamps are reused for this frame : they are read first.
+	// PERF_HUD_GPU_LATENCY frames later, they are normally there without waiting.
+	GLuint * queries = PerfHUDQueries[PerfHUDFrameCount % PERF_HUD_GPU_LATENCY];
+	if (PerfHUDFrameCount >= PERF_HUD_GPU_LATENCY){
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+		PerfHUDGpuMilliseconds = (float)((end - start) / 1e6);
+	}
+	glQueryCounter(queries[0], GL_TIMESTAMP);
+}
+
+void endPerfHUDFrame(PerfHUDFrame & frame){
+	glQueryCounter(PerfHUDQueries[PerfHUDFrameCount % PERF_HUD_GPU_LATENCY][1], GL_TIMESTAMP);
+
+	frame.cpuMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - PerfHUDFrameStart).count();
+	frame.gpuMilliseconds = PerfHUDGpuMilliseconds;
+	PerfHUDFrames[PerfHUDFrameCount % PERF_HUD_FRAMES] = frame;
+	PerfHUDFrameCount++;
+}
+
+// The median and the slowest of the frames of the graph, and the counters of the last frame
+static void formatPerfHUDText(float & out_median){
+	unsigned int count = std::min(PerfHUDFrameCount, (unsigned int)PERF_HUD_FRAMES);
+	float times[PERF_HUD_FRAMES];
+	for (unsigned int i = 0; i < count; i++)
+		times[i] = PerfHUDFrames[i].cpuMilliseconds;
+	float slowest = *std::max_element(times, times + count);
+	std::nth_element(times, times + count / 2, times + count);
+	out_median = times[count / 2];
+
+	const PerfHUDFrame & last = PerfHUDFrames[(PerfHUDFrameCount - 1) % PERF_HUD_FRAMES];
+	sprintf(PerfHUDLines[0], "median %5.2f max %5.2f", out_median, slowest);
+	sprintf(PerfHUDLines[1], "bodies %u/%u up %6.1f KB", last.visibleBodies, last.totalBodies, last.uploadedBytes / 1024.0);
+	sprintf(PerfHUDLines[2], "draws %u tris %u", last.drawCalls, last.triangles);
+	sprintf(PerfHUDLines[3], "CPU %5.2f GPU %5.2f ms", last.cpuMilliseconds, last.gpuMilliseconds);
+}
+
+void drawPerfHUD(int x, int y){
+	if (PerfHUDFrameCount == 0)
+		return;
+	glUseProgram(PerfHUDShaderID);
+
+	// The text above the graph, formatted again every PERF_HUD_TEXT_FRAMES frames
+	if (PerfHUDTextFrame == 0 || PerfHUDFrameCount - PerfHUDTextFrame >= PERF_HUD_TEXT_FRAMES){
+		float median;
+		formatPerfHUDText(median);
+		glUniform1f(PerfHUDSpikeID, PERF_HUD_SPIKE * median);
+		PerfHUDTextFrame = PerfHUDFrameCount;
+	}
+	int textY = y + PERF_HUD_GRAPH_HEIGHT + 4;
+	for (unsigned int i = 0; i < 4; i++)
+		addText2D(PerfHUDLines[i], x, textY + 14 * i, 12);
+
+	// The times of the frames recorded since the last draw, at most a whole ring, in at most
+	// two runs of consecutive elements. The elements never written are 0 : empty bars.
+	unsigned int frame = std::max(PerfHUDUploadedFrames, PerfHUDFrameCount - std::min(PerfHUDFrameCount, (unsigned int)PERF_HUD_FRAMES));
+	while (frame < PerfHUDFrameCount){
+		unsigned int slot = frame % PERF_HUD_FRAMES;
+		unsigned int run = std::min(PerfHUDFrameCount - frame, PERF_HUD_FRAMES - slot);
+		float bars[PERF_HUD_FRAMES];
+		for (unsigned int i = 0; i < run; i++)
+			bars[i] = PerfHUDFrames[slot + i].cpuMilliseconds;
+		glUniform1fv(PerfHUDBarIDs[slot], run, bars);
+		frame += run;
+	}
+	PerfHUDUploadedFrames = PerfHUDFrameCount;
+	glUniform1i(PerfHUDOldestID, PerfHUDFrameCount % PERF_HUD_FRAMES);
+	glUniform4f(PerfHUDGraphRectID, (float)x, (float)y, (float)PERF_HUD_GRAPH_WIDTH, (float)PERF_HUD_GRAPH_HEIGHT);
+
+	// Our own vertex array, the caller's is bound back at the end
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glBindVertexArray(PerfHUDVertexArrayID);
+
+	// Draw call : the bars and the target line, one quad for all of them
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glBindVertexArray(previousVertexArrayID);
+}
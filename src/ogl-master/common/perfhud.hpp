@@ -0,0 +1,36 @@
+#ifndef PERFHUD_HPP
+#define PERFHUD_HPP
+
+// Performance HUD : the counters of the last frame as text, and the CPU time of the last
+// PERF_HUD_FRAMES frames as a graph, the spikes in red. Cheap enough to stay on : the text is
+// formatted every PERF_HUD_TEXT_FRAMES frames and batched by text2D, the graph is a single quad
+// which only uploads the times of the new frames, and the GPU time is read from timestamp
+// queries PERF_HUD_GPU_LATENCY frames later, without waiting for the GPU.
+
+#define PERF_HUD_FRAMES 240
+#define PERF_HUD_GPU_LATENCY 4
+#define PERF_HUD_TEXT_FRAMES 15
+
+// Counters of a frame, filled by the caller except the times
+struct PerfHUDFrame {
+	float cpuMilliseconds;      // from beginPerfHUDFrame to endPerfHUDFrame
+	float gpuMilliseconds;      // of the frame PERF_HUD_GPU_LATENCY frames before, 0 until known
+	unsigned int drawCalls;
+	unsigned int triangles;
+	unsigned int visibleBodies;
+	unsigned int totalBodies;
+	size_t uploadedBytes;
+};
+
+void initPerfHUD();
+void cleanupPerfHUD();
+
+// Around the commands of the frame, before the HUDs : times it, and adds it to the graph
+void beginPerfHUDFrame();
+void endPerfHUDFrame(PerfHUDFrame & frame);
+
+// The text goes through addText2D, in its 800x600 space, drawn by the next flushText2D.
+// The graph is drawn now, its bottom left corner at (x, y).
+void drawPerfHUD(int x, int y);
+
+#endif
@@ -0,0 +1,223 @@
+#include <stdio.h>
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "profiler.hpp"
+
+struct ProfilerEvent {
+	const char * name;
+	long long start;   // nanoseconds since ProfilerEpoch
+	long long end;
+};
+
+// Written by one thread only ; the others read it with writeProfilerTrace()
+struct ProfilerRing {
+	ProfilerEvent events[PROFILER_RING_SIZE];
+	std::atomic<unsigned long long> head;   // events recorded since the start
+	std::string threadName;                 // under RingsMutex
+	unsigned int id;
+};
+
+struct GpuScopeQueries {
+	const char * name;
+	GLuint queries[2];   // timestamps before and after
+};
+
+// Scopes of one frame. The query objects are kept from one use of the frame to the next.
+struct GpuFrame {
+	std::vector<GpuScopeQueries> scopes;
+	unsigned int used;
+};
+
+static const std::chrono::steady_clock::time_point ProfilerEpoch = std::chrono::steady_clock::now();
+
+static std::mutex RingsMutex;
+static std::vector<ProfilerRing *> Rings;
+static thread_local ProfilerRing * ThreadRing = NULL;
+
+// The GPU scopes, converted to CPU time, go in a ring of their own
+static ProfilerRing * GpuRing = NULL;
+static GpuFrame GpuFrames[PROFILER_GPU_LATENCY];
+static unsigned int CurrentGpuFrame = 0;
+static long long GpuClockOffset = 0;   // GPU timestamp - CPU time
+
+static long long profilerNow(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - ProfilerEpoch).count();
+}
+
+static ProfilerRing * createRing(const char * name){
+	ProfilerRing * ring = new ProfilerRing();
+	ring->head.store(0);
+	std::lock_guard<std::mutex> lock(RingsMutex);
+	ring->id = (unsigned int)Rings.size();
+	char defaultName[32];
+	sprintf(defaultName, "Thread %u", ring->id);
+	ring->threadName = name != NULL ? name : defaultName;
+	Rings.push_back(ring);
+	return ring;
+}
+
+static void recordEvent(ProfilerRing * ring, const char * name, long long start, long long end){
+	unsigned long long head = ring->head.load(std::memory_order_relaxed);
+	ProfilerEvent & event = ring->events[head % PROFILER_RING_SIZE];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	// Publishes the event to the readers
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void setProfilerThreadName(const char * name){
+	if (ThreadRing == NULL){
+		ThreadRing = createRing(name);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(RingsMutex);
+	ThreadRing->threadName = name;
+}
+
+ProfileScope::ProfileScope(const char * scopeName){
+	name = scopeName;
+	start = profilerNow();
+}
+
+ProfileScope::~ProfileScope(){
+	long long end = profilerNow();
+	if (ThreadRing == NULL)
+		ThreadRing = createRing(NULL);
+	recordEvent(ThreadRing, name, start, end);
+}
+
+void initProfiler(){
+	if (GpuRing == NULL)
+		GpuRing = createRing("GPU");
+	// Both clocks now, to put the GPU timestamps on the CPU timeline
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	GpuClockOffset = gpuTime - profilerNow();
+	for (unsigned int i = 0; i < PROFILER_GPU_LATENCY; i++)
+		GpuFrames[i].used = 0;
+	CurrentGpuFrame = 0;
+}
+
+void deleteProfiler(){
+	for (unsigned int i = 0; i < PROFILER_GPU_LATENCY; i++){
+		for (unsigned int s = 0; s < GpuFrames[i].scopes.size(); s++)
+			glDeleteQueries(2, GpuFrames[i].scopes[s].queries);
+		GpuFrames[i].scopes.clear();
+		GpuFrames[i].used = 0;
+	}
+	// The rings stay : the threads that own them may still record
+	GpuRing = NULL;
+}
+
+GpuProfileScope::GpuProfileScope(const char * scopeName){
+	index = -1;
+	if (GpuRing == NULL)
+		return;
+	GpuFrame & frame = GpuFrames[CurrentGpuFrame];
+	if (frame.used == frame.scopes.size()){
+		GpuScopeQueries scope;
+		glGenQueries(2, scope.queries);
+		frame.scopes.push_back(scope);
+	}
+	index = frame.used++;
+	frame.scopes[index].name = scopeName;
+	glQueryCounter(frame.scopes[index].queries[0], GL_TIMESTAMP);
+}
+
+GpuProfileScope::~GpuProfileScope(){
+	if (index >= 0)
+		glQueryCounter(GpuFrames[CurrentGpuFrame].scopes[index].queries[1], GL_TIMESTAMP);
+}
+
+void profilerFrame(){
+	if (GpuRing == NULL)
+		return;
+	// The oldest frame is reused for the next one : its timestamps are read first.
+	// PROFILER_GPU_LATENCY frames later, they are normally there without waiting.
+	CurrentGpuFrame = (CurrentGpuFrame + 1) % PROFILER_GPU_LATENCY;
+	GpuFrame & frame = GpuFrames[CurrentGpuFrame];
+	for (unsigned int i = 0; i < frame.used; i++){
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(frame.scopes[i].queries[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.scopes[i].queries[1], GL_QUERY_RESULT, &end);
+		recordEvent(GpuRing, frame.scopes[i].name, (long long)start - GpuClockOffset, (long long)end - GpuClockOffset);
+	}
+	frame.used = 0;
+}
+
+// Copies the events of a ring that are not overwritten while they are copied
+static void readRing(const ProfilerRing & ring, std::vector<ProfilerEvent> & out_events){
+	out_events.clear();
+	unsigned long long head = ring.head.load(std::memory_order_acquire);
+	unsigned long long first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+	for (unsigned long long i = first; i < head; i++)
+		out_events.push_back(ring.events[i % PROFILER_RING_SIZE]);
+	// The owner may have written over the oldest ones meanwhile, and may be writing the slot of
+	// event newHead right now, which is also the slot of event newHead - PROFILER_RING_SIZE
+	unsigned long long newHead = ring.head.load(std::memory_order_acquire);
+	unsigned long long valid = newHead >= PROFILER_RING_SIZE ? newHead - PROFILER_RING_SIZE + 1 : 0;
+	if (valid > first)
+		out_events.erase(out_events.begin(), out_events.begin() + (size_t)std::min(valid - first, (unsigned long long)out_events.size()));
+}
+
+// The scope names are literals of our own, but the thread names may come from anywhere
+static std::string jsonString(const std::string & text){
+	std::string out = "\"";
+	for (size_t i = 0; i < text.size(); i++){
+		if (text[i] == '"' || text[i] == '\\')
+			out += '\\';
+		if ((unsigned char)text[i] >= 0x20)
+			out += text[i];
+	}
+	return out + "\"";
+}
+
+bool writeProfilerTrace(const char * path){
+	FILE * file = fopen(path, "w");
+	if (file == NULL){
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+
+	std::vector<ProfilerRing *> rings;
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(RingsMutex);
+		rings = Rings;
+		for (unsigned int i = 0; i < rings.size(); i++)
+			names.push_back(rings[i]->threadName);
+	}
+
+	// Complete events ("X"), in microseconds, one track per thread
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+	unsigned int eventCount = 0;
+	std::vector<ProfilerEvent> events;
+	for (unsigned int r = 0; r < rings.size(); r++){
+		fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": %s}}",
+			first ? "" : ",\n", rings[r]->id, jsonString(names[r]).c_str());
+		first = false;
+		readRing(*rings[r], events);
+		for (unsigned int i = 0; i < events.size(); i++){
+			fprintf(file, ",\n{\"name\": %s, \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+				jsonString(events[i].name).c_str(), rings[r]->id, events[i].start / 1000.0, (events[i].end - events[i].start) / 1000.0);
+		}
+		eventCount += (unsigned int)events.size();
+	}
+	fprintf(file, "\n]}\n");
+	bool ok = fclose(file) == 0;
+	if (ok)
+		printf("Wrote %u profiler scopes to %s\n", eventCount, path);
+	else
+		printf("Error while writing %s\n", path);
+	return ok;
+}
@@ -0,0 +1,49 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+// Frame profiler : named scopes timed on the CPU, on any thread, and on the GPU, written as a
+// Chrome trace (open it in chrome://tracing or ui.perfetto.dev).
+//
+// Each thread records its CPU scopes in its own ring buffer, without locks : only the last
+// PROFILER_RING_SIZE scopes of each thread are kept. The GPU scopes are GL_TIMESTAMP queries,
+// read PROFILER_GPU_LATENCY frames later so that the CPU doesn't wait for the GPU.
+
+#define PROFILER_RING_SIZE 16384
+#define PROFILER_GPU_LATENCY 4
+
+// The GPU scopes need the OpenGL context ; the CPU ones work without
+void initProfiler();
+void deleteProfiler();
+
+// Call once per frame, from the OpenGL thread : reads the GPU timestamps of an earlier frame
+void profilerFrame();
+
+// Name of the calling thread in the trace
+void setProfilerThreadName(const char * name);
+
+// Writes every scope still in the rings. Can be called while the other threads record.
+bool writeProfilerTrace(const char * path);
+
+// Times the enclosing block on the CPU. name must stay valid (a literal).
+struct ProfileScope {
+	const char * name;
+	long long start;
+	ProfileScope(const char * scopeName);
+	~ProfileScope();
+};
+
+// Times the OpenGL commands of the enclosing block on the GPU. OpenGL thread only.
+struct GpuProfileScope {
+	int index;   // in the scopes of the current frame, -1 if the profiler is not initialized
+	GpuProfileScope(const char * scopeName);
+	~GpuProfileScope();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// Both the CPU and the GPU time of the block
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name); \
+	GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif
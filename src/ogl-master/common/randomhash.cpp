@@ -0,0 +1,16 @@
+#include "randomhash.hpp"
+
+unsigned int hashRandom(unsigned int seed, unsigned int index){
+	unsigned int x = seed * 0x9E3779B9u + index;
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+float randomUnit(unsigned int & state){
+	state = hashRandom(state, 1);
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
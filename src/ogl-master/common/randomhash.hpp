@@ -0,0 +1,13 @@
+#ifndef RANDOMHASH_HPP
+#define RANDOMHASH_HPP
+
+// Random numbers from a hash rather than a generator : the same seed and index always give the
+// same values, in any order and on any thread, so a job can make the values of its own chunk.
+
+// 32 random bits from the seed and an index (lowbias32 of Chris Wellons)
+unsigned int hashRandom(unsigned int seed, unsigned int index);
+
+// In [0, 1), and a new hash in state for the next value
+float randomUnit(unsigned int & state);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#include "sceneframebuffer.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+bool resizeSceneFramebuffer(SceneFramebuffer & scene, int width, int height, int samples){
+	GLint maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	if (samples > maxSamples)
+		samples = maxSamples;
+	if (scene.framebuffer != 0 && scene.width == width && scene.height == height && scene.samples == samples)
+		return true;
+	deleteSceneFramebuffer(scene);
+	scene.width = width;
+	scene.height = height;
+	scene.samples = samples;
+
+	glGenRenderbuffers(1, &scene.colorbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, scene.colorbuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &scene.depthbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, scene.depthbuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGenFramebuffers(1, &scene.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, scene.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scene.colorbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, scene.depthbuffer);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	// A multisampled blit can't scale : the resolve goes through a single sampled copy, at the same size
+	if (complete && samples > 0){
+		glGenRenderbuffers(1, &scene.resolveColorbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, scene.resolveColorbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenFramebuffers(1, &scene.resolveFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, scene.resolveFramebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scene.resolveColorbuffer);
+		complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+
+	if (!complete){
+		printf("The %dx%d scene framebuffer with %d samples is incomplete\n", width, height, samples);
+		deleteSceneFramebuffer(scene);
+		return false;
+	}
+	return true;
+}
+
+void deleteSceneFramebuffer(SceneFramebuffer & scene){
+	if (scene.framebuffer != 0){
+		glDeleteFramebuffers(1, &scene.framebuffer);
+		glDeleteRenderbuffers(1, &scene.colorbuffer);
+		glDeleteRenderbuffers(1, &scene.depthbuffer);
+	}
+	if (scene.resolveFramebuffer != 0){
+		glDeleteFramebuffers(1, &scene.resolveFramebuffer);
+		glDeleteRenderbuffers(1, &scene.resolveColorbuffer);
+	}
+	scene.framebuffer = scene.colorbuffer = scene.depthbuffer = 0;
+	scene.resolveFramebuffer = scene.resolveColorbuffer = 0;
+}
+
+void bindSceneFramebuffer(const SceneFramebuffer & scene){
+	glBindFramebuffer(GL_FRAMEBUFFER, scene.framebuffer);
+	glViewport(0, 0, scene.width, scene.height);
+}
+
+void resolveSceneFramebuffer(const SceneFramebuffer & scene, GLuint target, int targetWidth, int targetHeight){
+	GLuint source = scene.framebuffer;
+	bool scaled = scene.width != targetWidth || scene.height != targetHeight;
+	if (scene.samples > 0 && scaled){
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, scene.framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, scene.resolveFramebuffer);
+		glBlitFramebuffer(0, 0, scene.width, scene.height, 0, 0, scene.width, scene.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		source = scene.resolveFramebuffer;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+	glBlitFramebuffer(0, 0, scene.width, scene.height, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	glViewport(0, 0, targetWidth, targetHeight);
+}
@@ -0,0 +1,29 @@
+#ifndef SCENEFRAMEBUFFER_HPP
+#define SCENEFRAMEBUFFER_HPP
+
+// The scene drawn offscreen, at its own resolution and sample count, then resolved and scaled into
+// the window's framebuffer : unlike the window's, they can change at any time without a new context.
+
+struct SceneFramebuffer {
+	GLuint framebuffer;          // drawn into, multisampled when samples > 0
+	GLuint colorbuffer;
+	GLuint depthbuffer;
+	GLuint resolveFramebuffer;   // when multisampled and scaled : resolved there first, at the same size
+	GLuint resolveColorbuffer;
+	int width;
+	int height;
+	int samples;
+};
+
+// (Re)creates the framebuffers when the size or the sample count changed, samples clamped to
+// GL_MAX_SAMPLES. The scene framebuffer starts zeroed. false when the framebuffer is incomplete.
+bool resizeSceneFramebuffer(SceneFramebuffer & scene, int width, int height, int samples);
+void deleteSceneFramebuffer(SceneFramebuffer & scene);
+
+// Binds the scene framebuffer and sets the viewport to it
+void bindSceneFramebuffer(const SceneFramebuffer & scene);
+// Resolves and scales the scene into the target framebuffer, bound with its viewport on return.
+// Only the color is copied.
+void resolveSceneFramebuffer(const SceneFramebuffer & scene, GLuint target, int targetWidth, int targetHeight);
+
+#endif
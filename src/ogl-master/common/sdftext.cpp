@@ -0,0 +1,165 @@
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+using namespace glm;
+
+#include "shader.hpp"
+#include "texture.hpp"
+
+#include "streambuffer.hpp"
+#include "sdftext.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+// The glyphs are written in a stream buffer of SDF_TEXT_SECTIONS sections of SDF_TEXT_SECTION_GLYPHS,
+// one section per flush : the glyphs past SDF_TEXT_SECTION_GLYPHS are not drawn.
+#define SDF_TEXT_SECTION_GLYPHS 16384
+#define SDF_TEXT_SECTIONS 3
+
+// One instance : the 4 vertices of the glyph are made by the vertex shader
+struct SDFGlyph {
+	glm::vec4 anchor;          // xyz in the world and w = 1, or xy in the 800x600 space and w = 0
+	glm::vec4 glyph;           // offset from the anchor and size, in pixels, then the character
+	unsigned char color[4];
+};
+
+unsigned int SDFTextTextureID;
+unsigned int SDFTextVertexArrayID;
+StreamBuffer SDFTextGlyphs;
+unsigned int SDFTextShaderID;
+unsigned int SDFTextViewProjectionID;
+unsigned int SDFTextViewportSizeID;
+
+// Points the instanced attributes at the glyphs which start at offset in the buffer
+static void setSDFGlyphAttributes(size_t offset){
+	glBindBuffer(GL_ARRAY_BUFFER, SDFTextGlyphs.buffer);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(SDFGlyph), (void*)(offset + offsetof(SDFGlyph, anchor)) );
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SDFGlyph), (void*)(offset + offsetof(SDFGlyph, glyph)) );
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SDFGlyph), (void*)(offset + offsetof(SDFGlyph, color)) );
+}
+
+bool initSDFText(const char * atlasPath){
+
+	// Initialize texture. Without the atlas there are no labels : unlike loadDDS, don't wait for a key.
+	DDSImage atlas;
+	if (!readDDS(atlasPath, atlas))
+		return false;
+	SDFTextTextureID = uploadDDS(atlas, 0);
+	freeDDS(atlas);
+	if (SDFTextTextureID == 0)
+		return false;
+
+	// Initialize VAO : one instance per glyph, no vertex attribute
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glGenVertexArrays(1, &SDFTextVertexArrayID);
+	glBindVertexArray(SDFTextVertexArrayID);
+
+	createStreamBuffer(GL_ARRAY_BUFFER, SDF_TEXT_SECTION_GLYPHS * sizeof(SDFGlyph), SDF_TEXT_SECTIONS, SDFTextGlyphs);
+	for (GLuint i = 0; i < 3; i++){
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+	setSDFGlyphAttributes(0);
+
+	glBindVertexArray(previousVertexArrayID);
+
+	// Initialize Shader
+	SDFTextShaderID = LoadShaders( "SDFText.vertexshader", "SDFText.fragmentshader" );
+
+	// Initialize uniforms' IDs
+	SDFTextViewProjectionID = glGetUniformLocation( SDFTextShaderID, "VP" );
+	SDFTextViewportSizeID = glGetUniformLocation( SDFTextShaderID, "ViewportSize" );
+
+	// The atlas is in Texture Unit 0, once
+	GLint previousProgramID;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgramID);
+	glUseProgram(SDFTextShaderID);
+	glUniform1i(glGetUniformLocation( SDFTextShaderID, "atlasSampler" ), 0);
+	glUseProgram(previousProgramID);
+
+	return true;
+}
+
+static void addSDFGlyphs(const char * text, glm::vec4 anchor, float x, float y, float size, glm::vec4 color){
+
+	unsigned char packedColor[4];
+	for (int c = 0; c < 4; c++)
+		packedColor[c] = (unsigned char)(glm::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+	unsigned int length = strlen(text);
+	for ( unsigned int i=0 ; i<length ; i++ ){
+		SDFGlyph * glyph = (SDFGlyph *)writeStreamBuffer(SDFTextGlyphs, sizeof(SDFGlyph));
+		if (glyph == NULL)
+			return;
+		glyph->anchor = anchor;
+		glyph->glyph = glm::vec4(x + i*size, y, size, (float)(unsigned char)text[i]);
+		memcpy(glyph->color, packedColor, 4);
+	}
+}
+
+void addSDFText2D(const char * text, int x, int y, int size, glm::vec4 color){
+	addSDFGlyphs(text, glm::vec4(x, y, 0, 0), 0.0f, 0.0f, (float)size, color);
+}
+
+void addSDFLabel(const char * text, glm::vec3 position, float size, glm::vec4 color){
+	// Centered, a few pixels above the point
+	float width = strlen(text) * size;
+	addSDFGlyphs(text, glm::vec4(position, 1), -0.5f * width, 0.25f * size, size, color);
+}
+
+void flushSDFText(const glm::mat4 & ViewProjection, int viewportWidth, int viewportHeight){
+
+	size_t offset;
+	unsigned int count = commitStreamBuffer(SDFTextGlyphs, offset) / sizeof(SDFGlyph);
+	if (count == 0)
+		return;
+
+	// Bind shader
+	glUseProgram(SDFTextShaderID);
+	glUniformMatrix4fv(SDFTextViewProjectionID, 1, GL_FALSE, &ViewProjection[0][0]);
+	glUniform2f(SDFTextViewportSizeID, (float)viewportWidth, (float)viewportHeight);
+
+	// Bind texture
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, SDFTextTextureID);
+
+	// Our own vertex array, the caller's is bound back at the end. The attributes start at the
+	// first glyph of the draw (see commitStreamBuffer).
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glBindVertexArray(SDFTextVertexArrayID);
+	setSDFGlyphAttributes(offset);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// Draw call
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+	glDisable(GL_BLEND);
+
+	glBindVertexArray(previousVertexArrayID);
+
+	// The next glyphs go in the next section, once the GPU is done with it
+	nextStreamBufferSection(SDFTextGlyphs);
+}
+
+void cleanupSDFText(){
+
+	// Delete buffers
+	deleteStreamBuffer(SDFTextGlyphs);
+	glDeleteVertexArrays(1, &SDFTextVertexArrayID);
+
+	// Delete texture
+	glDeleteTextures(1, &SDFTextTextureID);
+
+	// Delete shader
+	glDeleteProgram(SDFTextShaderID);
+}
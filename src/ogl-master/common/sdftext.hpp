@@ -0,0 +1,20 @@
+#ifndef SDFTEXT_HPP
+#define SDFTEXT_HPP
+
+// Text drawn from a signed distance field atlas (see sdffont/sdffont.cpp) : sharp at any size.
+// Each glyph is one instance of a 4 vertices strip ; all the glyphs added since the last flush,
+// on screen and in the world, are drawn by flushSDFText with a single instanced draw call.
+
+// false when the atlas could not be loaded
+bool initSDFText(const char * atlasPath);
+
+// Text on screen, in the 800x600 space of addText2D : size is the width and height of a glyph
+void addSDFText2D(const char * text, int x, int y, int size, glm::vec4 color);
+// Text centered above a point of the world, size in pixels whatever the distance
+void addSDFLabel(const char * text, glm::vec3 position, float size, glm::vec4 color);
+
+// ViewProjection places the labels ; the viewport size converts their pixels
+void flushSDFText(const glm::mat4 & ViewProjection, int viewportWidth, int viewportHeight);
+void cleanupSDFText();
+
+#endif
@@ -10,102 +10,348 @@ using namespace std;
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 #include <GL/glew.h>
 
 #include "shader.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+// Directory of the program binaries, empty when the cache is disabled
+static std::string ShaderCacheDirectory;
+// Looks the files up before the disk, NULL for the disk only
+static bool (*ShaderFileLookup)(const char * path, const unsigned char ** out_data, size_t * out_size) = NULL;
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+#define SHADER_CACHE_MAGIC 0x42505347 // "GSPB"
+#define SHADER_CACHE_VERSION 1
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
-		return 0;
+struct ShaderCacheHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long key;
+	unsigned int keySize;     // against the collisions of the 64 bits hash
+	unsigned int format;
+	unsigned int binarySize;
+};
+
+void setShaderCacheDirectory(const char * directory){
+	ShaderCacheDirectory = directory != NULL ? directory : "";
+	if (ShaderCacheDirectory.empty())
+		return;
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+}
+
+void setShaderFileLookup(bool (*lookup)(const char * path, const unsigned char ** out_data, size_t * out_size)){
+	ShaderFileLookup = lookup;
+}
+
+static bool readShaderFile(const char * file_path, std::string & out_code){
+	const unsigned char * data;
+	size_t size;
+	if (ShaderFileLookup != NULL && ShaderFileLookup(file_path, &data, &size)){
+		out_code.assign((const char *)data, size);
+		return true;
 	}
+	std::ifstream ShaderStream(file_path, std::ios::in);
+	if(!ShaderStream.is_open())
+		return false;
+	std::stringstream sstr;
+	sstr << ShaderStream.rdbuf();
+	out_code = sstr.str();
+	ShaderStream.close();
+	return true;
+}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
+// The defines go right after the #version line, which must stay the first one
+static std::string insertDefines(const std::string & code, const char * defines){
+	if (defines == NULL || defines[0] == 0)
+		return code;
+	size_t version = code.find("#version");
+	size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+	if (lineEnd == std::string::npos)
+		return std::string(defines) + "\n" + code;
+	return code.substr(0, lineEnd + 1) + defines + "\n" + code.substr(lineEnd + 1);
+}
+
+// 64 bits FNV-1a
+static unsigned long long hashString(unsigned long long hash, const std::string & data){
+	for (size_t i = 0; i < data.size(); i++){
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
 	}
+	// Separator, so that ("ab", "c") and ("a", "bc") differ
+	hash ^= 0xff;
+	hash *= 1099511628211ULL;
+	return hash;
+}
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+// The binaries only work with the driver that made them
+static std::string driverString(){
+	std::string driver;
+	const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+	for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); i++){
+		const char * name = (const char *)glGetString(names[i]);
+		driver += name != NULL ? name : "";
+		driver += "\n";
+	}
+	return driver;
+}
 
+static bool programBinariesSupported(){
+	if (!GLEW_ARB_get_program_binary)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+static std::string cachePath(unsigned long long key){
+	char name[32];
+	sprintf(name, "%016llx.bin", key);
+	return ShaderCacheDirectory + "/" + name;
+}
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+// Returns 0 if there is no valid binary for this key
+static GLuint loadCachedProgram(unsigned long long key, unsigned int keySize){
+	std::string path = cachePath(key);
+	FILE * file = fopen(path.c_str(), "rb");
+	if (!file)
+		return 0;
+	ShaderCacheHeader header;
+	std::vector<char> binary;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+		header.magic == SHADER_CACHE_MAGIC && header.version == SHADER_CACHE_VERSION &&
+		header.key == key && header.keySize == keySize && header.binarySize > 0;
+	if (ok){
+		binary.resize(header.binarySize);
+		ok = fread(&binary[0], 1, binary.size(), file) == binary.size();
+	}
+	fclose(file);
+	if (!ok)
+		return 0;
+
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, header.format, &binary[0], (GLsizei)binary.size());
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (Result != GL_TRUE){
+		// The driver changed in a way its strings don't show : recompile
+		glDeleteProgram(ProgramID);
+		return 0;
 	}
+	printf("Loading program from cache : %s\n", path.c_str());
+	return ProgramID;
+}
 
+static void saveCachedProgram(GLuint ProgramID, unsigned long long key, unsigned int keySize){
+	GLint binarySize = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0)
+		return;
+	std::vector<char> binary(binarySize);
+	GLenum format = 0;
+	glGetProgramBinary(ProgramID, binarySize, NULL, &format, &binary[0]);
 
+	ShaderCacheHeader header;
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.keySize = keySize;
+	header.format = format;
+	header.binarySize = binarySize;
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+	// Written aside then renamed, so that a crash never leaves a truncated binary
+	std::string path = cachePath(key);
+	std::string temporaryPath = path + ".tmp";
+	FILE * file = fopen(temporaryPath.c_str(), "wb");
+	if (!file)
+		return;
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(&binary[0], 1, binary.size(), file) == binary.size();
+	ok = fclose(file) == 0 && ok;
+	remove(path.c_str());
+	if (!ok || rename(temporaryPath.c_str(), path.c_str()) != 0)
+		remove(temporaryPath.c_str());
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+// A program whose compilation and link were started, and not checked yet
+struct PendingProgram {
+	GLuint ProgramID;
+	GLuint VertexShaderID;
+	GLuint FragmentShaderID;
+	std::string vertexPath;
+	std::string fragmentPath;
+	bool useCache;
+	unsigned long long CacheKey;
+	unsigned int CacheKeySize;
+};
+
+static std::vector<PendingProgram> PendingPrograms;
+
+// GLEW 1.13 only knows the ARB version of the extension : the KHR one has the same GL_COMPLETION_STATUS
+static bool parallelCompileSupported(){
+	static int supported = -1;
+	if (supported < 0){
+		supported = GLEW_ARB_parallel_shader_compile ? 1 : 0;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count && !supported; i++)
+			if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), "GL_KHR_parallel_shader_compile") == 0)
+				supported = 1;
+	}
+	return supported == 1;
+}
+
+static void printShaderLog(GLuint ShaderID){
+	int InfoLogLength;
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
 	}
+}
 
+// Checks the shaders and the program, which waits for them if they are not done yet
+static void finishProgram(unsigned int index){
+	PendingProgram pending = PendingPrograms[index];
+	PendingPrograms.erase(PendingPrograms.begin() + index);
 
+	// Check Vertex Shader
+	GLint Result = GL_FALSE;
+	glGetShaderiv(pending.VertexShaderID, GL_COMPILE_STATUS, &Result);
+	if (Result != GL_TRUE)
+		printf("Error in shader : %s\n", pending.vertexPath.c_str());
+	printShaderLog(pending.VertexShaderID);
 
-	// Link the program
-	printf("Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
+	// Check Fragment Shader
+	glGetShaderiv(pending.FragmentShaderID, GL_COMPILE_STATUS, &Result);
+	if (Result != GL_TRUE)
+		printf("Error in shader : %s\n", pending.fragmentPath.c_str());
+	printShaderLog(pending.FragmentShaderID);
 
 	// Check the program
-	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	int InfoLogLength;
+	glGetProgramiv(pending.ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(pending.ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
 		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		glGetProgramInfoLog(pending.ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
 
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+	if (pending.useCache && Result == GL_TRUE)
+		saveCachedProgram(pending.ProgramID, pending.CacheKey, pending.CacheKeySize);
 
-	return ProgramID;
+
+	glDetachShader(pending.ProgramID, pending.VertexShaderID);
+	glDetachShader(pending.ProgramID, pending.FragmentShaderID);
+
+	glDeleteShader(pending.VertexShaderID);
+	glDeleteShader(pending.FragmentShaderID);
 }
 
+static int findPendingProgram(GLuint ProgramID){
+	for (unsigned int i = 0; i < PendingPrograms.size(); i++)
+		if (PendingPrograms[i].ProgramID == ProgramID)
+			return i;
+	return -1;
+}
+
+GLuint LoadShadersAsync(const char * vertex_file_path,const char * fragment_file_path, const char * defines){
+
+	// Read the Vertex Shader code from the file
+	std::string VertexShaderCode;
+	if(!readShaderFile(vertex_file_path, VertexShaderCode)){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
+		getchar();
+		return 0;
+	}
+
+	// Read the Fragment Shader code from the file
+	std::string FragmentShaderCode;
+	readShaderFile(fragment_file_path, FragmentShaderCode);
+
+	VertexShaderCode = insertDefines(VertexShaderCode, defines);
+	FragmentShaderCode = insertDefines(FragmentShaderCode, defines);
 
+	PendingProgram pending;
+	pending.vertexPath = vertex_file_path;
+	pending.fragmentPath = fragment_file_path;
+
+	// Look for a binary of the same sources, made by the same driver
+	pending.useCache = !ShaderCacheDirectory.empty() && programBinariesSupported();
+	pending.CacheKey = 14695981039346656037ULL;
+	pending.CacheKeySize = 0;
+	if (pending.useCache){
+		std::string driver = driverString();
+		pending.CacheKey = hashString(pending.CacheKey, VertexShaderCode);
+		pending.CacheKey = hashString(pending.CacheKey, FragmentShaderCode);
+		pending.CacheKey = hashString(pending.CacheKey, driver);
+		pending.CacheKeySize = (unsigned int)(VertexShaderCode.size() + FragmentShaderCode.size() + driver.size());
+		GLuint ProgramID = loadCachedProgram(pending.CacheKey, pending.CacheKeySize);
+		if (ProgramID != 0)
+			return ProgramID;
+	}
+
+	// Create the shaders
+	pending.VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	pending.FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
+	// Compile Vertex Shader
+	printf("Compiling shader : %s\n", vertex_file_path);
+	char const * VertexSourcePointer = VertexShaderCode.c_str();
+	glShaderSource(pending.VertexShaderID, 1, &VertexSourcePointer , NULL);
+	glCompileShader(pending.VertexShaderID);
+
+	// Compile Fragment Shader
+	printf("Compiling shader : %s\n", fragment_file_path);
+	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
+	glShaderSource(pending.FragmentShaderID, 1, &FragmentSourcePointer , NULL);
+	glCompileShader(pending.FragmentShaderID);
+
+	// Link the program, without waiting for the compilations : their errors show up at the link
+	printf("Linking program\n");
+	pending.ProgramID = glCreateProgram();
+	glAttachShader(pending.ProgramID, pending.VertexShaderID);
+	glAttachShader(pending.ProgramID, pending.FragmentShaderID);
+	if (pending.useCache)
+		glProgramParameteri(pending.ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(pending.ProgramID);
+
+	PendingPrograms.push_back(pending);
+	return pending.ProgramID;
+}
+
+bool isProgramReady(GLuint ProgramID){
+	int index = findPendingProgram(ProgramID);
+	if (index < 0)
+		return true;
+	// Without the extension, there is no way to know without waiting
+	if (parallelCompileSupported()){
+		GLint Completed = GL_FALSE;
+		glGetProgramiv(ProgramID, GL_COMPLETION_STATUS_ARB, &Completed);
+		if (Completed != GL_TRUE)
+			return false;
+	}
+	finishProgram(index);
+	return true;
+}
+
+void waitProgram(GLuint ProgramID){
+	int index = findPendingProgram(ProgramID);
+	if (index >= 0)
+		finishProgram(index);
+}
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * defines){
+	GLuint ProgramID = LoadShadersAsync(vertex_file_path, fragment_file_path, defines);
+	waitProgram(ProgramID);
+	return ProgramID;
+}
@@ -1,6 +1,23 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+// defines : lines of "#define NAME VALUE", inserted after the #version line of both shaders
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * defines = NULL);
+
+// Only starts the compilation and the link : with GL_KHR_parallel_shader_compile, the driver does them
+// on its own threads, and isProgramReady() tells when the program can be used without waiting.
+// The errors are printed by isProgramReady() or waitProgram(). LoadShaders does both at once.
+GLuint LoadShadersAsync(const char * vertex_file_path,const char * fragment_file_path, const char * defines = NULL);
+bool isProgramReady(GLuint programID);
+void waitProgram(GLuint programID);
+
+// Enables the cache of program binaries (GL_ARB_get_program_binary) in the given directory, NULL disables it.
+// A binary is reused when the sources, the defines and the GL vendor, renderer and version strings
+// are the same ; otherwise, or if the driver rejects it, the program is compiled and the binary replaced.
+void setShaderCacheDirectory(const char * directory);
+
+// Where the shader files are looked for before the disk, e.g. findAsset (see assetarchive.hpp).
+// NULL, the default : the disk only.
+void setShaderFileLookup(bool (*lookup)(const char * path, const unsigned char ** out_data, size_t * out_size));
 
 #endif
@@ -0,0 +1,86 @@
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "shader.hpp"
+#include "shaderpermutations.hpp"
+
+void initShaderPermutations(const char * vertex_file_path, const char * fragment_file_path,
+	const char * const * features, unsigned int featureCount, ShaderPermutations & out_permutations){
+	if (featureCount > MAX_SHADER_FEATURES){
+		printf("%u shader features, only the first %d are used\n", featureCount, MAX_SHADER_FEATURES);
+		featureCount = MAX_SHADER_FEATURES;
+	}
+	out_permutations.vertexPath = vertex_file_path;
+	out_permutations.fragmentPath = fragment_file_path;
+	out_permutations.features.assign(features, features + featureCount);
+	out_permutations.programs.assign(1u << featureCount, 0);
+}
+
+// Starts the compilation of this mask if it was never asked for
+static GLuint startShaderPermutation(ShaderPermutations & permutations, unsigned int mask){
+	if (permutations.programs[mask] != 0)
+		return permutations.programs[mask];
+
+	std::string defines;
+	for (unsigned int i = 0; i < permutations.features.size(); i++)
+		if (mask & (1u << i))
+			defines += "#define " + permutations.features[i] + " 1\n";
+	permutations.programs[mask] = LoadShadersAsync(permutations.vertexPath.c_str(), permutations.fragmentPath.c_str(), defines.c_str());
+	return permutations.programs[mask];
+}
+
+GLuint getShaderPermutation(ShaderPermutations & permutations, unsigned int mask){
+	mask &= (unsigned int)permutations.programs.size() - 1;
+	GLuint program = startShaderPermutation(permutations, mask);
+	waitProgram(program);
+	return program;
+}
+
+// Number of bits set
+static unsigned int featureCount(unsigned int mask){
+	unsigned int count = 0;
+	for (; mask != 0; mask &= mask - 1)
+		count++;
+	return count;
+}
+
+unsigned int readyShaderPermutation(ShaderPermutations & permutations, unsigned int mask){
+	mask &= (unsigned int)permutations.programs.size() - 1;
+	if (isProgramReady(startShaderPermutation(permutations, mask)))
+		return mask;
+	// The ready submask with the most features : the submasks come in decreasing numeric order,
+	// which doesn't follow the number of features (0b100 comes before 0b011)
+	int best = -1;
+	unsigned int bestFeatures = 0;
+	for (unsigned int sub = (mask - 1) & mask; ; sub = (sub - 1) & mask){
+		unsigned int features = featureCount(sub);
+		if ((best < 0 || features > bestFeatures) &&
+			permutations.programs[sub] != 0 && isProgramReady(permutations.programs[sub])){
+			best = sub;
+			bestFeatures = features;
+		}
+		if (sub == 0)
+			break;
+	}
+	if (best >= 0)
+		return best;
+	// Nothing to draw with : wait
+	waitProgram(permutations.programs[mask]);
+	return mask;
+}
+
+void compileShaderPermutations(ShaderPermutations & permutations, const unsigned int * masks, unsigned int count){
+	for (unsigned int i = 0; i < count; i++)
+		startShaderPermutation(permutations, masks[i] & ((unsigned int)permutations.programs.size() - 1));
+}
+
+void deleteShaderPermutations(ShaderPermutations & permutations){
+	for (unsigned int i = 0; i < permutations.programs.size(); i++)
+		if (permutations.programs[i] != 0)
+			glDeleteProgram(permutations.programs[i]);
+	permutations.programs.assign(permutations.programs.size(), 0);
+}
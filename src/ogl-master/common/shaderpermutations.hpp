@@ -0,0 +1,34 @@
+#ifndef SHADERPERMUTATIONS_HPP
+#define SHADERPERMUTATIONS_HPP
+
+// Variants of one pair of shaders, compiled with a "#define FEATURE 1" for each bit set in
+// their mask. Each variant runs only the code of its features, instead of branching on uniforms.
+// The programs are compiled on first use (or up front with compileShaderPermutations),
+// and go through the program binary cache of LoadShaders.
+
+#define MAX_SHADER_FEATURES 8
+
+struct ShaderPermutations {
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::vector<std::string> features;   // bit i of the mask defines features[i]
+	std::vector<GLuint> programs;        // by mask, 0 until compiled
+};
+
+void initShaderPermutations(const char * vertex_file_path, const char * fragment_file_path,
+	const char * const * features, unsigned int featureCount, ShaderPermutations & out_permutations);
+
+// Compiles the program of this mask the first time, and waits for it
+GLuint getShaderPermutation(ShaderPermutations & permutations, unsigned int mask);
+
+// Returns mask if its program is ready, starting its compilation if needed. Otherwise returns the
+// ready permutation with the most of its features, and only waits when there is none.
+unsigned int readyShaderPermutation(ShaderPermutations & permutations, unsigned int mask);
+
+// Starts compiling these masks now, rather than on the frame they are first needed.
+// With GL_KHR_parallel_shader_compile the driver compiles them in the background.
+void compileShaderPermutations(ShaderPermutations & permutations, const unsigned int * masks, unsigned int count);
+
+void deleteShaderPermutations(ShaderPermutations & permutations);
+
+#endif
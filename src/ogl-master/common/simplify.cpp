@@ -0,0 +1,346 @@
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "simplify.hpp"
+
+// Sum of the squared distances to a set of planes, weighted by triangle area.
+// Stored as the upper half of the symmetric 4x4 matrix.
+struct Quadric {
+	double a00, a01, a02, a03;
+	double      a11, a12, a13;
+	double           a22, a23;
+	double                a33;
+	double weight;
+};
+
+static void quadricFromTriangle(Quadric & q, glm::vec3 p0, glm::vec3 p1, glm::vec3 p2){
+	glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+	double area = glm::length(n);
+	memset(&q, 0, sizeof(q));
+	if (area == 0.0)
+		return;
+	double a = n.x / area, b = n.y / area, c = n.z / area;
+	double d = -(a * p0.x + b * p0.y + c * p0.z);
+	q.a00 = a*a*area; q.a01 = a*b*area; q.a02 = a*c*area; q.a03 = a*d*area;
+	q.a11 = b*b*area; q.a12 = b*c*area; q.a13 = b*d*area;
+	q.a22 = c*c*area; q.a23 = c*d*area;
+	q.a33 = d*d*area;
+	q.weight = area;
+}
+
+static void quadricAdd(Quadric & q, const Quadric & r){
+	q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03;
+	q.a11 += r.a11; q.a12 += r.a12; q.a13 += r.a13;
+	q.a22 += r.a22; q.a23 += r.a23;
+	q.a33 += r.a33;
+	q.weight += r.weight;
+}
+
+// Mean squared distance of p to the planes of q
+static double quadricError(const Quadric & q, glm::vec3 p){
+	double x = p.x, y = p.y, z = p.z;
+	double e =
+		q.a00*x*x + 2*q.a01*x*y + 2*q.a02*x*z + 2*q.a03*x +
+		            q.a11*y*y   + 2*q.a12*y*z + 2*q.a13*y +
+		                          q.a22*z*z   + 2*q.a23*z +
+		                                        q.a33;
+	return q.weight > 0.0 ? fabs(e) / q.weight : 0.0;
+}
+
+struct Collapse {
+	unsigned int from;
+	unsigned int to;
+	double cost;
+	bool operator<(const Collapse & that) const{
+		return cost < that.cost;
+	}
+};
+
+// Orders vertex indices by the bits of their position
+struct PositionLess {
+	std::vector<glm::vec3> * vertices;
+	bool operator()(unsigned int a, unsigned int b) const{
+		return memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(glm::vec3)) < 0;
+	}
+};
+
+// Would moving "from" onto "to" flip or degenerate one of the triangles around "from" ?
+static bool collapseFlipsTriangle(
+	unsigned int from, unsigned int to,
+	std::vector<unsigned int> & indices,
+	std::vector<unsigned int> & adjacencyOffsets,
+	std::vector<unsigned int> & adjacency,
+	std::vector<unsigned int> & collapseTo,
+	std::vector<glm::vec3> & vertices
+){
+	for (unsigned int k=adjacencyOffsets[from]; k<adjacencyOffsets[from+1]; k++){
+		unsigned int * tri = &indices[adjacency[k]*3];
+		if (tri[0] == to || tri[1] == to || tri[2] == to)
+			continue; // This triangle disappears
+
+		glm::vec3 before[3], after[3];
+		for (int j=0; j<3; j++){
+			before[j] = vertices[collapseTo[tri[j]]];
+			after[j] = tri[j] == from ? vertices[to] : before[j];
+		}
+		glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+		glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+		if (glm::dot(n0, n1) <= 0.25f * glm::length(n0) * glm::length(n1))
+			return true;
+	}
+	return false;
+}
+
+// The point of the triangle abc closest to p (Ericson, Real-Time Collision Detection, 5.1.5)
+static glm::vec3 closestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c){
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return a;
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+		return b;
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return a + ab * (d1 / (d1 - d3));
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+		return c;
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return a + ac * (d2 / (d2 - d6));
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// The error of a level, in model units : the largest distance from an input vertex to the triangles
+// around the vertex it collapsed into. The quadrics only give a mean distance to planes, which
+// underestimates the error on curved surfaces.
+static float measureLODError(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<unsigned int> & indices,
+	std::vector<unsigned int> & representative
+){
+	unsigned int vertexCount = in_vertices.size();
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int i=0; i<indices.size(); i++)
+		offsets[indices[i] + 1]++;
+	for (unsigned int i=0; i<vertexCount; i++)
+		offsets[i + 1] += offsets[i];
+	std::vector<unsigned int> triangles(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int i=0; i<indices.size(); i++)
+		triangles[fill[indices[i]]++] = i / 3;
+
+	float error = 0.0f;
+	for (unsigned int v=0; v<vertexCount; v++){
+		unsigned int r = representative[v];
+		float nearest = -1.0f;
+		for (unsigned int k=offsets[r]; k<offsets[r+1]; k++){
+			unsigned int * tri = &indices[triangles[k]*3];
+			glm::vec3 closest = closestPointOnTriangle(in_vertices[v], in_vertices[tri[0]], in_vertices[tri[1]], in_vertices[tri[2]]);
+			float distance = glm::length(closest - in_vertices[v]);
+			if (nearest < 0.0f || distance < nearest)
+				nearest = distance;
+		}
+		error = std::max(error, nearest);
+	}
+	return error;
+}
+
+void buildLODChain(
+	std::vector<unsigned short> & in_indices,
+	std::vector<glm::vec3> & in_vertices,
+	unsigned int minTriangles,
+	float maxError,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<MeshLOD> & out_lods
+){
+	unsigned int vertexCount = in_vertices.size();
+
+	out_indices = in_indices;
+	out_lods.clear();
+	MeshLOD full = { 0, (GLsizei)in_indices.size(), 0.0f };
+	out_lods.push_back(full);
+
+	// Group the vertices sharing the same position. Groups of more than one vertex
+	// lie on a UV or normal seam : moving them would tear the mesh apart.
+	std::vector<unsigned int> sorted(vertexCount);
+	for (unsigned int i=0; i<vertexCount; i++)
+		sorted[i] = i;
+	PositionLess positionLess = { &in_vertices };
+	std::sort(sorted.begin(), sorted.end(), positionLess);
+
+	std::vector<unsigned int> group(vertexCount);
+	std::vector<unsigned char> locked(vertexCount, 0);
+	for (unsigned int i=0; i<vertexCount; ){
+		unsigned int j = i + 1;
+		while (j < vertexCount && memcmp(&in_vertices[sorted[i]], &in_vertices[sorted[j]], sizeof(glm::vec3)) == 0)
+			j++;
+		for (unsigned int k=i; k<j; k++){
+			group[sorted[k]] = sorted[i];
+			locked[sorted[k]] = (j - i) > 1;
+		}
+		i = j;
+	}
+
+	std::vector<unsigned int> indices(in_indices.begin(), in_indices.end());
+
+	// Edges used by a single triangle are open borders : lock them too
+	std::vector<unsigned long long> edges;
+	edges.reserve(indices.size());
+	for (unsigned int i=0; i<indices.size(); i+=3){
+		for (int j=0; j<3; j++){
+			unsigned long long a = group[indices[i+j]], b = group[indices[i+(j+1)%3]];
+			edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (unsigned int i=0; i<edges.size(); ){
+		unsigned int j = i + 1;
+		while (j < edges.size() && edges[j] == edges[i])
+			j++;
+		if (j - i == 1){
+			locked[edges[i] >> 32] = 1;
+			locked[edges[i] & 0xffffffff] = 1;
+		}
+		i = j;
+	}
+	for (unsigned int i=0; i<vertexCount; i++)
+		if (locked[group[i]])
+			locked[i] = 1;
+
+	// One quadric per position, shared by all the vertices of a group
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(&quadrics[0], 0, vertexCount * sizeof(Quadric));
+	for (unsigned int i=0; i<indices.size(); i+=3){
+		Quadric q;
+		quadricFromTriangle(q, in_vertices[indices[i]], in_vertices[indices[i+1]], in_vertices[indices[i+2]]);
+		for (int j=0; j<3; j++)
+			quadricAdd(quadrics[group[indices[i+j]]], q);
+	}
+
+	// collapseTo is the vertex each one goes to in the current pass, representative the one it
+	// went to since the input mesh
+	std::vector<unsigned int> collapseTo(vertexCount);
+	std::vector<unsigned int> representative(vertexCount);
+	for (unsigned int i=0; i<vertexCount; i++)
+		collapseTo[i] = representative[i] = i;
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned char> touched(vertexCount);
+
+	unsigned int triangleCount = indices.size() / 3;
+	unsigned int targetTriangles = triangleCount / 4;
+
+	while (targetTriangles >= minTriangles && triangleCount > minTriangles){
+
+		// Triangles around each vertex
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (unsigned int i=0; i<indices.size(); i++)
+			adjacencyOffsets[indices[i] + 1]++;
+		for (unsigned int i=0; i<vertexCount; i++)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		adjacency.resize(indices.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (unsigned int i=0; i<indices.size(); i++)
+			adjacency[fill[indices[i]]++] = i / 3;
+
+		// Every edge is a candidate, in both directions
+		collapses.clear();
+		for (unsigned int i=0; i<indices.size(); i+=3){
+			for (int j=0; j<3; j++){
+				unsigned int a = indices[i+j], b = indices[i+(j+1)%3];
+				Quadric q;
+				if (!locked[a]){
+					q = quadrics[group[a]];
+					quadricAdd(q, quadrics[group[b]]);
+					Collapse c = { a, b, quadricError(q, in_vertices[b]) };
+					collapses.push_back(c);
+				}
+				if (!locked[b]){
+					q = quadrics[group[b]];
+					quadricAdd(q, quadrics[group[a]]);
+					Collapse c = { b, a, quadricError(q, in_vertices[a]) };
+					collapses.push_back(c);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		// Cheapest collapses first, at most one per vertex and per pass.
+		// Each collapse removes about two triangles.
+		std::fill(touched.begin(), touched.end(), 0);
+		unsigned int removed = 0;
+		unsigned int applied = 0;
+		for (unsigned int i=0; i<collapses.size() && triangleCount - removed > targetTriangles; i++){
+			Collapse & c = collapses[i];
+			if (touched[group[c.from]] || touched[group[c.to]])
+				continue;
+			if (collapseFlipsTriangle(c.from, c.to, indices, adjacencyOffsets, adjacency, collapseTo, in_vertices))
+				continue;
+
+			collapseTo[c.from] = c.to;
+			quadricAdd(quadrics[group[c.to]], quadrics[group[c.from]]);
+			touched[group[c.from]] = 1;
+			touched[group[c.to]] = 1;
+			removed += 2;
+			applied++;
+		}
+		if (applied == 0)
+			break;
+
+		// Remap the triangles and drop the degenerate ones
+		unsigned int write = 0;
+		for (unsigned int i=0; i<indices.size(); i+=3){
+			unsigned int a = collapseTo[indices[i]], b = collapseTo[indices[i+1]], c = collapseTo[indices[i+2]];
+			if (a == b || b == c || c == a)
+				continue;
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+		triangleCount = write / 3;
+		for (unsigned int i=0; i<vertexCount; i++){
+			representative[i] = collapseTo[representative[i]];
+			collapseTo[i] = i;
+		}
+
+		if (triangleCount <= targetTriangles){
+			float error = measureLODError(in_vertices, indices, representative);
+			if (error > maxError)
+				return;
+			MeshLOD lod = { (GLsizei)out_indices.size(), (GLsizei)indices.size(), error };
+			out_indices.insert(out_indices.end(), indices.begin(), indices.end());
+			out_lods.push_back(lod);
+			targetTriangles = triangleCount / 4;
+		}
+	}
+
+	// Keep the coarsest reachable level even if it didn't reach its target
+	if (triangleCount * 3 < (unsigned int)out_lods.back().indexCount){
+		float error = measureLODError(in_vertices, indices, representative);
+		if (error > maxError)
+			return;
+		MeshLOD lod = { (GLsizei)out_indices.size(), (GLsizei)indices.size(), error };
+		out_indices.insert(out_indices.end(), indices.begin(), indices.end());
+		out_lods.push_back(lod);
+	}
+}
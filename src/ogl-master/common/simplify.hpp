@@ -0,0 +1,22 @@
+#ifndef SIMPLIFY_HPP
+#define SIMPLIFY_HPP
+
+// Builds a chain of levels of detail by quadric edge collapse.
+// Level 0 is the input mesh, each next level has about a quarter of the triangles
+// of the previous one, until minTriangles is reached or nothing can be collapsed anymore.
+// Each level's error is the largest distance from an input vertex to the level's surface, in
+// model units ; the chain stops before the first level whose error is above maxError.
+// All levels reference the input vertices : out_indices holds the index lists
+// of every level one after the other, described by out_lods.
+// Vertices on UV or normal seams and on open borders are never moved.
+void buildLODChain(
+	std::vector<unsigned short> & in_indices,
+	std::vector<glm::vec3> & in_vertices,
+	unsigned int minTriangles,
+	float maxError,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<MeshLOD> & out_lods
+);
+
+#endif
@@ -7,23 +7,29 @@
 //distance to sun ~150 000 000 km + radius of sun model of ~55.0f so we measure from the surface not the center
 vec3 gPositionEarth(205.0f, 0.0f, 0.0f);
 vec3 gOrientationEarth;
+float gScaleEarth = 1.0f;
 //distance to earth ~385 000km + earth model of ~0.55f
 vec3 gPositionMoon(206.0f, 0.0f, 0.0f);
 vec3 gOrientationMoon;
+float gScaleMoon = 0.25f;
 //center of sunsystem
 vec3 gPositionSun(0.0f, 0.0f, 0.0f);
 vec3 gOrientationSun;
+float gScaleSun = 108.0f; // sun.obj was 108 times bigger than erde.obj
 //distance to sun 58 000 000 km +radius of sun model of ~55.0f
 vec3 gPositionMercury(113.0f, 0.0f, 0.0f);
 vec3 gOrientationMercury;
+float gScaleMercury = 0.4f;
 
 //distance to sun 108 000 000 km + radius of sun model of ~55.0f
 vec3 gPositionVenus(173.0f, 0.0f, 0.0f);
 vec3 gOrientationVenus;
+float gScaleVenus = 0.9f;
 
 //distance to sun 228 000 000 km + radius of sun model of ~55.0f
 vec3 gPositionMars(283.0f, 0.0f, 0.0f);
 vec3 gOrientationMars;
+float gScaleMars = 0.5f;
 
 // For speed computation
 double lastTime = glfwGetTime();
@@ -32,82 +38,221 @@ double currentTime;
 float deltaTime;
 int nbFrames = 0;
 
-GLuint programID;
+// The simulation goes gTimeWarp times faster than the clock : simDeltaTime is deltaTime * gTimeWarp.
+// The orbits of the asteroids advance in gSimSubsteps steps per frame.
+float gTimeWarp = 1.0f;
+int gSimSubsteps = 1;
+float simDeltaTime;
 
+// Features of the StandardShading permutations
+#define SHADING_DIRECT_LIGHTING 1
+#define SHADING_VIRTUAL_TEXTURE 2
+#define SHADING_PERMUTATIONS 4
+
+// Uniforms of one permutation, looked up when it is first used
+struct ShadingProgram {
+	GLuint programID;
+	GLuint MatrixID;
+	GLuint ViewMatrixID;
+	GLuint ModelMatrixID;
+	GLuint LightID;
+	GLuint LightColorID;
+	GLuint TextureID;
+	MeshUniforms MeshUniformIDs;
+	VirtualTextureUniforms VTUniformIDs;
+	int lightVersion;   // gLightVersion when the light was last sent to this program
+};
+
+ShaderPermutations StandardShading;
+ShadingProgram ShadingPrograms[SHADING_PERMUTATIONS];
+ShadingProgram * CurrentShading = NULL;
+glm::vec3 gLightPosition;
+glm::vec3 gLightColor(1, 1, 1);
+int gLightVersion = 0;
+
+// Vertex format used for the planet meshes, and the uniforms to decode it
+VertexFormat gVertexFormat = VERTEX_FORMAT_COMPACT;
+MeshUniforms MeshUniformIDs;
+
+// All the bodies share one procedural sphere, of the same radius as erde.obj
+Mesh MeshSphere;
+// but the Moon, drawn with mond.obj scaled to the same radius : baked once to mond.mesh in the cache
+Mesh MeshMoon;
+float gSphereRadius = 0.49f;
+unsigned int gSphereSubdivisions = 32;
+unsigned int gSphereMinSubdivisions = 2;
+
+// Level of detail selection : maximum error on screen in pixels, and hysteresis margin
+float gLODErrorPixels = 1.0f;
+float gLODHysteresis = 0.25f;
+// The simplified levels of the loaded meshes : down to gLODMinTriangles, and off from the mesh
+// by at most gLODMaxRelativeError times its radius
+int gLODMinTriangles = 200;
+float gLODMaxRelativeError = 0.125f;
+
+// Archive of the assets, baked by the build from playground/assets.txt into the build directory
+#ifndef PLAYGROUND_ASSET_ARCHIVE
+#define PLAYGROUND_ASSET_ARCHIVE "playground.pak"
+#endif
+const char * gAssetArchive = PLAYGROUND_ASSET_ARCHIVE;
+
+// What the previous runs baked, in the build directory : created at startup, it can be deleted at any time
+#ifndef PLAYGROUND_CACHE_DIRECTORY
+#define PLAYGROUND_CACHE_DIRECTORY "cache"
+#endif
+const char * gCacheDirectory = PLAYGROUND_CACHE_DIRECTORY;
+
+// The files compiled into the executable, generated by the build from playground/embedded.txt
+extern const EmbeddedAsset PlaygroundEmbeddedAssets[];
+extern const unsigned int PlaygroundEmbeddedAssetsCount;
+
+// --loose-assets : read every file from the working directory, ignoring the embedded ones and the archive
+bool gLooseAssets = false;
+
+// --trace path : write the profiler scopes there at exit ; F2 writes them at any time, to gDefaultTracePath without --trace
+const char * gTracePath = NULL;
+const char * gDefaultTracePath = "trace.json";
+
+// --gl-stats : count the OpenGL calls, the redundant ones and the draws of each frame, shown top left.
+// --gl-stats-log path : the same, and one CSV line per frame in that file.
+bool gGLStats = false;
+const char * gGLStatsLog = NULL;
+GLStats LastGLStats;
+
+// --gpu-memory : the OpenGL objects alive and their memory by kind and by owner, shown top right.
+// --gpu-budget MB : warn when they go over it. The objects still alive at exit are reported in any case.
+bool gGpuMemoryHUD = false;
+int gGpuBudgetMB = 0;
+
+// --perf-hud, or F3 : the frame times of the last 240 frames, and the counters of the last one, bottom left
+bool gPerfHUD = false;
+// The text of the HUDs is ready : with a window, F3 can show the performance HUD at any time
+bool gHUDTextReady = false;
+
+// --labels, or L : the names of the bodies above them, in the signed distance field font
+bool gLabels = false;
+bool gLabelsReady = false;   // the font is loaded
+
+// F4 : the tuning panel, with a window. The cursor is free and the camera still while it is shown.
+bool gTuningPanel = false;
+bool gVSync = true;
+
+// The bodies and the asteroids outside the view frustum are not drawn
+bool gCulling = true;
+Frustum ViewFrustum;
+
+// --msaa N, --render-scale S : the scene is drawn offscreen with N samples, at S times the resolution
+// of the window, then resolved into it. -1 samples : 4 with a window, as its own framebuffer had, none with --bench.
+int gMSAASamples = -1;
+float gRenderScale = 1.0f;
+SceneFramebuffer SceneTarget = {};
+bool gSceneOffscreen = false;   // this frame is drawn in SceneTarget
+
+// --asteroids N : the synthetic asteroid belt, made the first time there are asteroids
+unsigned int gAsteroidCount = 0;
+unsigned int gAsteroidSeed = 1;
+AsteroidBelt Asteroids;
+bool gAsteroidBeltReady = false;
+int LODAsteroids;
+unsigned int LastAsteroidsDrawn = 0;
+
+// --stress bodies=N,moons=M,asteroids=K,seed=S : N more planets around the Sun with M moons each,
+// in the textures of the solar system, and K asteroids in the belt. gStressSceneName is in the bench report.
+bool gStress = false;
+StressSceneConfig gStressScene;
+char gStressSceneName[128] = "solar system";
+std::vector<StressBody> StressBodies;
+// The texture units of Earth, Moon, Mercury, Venus and Mars, bound by their bodies every frame
+const GLint StressTextureUnits[] = { 0, 1, 3, 4, 5 };
+unsigned int LastStressBodiesDrawn = 0;
+
+// --particles N : up to N live particles in the Sun's corona, the tail of a comet and the exhaust of a
+// ship around the Earth, made the first time there is a budget and made again when it changes
+unsigned int gParticleBudget = 0;
+unsigned int ParticleBudgetReady = 0;   // the budget the particle systems were made for, 0 before
+ParticleSystem CoronaParticles, CometParticles, ExhaustParticles;
+ParticleEmitter CoronaEmitter, CometEmitter, ExhaustEmitter;
+float CometAngle = 1.0f;
+float ShipAngle = 0.0f;
+unsigned int LastParticlesDrawn = 0;
+
+// --bench path : replay this camera path without window, then write the timings and exit.
+// --frames, --warmup, --width, --height and --report set the rest. The simulation advances
+// 1/gBenchFrameRate per frame ; the warmup frames (first uploads, first page faults) stay on the first key.
+const char * gBenchCameraPath = NULL;
+int gBenchFrames = 600;
+int gBenchWarmupFrames = 30;
+int gBenchWidth = 1024;
+int gBenchHeight = 768;
+const char * gBenchReport = "bench.json";
+float gBenchFrameRate = 60.0f;
+std::vector<CameraKey> BenchCameraPath;
+BenchRecorder Bench;
+
+// --screenshots 0,60,119 : with --bench, write these measured frames to <--screenshot-prefix>_<frame>.bmp,
+// for distrib/regression.py
+std::vector<int> gScreenshotFrames;
+const char * gScreenshotPrefix = "screenshot";
+
+// Program binaries of the previous runs, in this directory of the cache ; NULL to always compile the shaders
+const char * gShaderCacheDirectory = "shadercache";
+
+// Time spent each frame uploading the assets loaded in the background, in seconds
+double gAssetUploadBudget = 0.002;
+
+// Texture streaming : video memory for the streamed mipmaps, bytes uploaded per frame,
+// and size of the mip tail loaded up front
+size_t gTextureBudget = 32 * 1024 * 1024;
+size_t gTextureUploadBytesPerFrame = 1024 * 1024;
+unsigned int gTextureTailSize = 64;
+
+// Virtual texturing of Earth and Mars : the cache holds gVirtualTextureCacheTiles^2 pages of 128x128 texels,
+// and the feedback pass renders at 1/gFeedbackDivisor of the window's resolution
+bool gVirtualTexturing = true;
+unsigned int gVirtualTextureCacheTiles = 16;
+int gFeedbackDivisor = 8;
+GLuint feedbackProgramID;
+GLuint FeedbackMatrixID;
+MeshUniforms FeedbackMeshUniformIDs;
+VirtualTextureUniforms VTUniformIDs;
+VirtualTextureUniforms VTFeedbackUniformIDs;
+VirtualTextureFeedback Feedback;
+VirtualTexture VirtualTextureEarth;
+VirtualTexture VirtualTextureMars;
+std::vector<VirtualTexture *> VirtualTextures;
 
 //init Modevariables for Lightmode
 GLuint Mode1 = 1;
 GLuint Mode2 = 2;
+GLuint gLightMode = Mode1;
 bool ambientLight;
 bool specularLight;
 bool specularDisco;
 
 // init variables for Earth
 GLuint TextureEarth;
-GLuint TextureIDEarth;
-GLuint VertexArrayIDEarth;
-GLuint vertexbufferEarth;
-GLuint uvbufferEarth;
-GLuint normalbufferEarth;
-std::vector<glm::vec3> verticesEarth;
-std::vector<glm::vec2> uvsEarth;
-std::vector<glm::vec3> normalsEarth;
+int LODEarth;
 
 // init variables for Moon
 GLuint TextureMoon;
-GLuint TextureIDMoon;
-GLuint VertexArrayIDMoon;
-GLuint vertexbufferMoon;
-GLuint uvbufferMoon;
-GLuint normalbufferMoon;
-std::vector<glm::vec3> verticesMoon;
-std::vector<glm::vec2> uvsMoon;
-std::vector<glm::vec3> normalsMoon;
+int LODMoon;
 
 // init variables for Sun
 GLuint TextureSun;
-GLuint TextureIDSun;
-GLuint VertexArrayIDSun;
-GLuint vertexbufferSun;
-GLuint uvbufferSun;
-GLuint normalbufferSun;
-std::vector<glm::vec3> verticesSun;
-std::vector<glm::vec2> uvsSun;
-std::vector<glm::vec3> normalsSun;
+int LODSun;
 
 // init variables for Mercury
 GLuint TextureMercury;
-GLuint TextureIDMercury;
-GLuint VertexArrayIDMercury;
-GLuint vertexbufferMercury;
-GLuint uvbufferMercury;
-GLuint normalbufferMercury;
-std::vector<glm::vec3> verticesMercury;
-std::vector<glm::vec2> uvsMercury;
-std::vector<glm::vec3> normalsMercury;
+int LODMercury;
 
 // init variables for Venus
 GLuint TextureVenus;
-GLuint TextureIDVenus;
-GLuint VertexArrayIDVenus;
-GLuint vertexbufferVenus;
-GLuint uvbufferVenus;
-GLuint normalbufferVenus;
-std::vector<glm::vec3> verticesVenus;
-std::vector<glm::vec2> uvsVenus;
-std::vector<glm::vec3> normalsVenus;
+int LODVenus;
 
 
 // init variables for Mars
 GLuint TextureMars;
-GLuint TextureIDMars;
-GLuint VertexArrayIDMars;
-GLuint vertexbufferMars;
-GLuint uvbufferMars;
-GLuint normalbufferMars;
-std::vector<glm::vec3> verticesMars;
-std::vector<glm::vec2> uvsMars;
-std::vector<glm::vec3> normalsMars;
+int LODMars;
 
 // Get a handle for our "MVP" uniform
 GLuint MatrixID;
@@ -152,7 +297,24 @@ glm::mat4 MVPMars;
 #pragma endregion
 
 
-int main(void); //<<< main function, called at startup
+int main(int argc, char ** argv); //<<< main function, called at startup
+
+void createCacheDirectory();
+std::string cachePath(const char * name);
+
+bool buildObjMesh(const char * path, MeshData & data);
+bool loadBakedMesh(const char * objPath, const std::string & meshPath, MeshData & data);
+bool buildSphereMesh(MeshData & data);
+bool initSphere();
+bool initMoonMesh();
+float pixelsPerUnit(vec3 position, float scale);
+bool parseArguments(int argc, char ** argv);
+double getTime();
+void getFramebufferSize(int & width, int & height);
+void updateCamera();
+bool loadPageFile(const char * ddsPath, const char * pageName, VirtualTexture & vt);
+bool initVirtualTextures();
+void drawVirtualTextureFeedback();
 
 // initializes the vertex buffer array for all planets and binds it OpenGL
 bool initSun();
@@ -168,6 +330,31 @@ void rotateVenus();
 bool initMars();
 void rotateMars();
 void switchLight();
+void dumpProfilerTrace();
+void saveBenchScreenshot();
+void drawGLStatsHUD(const GLStats & stats);
+void drawGpuMemoryHUD();
+void toggleOverlays();
+void drawLabels();
+unsigned int countVisibleBodies();
+void recordPerfHUDFrame();
+bool bodyVisible(vec3 position, float scale);
+void drawAsteroids();
+void drawStressBodies();
+void drawParticles();
+bool initParticles(unsigned int budget);
+void deleteParticles();
+void beginScene();
+void endScene();
+void initTuningPanel();
+void showTuningPanel(bool show);
+void applyVSync();
+void onTuningKey(GLFWwindow * w, int key, int scancode, int action, int mods);
+void onTuningChar(GLFWwindow * w, unsigned int codepoint);
+void onTuningScroll(GLFWwindow * w, double xoffset, double yoffset);
+void useShading(unsigned int features);
+void setShadingLight(glm::vec3 position, glm::vec3 color);
+unsigned int lightingFeatures();
 bool drawPlanets();
 #endif
 
@@ -0,0 +1,247 @@
+#include <vector>
+#include <stdio.h>
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "vboindexer.hpp"
+#include "sphere.hpp"
+
+#define SPHERE_PI 3.14159265358979f
+
+// Width of the bands of quads : two rows of SPHERE_CACHE_BAND+1 vertices fit in a 16 entries vertex cache
+#define SPHERE_CACHE_BAND 7
+
+// Equirectangular mapping of erde.obj : the seam is the meridian towards -Z,
+// and V is inverted because the DDS textures are stored upside down.
+static glm::vec2 sphereUV(glm::vec3 n){
+	float u = 0.75f - atan2f(n.z, n.x) / (2.0f * SPHERE_PI);
+	if (u >= 1.0f) u -= 1.0f;
+	float v = acosf(glm::clamp(n.y, -1.0f, 1.0f)) / SPHERE_PI - 1.0f;
+	return glm::vec2(u, v);
+}
+
+// At most the vertices of buildSphere(n) : 6 (n+1)^2 on the faces of the cube, and the copies on the
+// seam and at the poles, which are fewer than 4 (n+1) + 16
+static unsigned int sphereVertexBound(unsigned int n){
+	return 6*(n+1)*(n+1) + 4*(n+1) + 16;
+}
+
+// With an odd count, no vertex is at the center of a face, so none is exactly at a pole : the
+// triangles around the poles would then be taken for triangles across the seam
+static unsigned int evenSubdivisions(unsigned int n){
+	return n < 2 ? 2 : (n + 1) & ~1u;
+}
+
+void buildSphere(
+	unsigned int subdivisions,
+	float radius,
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	unsigned int n = evenSubdivisions(subdivisions);
+	if (n > SPHERE_MAX_SUBDIVISIONS){
+		printf("%u subdivisions don't fit in 16 bits indices, the sphere has %u\n", subdivisions, SPHERE_MAX_SUBDIVISIONS);
+		n = SPHERE_MAX_SUBDIVISIONS;
+	}
+
+	// Equal-angle warp of the grid coordinates, computed once so that the
+	// vertices shared by two faces are bit-for-bit identical (no cracks)
+	std::vector<float> warp(n + 1);
+	for (unsigned int i=0; i<=n; i++){
+		if (2*i < n)
+			warp[i] = -tanf((1.0f - 2.0f*i/n) * SPHERE_PI / 4.0f);
+		else if (2*i == n)
+			warp[i] = 0.0f;
+		else
+			warp[i] = -warp[n - i];
+	}
+	warp[0] = -1.0f;
+	warp[n] = 1.0f;
+
+	// The faces of the cube : which axis is fixed and to which sign, and the
+	// order of the two other axes so that the triangles are counter-clockwise from outside.
+	static const int faces[6][4] = {
+		// fixed axis, sign, u axis, v axis
+		{ 0,  1, 2, 1 },
+		{ 0, -1, 1, 2 },
+		{ 1,  1, 0, 2 },
+		{ 1, -1, 2, 0 },
+		{ 2,  1, 1, 0 },
+		{ 2, -1, 0, 1 },
+	};
+
+	out_indices.clear();
+	out_vertices.clear();
+	out_uvs.clear();
+	out_normals.clear();
+
+	unsigned int stride = n + 1;
+	for (int f=0; f<6; f++){
+		unsigned int base = out_vertices.size();
+		for (unsigned int j=0; j<=n; j++){
+			for (unsigned int i=0; i<=n; i++){
+				glm::vec3 cube;
+				cube[faces[f][0]] = (float)faces[f][1];
+				cube[faces[f][2]] = warp[i];
+				cube[faces[f][3]] = warp[j];
+				glm::vec3 normal = glm::normalize(cube);
+				out_vertices.push_back(normal * radius);
+				out_normals.push_back(normal);
+				out_uvs.push_back(sphereUV(normal));
+			}
+		}
+		// Walk the grid in bands of a few columns : the row of vertices shared with
+		// the previous row of quads is still in the vertex cache
+		for (unsigned int band=0; band<n; band+=SPHERE_CACHE_BAND)
+		for (unsigned int j=0; j<n; j++){
+			for (unsigned int i=band; i<n && i<band+SPHERE_CACHE_BAND; i++){
+				unsigned short a = base + j*stride + i;
+				unsigned short b = a + 1;
+				unsigned short c = a + stride;
+				unsigned short d = c + 1;
+				// Split the quads along the diagonals pointing to the center of the face,
+				// so that the triangulation is symmetric
+				bool flip = (i < n/2) != (j < n/2);
+				unsigned short tris[6] = { a, b, d,  a, d, c };
+				if (flip){
+					unsigned short other[6] = { a, b, c,  b, d, c };
+					for (int k=0; k<6; k++) tris[k] = other[k];
+				}
+				out_indices.insert(out_indices.end(), tris, tris + 6);
+			}
+		}
+	}
+
+	// Make sure every triangle faces outwards, whatever the axis conventions above
+	for (unsigned int t=0; t<out_indices.size(); t+=3){
+		glm::vec3 & p0 = out_vertices[out_indices[t]];
+		glm::vec3 & p1 = out_vertices[out_indices[t+1]];
+		glm::vec3 & p2 = out_vertices[out_indices[t+2]];
+		if (glm::dot(glm::cross(p1 - p0, p2 - p0), p0 + p1 + p2) < 0.0f){
+			unsigned short tmp = out_indices[t+1];
+			out_indices[t+1] = out_indices[t+2];
+			out_indices[t+2] = tmp;
+		}
+	}
+
+	// Seam and poles : give the triangles their own copies of the vertices whose U
+	// would otherwise wrap around
+	std::vector<unsigned short> seamCopy(out_vertices.size(), 0xffff);
+	for (unsigned int t=0; t<out_indices.size(); t+=3){
+		unsigned short * tri = &out_indices[t];
+		bool pole[3];
+		float minU = 2.0f, maxU = -1.0f;
+		for (int k=0; k<3; k++){
+			glm::vec3 & nk = out_normals[tri[k]];
+			pole[k] = nk.x == 0.0f && nk.z == 0.0f;
+			if (!pole[k]){
+				minU = glm::min(minU, out_uvs[tri[k]].x);
+				maxU = glm::max(maxU, out_uvs[tri[k]].x);
+			}
+		}
+
+		// The triangle crosses the seam : use U+1 for the vertices on the low side
+		if (maxU - minU > 0.5f){
+			for (int k=0; k<3; k++){
+				if (pole[k] || out_uvs[tri[k]].x >= 0.5f)
+					continue;
+				if (seamCopy[tri[k]] == 0xffff){
+					seamCopy[tri[k]] = out_vertices.size();
+					out_vertices.push_back(out_vertices[tri[k]]);
+					out_normals.push_back(out_normals[tri[k]]);
+					out_uvs.push_back(out_uvs[tri[k]] + glm::vec2(1.0f, 0.0f));
+				}
+				tri[k] = seamCopy[tri[k]];
+			}
+		}
+
+		// At a pole U is undefined : take the middle of the two other vertices
+		for (int k=0; k<3; k++){
+			if (!pole[k])
+				continue;
+			float u = 0.0f;
+			for (int l=0; l<3; l++)
+				if (l != k) u += out_uvs[tri[l]].x * 0.5f;
+			unsigned short copy = out_vertices.size();
+			out_vertices.push_back(out_vertices[tri[k]]);
+			out_normals.push_back(out_normals[tri[k]]);
+			out_uvs.push_back(glm::vec2(u, out_uvs[tri[k]].y));
+			tri[k] = copy;
+		}
+	}
+
+	optimizeVertexFetch(out_indices, out_vertices, out_uvs, out_normals);
+}
+
+void buildSphereLODChain(
+	unsigned int subdivisions,
+	unsigned int minSubdivisions,
+	float radius,
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<MeshLOD> & out_lods
+){
+	out_indices.clear();
+	out_vertices.clear();
+	out_uvs.clear();
+	out_normals.clear();
+	out_lods.clear();
+
+	if (minSubdivisions < 1)
+		minSubdivisions = 1;
+
+	// All the levels share the 16 bits indices (0xffff excluded) : the finest one is coarser if they don't fit.
+	// Every level is even, see evenSubdivisions.
+	unsigned int finest = evenSubdivisions(subdivisions);
+	for (;;){
+		unsigned int vertices = 0;
+		for (unsigned int n = finest; ; n = evenSubdivisions(n / 2)){
+			vertices += sphereVertexBound(n);
+			if (n / 2 < minSubdivisions || n == 2)
+				break;
+		}
+		if (vertices < 0xffff || finest <= minSubdivisions || finest == 2)
+			break;
+		finest -= 2;
+	}
+	if (finest != evenSubdivisions(subdivisions))
+		printf("The levels of %u subdivisions don't fit in 16 bits indices, the finest has %u\n", subdivisions, finest);
+	subdivisions = finest;
+
+	for (unsigned int n = subdivisions; ; n = evenSubdivisions(n / 2)){
+		std::vector<unsigned short> indices;
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		buildSphere(n, radius, indices, vertices, uvs, normals);
+
+		// The flat triangles are inside the sphere : the error is the depth
+		// of the deepest one, measured along its normal
+		float error = 0.0f;
+		for (unsigned int t=0; t<indices.size(); t+=3){
+			glm::vec3 & p0 = vertices[indices[t]];
+			glm::vec3 normal = glm::normalize(glm::cross(vertices[indices[t+1]] - p0, vertices[indices[t+2]] - p0));
+			error = glm::max(error, radius - glm::dot(normal, p0));
+		}
+
+		unsigned short base = out_vertices.size();
+		MeshLOD lod = { (GLsizei)out_indices.size(), (GLsizei)indices.size(), error };
+		for (unsigned int i=0; i<indices.size(); i++)
+			out_indices.push_back(base + indices[i]);
+		out_vertices.insert(out_vertices.end(), vertices.begin(), vertices.end());
+		out_uvs.insert(out_uvs.end(), uvs.begin(), uvs.end());
+		out_normals.insert(out_normals.end(), normals.begin(), normals.end());
+		out_lods.push_back(lod);
+
+		if (n / 2 < minSubdivisions || n == 2)
+			break;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef SPHERE_HPP
+#define SPHERE_HPP
+
+// The most subdivisions whose vertices fit in 16 bits indices
+#define SPHERE_MAX_SUBDIVISIONS 102
+
+// Procedural cube-sphere : each face of a cube is cut in a subdivisions x subdivisions grid,
+// then projected on the sphere. An equal-angle warp keeps the cells of similar sizes.
+// UVs follow the same equirectangular mapping as erde.obj (V inverted for DDS textures),
+// with the vertices on the seam and at the poles duplicated so that no triangle wraps around.
+// The output is indexed, and ordered for the vertex cache and for linear vertex fetching.
+// The subdivisions are even, an odd count is rounded up : the poles are then vertices, at the
+// centers of the top and bottom faces.
+// The indices are 16 bits : more than SPHERE_MAX_SUBDIVISIONS are clamped, with a warning.
+void buildSphere(
+	unsigned int subdivisions,
+	float radius,
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+// All the levels from subdivisions down to minSubdivisions (halving each time, rounded up to even) in a single
+// vertex and index buffer. Unlike buildLODChain, each level has its own vertices,
+// and the error of a level is measured against the true sphere. When all the levels don't fit
+// in 16 bits indices, the finest one has fewer subdivisions.
+void buildSphereLODChain(
+	unsigned int subdivisions,
+	unsigned int minSubdivisions,
+	float radius,
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<MeshLOD> & out_lods
+);
+
+#endif
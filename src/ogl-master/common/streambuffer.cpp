@@ -0,0 +1,85 @@
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "streambuffer.hpp"
+
+void createStreamBuffer(GLenum target, size_t sectionSize, unsigned int sectionCount, StreamBuffer & out_stream){
+	out_stream.target = target;
+	out_stream.sectionSize = sectionSize;
+	out_stream.sectionCount = sectionCount < STREAM_BUFFER_MAX_SECTIONS ? sectionCount : STREAM_BUFFER_MAX_SECTIONS;
+	out_stream.mapped = NULL;
+	for (unsigned int i = 0; i < STREAM_BUFFER_MAX_SECTIONS; i++)
+		out_stream.fences[i] = 0;
+	out_stream.section = 0;
+	out_stream.written = 0;
+	out_stream.committed = 0;
+
+	size_t size = out_stream.sectionSize * out_stream.sectionCount;
+	glGenBuffers(1, &out_stream.buffer);
+	glBindBuffer(target, out_stream.buffer);
+	if (GLEW_ARB_buffer_storage){
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, size, NULL, flags);
+		out_stream.mapped = (unsigned char *)glMapBufferRange(target, 0, size, flags);
+	}
+	// Without ARB_buffer_storage, or when the storage can't be mapped : a mutable buffer, written by commitStreamBuffer
+	if (out_stream.mapped == NULL){
+		if (GLEW_ARB_buffer_storage){
+			glDeleteBuffers(1, &out_stream.buffer);
+			glGenBuffers(1, &out_stream.buffer);
+			glBindBuffer(target, out_stream.buffer);
+		}
+		glBufferData(target, size, NULL, GL_STREAM_DRAW);
+		out_stream.staging.resize(size);
+	}
+}
+
+void deleteStreamBuffer(StreamBuffer & stream){
+	for (unsigned int i = 0; i < STREAM_BUFFER_MAX_SECTIONS; i++){
+		if (stream.fences[i] != 0)
+			glDeleteSync(stream.fences[i]);
+		stream.fences[i] = 0;
+	}
+	if (stream.mapped != NULL){
+		glBindBuffer(stream.target, stream.buffer);
+		glUnmapBuffer(stream.target);
+		stream.mapped = NULL;
+	}
+	stream.staging.clear();
+	glDeleteBuffers(1, &stream.buffer);
+	stream.buffer = 0;
+}
+
+void * writeStreamBuffer(StreamBuffer & stream, size_t size){
+	if (stream.written + size > stream.sectionSize)
+		return NULL;
+	unsigned char * data = stream.mapped != NULL ? stream.mapped : &stream.staging[0];
+	void * pointer = data + stream.section * stream.sectionSize + stream.written;
+	stream.written += size;
+	return pointer;
+}
+
+size_t commitStreamBuffer(StreamBuffer & stream, size_t & out_offset){
+	size_t size = stream.written - stream.committed;
+	out_offset = stream.section * stream.sectionSize + stream.committed;
+	if (size != 0 && stream.mapped == NULL){
+		glBindBuffer(stream.target, stream.buffer);
+		glBufferSubData(stream.target, out_offset, size, &stream.staging[out_offset]);
+	}
+	stream.committed = stream.written;
+	return size;
+}
+
+void nextStreamBufferSection(StreamBuffer & stream){
+	stream.fences[stream.section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	stream.section = (stream.section + 1) % stream.sectionCount;
+	if (stream.fences[stream.section] != 0){
+		while (glClientWaitSync(stream.fences[stream.section], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+			;
+		glDeleteSync(stream.fences[stream.section]);
+		stream.fences[stream.section] = 0;
+	}
+	stream.written = 0;
+	stream.committed = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+// A buffer written by the CPU every frame and read by the draws that follow : a ring of sections.
+// A section is fenced when the writing moves to the next one, and only written again once the GPU
+// is done with it, so the CPU never waits for draws it just issued.
+// With ARB_buffer_storage the buffer is mapped once, persistent and coherent. Otherwise the data
+// is written in memory, and copied with glBufferSubData by commitStreamBuffer.
+
+#define STREAM_BUFFER_MAX_SECTIONS 4
+
+struct StreamBuffer {
+	GLuint buffer;
+	GLenum target;
+	unsigned char * mapped;              // NULL : written in staging
+	std::vector<unsigned char> staging;
+	size_t sectionSize;
+	unsigned int sectionCount;
+	GLsync fences[STREAM_BUFFER_MAX_SECTIONS];
+	unsigned int section;
+	size_t written;                      // bytes written in the current section
+	size_t committed;                    // of them, already committed
+};
+
+// Allocates the buffer and leaves it bound to target
+void createStreamBuffer(GLenum target, size_t sectionSize, unsigned int sectionCount, StreamBuffer & out_stream);
+void deleteStreamBuffer(StreamBuffer & stream);
+
+// Room for size bytes in the current section, NULL when it is full : commit and draw what was
+// written, then call nextStreamBufferSection.
+void * writeStreamBuffer(StreamBuffer & stream, size_t size);
+// The bytes written since the last commit, from out_offset in the buffer, are ready for the GPU.
+// Without base instance in OpenGL 3.3, an instanced draw reads its first instance at the start of
+// the attributes : point them at out_offset before each draw.
+size_t commitStreamBuffer(StreamBuffer & stream, size_t & out_offset);
+// Fences the current section, and waits until the GPU is done with the next one
+void nextStreamBufferSection(StreamBuffer & stream);
+
+#endif
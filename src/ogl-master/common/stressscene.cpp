@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "frustum.hpp"
+#include "streambuffer.hpp"
+#include "asteroidbelt.hpp"
+#include "stressscene.hpp"
+
+#define STRESS_PI 3.14159265358979f
+
+// Planets : scale of the mesh, inclination of the orbits in radians, and the days of the playground
+// (one minute) of their rotation
+#define STRESS_PLANET_MIN_SCALE 0.2f
+#define STRESS_PLANET_MAX_SCALE 1.5f
+#define STRESS_MAX_INCLINATION 0.05f
+#define STRESS_MIN_DAYS 1.0f
+#define STRESS_MAX_DAYS 90.0f
+// Moons : scale relative to their planet, and the orbit of the first one in radii of the planet,
+// each next one STRESS_MOON_SPACING radii further, so that they never meet
+#define STRESS_MOON_MIN_SCALE 0.1f
+#define STRESS_MOON_MAX_SCALE 0.3f
+#define STRESS_MOON_FIRST_ORBIT 2.5f
+#define STRESS_MOON_SPACING 1.2f
+// Planets and moons together, so that bodies * (1 + moons) fits in an unsigned int
+#define STRESS_MAX_BODIES (1 << 20)
+
+bool parseStressSceneConfig(const char * text, StressSceneConfig & out_config){
+	out_config.bodies = 0;
+	out_config.moons = 0;
+	out_config.asteroids = 0;
+	out_config.seed = 1;
+	while (*text != '\0'){
+		const char * equal = strchr(text, '=');
+		if (equal == NULL){
+			printf("Expected key=value in the stress scene, at %s\n", text);
+			return false;
+		}
+		// strtoul would take the spaces and a sign before the digits, and wrap "-1" around
+		char * end;
+		unsigned long long value = strtoull(equal + 1, &end, 10);
+		if (equal[1] < '0' || equal[1] > '9' || (*end != ',' && *end != '\0')){
+			printf("Expected a number in the stress scene, at %s\n", equal + 1);
+			return false;
+		}
+		size_t keyLength = equal - text;
+		unsigned int * field;
+		unsigned long long maxValue;
+		if (keyLength == 6 && strncmp(text, "bodies", 6) == 0){
+			field = &out_config.bodies;
+			maxValue = STRESS_MAX_BODIES;
+		}
+		else if (keyLength == 5 && strncmp(text, "moons", 5) == 0){
+			field = &out_config.moons;
+			maxValue = STRESS_MAX_BODIES - 1;
+		}
+		else if (keyLength == 9 && strncmp(text, "asteroids", 9) == 0){
+			field = &out_config.asteroids;
+			maxValue = ASTEROID_BELT_MAX_COUNT;
+		}
+		else if (keyLength == 4 && strncmp(text, "seed", 4) == 0){
+			field = &out_config.seed;
+			maxValue = 0xffffffffu;
+		}
+		else {
+			printf("Unknown key in the stress scene : %.*s (bodies, moons, asteroids or seed)\n", (int)keyLength, text);
+			return false;
+		}
+		if (value > maxValue){
+			printf("Too many in the stress scene : %.*s, at most %llu\n", (int)(end - text), text, maxValue);
+			return false;
+		}
+		*field = (unsigned int)value;
+		text = *end == ',' ? end + 1 : end;
+	}
+	if ((unsigned long long)out_config.bodies * (1 + out_config.moons) > STRESS_MAX_BODIES){
+		printf("Too many in the stress scene : %u bodies with %u moons each, at most %u in all\n",
+			out_config.bodies, out_config.moons, STRESS_MAX_BODIES);
+		return false;
+	}
+	return true;
+}
+
+// In [0, 1). The raw output of mt19937 is the same on every platform, unlike the distributions.
+static float randomStress(std::mt19937 & generator){
+	return (generator() >> 8) * (1.0f / 16777216.0f);
+}
+
+static float randomStress(std::mt19937 & generator, float low, float high){
+	return low + (high - low) * randomStress(generator);
+}
+
+// Axes of a circular orbit : in the horizontal plane tilted by inclination around the line of nodes
+static void orbitPlane(float node, float inclination, StressBody & body){
+	glm::vec3 nodeAxis(cosf(node), 0.0f, sinf(node));
+	glm::vec3 across(-sinf(node), 0.0f, cosf(node));
+	body.orbitU = nodeAxis;
+	body.orbitV = across * cosf(inclination) + glm::vec3(0.0f, sinf(inclination), 0.0f);
+}
+
+static float spinSpeed(std::mt19937 & generator){
+	// As rotateEarth : one turn a minute for a day
+	return STRESS_PI * 2.0f / (60.0f * randomStress(generator, STRESS_MIN_DAYS, STRESS_MAX_DAYS));
+}
+
+void buildStressScene(const StressSceneConfig & config, float meshRadius, float sunScale, unsigned int textureCount, std::vector<StressBody> & out_bodies){
+	std::mt19937 generator(config.seed);
+	float sunRadius = meshRadius * sunScale;
+	float gravity = asteroidBeltGravity();
+
+	out_bodies.clear();
+	out_bodies.reserve(config.bodies * (1 + config.moons));
+	for (unsigned int p = 0; p < config.bodies; p++){
+		StressBody planet;
+		planet.parent = -1;
+		planet.orbitRadius = sunRadius * randomStress(generator, 1.3f, 12.0f);
+		planet.orbitSpeed = sqrtf(gravity / (planet.orbitRadius * planet.orbitRadius * planet.orbitRadius));
+		planet.orbitAngle = randomStress(generator, 0.0f, 2.0f * STRESS_PI);
+		orbitPlane(randomStress(generator, 0.0f, 2.0f * STRESS_PI), randomStress(generator, -STRESS_MAX_INCLINATION, STRESS_MAX_INCLINATION), planet);
+		planet.scale = randomStress(generator, STRESS_PLANET_MIN_SCALE, STRESS_PLANET_MAX_SCALE);
+		planet.spinAngle = randomStress(generator, 0.0f, 2.0f * STRESS_PI);
+		planet.spinSpeed = spinSpeed(generator);
+		planet.texture = generator() % textureCount;
+		planet.lod = 0;
+		int parent = (int)out_bodies.size();
+		out_bodies.push_back(planet);
+
+		// The mass of a planet is the Sun's times the cube of their ratio of sizes, as if of the same density
+		float planetRadius = meshRadius * planet.scale;
+		float ratio = planet.scale / sunScale;
+		float planetGravity = gravity * ratio * ratio * ratio;
+		for (unsigned int m = 0; m < config.moons; m++){
+			StressBody moon;
+			moon.parent = parent;
+			moon.orbitRadius = planetRadius * (STRESS_MOON_FIRST_ORBIT + STRESS_MOON_SPACING * (m + randomStress(generator, 0.0f, 0.5f)));
+			moon.orbitSpeed = sqrtf(planetGravity / (moon.orbitRadius * moon.orbitRadius * moon.orbitRadius));
+			moon.orbitAngle = randomStress(generator, 0.0f, 2.0f * STRESS_PI);
+			orbitPlane(randomStress(generator, 0.0f, 2.0f * STRESS_PI), randomStress(generator, -4.0f * STRESS_MAX_INCLINATION, 4.0f * STRESS_MAX_INCLINATION), moon);
+			moon.scale = planet.scale * randomStress(generator, STRESS_MOON_MIN_SCALE, STRESS_MOON_MAX_SCALE);
+			moon.spinAngle = 0.0f;
+			// Tidally locked
+			moon.spinSpeed = moon.orbitSpeed;
+			moon.texture = generator() % textureCount;
+			moon.lod = 0;
+			out_bodies.push_back(moon);
+		}
+	}
+	updateStressScene(out_bodies, 0.0f);
+}
+
+void updateStressScene(std::vector<StressBody> & bodies, float seconds){
+	for (unsigned int i = 0; i < bodies.size(); i++){
+		StressBody & body = bodies[i];
+		body.orbitAngle = fmodf(body.orbitAngle + body.orbitSpeed * seconds, 2.0f * STRESS_PI);
+		body.spinAngle = fmodf(body.spinAngle + body.spinSpeed * seconds, 2.0f * STRESS_PI);
+		// The planets are before their moons : the parent is already placed
+		glm::vec3 center = body.parent >= 0 ? bodies[body.parent].position : glm::vec3(0.0f);
+		body.position = center + body.orbitRadius * (cosf(body.orbitAngle) * body.orbitU + sinf(body.orbitAngle) * body.orbitV);
+	}
+}
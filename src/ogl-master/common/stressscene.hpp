@@ -0,0 +1,42 @@
+#ifndef STRESSSCENE_HPP
+#define STRESSSCENE_HPP
+
+// Generated scenes for the scaling tests : planets on circular orbits around the origin, moons on
+// circular orbits around them, each with a mesh scale, a spin and one of the caller's textures.
+// The same configuration always generates the same scene.
+
+struct StressSceneConfig {
+	unsigned int bodies;      // planets
+	unsigned int moons;       // per planet
+	unsigned int asteroids;   // in the belt, for the caller (see common/asteroidbelt.hpp)
+	unsigned int seed;
+};
+
+struct StressBody {
+	int parent;              // index of the planet a moon orbits, before it ; -1 for the planets
+	float orbitRadius;
+	float orbitSpeed;        // radians per second
+	float orbitAngle;
+	glm::vec3 orbitU;        // orthonormal axes of the plane of the orbit
+	glm::vec3 orbitV;
+	float scale;             // of the mesh
+	float spinAngle;         // around the vertical axis
+	float spinSpeed;
+	unsigned int texture;    // index in the caller's textures
+	glm::vec3 position;      // in the world, by updateStressScene
+	int lod;                 // left to the caller
+};
+
+// "bodies=N,moons=M,asteroids=K,seed=S", in any order : the missing values are 0, and 1 for the seed.
+// At most 2^20 planets and moons in all, and ASTEROID_BELT_MAX_COUNT asteroids.
+// false, with a message, on anything else or more.
+bool parseStressSceneConfig(const char * text, StressSceneConfig & out_config);
+
+// The planets orbit between 1.3 and 12 times the radius of the central body, meshRadius * sunScale,
+// with the gravity of asteroidBeltGravity(). textureCount is at least 1. Positions at time 0.
+void buildStressScene(const StressSceneConfig & config, float meshRadius, float sunScale, unsigned int textureCount, std::vector<StressBody> & out_bodies);
+
+// Advances the orbits and the spins by seconds, and places the bodies
+void updateStressScene(std::vector<StressBody> & bodies, float seconds);
+
+#endif
@@ -10,11 +10,26 @@ using namespace glm;
 #include "shader.hpp"
 #include "texture.hpp"
 
+#include "streambuffer.hpp"
 #include "text2D.hpp"
 
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+// The glyphs are written in a stream buffer of TEXT2D_SECTIONS sections of TEXT2D_SECTION_GLYPHS
+#define TEXT2D_SECTION_GLYPHS 4096
+#define TEXT2D_SECTIONS 3
+
+struct TextVertex {
+	glm::vec2 position;
+	glm::vec2 UV;
+};
+
 unsigned int Text2DTextureID;
-unsigned int Text2DVertexBufferID;
-unsigned int Text2DUVBufferID;
+unsigned int Text2DVertexArrayID;
+StreamBuffer Text2DVertices;
+unsigned int Text2DIndexBufferID;
 unsigned int Text2DShaderID;
 unsigned int Text2DUniformID;
 
@@ -23,9 +38,40 @@ void initText2D(const char * texturePath){
 	// Initialize texture
 	Text2DTextureID = loadDDS(texturePath);
 
-	// Initialize VBO
-	glGenBuffers(1, &Text2DVertexBufferID);
-	glGenBuffers(1, &Text2DUVBufferID);
+	// Initialize VAO : the text's attributes don't touch the caller's vertex array
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glGenVertexArrays(1, &Text2DVertexArrayID);
+	glBindVertexArray(Text2DVertexArrayID);
+
+	// Initialize VBO : 4 vertices per glyph
+	createStreamBuffer(GL_ARRAY_BUFFER, TEXT2D_SECTION_GLYPHS * 4 * sizeof(TextVertex), TEXT2D_SECTIONS, Text2DVertices);
+
+	// 1rst attribute : vertices
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)0 );
+
+	// 2nd attribute : UVs
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(sizeof(glm::vec2)) );
+
+	// The two triangles of each glyph of a section, the draws start at the section's first vertex
+	std::vector<unsigned short> indices;
+	for (unsigned short i=0; i<TEXT2D_SECTION_GLYPHS; i++){
+		unsigned short up_left = i*4, down_left = i*4+1, up_right = i*4+2, down_right = i*4+3;
+		indices.push_back(up_left);
+		indices.push_back(down_left);
+		indices.push_back(up_right);
+
+		indices.push_back(down_right);
+		indices.push_back(up_right);
+		indices.push_back(down_left);
+	}
+	glGenBuffers(1, &Text2DIndexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Text2DIndexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+
+	glBindVertexArray(previousVertexArrayID);
 
 	// Initialize Shader
 	Text2DShaderID = LoadShaders( "TextVertexShader.vertexshader", "TextVertexShader.fragmentshader" );
@@ -33,50 +79,52 @@ void initText2D(const char * texturePath){
 	// Initialize uniforms' IDs
 	Text2DUniformID = glGetUniformLocation( Text2DShaderID, "myTextureSampler" );
 
+	// Set our "myTextureSampler" sampler to use Texture Unit 0, once
+	GLint previousProgramID;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgramID);
+	glUseProgram(Text2DShaderID);
+	glUniform1i(Text2DUniformID, 0);
+	glUseProgram(previousProgramID);
+
 }
 
-void printText2D(const char * text, int x, int y, int size){
+void addText2D(const char * text, int x, int y, int size){
 
 	unsigned int length = strlen(text);
-
-	// Fill buffers
-	std::vector<glm::vec2> vertices;
-	std::vector<glm::vec2> UVs;
 	for ( unsigned int i=0 ; i<length ; i++ ){
-		
-		glm::vec2 vertex_up_left    = glm::vec2( x+i*size     , y+size );
-		glm::vec2 vertex_up_right   = glm::vec2( x+i*size+size, y+size );
-		glm::vec2 vertex_down_right = glm::vec2( x+i*size+size, y      );
-		glm::vec2 vertex_down_left  = glm::vec2( x+i*size     , y      );
-
-		vertices.push_back(vertex_up_left   );
-		vertices.push_back(vertex_down_left );
-		vertices.push_back(vertex_up_right  );
 
-		vertices.push_back(vertex_down_right);
-		vertices.push_back(vertex_up_right);
-		vertices.push_back(vertex_down_left);
+		TextVertex * glyph = (TextVertex *)writeStreamBuffer(Text2DVertices, 4 * sizeof(TextVertex));
+		if (glyph == NULL){
+			// The section is full : its glyphs are drawn before moving to the next one
+			flushText2D();
+			nextStreamBufferSection(Text2DVertices);
+			glyph = (TextVertex *)writeStreamBuffer(Text2DVertices, 4 * sizeof(TextVertex));
+		}
 
 		char character = text[i];
 		float uv_x = (character%16)/16.0f;
 		float uv_y = (character/16)/16.0f;
 
-		glm::vec2 uv_up_left    = glm::vec2( uv_x           , uv_y );
-		glm::vec2 uv_up_right   = glm::vec2( uv_x+1.0f/16.0f, uv_y );
-		glm::vec2 uv_down_right = glm::vec2( uv_x+1.0f/16.0f, (uv_y + 1.0f/16.0f) );
-		glm::vec2 uv_down_left  = glm::vec2( uv_x           , (uv_y + 1.0f/16.0f) );
-		UVs.push_back(uv_up_left   );
-		UVs.push_back(uv_down_left );
-		UVs.push_back(uv_up_right  );
-
-		UVs.push_back(uv_down_right);
-		UVs.push_back(uv_up_right);
-		UVs.push_back(uv_down_left);
+		// up left, down left, up right, down right
+		glyph[0].position = glm::vec2( x+i*size     , y+size );
+		glyph[1].position = glm::vec2( x+i*size     , y      );
+		glyph[2].position = glm::vec2( x+i*size+size, y+size );
+		glyph[3].position = glm::vec2( x+i*size+size, y      );
+		glyph[0].UV = glm::vec2( uv_x           , uv_y );
+		glyph[1].UV = glm::vec2( uv_x           , (uv_y + 1.0f/16.0f) );
+		glyph[2].UV = glm::vec2( uv_x+1.0f/16.0f, uv_y );
+		glyph[3].UV = glm::vec2( uv_x+1.0f/16.0f, (uv_y + 1.0f/16.0f) );
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), &vertices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
-	glBufferData(GL_ARRAY_BUFFER, UVs.size() * sizeof(glm::vec2), &UVs[0], GL_STATIC_DRAW);
+
+}
+
+void flushText2D(){
+
+	size_t offset;
+	unsigned int count = commitStreamBuffer(Text2DVertices, offset) / (4 * sizeof(TextVertex));
+	if (count == 0)
+		return;
+	unsigned int firstVertex = offset / sizeof(TextVertex);
 
 	// Bind shader
 	glUseProgram(Text2DShaderID);
@@ -84,37 +132,35 @@ void printText2D(const char * text, int x, int y, int size){
 	// Bind texture
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, Text2DTextureID);
-	// Set our "myTextureSampler" sampler to use Texture Unit 0
-	glUniform1i(Text2DUniformID, 0);
 
-	// 1rst attribute buffer : vertices
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
-
-	// 2nd attribute buffer : UVs
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
+	// Our own vertex array, the caller's is bound back at the end
+	GLint previousVertexArrayID;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArrayID);
+	glBindVertexArray(Text2DVertexArrayID);
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// Draw call
-	glDrawArrays(GL_TRIANGLES, 0, vertices.size() );
+	glDrawElementsBaseVertex(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, (void*)0, firstVertex);
 
 	glDisable(GL_BLEND);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
+	glBindVertexArray(previousVertexArrayID);
 
 }
 
+void printText2D(const char * text, int x, int y, int size){
+	addText2D(text, x, y, size);
+	flushText2D();
+}
+
 void cleanupText2D(){
 
 	// Delete buffers
-	glDeleteBuffers(1, &Text2DVertexBufferID);
-	glDeleteBuffers(1, &Text2DUVBufferID);
+	deleteStreamBuffer(Text2DVertices);
+	glDeleteBuffers(1, &Text2DIndexBufferID);
+	glDeleteVertexArrays(1, &Text2DVertexArrayID);
 
 	// Delete texture
 	glDeleteTextures(1, &Text2DTextureID);
@@ -2,7 +2,14 @@
 #define TEXT2D_HPP
 
 void initText2D(const char * texturePath);
+
+// Batched text : addText2D only writes the glyphs, flushText2D draws all the glyphs added since
+// the last flush with one draw call. Nothing is allocated once initText2D returned.
+void addText2D(const char * text, int x, int y, int size);
+void flushText2D();
+
+// addText2D then flushText2D : one draw per string
 void printText2D(const char * text, int x, int y, int size);
 void cleanupText2D();
 
-#endif
\ No newline at end of file
+#endif
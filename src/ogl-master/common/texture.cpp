@@ -2,48 +2,58 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <vector>
+
 #include <GL/glew.h>
 
 #include <GLFW/glfw3.h>
 
+#include "mappedfile.hpp"
+#include "texture.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
 
 GLuint loadBMP_custom(const char * imagepath){
 
 	printf("Reading image %s\n", imagepath);
 
 	// Data read from the header of the BMP file
-	unsigned char header[54];
+	const unsigned char * header;
 	unsigned int dataPos;
 	unsigned int imageSize;
 	unsigned int width, height;
 	// Actual RGB data
-	unsigned char * data;
+	const unsigned char * data;
 
-	// Open the file
-	FILE * file = fopen(imagepath,"rb");
-	if (!file){
+	// Map the file
+	MappedFile file;
+	if (!mapFile(imagepath, file)){
 		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
 		getchar();
 		return 0;
 	}
 
 	// Read the header, i.e. the 54 first bytes
+	header = file.data;
 
 	// If less than 54 bytes are read, problem
-	if ( fread(header, 1, 54, file)!=54 ){ 
+	if ( file.size < 54 ){ 
 		printf("Not a correct BMP file\n");
-		fclose(file);
+		unmapFile(file);
 		return 0;
 	}
 	// A BMP files always begins with "BM"
 	if ( header[0]!='B' || header[1]!='M' ){
 		printf("Not a correct BMP file\n");
-		fclose(file);
+		unmapFile(file);
 		return 0;
 	}
 	// Make sure this is a 24bpp file
-	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    fclose(file); return 0;}
-	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    fclose(file); return 0;}
+	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    unmapFile(file); return 0;}
+	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    unmapFile(file); return 0;}
 
 	// Read the information about the image
 	dataPos    = *(int*)&(header[0x0A]);
@@ -55,14 +65,14 @@ GLuint loadBMP_custom(const char * imagepath){
 	if (imageSize==0)    imageSize=width*height*3; // 3 : one byte for each Red, Green and Blue component
 	if (dataPos==0)      dataPos=54; // The BMP header is done that way
 
-	// Create a buffer
-	data = new unsigned char [imageSize];
-
-	// Read the actual data from the file into the buffer
-	fread(data,1,imageSize,file);
+	if ( dataPos > file.size || imageSize > file.size - dataPos ){
+		printf("Not a correct BMP file\n");
+		unmapFile(file);
+		return 0;
+	}
 
-	// Everything is in memory now, the file can be closed.
-	fclose (file);
+	// The pixels are read straight from the mapping
+	data = file.data + dataPos;
 
 	// Create one OpenGL texture
 	GLuint textureID;
@@ -74,8 +84,8 @@ GLuint loadBMP_custom(const char * imagepath){
 	// Give the image to OpenGL
 	glTexImage2D(GL_TEXTURE_2D, 0,GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
 
-	// OpenGL has now copied the data. Free our own version
-	delete [] data;
+	// OpenGL has now copied the data. The file can be closed.
+	unmapFile(file);
 
 	// Poor filtering, or ...
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -121,98 +131,277 @@ GLuint loadBMP_custom(const char * imagepath){
 
 
 #define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
+#define FOURCC_DXT2 0x32545844
 #define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
+#define FOURCC_DXT4 0x34545844
 #define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+#define FOURCC_ATI1 0x31495441
+#define FOURCC_BC4U 0x55344342
+#define FOURCC_BC4S 0x53344342
+#define FOURCC_ATI2 0x32495441
+#define FOURCC_BC5U 0x55354342
+#define FOURCC_BC5S 0x53354342
+#define FOURCC_DX10 0x30315844 // An extended header follows the DDS header
+
+// Offsets in the DDS header (after the "DDS " magic)
+#define DDS_HEADER_SIZE       124
+#define DDS_HEADER_DX10_SIZE  20
+#define DDSD_MIPMAPCOUNT      0x20000
+#define DDSD_DEPTH            0x800000
+#define DDSCAPS2_CUBEMAP      0x200
+#define DDSCAPS2_CUBEMAP_ALL  0xFC00
+#define DDSCAPS2_VOLUME       0x200000
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_MISC_TEXTURECUBE  0x4
+
+// Largest texture we accept, so that the size computations can't overflow
+#define DDS_MAX_SIZE 16384
+
+static unsigned int readUint(const unsigned char * p){
+	unsigned int value;
+	memcpy(&value, p, 4);
+	return value;
+}
 
-GLuint loadDDS(const char * imagepath){
+// Block compressed format for a legacy FourCC code or a DX10 DXGI_FORMAT
+static bool ddsFormat(unsigned int fourCC, unsigned int dxgiFormat, GLenum & format, unsigned int & blockSize){
+	if (fourCC != FOURCC_DX10){
+		switch(fourCC)
+		{
+		case FOURCC_DXT1: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; blockSize = 8; return true;
+		case FOURCC_DXT2:
+		case FOURCC_DXT3: format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; blockSize = 16; return true;
+		case FOURCC_DXT4:
+		case FOURCC_DXT5: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; blockSize = 16; return true;
+		case FOURCC_ATI1:
+		case FOURCC_BC4U: format = GL_COMPRESSED_RED_RGTC1; blockSize = 8; return true;
+		case FOURCC_BC4S: format = GL_COMPRESSED_SIGNED_RED_RGTC1; blockSize = 8; return true;
+		case FOURCC_ATI2:
+		case FOURCC_BC5U: format = GL_COMPRESSED_RG_RGTC2; blockSize = 16; return true;
+		case FOURCC_BC5S: format = GL_COMPRESSED_SIGNED_RG_RGTC2; blockSize = 16; return true;
+		default: return false;
+		}
+	}
 
-	unsigned char header[124];
+	switch(dxgiFormat)
+	{
+	case 70: // BC1_TYPELESS
+	case 71: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; blockSize = 8; return true;
+	case 72: format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; blockSize = 8; return true;
+	case 73: // BC2_TYPELESS
+	case 74: format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; blockSize = 16; return true;
+	case 75: format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT; blockSize = 16; return true;
+	case 76: // BC3_TYPELESS
+	case 77: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; blockSize = 16; return true;
+	case 78: format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; blockSize = 16; return true;
+	case 79: // BC4_TYPELESS
+	case 80: format = GL_COMPRESSED_RED_RGTC1; blockSize = 8; return true;
+	case 81: format = GL_COMPRESSED_SIGNED_RED_RGTC1; blockSize = 8; return true;
+	case 82: // BC5_TYPELESS
+	case 83: format = GL_COMPRESSED_RG_RGTC2; blockSize = 16; return true;
+	case 84: format = GL_COMPRESSED_SIGNED_RG_RGTC2; blockSize = 16; return true;
+	case 94: // BC6H_TYPELESS
+	case 95: format = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; blockSize = 16; return true;
+	case 96: format = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT; blockSize = 16; return true;
+	case 97: // BC7_TYPELESS
+	case 98: format = GL_COMPRESSED_RGBA_BPTC_UNORM; blockSize = 16; return true;
+	case 99: format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; blockSize = 16; return true;
+	default: return false;
+	}
+}
 
-	FILE *fp; 
- 
-	/* try to open the file */ 
-	fp = fopen(imagepath, "rb"); 
-	if (fp == NULL){
-		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); 
-		return 0;
+static bool invalidDDS(const char * imagepath, const char * reason, DDSImage & image){
+	printf("%s is not a valid DDS file : %s\n", imagepath, reason);
+	freeDDS(image);
+	return false;
+}
+
+bool readDDS(const char * imagepath, DDSImage & out_image){
+
+	out_image.data = NULL;
+	out_image.dataSize = 0;
+	out_image.levels.clear();
+
+	/* map the file : the pixel data is uploaded from the mapping, without any copy */
+	if (!mapFile(imagepath, out_image.file)){
+		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
+		return false;
 	}
-   
-	/* verify the type of file */ 
-	char filecode[4]; 
-	fread(filecode, 1, 4, fp); 
-	if (strncmp(filecode, "DDS ", 4) != 0) { 
-		fclose(fp); 
-		return 0; 
+	const unsigned char * file = out_image.file.data;
+	size_t fileSize = out_image.file.size;
+
+	/* verify the type of file */
+	if (fileSize < 4 + DDS_HEADER_SIZE || strncmp((const char *)file, "DDS ", 4) != 0)
+		return invalidDDS(imagepath, "bad header", out_image);
+
+	/* get the surface desc */
+	const unsigned char * header = file + 4;
+	unsigned int headerSize  = readUint(header);
+	unsigned int flags       = readUint(header + 4);
+	unsigned int height      = readUint(header + 8);
+	unsigned int width       = readUint(header + 12);
+	unsigned int mipMapCount = readUint(header + 24);
+	unsigned int fourCC      = readUint(header + 80);
+	unsigned int caps2       = readUint(header + 108);
+	if (headerSize != DDS_HEADER_SIZE)
+		return invalidDDS(imagepath, "bad header size", out_image);
+
+	size_t dataOffset = 4 + DDS_HEADER_SIZE;
+	unsigned int dxgiFormat = 0;
+	unsigned int arraySize = 1;
+	bool cube;
+	if (fourCC == FOURCC_DX10){
+		if (fileSize < dataOffset + DDS_HEADER_DX10_SIZE)
+			return invalidDDS(imagepath, "truncated DX10 header", out_image);
+		const unsigned char * dx10 = file + dataOffset;
+		dxgiFormat = readUint(dx10);
+		if (readUint(dx10 + 4) != DDS_DIMENSION_TEXTURE2D)
+			return invalidDDS(imagepath, "only 2D textures are supported", out_image);
+		cube = (readUint(dx10 + 8) & DDS_MISC_TEXTURECUBE) != 0;
+		arraySize = readUint(dx10 + 12);
+		dataOffset += DDS_HEADER_DX10_SIZE;
+	} else {
+		if ((flags & DDSD_DEPTH) || (caps2 & DDSCAPS2_VOLUME))
+			return invalidDDS(imagepath, "volume textures are not supported", out_image);
+		cube = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+		if (cube && (caps2 & DDSCAPS2_CUBEMAP_ALL) != DDSCAPS2_CUBEMAP_ALL)
+			return invalidDDS(imagepath, "cube maps need all 6 faces", out_image);
 	}
-	
-	/* get the surface desc */ 
-	fread(&header, 124, 1, fp); 
-
-	unsigned int height      = *(unsigned int*)&(header[8 ]);
-	unsigned int width	     = *(unsigned int*)&(header[12]);
-	unsigned int linearSize	 = *(unsigned int*)&(header[16]);
-	unsigned int mipMapCount = *(unsigned int*)&(header[24]);
-	unsigned int fourCC      = *(unsigned int*)&(header[80]);
-
- 
-	unsigned char * buffer;
-	unsigned int bufsize;
-	/* how big is it going to be including all mipmaps? */ 
-	bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize; 
-	buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char)); 
-	fread(buffer, 1, bufsize, fp); 
-	/* close the file pointer */ 
-	fclose(fp);
-
-	unsigned int components  = (fourCC == FOURCC_DXT1) ? 3 : 4; 
-	unsigned int format;
-	switch(fourCC) 
-	{ 
-	case FOURCC_DXT1: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; 
-		break; 
-	case FOURCC_DXT3: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; 
-		break; 
-	case FOURCC_DXT5: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; 
-		break; 
-	default: 
-		free(buffer); 
-		return 0; 
+
+	if (!ddsFormat(fourCC, dxgiFormat, out_image.format, out_image.blockSize))
+		return invalidDDS(imagepath, "unsupported format", out_image);
+	if (width == 0 || height == 0 || width > DDS_MAX_SIZE || height > DDS_MAX_SIZE)
+		return invalidDDS(imagepath, "bad dimensions", out_image);
+	if (cube && width != height)
+		return invalidDDS(imagepath, "cube map faces are not square", out_image);
+	if (arraySize == 0 || arraySize > 2048)
+		return invalidDDS(imagepath, "bad array size", out_image);
+
+	// Levels down to 1x1 at most
+	unsigned int maxLevels = 1;
+	while ((width >> maxLevels) > 0 || (height >> maxLevels) > 0)
+		maxLevels++;
+	if (!(flags & DDSD_MIPMAPCOUNT) || mipMapCount == 0)
+		mipMapCount = 1;
+	if (mipMapCount > maxLevels)
+		return invalidDDS(imagepath, "too many mipmaps", out_image);
+
+	/* exact size of each mipmap, from the number of 4x4 blocks */
+	out_image.layerSize = 0;
+	for (unsigned int level = 0; level < mipMapCount; ++level)
+	{
+		DDSLevel l;
+		l.width = width >> level;
+		l.height = height >> level;
+		// Deal with Non-Power-Of-Two textures.
+		if(l.width < 1) l.width = 1;
+		if(l.height < 1) l.height = 1;
+		l.offset = out_image.layerSize;
+		l.size = ((l.width+3)/4)*((l.height+3)/4)*out_image.blockSize;
+		out_image.levels.push_back(l);
+		out_image.layerSize += l.size;
+	}
+
+	// Array elements (each with its 6 faces for cube maps) follow each other, with all their mipmaps
+	out_image.layers = arraySize * (cube ? 6 : 1);
+	unsigned long long dataSize = (unsigned long long)out_image.layerSize * out_image.layers;
+	if (dataSize > fileSize - dataOffset)
+		return invalidDDS(imagepath, "file is truncated", out_image);
+
+	if (cube)
+		out_image.target = arraySize > 1 ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+	else
+		out_image.target = arraySize > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	out_image.width = width;
+	out_image.height = height;
+	out_image.data = file + dataOffset;
+	out_image.dataSize = (size_t)dataSize;
+	return true;
+}
+
+void freeDDS(DDSImage & image){
+	unmapFile(image.file);
+	image.data = NULL;
+	image.dataSize = 0;
+}
+
+GLuint uploadDDSLevels(const DDSImage & image, GLuint textureID, unsigned int firstLevel, unsigned int lastLevel){
+
+	if (image.target == GL_TEXTURE_CUBE_MAP_ARRAY && !GLEW_VERSION_4_0 && !GLEW_ARB_texture_cube_map_array){
+		printf("Cube map arrays are not supported by this OpenGL implementation\n");
+		return 0;
 	}
 
 	// Create one OpenGL texture
-	GLuint textureID;
-	glGenTextures(1, &textureID);
+	if (textureID == 0)
+		glGenTextures(1, &textureID);
 
 	// "Bind" the newly created texture : all future texture functions will modify this texture
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	glBindTexture(image.target, textureID);
 	glPixelStorei(GL_UNPACK_ALIGNMENT,1);	
-	
-	unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16; 
-	unsigned int offset = 0;
+
+	// Read from the bound pixel unpack buffer, if any
+	GLint unpackBuffer = 0;
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+	const unsigned char * buffer = unpackBuffer ? NULL : image.data;
 
 	/* load the mipmaps */ 
-	for (unsigned int level = 0; level < mipMapCount && (width || height); ++level) 
+	unsigned int levelCount = image.levels.size();
+	for (unsigned int level = firstLevel; level <= lastLevel && level < levelCount; ++level) 
 	{ 
-		unsigned int size = ((width+3)/4)*((height+3)/4)*blockSize; 
-		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height,  
-			0, size, buffer + offset); 
-	 
-		offset += size; 
-		width  /= 2; 
-		height /= 2; 
-
-		// Deal with Non-Power-Of-Two textures. This code is not included in the webpage to reduce clutter.
-		if(width < 1) width = 1;
-		if(height < 1) height = 1;
-
+		const DDSLevel & l = image.levels[level];
+		switch (image.target){
+		case GL_TEXTURE_2D:
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format, l.width, l.height,  
+				0, l.size, buffer + l.offset); 
+			break;
+		case GL_TEXTURE_CUBE_MAP:
+			for (unsigned int face = 0; face < 6; ++face)
+				glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, image.format, l.width, l.height,
+					0, l.size, buffer + face * image.layerSize + l.offset);
+			break;
+		default:
+			// Arrays : allocate the level for all the layers (not from the unpack buffer),
+			// then fill the layers one by one since the file stores them one after the other
+			if (unpackBuffer)
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glCompressedTexImage3D(image.target, level, image.format, l.width, l.height, image.layers,
+				0, l.size * image.layers, NULL);
+			if (unpackBuffer)
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+			for (unsigned int layer = 0; layer < image.layers; ++layer)
+				glCompressedTexSubImage3D(image.target, level, 0, 0, layer, l.width, l.height, 1,
+					image.format, l.size, buffer + layer * image.layerSize + l.offset);
+			break;
+		}
 	} 
 
-	free(buffer); 
+	return textureID;
+}
+
+GLuint uploadDDS(const DDSImage & image, GLuint textureID){
+
+	unsigned int levelCount = image.levels.size();
+	textureID = uploadDDSLevels(image, textureID, 0, levelCount - 1);
+	if (textureID == 0)
+		return 0;
+
+	// Only sample the levels we have (the texture may have been a placeholder before)
+	glTexParameteri(image.target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(image.target, GL_TEXTURE_MAX_LEVEL, levelCount > 0 ? levelCount - 1 : 0);
 
 	return textureID;
+}
+
+GLuint loadDDS(const char * imagepath){
 
+	DDSImage image;
+	if (!readDDS(imagepath, image)){
+		getchar();
+		return 0;
+	}
 
-}
\ No newline at end of file
+	GLuint textureID = uploadDDS(image, 0);
+	freeDDS(image);
+	return textureID;
+}
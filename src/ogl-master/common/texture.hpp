@@ -1,6 +1,10 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
+#include <vector>
+
+#include "mappedfile.hpp"
+
 // Load a .BMP file using our custom loader
 GLuint loadBMP_custom(const char * imagepath);
 
@@ -12,5 +16,36 @@ GLuint loadBMP_custom(const char * imagepath);
 // Load a .DDS file using GLFW's own loader
 GLuint loadDDS(const char * imagepath);
 
+// A .DDS file mapped in memory, ready to be uploaded. Supports BC1 to BC7 (DXT1/3/5, RGTC, BPTC),
+// and through the DX10 header, sRGB formats, texture arrays, cube maps and cube map arrays.
+// readDDS doesn't call OpenGL, so it can run on any thread.
+struct DDSLevel {
+	unsigned int width;
+	unsigned int height;
+	size_t offset;                // from the start of the layer
+	size_t size;                  // exact, from the number of 4x4 blocks
+};
+struct DDSImage {
+	GLenum target;                // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_CUBE_MAP_ARRAY
+	GLenum format;                // GL_COMPRESSED_xxx
+	unsigned int width;
+	unsigned int height;
+	unsigned int blockSize;       // bytes per 4x4 block
+	unsigned int layers;          // array size, times 6 for cube maps
+	std::vector<DDSLevel> levels; // mipmaps of one layer
+	size_t layerSize;             // a layer and all its mipmaps
+	const unsigned char * data;   // pixel data of all the layers, points in the mapped file
+	size_t dataSize;
+	MappedFile file;
+};
+// Maps the file and checks that every mipmap of every layer fits in it
+bool readDDS(const char * imagepath, DDSImage & out_image);
+void freeDDS(DDSImage & image);
+
+// Uploads the image in the given texture, or in a new one if textureID is 0.
+// When a pixel unpack buffer is bound, data is read from it (at the same offsets) instead of image.data.
+GLuint uploadDDS(const DDSImage & image, GLuint textureID);
+// Same for the levels from firstLevel to lastLevel only. The texture parameters are left alone.
+GLuint uploadDDSLevels(const DDSImage & image, GLuint textureID, unsigned int firstLevel, unsigned int lastLevel);
 
 #endif
\ No newline at end of file
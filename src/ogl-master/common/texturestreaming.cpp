@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "texture.hpp"
+#include "mesh.hpp"
+#include "assetloader.hpp"
+#include "texturestreaming.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+// Levels per second at which GL_TEXTURE_MIN_LOD follows a new base level
+#define STREAMING_FADE_SPEED 2.0f
+
+struct StreamedTexture {
+	GLuint texture;
+	DDSImage image;
+	unsigned int tailLevel;       // this level and the coarser ones are always resident
+	unsigned int residentLevel;   // finest resident level, the texture's base level
+	int loadingLevel;             // level read by a worker, or -1
+	bool loadingReady;            // the worker is done, the level can be uploaded
+	GLuint stagingBuffer;         // pixel unpack buffer the worker copies the level into
+	void * staging;               // where it is mapped
+	bool unloaded;                // deleted while a level was loading
+	float screenTexels;
+	float minLod;
+};
+
+static std::vector<StreamedTexture *> streamedTextures;
+static size_t budgetBytes = 64 * 1024 * 1024;
+static size_t uploadBudgetBytes = 2 * 1024 * 1024;
+static unsigned int tailSize = 64;
+static size_t residentBytes = 0;
+static size_t uploadedBytes = 0;
+
+void setTextureStreamingBudget(size_t residentBytes, size_t uploadBytesPerFrame, unsigned int tail){
+	budgetBytes = residentBytes;
+	uploadBudgetBytes = uploadBytesPerFrame;
+	tailSize = tail;
+}
+
+size_t streamedTextureMemory(){
+	return residentBytes;
+}
+
+size_t streamedTextureUploadedBytes(){
+	return uploadedBytes;
+}
+
+static StreamedTexture * findStreamedTexture(GLuint textureID){
+	for (unsigned int i = 0; i < streamedTextures.size(); i++)
+		if (streamedTextures[i]->texture == textureID)
+			return streamedTextures[i];
+	return NULL;
+}
+
+// Coarsest level still sampled 1:1 on screen
+static unsigned int wantedLevel(const StreamedTexture & t){
+	unsigned int level = 0;
+	while (level < t.tailLevel && t.image.levels[level + 1].width >= t.screenTexels)
+		level++;
+	return level;
+}
+
+// How much the texture would gain from its next finer level : above 1, it is magnified on screen
+static float streamingPriority(const StreamedTexture & t){
+	return t.screenTexels / t.image.levels[t.residentLevel].width;
+}
+
+// minLod is in levels of the whole chain, GL_TEXTURE_MIN_LOD is relative to the base level
+static void setBaseLevel(StreamedTexture & t, unsigned int level){
+	t.residentLevel = level;
+	t.minLod = std::max(t.minLod, (float)level);
+	glBindTexture(GL_TEXTURE_2D, t.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, t.minLod - level);
+}
+
+GLuint loadDDSStreamed(const char * imagepath){
+	StreamedTexture * t = new StreamedTexture();
+	if (!readDDS(imagepath, t->image)){
+		delete t;
+		return 0;
+	}
+	if (t->image.target != GL_TEXTURE_2D){
+		GLuint textureID = uploadDDS(t->image, 0);
+		freeDDS(t->image);
+		delete t;
+		return textureID;
+	}
+
+	unsigned int levelCount = t->image.levels.size();
+	t->tailLevel = 0;
+	while (t->tailLevel + 1 < levelCount &&
+		(t->image.levels[t->tailLevel].width > tailSize || t->image.levels[t->tailLevel].height > tailSize))
+		t->tailLevel++;
+
+	t->texture = uploadDDSLevels(t->image, 0, t->tailLevel, levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	t->minLod = (float)t->tailLevel;
+	setBaseLevel(*t, t->tailLevel);
+	t->loadingLevel = -1;
+	t->stagingBuffer = 0;
+	t->staging = NULL;
+	t->screenTexels = 0.0f;
+
+	for (unsigned int level = t->tailLevel; level < levelCount; level++)
+		residentBytes += t->image.levels[level].size;
+	streamedTextures.push_back(t);
+	return t->texture;
+}
+
+// Unmaps and deletes the level's staging buffer. False when its contents were lost while mapped.
+static bool dropStagingBuffer(StreamedTexture * t){
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, t->stagingBuffer);
+	bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &t->stagingBuffer);
+	t->stagingBuffer = 0;
+	t->staging = NULL;
+	return ok;
+}
+
+static void deleteStreamedTexture(StreamedTexture * t){
+	if (t->staging != NULL)
+		dropStagingBuffer(t);
+	freeDDS(t->image);
+	delete t;
+}
+
+void unloadStreamedTexture(GLuint textureID){
+	StreamedTexture * t = findStreamedTexture(textureID);
+	if (t == NULL){
+		glDeleteTextures(1, &textureID);
+		return;
+	}
+	streamedTextures.erase(std::find(streamedTextures.begin(), streamedTextures.end(), t));
+	for (unsigned int level = t->residentLevel; level < t->image.levels.size(); level++)
+		residentBytes -= t->image.levels[level].size;
+	glDeleteTextures(1, &t->texture);
+	t->texture = 0;
+
+	// The worker still reads the file : the last one out deletes the texture
+	if (t->loadingLevel >= 0 && !t->loadingReady)
+		t->unloaded = true;
+	else
+		deleteStreamedTexture(t);
+}
+
+void setStreamedTextureSize(GLuint textureID, float screenTexels){
+	StreamedTexture * t = findStreamedTexture(textureID);
+	if (t != NULL)
+		t->screenTexels = screenTexels;
+}
+
+// On the worker : reads the level from the mapped file into the staging buffer
+static void copyLevel(StreamedTexture * t, int level){
+	const DDSLevel & l = t->image.levels[level];
+	memcpy(t->staging, t->image.data + l.offset, l.size);
+}
+
+// Maps a pixel unpack buffer of the level's size, for copyLevel. False when it can't be mapped.
+static bool mapStagingBuffer(StreamedTexture & t, unsigned int level){
+	glGenBuffers(1, &t.stagingBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, t.stagingBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, t.image.levels[level].size, NULL, GL_STREAM_DRAW);
+	t.staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, t.image.levels[level].size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (t.staging == NULL){
+		glDeleteBuffers(1, &t.stagingBuffer);
+		t.stagingBuffer = 0;
+		return false;
+	}
+	return true;
+}
+
+// The level from the staging buffer, or from the mapped file if the buffer lost its contents
+static void uploadLevel(StreamedTexture & t, unsigned int level){
+	const DDSLevel & l = t.image.levels[level];
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, t.stagingBuffer);
+	bool ok = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+	glBindTexture(GL_TEXTURE_2D, t.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (ok)
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, t.image.format, l.width, l.height, 0, l.size, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!ok)
+		uploadDDSLevels(t.image, t.texture, level, level);
+	// The driver keeps the contents until the upload is done
+	glDeleteBuffers(1, &t.stagingBuffer);
+	t.stagingBuffer = 0;
+	t.staging = NULL;
+}
+
+static void levelLoaded(StreamedTexture * t){
+	if (t->unloaded)
+		deleteStreamedTexture(t);
+	else
+		t->loadingReady = true;
+}
+
+static bool higherPriority(const StreamedTexture * a, const StreamedTexture * b){
+	return streamingPriority(*a) > streamingPriority(*b);
+}
+
+// Evicts the finest levels of the textures of lower priority than t, smallest on screen first,
+// until size more bytes fit in the budget
+static bool makeRoom(StreamedTexture & t, size_t size){
+	float priority = streamingPriority(t);
+	while (residentBytes + size > budgetBytes){
+		StreamedTexture * victim = NULL;
+		for (unsigned int i = 0; i < streamedTextures.size(); i++){
+			StreamedTexture * other = streamedTextures[i];
+			if (other == &t || other->residentLevel >= other->tailLevel)
+				continue;
+			// Its finest level is worth less than the level t is waiting for
+			float otherPriority = other->screenTexels / other->image.levels[other->residentLevel].width * 2.0f;
+			if (otherPriority >= priority)
+				continue;
+			if (victim == NULL || other->screenTexels < victim->screenTexels)
+				victim = other;
+		}
+		if (victim == NULL)
+			return false;
+
+		unsigned int level = victim->residentLevel;
+		residentBytes -= victim->image.levels[level].size;
+		setBaseLevel(*victim, level + 1);
+		// Free the level's memory
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, victim->image.format, 0, 0, 0, 0, NULL);
+	}
+	return true;
+}
+
+void updateTextureStreaming(float deltaTime){
+	std::vector<StreamedTexture *> sorted(streamedTextures);
+	std::sort(sorted.begin(), sorted.end(), higherPriority);
+
+	size_t uploaded = 0;
+	for (unsigned int i = 0; i < sorted.size(); i++){
+		StreamedTexture & t = *sorted[i];
+
+		// Upload the level the worker has read, if this frame's upload budget allows
+		if (t.loadingLevel >= 0 && t.loadingReady &&
+			(uploaded == 0 || uploaded + t.image.levels[t.loadingLevel].size <= uploadBudgetBytes)){
+			if ((unsigned int)t.loadingLevel + 1 == t.residentLevel && makeRoom(t, t.image.levels[t.loadingLevel].size)){
+				uploadLevel(t, t.loadingLevel);
+				residentBytes += t.image.levels[t.loadingLevel].size;
+				uploaded += t.image.levels[t.loadingLevel].size;
+				setBaseLevel(t, t.loadingLevel);
+			}
+			else
+				dropStagingBuffer(&t);
+			t.loadingLevel = -1;
+			t.loadingReady = false;
+		}
+
+		// Ask for the next finer level, if it would be visible and fits in the budget
+		if (t.loadingLevel < 0 && wantedLevel(t) < t.residentLevel){
+			unsigned int level = t.residentLevel - 1;
+			if ((residentBytes + t.image.levels[level].size <= budgetBytes || makeRoom(t, t.image.levels[level].size)) &&
+				mapStagingBuffer(t, level)){
+				t.loadingLevel = level;
+				StreamedTexture * target = &t;
+				runAsync(std::bind(copyLevel, target, (int)level), std::bind(levelLoaded, target));
+			}
+		}
+
+		// Fade the new levels in
+		if (t.minLod > t.residentLevel){
+			t.minLod = std::max((float)t.residentLevel, t.minLod - STREAMING_FADE_SPEED * deltaTime);
+			glBindTexture(GL_TEXTURE_2D, t.texture);
+			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, t.minLod - t.residentLevel);
+		}
+	}
+	uploadedBytes = uploaded;
+}
@@ -0,0 +1,32 @@
+#ifndef TEXTURESTREAMING_HPP
+#define TEXTURESTREAMING_HPP
+
+// Progressive texture streaming : a texture starts with its mip tail only (the levels no bigger
+// than tailSize), so that it can be drawn right away. The finer levels are read on the asset
+// loader's workers and uploaded one per texture at a time, in the order of the textures'
+// screen sizes. GL_TEXTURE_BASE_LEVEL clamps sampling to the resident levels, and
+// GL_TEXTURE_MIN_LOD fades each new level in instead of popping.
+// When the resident levels exceed the memory budget, the finest levels of the textures
+// that are the smallest on screen are evicted. The mip tails are never evicted.
+
+// residentBytes : memory budget for all the streamed textures.
+// uploadBytesPerFrame : at least one level is uploaded per frame, whatever its size.
+void setTextureStreamingBudget(size_t residentBytes, size_t uploadBytesPerFrame, unsigned int tailSize);
+
+// Loads the mip tail of a 2D .DDS and keeps the file mapped for the other levels.
+// Other kinds of textures are loaded entirely, and not streamed.
+GLuint loadDDSStreamed(const char * imagepath);
+void unloadStreamedTexture(GLuint textureID);
+
+// Width in texels the texture would need to be sampled 1:1 on screen, this frame
+void setStreamedTextureSize(GLuint textureID, float screenTexels);
+
+// Call once per frame, after updateAssetLoader()
+void updateTextureStreaming(float deltaTime);
+
+// Video memory used by the resident levels
+size_t streamedTextureMemory();
+// Bytes uploaded by the last updateTextureStreaming()
+size_t streamedTextureUploadedBytes();
+
+#endif
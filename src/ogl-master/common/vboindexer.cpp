@@ -6,6 +6,7 @@
 #include "vboindexer.hpp"
 
 #include <string.h> // for memcmp
+#include <math.h> // for powf
 
 
 // Returns true iif v1 can be considered equal to v2
@@ -175,3 +176,181 @@ void indexVBO_TBN(
 		}
 	}
 }
+
+
+
+// Tom Forsyth's "Linear-speed vertex cache optimisation" :
+// triangles are emitted greedily, picking the one whose vertices score best.
+// A vertex scores high when it is recently used (still in the simulated cache)
+// and when few triangles that use it remain.
+
+#define VERTEX_CACHE_SIZE 32
+
+#define VERTEX_VALENCE_TABLE_SIZE 32
+
+static float vertexCacheScore(int cachePosition, unsigned int remainingTriangles){
+	if (remainingTriangles == 0)
+		return -1.0f; // No triangle needs this vertex anymore
+
+	// powf is too slow to be called for every vertex of the cache after every triangle
+	static float cacheScores[VERTEX_CACHE_SIZE];
+	static float valenceScores[VERTEX_VALENCE_TABLE_SIZE];
+	static bool tablesReady = false;
+	if (!tablesReady){
+		for (int i=0; i<VERTEX_CACHE_SIZE; i++){
+			// The vertices of the last triangle : using them again doesn't add much
+			cacheScores[i] = i < 3 ? 0.75f : powf(1.0f - (i - 3) / float(VERTEX_CACHE_SIZE - 3), 1.5f);
+		}
+		for (int i=1; i<VERTEX_VALENCE_TABLE_SIZE; i++)
+			valenceScores[i] = 2.0f * powf((float)i, -0.5f);
+		tablesReady = true;
+	}
+
+	float score = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+	// Bonus for vertices with few remaining triangles, to finish them off
+	score += remainingTriangles < VERTEX_VALENCE_TABLE_SIZE ? valenceScores[remainingTriangles] : 2.0f * powf((float)remainingTriangles, -0.5f);
+	return score;
+}
+
+void optimizeVertexCache(
+	std::vector<unsigned short> & indices,
+	unsigned int vertexCount
+){
+	unsigned int triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles using each vertex
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int i=0; i<indices.size(); i++)
+		offsets[indices[i] + 1]++;
+	for (unsigned int i=0; i<vertexCount; i++)
+		offsets[i + 1] += offsets[i];
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int i=0; i<indices.size(); i++)
+		adjacency[offsets[indices[i]] + remaining[indices[i]]++] = i / 3;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (unsigned int i=0; i<vertexCount; i++)
+		vertexScore[i] = vertexCacheScore(-1, remaining[i]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (unsigned int t=0; t<triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t*3]] + vertexScore[indices[t*3+1]] + vertexScore[indices[t*3+2]];
+
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	std::vector<unsigned short> output;
+	output.reserve(indices.size());
+
+	unsigned int cache[VERTEX_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+	unsigned int nextCandidate = 0; // For the linear scan when the cache has no candidates
+
+	int best = -1;
+	for (unsigned int emittedCount = 0; emittedCount < triangleCount; emittedCount++){
+
+		if (best < 0){
+			// Restart from the best remaining triangle
+			float bestScore = -1.0f;
+			for (unsigned int t=nextCandidate; t<triangleCount; t++){
+				if (!emitted[t] && triangleScore[t] > bestScore){
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+			while (nextCandidate < triangleCount && emitted[nextCandidate])
+				nextCandidate++;
+		}
+
+		unsigned int tri[3] = { indices[best*3], indices[best*3+1], indices[best*3+2] };
+		output.push_back(tri[0]);
+		output.push_back(tri[1]);
+		output.push_back(tri[2]);
+		emitted[best] = 1;
+
+		// Move the triangle's vertices to the front of the cache
+		unsigned int newCache[VERTEX_CACHE_SIZE + 3];
+		unsigned int newCount = 0;
+		for (int j=0; j<3; j++)
+			newCache[newCount++] = tri[j];
+		for (unsigned int j=0; j<cacheCount; j++){
+			unsigned int v = cache[j];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// The emitted triangle no longer counts for its vertices
+		for (int j=0; j<3; j++){
+			unsigned int v = tri[j];
+			unsigned int * begin = &adjacency[offsets[v]];
+			unsigned int * end = begin + remaining[v];
+			for (unsigned int * it = begin; it != end; it++){
+				if (*it == (unsigned int)best){
+					*it = *(end - 1);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Update the scores of the vertices in the cache, and of their triangles
+		for (unsigned int j=0; j<newCount; j++){
+			unsigned int v = newCache[j];
+			cachePosition[v] = j < VERTEX_CACHE_SIZE ? (int)j : -1;
+			vertexScore[v] = vertexCacheScore(cachePosition[v], remaining[v]);
+		}
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int j=0; j<newCount; j++){
+			unsigned int v = newCache[j];
+			for (unsigned int k=0; k<remaining[v]; k++){
+				unsigned int t = adjacency[offsets[v] + k];
+				triangleScore[t] = vertexScore[indices[t*3]] + vertexScore[indices[t*3+1]] + vertexScore[indices[t*3+2]];
+				if (triangleScore[t] > bestScore){
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = newCount < VERTEX_CACHE_SIZE ? newCount : VERTEX_CACHE_SIZE;
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+	}
+
+	indices.swap(output);
+}
+
+void optimizeVertexFetch(
+	std::vector<unsigned short> & indices,
+	std::vector<glm::vec3> & vertices,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+){
+	const unsigned short unused = 0xffff;
+	std::vector<unsigned short> remap(vertices.size(), unused);
+
+	std::vector<glm::vec3> out_vertices;
+	std::vector<glm::vec2> out_uvs;
+	std::vector<glm::vec3> out_normals;
+	out_vertices.reserve(vertices.size());
+	out_uvs.reserve(uvs.size());
+	out_normals.reserve(normals.size());
+
+	for (unsigned int i=0; i<indices.size(); i++){
+		unsigned short & index = indices[i];
+		if (remap[index] == unused){
+			remap[index] = (unsigned short)out_vertices.size();
+			out_vertices.push_back(vertices[index]);
+			out_uvs     .push_back(uvs[index]);
+			out_normals .push_back(normals[index]);
+		}
+		index = remap[index];
+	}
+
+	// Vertices not used by any triangle are dropped
+	vertices.swap(out_vertices);
+	uvs.swap(out_uvs);
+	normals.swap(out_normals);
+}
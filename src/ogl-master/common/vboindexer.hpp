@@ -13,6 +13,19 @@ void indexVBO(
 );
 
 
+// Same, with a linear search of the similar vertices : quadratic, kept for reference (Tutorial 9)
+void indexVBO_slow(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+
 void indexVBO_TBN(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
@@ -28,4 +41,20 @@ void indexVBO_TBN(
 	std::vector<glm::vec3> & out_bitangents
 );
 
+// Reorders the triangles so that consecutive triangles share vertices,
+// for a better use of the GPU's post-transform vertex cache (Tom Forsyth's algorithm).
+void optimizeVertexCache(
+	std::vector<unsigned short> & indices,
+	unsigned int vertexCount
+);
+
+// Reorders the vertices in the order in which the triangles use them,
+// so that vertex fetching reads memory linearly. Call after optimizeVertexCache.
+void optimizeVertexFetch(
+	std::vector<unsigned short> & indices,
+	std::vector<glm::vec3> & vertices,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+);
+
 #endif
\ No newline at end of file
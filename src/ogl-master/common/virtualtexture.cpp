@@ -0,0 +1,577 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.hpp"
+#include "texture.hpp"
+#include "mesh.hpp"
+#include "assetloader.hpp"
+#include "virtualtexture.hpp"
+
+#ifdef GL_INTERCEPT
+#include "glintercept.hpp"
+#endif
+
+#define VT_FILE_VERSION 1
+// Pages start on a disk page boundary, so that reading one only touches its own memory pages
+#define VT_FILE_ALIGNMENT 4096
+
+struct PageFileHeader {
+	char magic[4];                // "VTEX"
+	unsigned int version;
+	unsigned int format;          // GL_COMPRESSED_xxx
+	unsigned int blockSize;
+	unsigned int width;
+	unsigned int height;
+	unsigned int tileSize;        // VT_TILE_SIZE
+	unsigned int border;          // VT_BORDER
+	unsigned int levelCount;
+	unsigned int dataOffset;
+	// followed by levelCount VirtualTextureLevel, then the pages
+};
+
+static unsigned int nextPowerOfTwo(unsigned int x){
+	unsigned int p = 1;
+	while (p < x)
+		p *= 2;
+	return p;
+}
+
+static unsigned int log2Floor(unsigned int x){
+	unsigned int l = 0;
+	while (x > 1){
+		x /= 2;
+		l++;
+	}
+	return l;
+}
+
+// Levels of a virtual texture of the given size, down to the level that fits in a single page,
+// or as many as the source has
+static void computeLevels(unsigned int width, unsigned int height, unsigned int sourceLevels, std::vector<VirtualTextureLevel> & out_levels){
+	unsigned int indirectionWidth = nextPowerOfTwo((width + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE);
+	unsigned int indirectionHeight = nextPowerOfTwo((height + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE);
+	unsigned int levelCount = std::min(sourceLevels, log2Floor(std::max(indirectionWidth, indirectionHeight)) + 1);
+
+	out_levels.clear();
+	unsigned int firstPage = 0;
+	for (unsigned int level = 0; level < levelCount; level++){
+		VirtualTextureLevel l;
+		l.width = std::max(width >> level, 1u);
+		l.height = std::max(height >> level, 1u);
+		l.pagesX = (l.width + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE;
+		l.pagesY = (l.height + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE;
+		l.firstPage = firstPage;
+		firstPage += l.pagesX * l.pagesY;
+		out_levels.push_back(l);
+	}
+}
+
+bool buildPageFile(const char * ddsPath, const char * pagePath){
+	DDSImage image;
+	if (!readDDS(ddsPath, image))
+		return false;
+	if (image.target != GL_TEXTURE_2D){
+		printf("%s : only 2D textures can be virtual\n", ddsPath);
+		freeDDS(image);
+		return false;
+	}
+
+	std::vector<VirtualTextureLevel> levels;
+	computeLevels(image.width, image.height, image.levels.size(), levels);
+
+	FILE * file = fopen(pagePath, "wb");
+	if (file == NULL){
+		printf("Impossible to open %s\n", pagePath);
+		freeDDS(image);
+		return false;
+	}
+
+	PageFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "VTEX", 4);
+	header.version = VT_FILE_VERSION;
+	header.format = image.format;
+	header.blockSize = image.blockSize;
+	header.width = image.width;
+	header.height = image.height;
+	header.tileSize = VT_TILE_SIZE;
+	header.border = VT_BORDER;
+	header.levelCount = levels.size();
+	size_t headerSize = sizeof(header) + levels.size() * sizeof(VirtualTextureLevel);
+	header.dataOffset = (headerSize + VT_FILE_ALIGNMENT - 1) / VT_FILE_ALIGNMENT * VT_FILE_ALIGNMENT;
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&levels[0], sizeof(VirtualTextureLevel), levels.size(), file);
+	std::vector<unsigned char> padding(header.dataOffset - headerSize, 0);
+	if (!padding.empty())
+		fwrite(&padding[0], 1, padding.size(), file);
+
+	// Pages are copied block by block : the page size and the border are multiples of 4 texels,
+	// so the compressed blocks don't need to be decoded
+	const int tileBlocks = VT_TILE_SIZE / 4;
+	const int pageBlocks = VT_PAGE_SIZE / 4;
+	const int borderBlocks = VT_BORDER / 4;
+	std::vector<unsigned char> tile(tileBlocks * tileBlocks * image.blockSize);
+	for (unsigned int level = 0; level < levels.size(); level++){
+		const DDSLevel & source = image.levels[level];
+		const unsigned char * blocks = image.data + source.offset;
+		int blocksX = (source.width + 3) / 4;
+		int blocksY = (source.height + 3) / 4;
+
+		for (unsigned int py = 0; py < levels[level].pagesY; py++){
+			for (unsigned int px = 0; px < levels[level].pagesX; px++){
+				unsigned char * out = &tile[0];
+				for (int j = 0; j < tileBlocks; j++){
+					int y = glm::clamp((int)py * pageBlocks + j - borderBlocks, 0, blocksY - 1);
+					for (int i = 0; i < tileBlocks; i++){
+						int x = ((int)px * pageBlocks + i - borderBlocks) % blocksX;
+						if (x < 0) x += blocksX;
+						memcpy(out, blocks + (y * blocksX + x) * image.blockSize, image.blockSize);
+						out += image.blockSize;
+					}
+				}
+				fwrite(&tile[0], 1, tile.size(), file);
+			}
+		}
+	}
+
+	fclose(file);
+	freeDDS(image);
+	return true;
+}
+
+static unsigned int pageLevel(const VirtualTexture & vt, unsigned int page){
+	unsigned int level = 0;
+	while (level + 1 < vt.levels.size() && page >= vt.levels[level + 1].firstPage)
+		level++;
+	return level;
+}
+
+// The page of the next level covering the same texels, or VT_NO_PAGE for the coarsest level
+static unsigned int parentPage(const VirtualTexture & vt, unsigned int page){
+	unsigned int level = pageLevel(vt, page);
+	if (level + 1 >= vt.levels.size())
+		return VT_NO_PAGE;
+	const VirtualTextureLevel & l = vt.levels[level];
+	const VirtualTextureLevel & parent = vt.levels[level + 1];
+	unsigned int x = (page - l.firstPage) % l.pagesX;
+	unsigned int y = (page - l.firstPage) / l.pagesX;
+	return parent.firstPage + std::min(y / 2, parent.pagesY - 1) * parent.pagesX + std::min(x / 2, parent.pagesX - 1);
+}
+
+static const unsigned char * pageData(const VirtualTexture & vt, unsigned int page){
+	return vt.file.data + vt.dataOffset + page * vt.tileBytes;
+}
+
+// A free tile, or the one of the least recently used page that the last feedback didn't ask for
+static int allocateTile(VirtualTexture & vt){
+	int best = -1;
+	for (unsigned int tile = 0; tile < vt.tilePage.size(); tile++){
+		if (vt.tilePage[tile] == VT_NO_PAGE)
+			return tile;
+		if (vt.tilePinned[tile] || vt.tileLastUsed[tile] + 1 >= vt.frame)
+			continue;
+		if (best < 0 || vt.tileLastUsed[tile] < vt.tileLastUsed[best])
+			best = tile;
+	}
+	if (best >= 0){
+		vt.pageTile[vt.tilePage[best]] = VT_PAGE_ABSENT;
+		vt.tilePage[best] = VT_NO_PAGE;
+		vt.indirectionDirty = true;
+	}
+	return best;
+}
+
+static void placePage(VirtualTexture & vt, unsigned int page, int tile){
+	vt.pageTile[page] = tile;
+	vt.tilePage[tile] = page;
+	vt.tileLastUsed[tile] = vt.frame;
+	vt.indirectionDirty = true;
+}
+
+bool loadVirtualTexture(const char * pagePath, unsigned int cacheTiles, VirtualTexture & out_vt){
+	static unsigned int nextFeedbackID = 1;
+
+	if (!mapFile(pagePath, out_vt.file)){
+		printf("Impossible to open %s\n", pagePath);
+		return false;
+	}
+
+	PageFileHeader header;
+	bool valid = out_vt.file.size >= sizeof(header);
+	if (valid){
+		memcpy(&header, out_vt.file.data, sizeof(header));
+		valid = memcmp(header.magic, "VTEX", 4) == 0 && header.version == VT_FILE_VERSION &&
+			header.tileSize == VT_TILE_SIZE && header.border == VT_BORDER &&
+			header.levelCount > 0 && header.levelCount <= 16 &&
+			sizeof(header) + header.levelCount * sizeof(VirtualTextureLevel) <= header.dataOffset;
+	}
+	if (valid){
+		const VirtualTextureLevel * levels = (const VirtualTextureLevel *)(out_vt.file.data + sizeof(header));
+		out_vt.levels.assign(levels, levels + header.levelCount);
+		out_vt.tileBytes = (VT_TILE_SIZE / 4) * (VT_TILE_SIZE / 4) * header.blockSize;
+		out_vt.dataOffset = header.dataOffset;
+		const VirtualTextureLevel & last = out_vt.levels.back();
+		unsigned long long pageCount = last.firstPage + last.pagesX * last.pagesY;
+		valid = out_vt.dataOffset + pageCount * out_vt.tileBytes <= out_vt.file.size;
+	}
+	if (!valid){
+		printf("%s is not a valid page file\n", pagePath);
+		unmapFile(out_vt.file);
+		return false;
+	}
+
+	out_vt.format = header.format;
+	out_vt.width = header.width;
+	out_vt.height = header.height;
+	out_vt.feedbackID = nextFeedbackID;
+	nextFeedbackID = nextFeedbackID % 255 + 1;
+
+	const VirtualTextureLevel & coarsest = out_vt.levels.back();
+	unsigned int pageCount = coarsest.firstPage + coarsest.pagesX * coarsest.pagesY;
+	unsigned int tileCount = cacheTiles * cacheTiles;
+	if (coarsest.pagesX * coarsest.pagesY * 2 > tileCount){
+		printf("%s : the cache is too small for the coarsest level\n", pagePath);
+		unmapFile(out_vt.file);
+		return false;
+	}
+
+	out_vt.cacheTiles = cacheTiles;
+	out_vt.pageTile.assign(pageCount, VT_PAGE_ABSENT);
+	out_vt.tilePage.assign(tileCount, VT_NO_PAGE);
+	out_vt.tileLastUsed.assign(tileCount, 0);
+	out_vt.tilePinned.assign(tileCount, 0);
+	out_vt.frame = 1;
+	out_vt.loadedPages.clear();
+	out_vt.loadsInFlight = 0;
+	out_vt.maxLoadsInFlight = 32;
+	out_vt.maxUploadsPerFrame = 16;
+	out_vt.uploadedBytes = 0;
+
+	// Physical cache : no mipmaps, the levels are in the indirection
+	glGenTextures(1, &out_vt.physicalTexture);
+	glBindTexture(GL_TEXTURE_2D, out_vt.physicalTexture);
+	GLsizei cacheSize = cacheTiles * VT_TILE_SIZE;
+	glCompressedTexImage2D(GL_TEXTURE_2D, 0, out_vt.format, cacheSize, cacheSize, 0, tileCount * out_vt.tileBytes, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// The coarsest level is loaded right away and never evicted, so that every texel has a page
+	for (unsigned int page = coarsest.firstPage; page < pageCount; page++){
+		int tile = allocateTile(out_vt);
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0,
+			(tile % cacheTiles) * VT_TILE_SIZE, (tile / cacheTiles) * VT_TILE_SIZE, VT_TILE_SIZE, VT_TILE_SIZE,
+			out_vt.format, out_vt.tileBytes, pageData(out_vt, page));
+		placePage(out_vt, page, tile);
+		out_vt.tilePinned[tile] = 1;
+	}
+
+	// Indirection : one mipmap per level, sampled with texelFetch
+	out_vt.indirectionWidth = nextPowerOfTwo(out_vt.levels[0].pagesX);
+	out_vt.indirectionHeight = nextPowerOfTwo(out_vt.levels[0].pagesY);
+	out_vt.indirectionOffsets.clear();
+	size_t indirectionSize = 0;
+	for (unsigned int level = 0; level < out_vt.levels.size(); level++){
+		out_vt.indirectionOffsets.push_back(indirectionSize);
+		indirectionSize += std::max(out_vt.indirectionWidth >> level, 1u) * std::max(out_vt.indirectionHeight >> level, 1u) * 4;
+	}
+	out_vt.indirection.assign(indirectionSize, 0);
+
+	glGenTextures(1, &out_vt.indirectionTexture);
+	glBindTexture(GL_TEXTURE_2D, out_vt.indirectionTexture);
+	for (unsigned int level = 0; level < out_vt.levels.size(); level++)
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8,
+			std::max(out_vt.indirectionWidth >> level, 1u), std::max(out_vt.indirectionHeight >> level, 1u),
+			0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, out_vt.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenBuffers(1, &out_vt.indirectionBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, out_vt.indirectionBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, indirectionSize, NULL, GL_STREAM_DRAW);
+	glGenBuffers(1, &out_vt.uploadBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, out_vt.uploadBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, out_vt.maxUploadsPerFrame * out_vt.tileBytes, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	updateVirtualTexture(out_vt);
+	return true;
+}
+
+void deleteVirtualTexture(VirtualTexture & vt){
+	glDeleteTextures(1, &vt.physicalTexture);
+	glDeleteTextures(1, &vt.indirectionTexture);
+	glDeleteBuffers(1, &vt.indirectionBuffer);
+	glDeleteBuffers(1, &vt.uploadBuffer);
+	unmapFile(vt.file);
+}
+
+// Each texel points to its own page if it is resident, else to the same texel of the next level
+static void buildIndirection(VirtualTexture & vt){
+	for (int level = (int)vt.levels.size() - 1; level >= 0; level--){
+		const VirtualTextureLevel & l = vt.levels[level];
+		unsigned int width = std::max(vt.indirectionWidth >> level, 1u);
+		unsigned int height = std::max(vt.indirectionHeight >> level, 1u);
+		unsigned char * entries = &vt.indirection[vt.indirectionOffsets[level]];
+		unsigned int parentWidth = std::max(width / 2, 1u);
+		unsigned int parentHeight = std::max(height / 2, 1u);
+		const unsigned char * parents = level + 1 < (int)vt.levels.size() ? &vt.indirection[vt.indirectionOffsets[level + 1]] : NULL;
+
+		for (unsigned int y = 0; y < height; y++){
+			for (unsigned int x = 0; x < width; x++){
+				unsigned char * entry = entries + (y * width + x) * 4;
+				int tile = (x < l.pagesX && y < l.pagesY) ? vt.pageTile[l.firstPage + y * l.pagesX + x] : VT_PAGE_ABSENT;
+				if (tile >= 0){
+					entry[0] = tile % vt.cacheTiles;
+					entry[1] = tile / vt.cacheTiles;
+					entry[2] = level;
+					entry[3] = 255;
+				} else if (parents != NULL){
+					memcpy(entry, parents + (std::min(y / 2, parentHeight - 1) * parentWidth + std::min(x / 2, parentWidth - 1)) * 4, 4);
+				} else {
+					memset(entry, 0, 4);
+				}
+			}
+		}
+	}
+}
+
+void updateVirtualTexture(VirtualTexture & vt){
+	vt.frame++;
+	vt.uploadedBytes = 0;
+
+	// Upload the pages read by the workers, through the pixel unpack buffer
+	unsigned int uploadCount = std::min((unsigned int)vt.loadedPages.size(), vt.maxUploadsPerFrame);
+	if (uploadCount > 0){
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, vt.uploadBuffer);
+		unsigned char * mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, vt.maxUploadsPerFrame * vt.tileBytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		std::vector<int> tiles(uploadCount, -1);
+		if (mapped != NULL){
+			for (unsigned int i = 0; i < uploadCount; i++){
+				unsigned int page = vt.loadedPages[i];
+				tiles[i] = allocateTile(vt);
+				if (tiles[i] < 0){
+					// No room : the feedback will ask again
+					vt.pageTile[page] = VT_PAGE_ABSENT;
+					continue;
+				}
+				memcpy(mapped + i * vt.tileBytes, pageData(vt, page), vt.tileBytes);
+				placePage(vt, page, tiles[i]);
+			}
+		}
+
+		if (mapped == NULL || glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE){
+			// The buffer was lost : forget these pages
+			for (unsigned int i = 0; i < uploadCount; i++){
+				vt.pageTile[vt.loadedPages[i]] = VT_PAGE_ABSENT;
+				if (tiles[i] >= 0)
+					vt.tilePage[tiles[i]] = VT_NO_PAGE;
+			}
+		} else {
+			glBindTexture(GL_TEXTURE_2D, vt.physicalTexture);
+			for (unsigned int i = 0; i < uploadCount; i++){
+				if (tiles[i] < 0)
+					continue;
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, 0,
+					(tiles[i] % vt.cacheTiles) * VT_TILE_SIZE, (tiles[i] / vt.cacheTiles) * VT_TILE_SIZE, VT_TILE_SIZE, VT_TILE_SIZE,
+					vt.format, vt.tileBytes, (void*)(i * vt.tileBytes));
+				vt.uploadedBytes += vt.tileBytes;
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		vt.loadedPages.erase(vt.loadedPages.begin(), vt.loadedPages.begin() + uploadCount);
+	}
+
+	// Rebuild the indirection when pages came or went, and upload it through its own buffer
+	if (vt.indirectionDirty){
+		buildIndirection(vt);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, vt.indirectionBuffer);
+		void * mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, vt.indirection.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped != NULL){
+			memcpy(mapped, &vt.indirection[0], vt.indirection.size());
+			if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE){
+				glBindTexture(GL_TEXTURE_2D, vt.indirectionTexture);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				for (unsigned int level = 0; level < vt.levels.size(); level++)
+					glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0,
+						std::max(vt.indirectionWidth >> level, 1u), std::max(vt.indirectionHeight >> level, 1u),
+						GL_RGBA, GL_UNSIGNED_BYTE, (void*)vt.indirectionOffsets[level]);
+				vt.indirectionDirty = false;
+				vt.uploadedBytes += vt.indirection.size();
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+}
+
+// Reads the page from the disk on the worker, rather than in updateVirtualTexture
+static void prefetchPage(const VirtualTexture * vt, unsigned int page){
+	prefetchMapped(pageData(*vt, page), vt->tileBytes);
+}
+
+static void pageLoaded(VirtualTexture * vt, unsigned int page){
+	vt->loadsInFlight--;
+	vt->loadedPages.push_back(page);
+}
+
+// Marks the requested pages and their ancestors as used, and loads the missing ones, coarsest first
+static void requestPages(VirtualTexture & vt, std::vector<unsigned int> & pages){
+	std::sort(pages.begin(), pages.end());
+	pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+	std::vector<unsigned int> missing;
+	for (unsigned int i = 0; i < pages.size(); i++){
+		for (unsigned int page = pages[i]; page != VT_NO_PAGE; page = parentPage(vt, page)){
+			int tile = vt.pageTile[page];
+			if (tile >= 0)
+				vt.tileLastUsed[tile] = vt.frame;
+			else if (tile == VT_PAGE_ABSENT)
+				missing.push_back(page);
+		}
+	}
+	// Higher page indices are coarser levels
+	std::sort(missing.begin(), missing.end());
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+	VirtualTexture * target = &vt;
+	for (int i = (int)missing.size() - 1; i >= 0 && vt.loadsInFlight < vt.maxLoadsInFlight; i--){
+		unsigned int page = missing[i];
+		vt.pageTile[page] = VT_PAGE_LOADING;
+		vt.loadsInFlight++;
+		runAsync(std::bind(prefetchPage, target, page), std::bind(pageLoaded, target, page));
+	}
+}
+
+VirtualTextureUniforms getVirtualTextureUniforms(GLuint programID){
+	VirtualTextureUniforms uniforms;
+	uniforms.physicalTexture = glGetUniformLocation(programID, "PhysicalTexture");
+	uniforms.indirectionTexture = glGetUniformLocation(programID, "IndirectionTexture");
+	uniforms.virtualTextureSize = glGetUniformLocation(programID, "VirtualTextureSize");
+	uniforms.pageInfo = glGetUniformLocation(programID, "PageInfo");
+	uniforms.levelCount = glGetUniformLocation(programID, "VirtualLevelCount");
+	uniforms.feedbackID = glGetUniformLocation(programID, "FeedbackID");
+	uniforms.lodBias = glGetUniformLocation(programID, "VirtualLODBias");
+	return uniforms;
+}
+
+void bindVirtualTexture(const VirtualTexture & vt, const VirtualTextureUniforms & uniforms, int firstTextureUnit, float lodBias){
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, vt.physicalTexture);
+	glUniform1i(uniforms.physicalTexture, firstTextureUnit);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, vt.indirectionTexture);
+	glUniform1i(uniforms.indirectionTexture, firstTextureUnit + 1);
+
+	glUniform2f(uniforms.virtualTextureSize, (float)vt.width, (float)vt.height);
+	glUniform4f(uniforms.pageInfo, (float)VT_PAGE_SIZE, (float)VT_BORDER, (float)VT_TILE_SIZE, (float)(vt.cacheTiles * VT_TILE_SIZE));
+	glUniform1f(uniforms.levelCount, (float)vt.levels.size());
+	glUniform1ui(uniforms.feedbackID, vt.feedbackID);
+	glUniform1f(uniforms.lodBias, lodBias);
+}
+
+bool initVirtualTextureFeedback(int width, int height, VirtualTextureFeedback & out_feedback){
+	out_feedback.width = width;
+	out_feedback.height = height;
+	out_feedback.frame = 0;
+
+	// Page x, page y, level, texture : integers, no blending nor filtering
+	glGenRenderbuffers(1, &out_feedback.colorbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, out_feedback.colorbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA16UI, width, height);
+	glGenRenderbuffers(1, &out_feedback.depthbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, out_feedback.depthbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+	glGenFramebuffers(1, &out_feedback.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, out_feedback.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, out_feedback.colorbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, out_feedback.depthbuffer);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+
+	// Two buffers : the GPU writes one frame while the CPU reads the previous one
+	glGenBuffers(2, out_feedback.readbackBuffers);
+	for (int i = 0; i < 2; i++){
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, out_feedback.readbackBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4 * sizeof(unsigned short), NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!complete){
+		printf("The virtual texture feedback framebuffer is incomplete\n");
+		deleteVirtualTextureFeedback(out_feedback);
+		return false;
+	}
+	return true;
+}
+
+void deleteVirtualTextureFeedback(VirtualTextureFeedback & feedback){
+	glDeleteFramebuffers(1, &feedback.framebuffer);
+	glDeleteRenderbuffers(1, &feedback.colorbuffer);
+	glDeleteRenderbuffers(1, &feedback.depthbuffer);
+	glDeleteBuffers(2, feedback.readbackBuffers);
+}
+
+void beginVirtualTextureFeedback(VirtualTextureFeedback & feedback){
+	glGetIntegerv(GL_VIEWPORT, feedback.savedViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &feedback.savedFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedback.framebuffer);
+	glViewport(0, 0, feedback.width, feedback.height);
+	GLuint clearColor[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, clearColor);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void endVirtualTextureFeedback(VirtualTextureFeedback & feedback, std::vector<VirtualTexture *> & textures){
+	// Start reading this frame's feedback
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback.readbackBuffers[feedback.frame % 2]);
+	glReadPixels(0, 0, feedback.width, feedback.height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, (void*)0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedback.savedFramebuffer);
+	glViewport(feedback.savedViewport[0], feedback.savedViewport[1], feedback.savedViewport[2], feedback.savedViewport[3]);
+
+	// and process the previous one, which should be ready by now
+	if (feedback.frame > 0){
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback.readbackBuffers[(feedback.frame + 1) % 2]);
+		const unsigned short * texels = (const unsigned short *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+			feedback.width * feedback.height * 4 * sizeof(unsigned short), GL_MAP_READ_BIT);
+		if (texels != NULL){
+			std::vector< std::vector<unsigned int> > pages(textures.size());
+			for (int i = 0; i < feedback.width * feedback.height; i++){
+				const unsigned short * texel = texels + i * 4;
+				if (texel[3] == 0)
+					continue;
+				for (unsigned int t = 0; t < textures.size(); t++){
+					const VirtualTexture & vt = *textures[t];
+					if (vt.feedbackID != texel[3] || texel[2] >= vt.levels.size())
+						continue;
+					const VirtualTextureLevel & l = vt.levels[texel[2]];
+					if (texel[0] < l.pagesX && texel[1] < l.pagesY)
+						pages[t].push_back(l.firstPage + texel[1] * l.pagesX + texel[0]);
+				}
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			for (unsigned int t = 0; t < textures.size(); t++)
+				requestPages(*textures[t], pages[t]);
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	feedback.frame++;
+}
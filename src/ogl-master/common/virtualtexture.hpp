@@ -0,0 +1,119 @@
+#ifndef VIRTUALTEXTURE_HPP
+#define VIRTUALTEXTURE_HPP
+
+// Streaming virtual textures : the texture is cut in pages stored in a page file.
+// A low resolution feedback pass records which pages the visible surfaces need,
+// worker threads stream them from the page file, and they are uploaded in a physical cache
+// texture of fixed size. An indirection texture (one texel per page, one mip per level)
+// tells the shader where each page lives in the cache, falling back to a coarser
+// page while a finer one is loading. Video memory doesn't depend on the texture's size.
+//
+// Pages are 128x128 texels : 120x120 texels of content with a border of 4 texels on each side
+// copied from the neighbour pages, so that bilinear filtering doesn't need to cross pages.
+// The texture wraps horizontally and is clamped vertically (equirectangular planet maps).
+
+#include <vector>
+
+#include "mappedfile.hpp"
+
+#define VT_TILE_SIZE 128
+#define VT_BORDER    4
+#define VT_PAGE_SIZE (VT_TILE_SIZE - 2 * VT_BORDER)
+
+// Pages are never moved : each one keeps the tile it was uploaded in until it is evicted
+#define VT_PAGE_ABSENT  -1
+#define VT_PAGE_LOADING -2
+#define VT_NO_PAGE      0xffffffff
+
+struct VirtualTextureLevel {
+	unsigned int width;           // in texels
+	unsigned int height;
+	unsigned int pagesX;
+	unsigned int pagesY;
+	unsigned int firstPage;       // index of the level's first page in the page file
+};
+
+struct VirtualTexture {
+	MappedFile file;
+	GLenum format;                // block compressed format of the pages
+	unsigned int width;           // of level 0, in texels
+	unsigned int height;
+	size_t tileBytes;             // size of a page in the file and in the cache
+	size_t dataOffset;            // of the first page in the file
+	std::vector<VirtualTextureLevel> levels;
+	unsigned int feedbackID;      // written by the feedback pass, 1 to 255
+
+	// Physical cache : cacheTiles x cacheTiles pages
+	GLuint physicalTexture;
+	unsigned int cacheTiles;
+	std::vector<int> pageTile;                 // for each page : its tile, VT_PAGE_ABSENT or VT_PAGE_LOADING
+	std::vector<unsigned int> tilePage;        // for each tile : its page, or VT_NO_PAGE
+	std::vector<unsigned int> tileLastUsed;    // frame in which the page was last seen by the feedback pass
+	std::vector<unsigned char> tilePinned;     // the coarsest level is always resident
+	unsigned int frame;
+
+	// Indirection : for each page of each level, RGBA8 = tile x, tile y, level of the page really used
+	GLuint indirectionTexture;
+	unsigned int indirectionWidth;             // of level 0, powers of two
+	unsigned int indirectionHeight;
+	std::vector<unsigned char> indirection;    // all the levels, one after the other
+	std::vector<size_t> indirectionOffsets;
+	bool indirectionDirty;
+	GLuint indirectionBuffer;                  // pixel unpack buffers
+	GLuint uploadBuffer;
+
+	// Streaming
+	std::vector<unsigned int> loadedPages;     // read by the workers, waiting for upload
+	unsigned int loadsInFlight;
+	unsigned int maxLoadsInFlight;
+	unsigned int maxUploadsPerFrame;
+	size_t uploadedBytes;                      // pages and indirection, by the last updateVirtualTexture
+};
+
+struct VirtualTextureUniforms {
+	GLint physicalTexture;
+	GLint indirectionTexture;
+	GLint virtualTextureSize;
+	GLint pageInfo;
+	GLint levelCount;
+	GLint feedbackID;
+	GLint lodBias;
+};
+
+// Low resolution render target of the feedback pass, read back asynchronously
+struct VirtualTextureFeedback {
+	GLuint framebuffer;
+	GLuint colorbuffer;
+	GLuint depthbuffer;
+	GLuint readbackBuffers[2];
+	int width;
+	int height;
+	unsigned int frame;
+	GLint savedViewport[4];
+	GLint savedFramebuffer;
+};
+
+// Cuts the mipmaps of a block compressed .DDS into a page file
+bool buildPageFile(const char * ddsPath, const char * pagePath);
+
+// Maps the page file, creates the cache and indirection textures and loads the coarsest level
+bool loadVirtualTexture(const char * pagePath, unsigned int cacheTiles, VirtualTexture & out_vt);
+// Call after stopAssetLoader(), the workers may still reference the texture
+void deleteVirtualTexture(VirtualTexture & vt);
+
+// Once per frame, after updateAssetLoader() : uploads the pages that were read and the indirection texture
+void updateVirtualTexture(VirtualTexture & vt);
+
+VirtualTextureUniforms getVirtualTextureUniforms(GLuint programID);
+// Binds the cache and indirection textures on firstTextureUnit and the next one,
+// for a program that samples the virtual texture
+void bindVirtualTexture(const VirtualTexture & vt, const VirtualTextureUniforms & uniforms, int firstTextureUnit, float lodBias);
+
+bool initVirtualTextureFeedback(int width, int height, VirtualTextureFeedback & out_feedback);
+void deleteVirtualTextureFeedback(VirtualTextureFeedback & feedback);
+// Draw the virtual textured meshes with the feedback shader between begin and end.
+// end reads back the last frame's results and requests the missing pages.
+void beginVirtualTextureFeedback(VirtualTextureFeedback & feedback);
+void endVirtualTextureFeedback(VirtualTextureFeedback & feedback, std::vector<VirtualTexture *> & textures);
+
+#endif
@@ -0,0 +1,386 @@
+// common_bench : micro-benchmarks of the hot functions of common/, on the meshes and textures
+// of the tutorials, to tell whether a change made them faster or slower.
+//
+// Usage : common_bench [-filter text] [-min-time seconds] [-repetitions N] [-o report.json]
+//   -filter      : only the benchmarks whose name contains text
+//   -min-time    : each repetition runs the function until this time has passed (0.1 s by default)
+//   -repetitions : 5 by default ; the report gives the median, which is stable from run to run
+//   -o           : the JSON report. It uses the format of Google Benchmark, so its compare.py
+//                  can diff two reports : compare.py benchmarks before.json after.json
+//
+// Run it from the source directory : the data is read from the tutorial directories.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+using namespace glm;
+
+#include <common/objloader.hpp>
+#include <common/vboindexer.hpp>
+#include <common/tangentspace.hpp>
+#include <common/texture.hpp>
+#include <common/quaternion_utils.hpp>
+#include <common/picking.hpp>
+#include <common/mappedfile.hpp>
+
+// Random inputs for the math benchmarks
+#define BENCH_BATCH 4096
+
+struct Benchmark {
+	std::string name;
+	std::function<void()> run;   // one iteration
+	double items;                // processed by one iteration (vertices, rays...), for items_per_second
+};
+
+struct BenchmarkResult {
+	std::string name;
+	unsigned long long iterations;           // per repetition
+	std::vector<double> realNanoseconds;     // per iteration, one per repetition
+	std::vector<double> cpuNanoseconds;
+	double items;
+};
+
+struct BenchOptions {
+	const char * filter;
+	double minTime;
+	unsigned int repetitions;
+	const char * output;
+};
+
+// Written by the benchmarks, so that the compiler can't drop their work
+static volatile float Sink;
+
+struct BenchMesh {
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> tangents;
+	std::vector<glm::vec3> bitangents;
+};
+
+static bool readMesh(const char * path, std::string & out_text, BenchMesh & out_mesh){
+	MappedFile file;
+	if (!mapFile(path, file)){
+		printf("%s could not be opened. Run common_bench from the source directory.\n", path);
+		return false;
+	}
+	out_text.assign((const char *)file.data, file.size);
+	unmapFile(file);
+	if (!loadOBJFromMemory(out_text.data(), out_text.size(), out_mesh.vertices, out_mesh.uvs, out_mesh.normals))
+		return false;
+	computeTangentBasis(out_mesh.vertices, out_mesh.uvs, out_mesh.normals, out_mesh.tangents, out_mesh.bitangents);
+	return true;
+}
+
+static float randomFloat(float min, float max){
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+static vec3 randomDirection(){
+	vec3 v;
+	do {
+		v = vec3(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1));
+	} while (dot(v, v) < 0.01f || dot(v, v) > 1.0f);
+	return normalize(v);
+}
+
+static double cpuSeconds(){
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// Runs the benchmark iterations times, in seconds of wall clock and of CPU
+static void runIterations(const Benchmark & benchmark, unsigned long long iterations, double & out_real, double & out_cpu){
+	double cpuStart = cpuSeconds();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned long long i = 0; i < iterations; i++)
+		benchmark.run();
+	out_real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	out_cpu = cpuSeconds() - cpuStart;
+}
+
+static BenchmarkResult runBenchmark(const Benchmark & benchmark, const BenchOptions & options){
+	BenchmarkResult result;
+	result.name = benchmark.name;
+	result.items = benchmark.items;
+
+	// Warms the caches, then finds how many iterations last minTime
+	unsigned long long iterations = 1;
+	double real, cpu;
+	runIterations(benchmark, 1, real, cpu);
+	for (;;){
+		runIterations(benchmark, iterations, real, cpu);
+		if (real >= options.minTime || iterations >= 1000000000ull)
+			break;
+		// Aims a bit above minTime, at most 10 times more iterations at once
+		double factor = real > 0.0 ? options.minTime * 1.4 / real : 10.0;
+		iterations = (unsigned long long)(iterations * std::min(std::max(factor, 2.0), 10.0));
+	}
+	result.iterations = iterations;
+
+	for (unsigned int r = 0; r < options.repetitions; r++){
+		runIterations(benchmark, iterations, real, cpu);
+		result.realNanoseconds.push_back(real * 1.0e9 / iterations);
+		result.cpuNanoseconds.push_back(cpu * 1.0e9 / iterations);
+	}
+	return result;
+}
+
+static double median(std::vector<double> values){
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+static bool writeReport(const char * path, const std::vector<BenchmarkResult> & results, const BenchOptions & options){
+	FILE * file = fopen(path, "w");
+	if (file == NULL){
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+	char date[64];
+	time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+	fprintf(file, "{\n");
+	fprintf(file, "  \"context\": {\n");
+	fprintf(file, "    \"date\": \"%s\",\n", date);
+	fprintf(file, "    \"executable\": \"common_bench\",\n");
+#ifdef NDEBUG
+	fprintf(file, "    \"library_build_type\": \"release\",\n");
+#else
+	fprintf(file, "    \"library_build_type\": \"debug\",\n");
+#endif
+	fprintf(file, "    \"min_time\": %.3f,\n", options.minTime);
+	fprintf(file, "    \"repetitions\": %u\n", options.repetitions);
+	fprintf(file, "  },\n");
+	// One line per benchmark, so that two reports diff line by line
+	fprintf(file, "  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++){
+		const BenchmarkResult & result = results[i];
+		std::vector<double> sorted = result.realNanoseconds;
+		std::sort(sorted.begin(), sorted.end());
+		double realTime = median(result.realNanoseconds);
+		fprintf(file, "    {\"name\": \"%s\", \"run_name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %llu, "
+			"\"real_time\": %.2f, \"cpu_time\": %.2f, \"time_unit\": \"ns\", \"min_time\": %.2f, \"max_time\": %.2f, \"items_per_second\": %.6e}%s\n",
+			result.name.c_str(), result.name.c_str(), result.iterations,
+			realTime, median(result.cpuNanoseconds), sorted.front(), sorted.back(),
+			realTime > 0.0 ? result.items * 1.0e9 / realTime : 0.0,
+			i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+	bool ok = fclose(file) == 0;
+	if (!ok)
+		printf("Error while writing %s\n", path);
+	return ok;
+}
+
+static bool parseArguments(int argc, char ** argv, BenchOptions & out_options){
+	out_options.filter = NULL;
+	out_options.minTime = 0.1;
+	out_options.repetitions = 5;
+	out_options.output = NULL;
+	for (int i = 1; i < argc; i++){
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-filter") == 0 && hasValue)
+			out_options.filter = argv[++i];
+		else if (strcmp(argv[i], "-min-time") == 0 && hasValue)
+			out_options.minTime = atof(argv[++i]);
+		else if (strcmp(argv[i], "-repetitions") == 0 && hasValue)
+			out_options.repetitions = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && hasValue)
+			out_options.output = argv[++i];
+		else {
+			printf("Usage : common_bench [-filter text] [-min-time seconds] [-repetitions N] [-o report.json]\n");
+			return false;
+		}
+	}
+	if (out_options.minTime <= 0.0 || out_options.repetitions == 0){
+		printf("-min-time and -repetitions must be positive\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char ** argv){
+	BenchOptions options;
+	if (!parseArguments(argc, argv, options))
+		return 1;
+
+	// Suzanne (Tutorials 7 to 17), the Earth and the Moon of the playground, the cylinder of Tutorial 13
+	const char * meshNames[] = { "suzanne", "erde", "mond", "cylinder" };
+	const char * meshPaths[] = {
+		"tutorial09_vbo_indexing/suzanne.obj",
+		"playground/erde.obj",
+		"playground/mond.obj",
+		"tutorial13_normal_mapping/cylinder.obj",
+	};
+	const unsigned int meshCount = sizeof(meshPaths) / sizeof(meshPaths[0]);
+	std::vector<std::string> texts(meshCount);
+	std::vector<BenchMesh> meshes(meshCount);
+	for (unsigned int i = 0; i < meshCount; i++){
+		if (!readMesh(meshPaths[i], texts[i], meshes[i]))
+			return 1;
+	}
+
+	// A BC1 texture with its mipmaps, and a larger BC3 one
+	const char * textureNames[] = { "uvmap", "erde" };
+	const char * texturePaths[] = { "tutorial09_vbo_indexing/uvmap.DDS", "playground/erde_dds.dds" };
+
+	std::vector<Benchmark> benchmarks;
+
+	// The parser of loadOBJ, on the file already in memory : loadOBJ only adds the mapping and a log line
+	for (unsigned int i = 0; i < meshCount; i++){
+		const std::string * text = &texts[i];
+		Benchmark benchmark = { std::string("loadOBJ/") + meshNames[i], [text](){
+			std::vector<glm::vec3> vertices, normals;
+			std::vector<glm::vec2> uvs;
+			loadOBJFromMemory(text->data(), text->size(), vertices, uvs, normals);
+			Sink = vertices.empty() ? 0.0f : vertices.back().x;
+		}, (double)meshes[i].vertices.size() };
+		benchmarks.push_back(benchmark);
+	}
+
+	// Quadratic : only on the small meshes
+	for (unsigned int i = 0; i < meshCount; i++){
+		BenchMesh * mesh = &meshes[i];
+		if (mesh->vertices.size() > 10000)
+			continue;
+		Benchmark benchmark = { std::string("indexVBO_slow/") + meshNames[i], [mesh](){
+			BenchMesh out;
+			std::vector<unsigned short> indices;
+			indexVBO_slow(mesh->vertices, mesh->uvs, mesh->normals, indices, out.vertices, out.uvs, out.normals);
+			Sink = (float)indices.size();
+		}, (double)mesh->vertices.size() };
+		benchmarks.push_back(benchmark);
+	}
+
+	// The indices are unsigned shorts : the Moon has too many vertices
+	for (unsigned int i = 0; i < meshCount; i++){
+		BenchMesh * mesh = &meshes[i];
+		if (mesh->vertices.size() > 65535)
+			continue;
+		Benchmark benchmark = { std::string("indexVBO/") + meshNames[i], [mesh](){
+			BenchMesh out;
+			std::vector<unsigned short> indices;
+			indexVBO(mesh->vertices, mesh->uvs, mesh->normals, indices, out.vertices, out.uvs, out.normals);
+			Sink = (float)indices.size();
+		}, (double)mesh->vertices.size() };
+		benchmarks.push_back(benchmark);
+	}
+	for (unsigned int i = 0; i < meshCount; i++){
+		BenchMesh * mesh = &meshes[i];
+		if (mesh->vertices.size() > 65535)
+			continue;
+		Benchmark benchmark = { std::string("indexVBO_TBN/") + meshNames[i], [mesh](){
+			BenchMesh out;
+			std::vector<unsigned short> indices;
+			indexVBO_TBN(mesh->vertices, mesh->uvs, mesh->normals, mesh->tangents, mesh->bitangents,
+				indices, out.vertices, out.uvs, out.normals, out.tangents, out.bitangents);
+			Sink = (float)indices.size();
+		}, (double)mesh->vertices.size() };
+		benchmarks.push_back(benchmark);
+	}
+
+	for (unsigned int i = 0; i < meshCount; i++){
+		BenchMesh * mesh = &meshes[i];
+		Benchmark benchmark = { std::string("computeTangentBasis/") + meshNames[i], [mesh](){
+			std::vector<glm::vec3> tangents, bitangents;
+			computeTangentBasis(mesh->vertices, mesh->uvs, mesh->normals, tangents, bitangents);
+			Sink = tangents.empty() ? 0.0f : tangents.back().x;
+		}, (double)mesh->vertices.size() };
+		benchmarks.push_back(benchmark);
+	}
+
+	// The header and mipmap checks of loadDDS, without the upload : readDDS doesn't need OpenGL
+	for (unsigned int i = 0; i < sizeof(texturePaths) / sizeof(texturePaths[0]); i++){
+		const char * path = texturePaths[i];
+		DDSImage image;
+		if (!readDDS(path, image))
+			return 1;
+		freeDDS(image);
+		Benchmark benchmark = { std::string("readDDS/") + textureNames[i], [path](){
+			DDSImage image;
+			if (readDDS(path, image)){
+				Sink = (float)image.levels.size();
+				freeDDS(image);
+			}
+		}, 1.0 };
+		benchmarks.push_back(benchmark);
+	}
+
+	// Random directions and orientations, the same from one run to the next
+	srand(1234);
+	std::vector<vec3> starts(BENCH_BATCH), dests(BENCH_BATCH);
+	std::vector<quat> from(BENCH_BATCH), to(BENCH_BATCH);
+	for (unsigned int i = 0; i < BENCH_BATCH; i++){
+		starts[i] = randomDirection();
+		dests[i] = randomDirection();
+		from[i] = angleAxis(randomFloat(0.0f, 6.28f), randomDirection());
+		to[i] = angleAxis(randomFloat(0.0f, 6.28f), randomDirection());
+	}
+	Benchmark rotationBetweenVectors = { "RotationBetweenVectors", [&starts, &dests](){
+		float sum = 0.0f;
+		for (unsigned int i = 0; i < BENCH_BATCH; i++)
+			sum += RotationBetweenVectors(starts[i], dests[i]).w;
+		Sink = sum;
+	}, (double)BENCH_BATCH };
+	benchmarks.push_back(rotationBetweenVectors);
+	Benchmark rotateTowards = { "RotateTowards", [&from, &to](){
+		float sum = 0.0f;
+		for (unsigned int i = 0; i < BENCH_BATCH; i++)
+			sum += RotateTowards(from[i], to[i], 0.1f).w;
+		Sink = sum;
+	}, (double)BENCH_BATCH };
+	benchmarks.push_back(rotateTowards);
+
+	// Rays from around the origin, towards boxes placed and oriented as in misc05_picking_custom
+	std::vector<vec3> rayOrigins(BENCH_BATCH), rayDirections(BENCH_BATCH);
+	std::vector<mat4> models(BENCH_BATCH);
+	for (unsigned int i = 0; i < BENCH_BATCH; i++){
+		rayOrigins[i] = vec3(randomFloat(-1, 1), randomFloat(-1, 1), randomFloat(-1, 1));
+		vec3 position(randomFloat(-10, 10), randomFloat(-10, 10), randomFloat(-10, 10));
+		rayDirections[i] = normalize(position - rayOrigins[i] + randomDirection() * 2.0f);
+		models[i] = translate(mat4(), position) * toMat4(angleAxis(randomFloat(0.0f, 6.28f), randomDirection()));
+	}
+	Benchmark rayOBB = { "TestRayOBBIntersection", [&rayOrigins, &rayDirections, &models](){
+		float sum = 0.0f;
+		for (unsigned int i = 0; i < BENCH_BATCH; i++){
+			float distance;
+			if (TestRayOBBIntersection(rayOrigins[i], rayDirections[i], vec3(-1.0f), vec3(1.0f), models[i], distance))
+				sum += distance;
+		}
+		Sink = sum;
+	}, (double)BENCH_BATCH };
+	benchmarks.push_back(rayOBB);
+
+	std::vector<BenchmarkResult> results;
+	printf("%-36s %14s %14s %12s %16s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations", "Items/s");
+	for (unsigned int i = 0; i < benchmarks.size(); i++){
+		if (options.filter != NULL && benchmarks[i].name.find(options.filter) == std::string::npos)
+			continue;
+		BenchmarkResult result = runBenchmark(benchmarks[i], options);
+		double realTime = median(result.realNanoseconds);
+		printf("%-36s %14.0f %14.0f %12llu %16.4g\n", result.name.c_str(), realTime, median(result.cpuNanoseconds),
+			result.iterations, result.items * 1.0e9 / realTime);
+		fflush(stdout);
+		results.push_back(result);
+	}
+
+	if (options.output != NULL && !writeReport(options.output, results, options))
+		return 1;
+	return 0;
+}
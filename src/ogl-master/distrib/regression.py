@@ -0,0 +1,294 @@
+# Regression tests on Linux : runs the tutorials and the playground on llvmpipe, compares the
+# frames they write with the goldens of distrib/regression/goldens, and their frame time with
+# the one recorded when the goldens were accepted.
+#
+# Build first with -DREGRESSION_TESTS=ON (see distrib/screenshot.h), then, from anywhere :
+#   python3 distrib/regression.py              run every target of distrib/regression/targets.json
+#   python3 distrib/regression.py --only playground --only tutorial02_red_triangle
+#   python3 distrib/regression.py --accept     write the goldens and the frame times of this machine
+# The tutorials need a display : without DISPLAY, they run in xvfb-run. The playground renders
+# headless itself (--bench). A target without goldens fails until they are accepted.
+# Frame times are recorded per machine (CPU model and thread count), and only compared on the
+# machine that recorded them.
+#
+# Only needs the standard library : the goldens are PNG, written and read here.
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import struct
+import subprocess
+import sys
+import zlib
+
+Root = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+DataDir = os.path.join(Root, 'distrib', 'regression')
+GoldenDir = os.path.join(DataDir, 'goldens')
+PerfPath = os.path.join(GoldenDir, 'perf.json')
+
+
+# Images : (width, height, bytearray of RGB rows, top row first)
+
+def ReadBMP(path):
+	with open(path, 'rb') as f:
+		data = f.read()
+	if data[0:2] != b'BM':
+		raise Exception(path + ' is not a BMP file')
+	offset, = struct.unpack_from('<I', data, 0x0A)
+	width, height = struct.unpack_from('<ii', data, 0x12)
+	bpp, = struct.unpack_from('<H', data, 0x1C)
+	if bpp != 24:
+		raise Exception(path + ' is not a 24 bits BMP file')
+	rowBytes = (width * 3 + 3) & ~3
+	pixels = bytearray(width * abs(height) * 3)
+	for y in range(abs(height)):
+		# Bottom-up when the height is positive
+		source = offset + (abs(height) - 1 - y if height > 0 else y) * rowBytes
+		row = data[source:source + width * 3]
+		# BGR to RGB
+		pixels[y * width * 3 + 0:(y + 1) * width * 3:3] = row[2::3]
+		pixels[y * width * 3 + 1:(y + 1) * width * 3:3] = row[1::3]
+		pixels[y * width * 3 + 2:(y + 1) * width * 3:3] = row[0::3]
+	return width, abs(height), pixels
+
+def PNGChunk(kind, data):
+	chunk = kind + data
+	return struct.pack('>I', len(data)) + chunk + struct.pack('>I', zlib.crc32(chunk) & 0xFFFFFFFF)
+
+def WritePNG(path, image):
+	width, height, pixels = image
+	raw = bytearray()
+	for y in range(height):
+		raw.append(0) # no filter
+		raw += pixels[y * width * 3:(y + 1) * width * 3]
+	with open(path, 'wb') as f:
+		f.write(b'\x89PNG\r\n\x1a\n')
+		f.write(PNGChunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 2, 0, 0, 0)))
+		f.write(PNGChunk(b'IDAT', zlib.compress(bytes(raw), 9)))
+		f.write(PNGChunk(b'IEND', b''))
+
+def Paeth(a, b, c):
+	p = a + b - c
+	pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+	if pa <= pb and pa <= pc: return a
+	if pb <= pc: return b
+	return c
+
+# 8 bits RGB or RGBA, not interlaced : what WritePNG and the usual image editors write
+def ReadPNG(path):
+	with open(path, 'rb') as f:
+		data = f.read()
+	if data[0:8] != b'\x89PNG\r\n\x1a\n':
+		raise Exception(path + ' is not a PNG file')
+	position = 8
+	compressed = bytearray()
+	while position < len(data):
+		length, = struct.unpack_from('>I', data, position)
+		kind = data[position + 4:position + 8]
+		chunk = data[position + 8:position + 8 + length]
+		if kind == b'IHDR':
+			width, height, depth, colorType, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+			if depth != 8 or colorType not in (2, 6) or interlace != 0:
+				raise Exception(path + ' : only 8 bits RGB and RGBA PNG are read')
+		elif kind == b'IDAT':
+			compressed += chunk
+		position += 12 + length
+	channels = 3 if colorType == 2 else 4
+	stride = width * channels
+	raw = zlib.decompress(bytes(compressed))
+	previous = bytearray(stride)
+	pixels = bytearray(width * height * 3)
+	for y in range(height):
+		kind = raw[y * (stride + 1)]
+		row = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+		for x in range(stride):
+			left = row[x - channels] if x >= channels else 0
+			if kind == 1: row[x] = (row[x] + left) & 0xFF
+			elif kind == 2: row[x] = (row[x] + previous[x]) & 0xFF
+			elif kind == 3: row[x] = (row[x] + ((left + previous[x]) >> 1)) & 0xFF
+			elif kind == 4: row[x] = (row[x] + Paeth(left, previous[x], previous[x - channels] if x >= channels else 0)) & 0xFF
+		previous = row
+		if channels == 3:
+			pixels[y * width * 3:(y + 1) * width * 3] = row
+		else:
+			for c in range(3):
+				pixels[y * width * 3 + c:(y + 1) * width * 3:3] = row[c::4]
+	return width, height, pixels
+
+
+# Perceptual difference : the distance of the two colors in YIQ, weighted as the eye sees
+# it (as in pixelmatch). A pixel differs when it is over threshold, 0 to 1, of the largest distance.
+MaxYIQDelta = 35215.0
+
+def CompareImages(image, golden, threshold):
+	width, height, a = image
+	goldenWidth, goldenHeight, b = golden
+	if (width, height) != (goldenWidth, goldenHeight):
+		return None, None
+	limit = MaxYIQDelta * threshold * threshold
+	different = 0
+	diff = bytearray(len(a))
+	for i in range(0, len(a), 3):
+		dr = a[i] - b[i]
+		dg = a[i + 1] - b[i + 1]
+		db = a[i + 2] - b[i + 2]
+		if dr == 0 and dg == 0 and db == 0:
+			# The golden, dimmed, to show where the differences are
+			diff[i] = diff[i + 1] = diff[i + 2] = (b[i] + b[i + 1] + b[i + 2]) // 12
+			continue
+		dy = dr * 0.29889531 + dg * 0.58662247 + db * 0.11448223
+		di = dr * 0.59597799 - dg * 0.27417610 - db * 0.32180189
+		dq = dr * 0.21147017 - dg * 0.52261711 + db * 0.31114694
+		if 0.5053 * dy * dy + 0.299 * di * di + 0.1957 * dq * dq > limit:
+			different += 1
+			diff[i] = 255
+			diff[i + 1] = diff[i + 2] = 0
+		else:
+			diff[i] = diff[i + 1] = diff[i + 2] = (b[i] + b[i + 1] + b[i + 2]) // 12
+	return different / float(width * height), (width, height, diff)
+
+
+# Key of this machine's frame times in perf.json
+def MachineName():
+	model = platform.processor() or platform.machine()
+	try:
+		with open('/proc/cpuinfo') as f:
+			for line in f:
+				if line.startswith('model name'):
+					model = line.split(':', 1)[1].strip()
+					break
+	except IOError:
+		pass
+	return '%s, %d threads' % (model, os.cpu_count() or 1)
+
+def Median(values):
+	values = sorted(values)
+	if not values:
+		return None
+	middle = len(values) // 2
+	return values[middle] if len(values) % 2 else (values[middle - 1] + values[middle]) / 2.0
+
+# Runs the target, which writes <prefix>_<frame>.bmp. Returns the median frame time in ms.
+def RunTarget(target, prefix):
+	env = dict(os.environ)
+	# Mesa's software rasterizer : the same pixels on every machine
+	env['LIBGL_ALWAYS_SOFTWARE'] = '1'
+	env['GALLIUM_DRIVER'] = 'llvmpipe'
+	frames = ','.join(str(frame) for frame in target['frames'])
+	command = [os.path.join(Root, target['exe'])] + target.get('args', [])
+	if target.get('headless', False):
+		report = prefix + '_bench.json'
+		command += ['--report', report, '--screenshots', frames, '--screenshot-prefix', prefix]
+	else:
+		env['OGL_SCREENSHOT_FRAMES'] = frames
+		env['OGL_SCREENSHOT_PREFIX'] = prefix
+		if 'input' in target:
+			env['OGL_INPUT_SCRIPT'] = os.path.join(DataDir, target['input'])
+		if 'DISPLAY' not in env:
+			if shutil.which('xvfb-run') is None:
+				raise Exception('no DISPLAY, and xvfb-run is not installed')
+			command = ['xvfb-run', '-a', '-s', '-screen 0 1280x1024x24'] + command
+	with open(prefix + '_log.txt', 'w') as log:
+		# The tutorials wait for a key after an error : without input, they exit instead
+		result = subprocess.call(command, cwd=os.path.join(Root, target['cwd']), env=env, stdin=subprocess.DEVNULL, stdout=log, stderr=subprocess.STDOUT, timeout=600)
+	if result != 0:
+		raise Exception('exited with ' + str(result) + ', see ' + prefix + '_log.txt')
+	if target.get('headless', False):
+		with open(report) as f:
+			return json.load(f)['cpu_ms']['p50']
+	with open(prefix + '_frametimes.txt') as f:
+		return Median([float(line) for line in f if line.strip()])
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Golden image and frame time regression tests')
+	parser.add_argument('--accept', action='store_true', help='write the goldens and the frame times instead of comparing')
+	parser.add_argument('--only', action='append', help='run only this target, can be repeated')
+	parser.add_argument('--out', default=os.path.join(Root, 'regression_out'), help='where the frames, logs and differences go')
+	options = parser.parse_args()
+
+	with open(os.path.join(DataDir, 'targets.json')) as f:
+		config = json.load(f)
+	tolerance = config['tolerance']
+	allPerf = {}
+	if os.path.exists(PerfPath):
+		with open(PerfPath) as f:
+			allPerf = json.load(f)
+	machine = MachineName()
+	perf = allPerf.setdefault(machine, {})
+	if not os.path.exists(options.out):
+		os.makedirs(options.out)
+
+	failures = []
+	skipped = []
+	for target in config['targets']:
+		name = target['name']
+		if options.only and name not in options.only:
+			continue
+		if not os.path.exists(os.path.join(Root, target['exe'])):
+			print(name + ' : not built, skipped')
+			skipped.append(name)
+			continue
+		missing = [frame for frame in target['frames'] if not os.path.exists(os.path.join(GoldenDir, '%s_%d.png' % (name, frame)))]
+		if missing and not options.accept:
+			print(name + ' : FAILED, no golden for frame ' + ', '.join(str(frame) for frame in missing) + ' (run with --accept)')
+			failures.append(name)
+			continue
+		print('Running ' + name + '...')
+		prefix = os.path.join(options.out, name)
+		try:
+			# The fastest of the runs : the others were slowed down by the rest of the machine
+			milliseconds = min(RunTarget(target, prefix) for run in range(tolerance['runs']))
+		except Exception as e:
+			print('  FAILED : ' + str(e))
+			failures.append(name)
+			continue
+
+		if options.accept:
+			for frame in target['frames']:
+				WritePNG(os.path.join(GoldenDir, '%s_%d.png' % (name, frame)), ReadBMP('%s_%d.bmp' % (prefix, frame)))
+			perf[name] = { 'p50_ms': round(milliseconds, 4) }
+			print('  accepted, %.3f ms per frame' % milliseconds)
+			continue
+
+		ok = True
+		for frame in target['frames']:
+			goldenPath = os.path.join(GoldenDir, '%s_%d.png' % (name, frame))
+			fraction, diff = CompareImages(ReadBMP('%s_%d.bmp' % (prefix, frame)), ReadPNG(goldenPath), tolerance['pixel_threshold'])
+			if fraction is None:
+				print('  frame %d : not the size of the golden' % frame)
+				ok = False
+			elif fraction > tolerance['max_different_pixels']:
+				diffPath = '%s_%d_diff.png' % (prefix, frame)
+				WritePNG(diffPath, diff)
+				print('  frame %d : %.3f%% of the pixels differ, see %s' % (frame, fraction * 100.0, diffPath))
+				ok = False
+			else:
+				print('  frame %d : %.3f%% of the pixels differ' % (frame, fraction * 100.0))
+
+		if name in perf:
+			limit = perf[name]['p50_ms'] * (1.0 + tolerance['max_slowdown'])
+			print('  %.3f ms per frame, %.3f ms at most' % (milliseconds, limit))
+			if milliseconds > limit:
+				print('  slower than the recorded frame time')
+				ok = False
+		else:
+			print('  %.3f ms per frame, no frame time recorded on this machine' % milliseconds)
+
+		if not ok:
+			failures.append(name)
+
+	if options.accept:
+		with open(PerfPath, 'w') as f:
+			json.dump(allPerf, f, indent=2, sort_keys=True)
+			f.write('\n')
+
+	print('%d failed, %d skipped' % (len(failures), len(skipped)))
+	for name in failures:
+		print('  ' + name)
+	return 1 if failures else 0
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -1,11 +1,39 @@
 #ifndef DISTRIB_SCREENSHOT_INTERNAL_H
 #define DISTRIB_SCREENSHOT_INTERNAL_H
 
+// Regression tests (distrib/regression.py) : compiled into the tutorials with REGRESSION_TESTS
+// (CMake passes it with -include), or pasted after the GLFW include by utils.py.
+// The tutorials then run the same frames on every machine : a fixed time step of 1/60 s,
+// a fixed seed, no MSAA, and the keys of a script instead of the keyboard. Environment :
+//   OGL_SCREENSHOT_FRAMES=0,30,90  the frames written, 0 by default. The program stops after the last one.
+//   OGL_SCREENSHOT_PREFIX=out/tut  they go to out/tut_0.bmp, out/tut_30.bmp ... and the time of
+//                                  each frame, in ms, to out/tut_frametimes.txt.
+//                                  Without it : only screenshot.bmp, as the older scripts expect.
+//   OGL_INPUT_SCRIPT=keys.txt      lines "first last KEY" : KEY is held from frame first to frame last.
+//                                  KEY is UP, DOWN, LEFT, RIGHT, SPACE, ENTER, a letter or digit, or a GLFW key code.
+//
+// With DISTRIB_SCREENSHOT_NO_HOOKS, only SaveScreenshot() is defined : the playground renders headless
+// and captures its frames itself.
 
-void TakeScreenshot(){
-	char * buffer = new char[54 + 1024*768*3];
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
 
-	char header[54] = {
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// The current read buffer, the size of the viewport, as a 24 bits BMP
+inline bool SaveScreenshot(const char * path){
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int width = viewport[2];
+	int height = viewport[3];
+	int rowBytes = (width * 3 + 3) & ~3; // BMP rows are aligned on 4 bytes, like GL_PACK_ALIGNMENT 4
+	int imageBytes = rowBytes * height;
+	unsigned char * buffer = new unsigned char[54 + imageBytes];
+
+	unsigned char header[54] = {
 		0x42,0x4D,0x36,0x00,0x24,0x00,0x00,0x00,
 		0x00,0x00,0x36,0x00,0x00,0x00,0x28,0x00,
 		0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x03,
@@ -15,34 +43,192 @@ void TakeScreenshot(){
 		0x00,0x00,0x00,0x00,0x00,0x00
 	};
 	for(int i=0; i<54;i++) buffer[i] = header[i];
-	*(int*)&(buffer[0x22]) = 1024*768*3;
-	*(int*)&(buffer[0x12]) = 1024;
-	*(int*)&(buffer[0x16]) = 768;
-
-	glReadPixels(0,0,1024,768, GL_BGR, GL_UNSIGNED_BYTE, buffer+54);
-	
-	FILE * file = fopen("screenshot.bmp", "wb");
-	fwrite(buffer, 54+1024*768*3, 1, file);
+	*(int*)&(buffer[0x02]) = 54 + imageBytes;
+	*(int*)&(buffer[0x22]) = imageBytes;
+	*(int*)&(buffer[0x12]) = width;
+	*(int*)&(buffer[0x16]) = height;
+
+	GLint packAlignment;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(viewport[0], viewport[1], width, height, GL_BGR, GL_UNSIGNED_BYTE, buffer+54);
+	glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+	FILE * file = fopen(path, "wb");
+	if (file == NULL){
+		printf("Impossible to write %s\n", path);
+		delete[] buffer;
+		return false;
+	}
+	fwrite(buffer, 54+imageBytes, 1, file);
 	fclose(file);
+	delete[] buffer;
+	return true;
+}
+
+#ifndef DISTRIB_SCREENSHOT_NO_HOOKS
+
+struct ScriptedKey {
+	int first, last;
+	int key;
+};
 
+// Shared by every file of the program : the functions are inline, so their statics exist once
+struct ScreenshotTest {
+	int frame;
+	std::vector<int> frames;              // to write, in increasing order
+	const char * prefix;                  // NULL : screenshot.bmp
+	std::vector<ScriptedKey> keys;
+	std::vector<double> frameMilliseconds;
+	double frameStart;                    // real time, at the end of the previous swap
 };
 
-double Zero(){
-	return 0.0;
+// The real GLFW functions, before the macros below replace them
+inline double screenshotRealTime(){
+	return glfwGetTime();
+}
+
+inline void screenshotRealSwapBuffers(GLFWwindow * window){
+	glfwSwapBuffers(window);
+}
+
+inline int screenshotKeyCode(const char * name){
+	if (strcmp(name, "UP") == 0)    return GLFW_KEY_UP;
+	if (strcmp(name, "DOWN") == 0)  return GLFW_KEY_DOWN;
+	if (strcmp(name, "LEFT") == 0)  return GLFW_KEY_LEFT;
+	if (strcmp(name, "RIGHT") == 0) return GLFW_KEY_RIGHT;
+	if (strcmp(name, "SPACE") == 0) return GLFW_KEY_SPACE;
+	if (strcmp(name, "ENTER") == 0) return GLFW_KEY_ENTER;
+	// Letters and digits are their ASCII code in GLFW
+	if (strlen(name) == 1 && ((name[0] >= 'A' && name[0] <= 'Z') || (name[0] >= '0' && name[0] <= '9')))
+		return name[0];
+	return atoi(name);
+}
+
+inline void readInputScript(const char * path, std::vector<ScriptedKey> & out_keys){
+	FILE * file = fopen(path, "r");
+	if (file == NULL){
+		printf("Impossible to open the input script %s\n", path);
+		return;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL){
+		ScriptedKey key;
+		char name[64];
+		if (line[0] == '#' || sscanf(line, "%d %d %63s", &key.first, &key.last, name) != 3)
+			continue;
+		key.key = screenshotKeyCode(name);
+		out_keys.push_back(key);
+	}
+	fclose(file);
+}
+
+inline ScreenshotTest & screenshotTest(){
+	static ScreenshotTest test;
+	static bool initialized = false;
+	if (!initialized){
+		initialized = true;
+		test.frame = 0;
+		test.prefix = getenv("OGL_SCREENSHOT_PREFIX");
+		const char * frames = getenv("OGL_SCREENSHOT_FRAMES");
+		while (frames != NULL && *frames != '\0'){
+			int frame = (int)strtol(frames, (char **)&frames, 10);
+			if (test.frames.empty() || frame > test.frames.back())
+				test.frames.push_back(frame);
+			while (*frames == ',' || *frames == ' ')
+				frames++;
+		}
+		if (test.frames.empty())
+			test.frames.push_back(0);
+		const char * script = getenv("OGL_INPUT_SCRIPT");
+		if (script != NULL)
+			readInputScript(script, test.keys);
+		test.frameStart = screenshotRealTime();
+	}
+	return test;
+}
+
+// Writes the frame if it was asked, then shows it. True after the last frame asked : the render loop stops.
+inline bool screenshotSwapBuffers(GLFWwindow * window){
+	ScreenshotTest & test = screenshotTest();
+	// The screenshot isn't part of the frame time
+	double captureStart = screenshotRealTime();
+	bool captured = false;
+	for (size_t i = 0; i < test.frames.size(); i++){
+		if (test.frames[i] != test.frame)
+			continue;
+		char path[1024];
+		if (test.prefix != NULL)
+			snprintf(path, sizeof(path), "%s_%d.bmp", test.prefix, test.frame);
+		else
+			snprintf(path, sizeof(path), "screenshot.bmp");
+		SaveScreenshot(path);
+		captured = true;
+	}
+	double captureSeconds = captured ? screenshotRealTime() - captureStart : 0.0;
+
+	screenshotRealSwapBuffers(window);
+	double now = screenshotRealTime();
+	// The first frame also loads the shaders and the textures : not counted
+	if (test.frame > 0)
+		test.frameMilliseconds.push_back((now - test.frameStart - captureSeconds) * 1000.0);
+	test.frameStart = now;
+
+	if (test.frame < test.frames.back()){
+		test.frame++;
+		return false;
+	}
+
+	if (test.prefix != NULL){
+		char path[1024];
+		snprintf(path, sizeof(path), "%s_frametimes.txt", test.prefix);
+		FILE * file = fopen(path, "w");
+		if (file != NULL){
+			for (size_t i = 0; i < test.frameMilliseconds.size(); i++)
+				fprintf(file, "%.4f\n", test.frameMilliseconds[i]);
+			fclose(file);
+		}
+	}
+	return true;
 }
 
-void callGlfwWindowHint(int target, int hint){
+// The time of the frame, not of the clock : the animations are the same at any speed
+inline double screenshotTime(){
+	return screenshotTest().frame / 60.0;
+}
+
+inline int screenshotGetKey(GLFWwindow * window, int key){
+	ScreenshotTest & test = screenshotTest();
+	for (size_t i = 0; i < test.keys.size(); i++)
+		if (test.keys[i].key == key && test.frame >= test.keys[i].first && test.frame <= test.keys[i].last)
+			return GLFW_PRESS;
+	return GLFW_RELEASE;
+}
+
+// The mouse stays in the middle of the window, where controls.cpp puts it back
+inline void screenshotGetCursorPos(GLFWwindow * window, double * xpos, double * ypos){
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+	*xpos = width / 2;
+	*ypos = height / 2;
+}
+
+inline void callGlfwWindowHint(int target, int hint){
 	if ( target == GLFW_SAMPLES )
 		return; // Disable MSAA when testing, since this is the biggest source of errors
 	glfwWindowHint(target, hint);
-	
+
 	srand(42); // Always use the same seed
 }
 
 
-#define glfwSwapBuffers(a) TakeScreenshot(); break;
-#define glfwGetTime() Zero()
+#define glfwSwapBuffers(a) if (screenshotSwapBuffers(a)) break
+#define glfwGetTime() screenshotTime()
+#define glfwGetKey(a,b) screenshotGetKey(a,b)
+#define glfwGetMouseButton(a,b) GLFW_RELEASE
+#define glfwGetCursorPos(a,b,c) screenshotGetCursorPos(a,b,c)
 #define glfwWindowHint(a,b) callGlfwWindowHint(a,b)
 
+#endif
 
 #endif
@@ -0,0 +1,69 @@
+# Scaling curves : runs the playground's benchmark on generated scenes of growing size (--stress),
+# and prints the frame times against the size of the scene, as CSV.
+#
+# Build the playground first, then, from anywhere :
+#   python3 distrib/stress.py --bodies 0,10,100,1000
+#   python3 distrib/stress.py --bodies 100 --moons 0,2,4 --asteroids 0,10000,100000 --csv stress.csv
+# Every combination of the lists is run. The other benchmark options go after -- :
+#   python3 distrib/stress.py --bodies 0,1000 -- --frames 120 --msaa 4
+#
+# Only needs the standard library.
+
+import argparse
+import itertools
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+Root = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+PlaygroundDir = os.path.join(Root, 'playground')
+
+def Counts(text):
+	return [int(value) for value in text.split(',')]
+
+# Runs one benchmark, returns its report
+def RunScene(options, bodies, moons, asteroids, extra):
+	scene = 'bodies=%d,moons=%d,asteroids=%d,seed=%d' % (bodies, moons, asteroids, options.seed)
+	report = os.path.join(tempfile.gettempdir(), 'stress_bench.json')
+	command = [os.path.join(PlaygroundDir, 'playground'), '--bench', options.camera_path, '--stress', scene,
+		'--frames', str(options.frames), '--report', report] + extra
+	with open(os.devnull, 'w') as log:
+		result = subprocess.call(command, cwd=PlaygroundDir, stdout=log, stderr=subprocess.STDOUT)
+	if result != 0:
+		raise Exception(scene + ' : the playground exited with ' + str(result))
+	with open(report) as f:
+		return json.load(f)
+
+def main():
+	arguments = sys.argv[1:]
+	extra = []
+	if '--' in arguments:
+		extra = arguments[arguments.index('--') + 1:]
+		arguments = arguments[:arguments.index('--')]
+	parser = argparse.ArgumentParser(description='Frame times of the playground against the size of generated scenes')
+	parser.add_argument('--bodies', type=Counts, default=[0], help='planets, comma separated')
+	parser.add_argument('--moons', type=Counts, default=[0], help='moons per planet, comma separated')
+	parser.add_argument('--asteroids', type=Counts, default=[0], help='asteroids of the belt, comma separated')
+	parser.add_argument('--seed', type=int, default=1)
+	parser.add_argument('--frames', type=int, default=300)
+	parser.add_argument('--camera-path', default='camera_path.txt', help='relative to the playground directory')
+	parser.add_argument('--csv', help='also write the table there')
+	options = parser.parse_args(arguments)
+
+	lines = ['bodies,moons,asteroids,cpu_p50_ms,cpu_p95_ms,gpu_p50_ms,gpu_p95_ms']
+	print(lines[0])
+	for bodies, moons, asteroids in itertools.product(options.bodies, options.moons, options.asteroids):
+		report = RunScene(options, bodies, moons, asteroids, extra)
+		lines.append('%d,%d,%d,%.3f,%.3f,%.3f,%.3f' % (bodies, moons, asteroids,
+			report['cpu_ms']['p50'], report['cpu_ms']['p95'], report['gpu_ms']['p50'], report['gpu_ms']['p95']))
+		print(lines[-1])
+		sys.stdout.flush()
+
+	if options.csv:
+		with open(options.csv, 'w') as f:
+			f.write('\n'.join(lines) + '\n')
+
+if __name__ == '__main__':
+	main()
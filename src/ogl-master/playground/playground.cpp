@@ -1,7 +1,17 @@
 // Include standard headers
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 // Include GLEW
 #include <GL/glew.h>
@@ -16,58 +26,114 @@ GLFWwindow* window;
 using namespace glm;
 
 #include <common/shader.hpp>
+#include <common/shaderpermutations.hpp>
 #include <common/texture.hpp>
 #include <common/controls.hpp>
+#include <common/headless.hpp>
+#include <common/bench.hpp>
+#include <common/profiler.hpp>
+#include <common/glintercept.hpp>
+#include <common/glstats.hpp>
+#include <common/gpuresources.hpp>
+#include <common/text2D.hpp>
+#include <common/sdftext.hpp>
+#include <common/perfhud.hpp>
+#include <common/sceneframebuffer.hpp>
 #include <common/objloader.hpp>
 #include <common/vboindexer.hpp>
+#include <common/mesh.hpp>
+#include <common/simplify.hpp>
+#include <common/sphere.hpp>
+#include <common/frustum.hpp>
+#include <common/streambuffer.hpp>
+#include <common/asteroidbelt.hpp>
+#include <common/stressscene.hpp>
+#include <common/jobsystem.hpp>
+#include <common/particles.hpp>
+#include <common/assetarchive.hpp>
+#include <common/assetloader.hpp>
+#include <common/virtualtexture.hpp>
+#include <common/texturestreaming.hpp>
+#define DISTRIB_SCREENSHOT_NO_HOOKS
+#include <distrib/screenshot.h>
 #include <glm/gtx/euler_angles.hpp>
 #include <common/quaternion_utils.hpp>
+
+// Include AntTweakBar
+#include <AntTweakBar.h>
+
 #include <common/space.h>
 
 
 
-int main(void)
+int main(int argc, char ** argv)
 {
-	// Initialise GLFW
-	if (!glfwInit())
-	{
-		fprintf(stderr, "Failed to initialize GLFW\n");
-		getchar();
+	if (!parseArguments(argc, argv))
 		return -1;
+	if (gMSAASamples < 0)
+		gMSAASamples = gBenchCameraPath == NULL ? 4 : 0;
+	if (gStress) {
+		buildStressScene(gStressScene, gSphereRadius, gScaleSun, sizeof(StressTextureUnits) / sizeof(StressTextureUnits[0]), StressBodies);
+		gAsteroidCount = gStressScene.asteroids;
+		gAsteroidSeed = gStressScene.seed;
+		printf("Stress scene : %u bodies, %u asteroids\n", (unsigned int)StressBodies.size(), gAsteroidCount);
 	}
-	
-	glfwWindowHint(GLFW_SAMPLES, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// Open a window and create its OpenGL context
-	window = glfwCreateWindow(1024, 768, "Space Explorer", NULL, NULL);
-	if (window == NULL) {
-		fprintf(stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.\n");
-		getchar();
-		glfwTerminate();
-		return -1;
+
+	if (gBenchCameraPath != NULL) {
+		// No window : everything is drawn in a framebuffer object of the requested size
+		if (!loadCameraPath(gBenchCameraPath, BenchCameraPath) || !createHeadlessContext(gBenchWidth, gBenchHeight))
+			return -1;
 	}
-	glfwMakeContextCurrent(window);
+	else {
+		// Initialise GLFW
+		if (!glfwInit())
+		{
+			fprintf(stderr, "Failed to initialize GLFW\n");
+			getchar();
+			return -1;
+		}
+	
+		// No multisampling : the scene is drawn offscreen with gMSAASamples, which can change at any time
+		glfwWindowHint(GLFW_SAMPLES, 0);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // To make MacOS happy; should not be needed
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Open a window and create its OpenGL context
+		window = glfwCreateWindow(1024, 768, "Space Explorer", NULL, NULL);
+		if (window == NULL) {
+			fprintf(stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials.\n");
+			getchar();
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+
+		// Initialize GLEW
+		glewExperimental = true; // Needed for core profile
+		if (glewInit() != GLEW_OK) {
+			fprintf(stderr, "Failed to initialize GLEW\n");
+			getchar();
+			glfwTerminate();
+			return -1;
+		}
+		// Ensure we can capture the escape key being pressed below
+		//glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+		// Hide the mouse and enable unlimited mouvement
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	// Initialize GLEW
-	glewExperimental = true; // Needed for core profile
-	if (glewInit() != GLEW_OK) {
-		fprintf(stderr, "Failed to initialize GLEW\n");
-		getchar();
-		glfwTerminate();
-		return -1;
+		// Set the mouse at the center of the screen
+		glfwPollEvents();
+		glfwSetCursorPos(window, 1024 / 2, 768 / 2);
 	}
-	// Ensure we can capture the escape key being pressed below
-	//glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
-	// Hide the mouse and enable unlimited mouvement
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	// Set the mouse at the center of the screen
-	glfwPollEvents();
-	glfwSetCursorPos(window, 1024 / 2, 768 / 2);
+	// From the default state of the new context, before any object is made
+	if (!installGpuResources())
+		return -1;
+	setGpuMemoryBudget((size_t)gGpuBudgetMB * 1024 * 1024);
+	if (gGLStats && !installGLStats(gGLStatsLog))
+		return -1;
 
 	// Dark blue background
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
@@ -80,69 +146,190 @@ int main(void)
 	// Cull triangles which normal is not towards the camera
 	glEnable(GL_CULL_FACE);
 
-	// Create and compile our GLSL program from the shaders
-	programID = LoadShaders("StandardShading.vertexshader", "StandardShading.fragmentshader");
+	setProfilerThreadName("Main");
+	initProfiler();
+
+	createCacheDirectory();
+
+	// The shaders are compiled into the executable, the other files come from the archive baked
+	// by the build ; without it, or with --loose-assets, from the directory
+	registerEmbeddedAssets(PlaygroundEmbeddedAssets, PlaygroundEmbeddedAssetsCount);
+	setLooseAssets(gLooseAssets);
+	setMappedFileLookup(findAsset);
+	setShaderFileLookup(findAsset);
+	if (!gLooseAssets && !openAssetArchive(gAssetArchive))
+		printf("Reading the loose files instead\n");
+
+	// Create and compile our GLSL programs from the shaders, or load them from the last run's binaries :
+	// one per combination of features, so that each light mode only runs the math it needs.
+	// They compile in the background when the driver can, the first frames use whichever are ready.
+	setShaderCacheDirectory(gShaderCacheDirectory != NULL ? cachePath(gShaderCacheDirectory).c_str() : NULL);
+	const char * shadingFeatures[] = { "DIRECT_LIGHTING", "VIRTUAL_TEXTURE" };
+	const unsigned int startupShadings[] = { 0, SHADING_DIRECT_LIGHTING, SHADING_VIRTUAL_TEXTURE, SHADING_DIRECT_LIGHTING | SHADING_VIRTUAL_TEXTURE };
+	{
+	GpuResourceOwner owner("Shaders");
+	initShaderPermutations("StandardShading.vertexshader", "StandardShading.fragmentshader", shadingFeatures, 2, StandardShading);
+	compileShaderPermutations(StandardShading, startupShadings, gVirtualTexturing ? 4 : 2);
+	}
+
+	// Files are read on worker threads, the bodies show placeholders until they are uploaded
+	startAssetLoader(0);
+	// The work of each frame is split across all of them (the particles)
+	startJobSystem(0);
+	setTextureStreamingBudget(gTextureBudget, gTextureUploadBytesPerFrame, gTextureTailSize);
 
-	// Get a handle for our "MVP" uniform
-	MatrixID = glGetUniformLocation(programID, "MVP");
-	ViewMatrixID = glGetUniformLocation(programID, "V");
-	ModelMatrixID = glGetUniformLocation(programID, "M");
+	// The objects of each part are counted under its name (--gpu-memory)
+	{
+	GpuResourceOwner owner("Sphere");
+	if (!initSphere()) return -1;
+	if (!initMoonMesh()) return -1;
+	}
 
+	{
+	GpuResourceOwner owner("Sun");
 	bool vertexbufferInitializedSun = initSun();
 	if (!vertexbufferInitializedSun) return -1;
+	}
 
+	{
+	GpuResourceOwner owner("Earth");
 	bool vertexbufferInitializedEarth = initEarth();
 	if (!vertexbufferInitializedEarth) return -1;
+	}
 	
+	{
+	GpuResourceOwner owner("Moon");
 	bool vertexbufferInitializedMoon = initMoon();
 	if (!vertexbufferInitializedMoon) return -1;
+	}
 
+	{
+	GpuResourceOwner owner("Mercury");
 	bool vertexbufferInitializedMercury = initMercury();
 	if (!vertexbufferInitializedMercury) return -1;
+	}
 
+	{
+	GpuResourceOwner owner("Venus");
 	bool vertexbufferInitializedVenus = initVenus();
 	if (!vertexbufferInitializedVenus) return -1;
+	}
 
+	{
+	GpuResourceOwner owner("Mars");
 	bool vertexbufferInitializedMars = initMars();
 	if (!vertexbufferInitializedMars) return -1;
+	}
 
+	{
+	GpuResourceOwner owner("Virtual textures");
+	if (gVirtualTexturing && !initVirtualTextures()) return -1;
+	}
 
-	// Get a handle for Light uniform + camara position
-	glUseProgram(programID);
-	
-	GLuint LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
-	GLuint LightColor = glGetUniformLocation(programID, "LightColor");
-	GLuint CamPosID = glGetUniformLocation(programID, "CamPos");
-	GLuint LightMode = glGetUniformLocation(programID, "LightMode");
+	if (gGLStats || gGpuMemoryHUD || gPerfHUD || gBenchCameraPath == NULL) {
+		GpuResourceOwner owner("HUD");
+		// The font of tutorial 11
+		initText2D("../tutorial11_2d_fonts/Holstein.DDS");
+		initPerfHUD();
+		gHUDTextReady = true;
+	}
+
+	{
+	GpuResourceOwner owner("Labels");
+	gLabelsReady = initSDFText("HolsteinSDF.dds");
+	}
+
+	if (gBenchCameraPath == NULL)
+		initTuningPanel();
 
 
-	glUniform3f(LightColor, 1, 1, 1);
-	glUniform1i(LightMode, Mode1);
+	// Start with the ambient light, in white
+	gLightMode = Mode1;
+	setShadingLight(gLightPosition, glm::vec3(1, 1, 1));
+
+	// The benchmark measures the frames, not the loading : wait for the assets and the shaders
+	if (gBenchCameraPath != NULL) {
+		{
+		GpuResourceOwner owner("Streaming");
+		waitForAssets();
+		}
+		GpuResourceOwner owner("Shaders");
+		for (unsigned int i=0; i<sizeof(startupShadings)/sizeof(startupShadings[0]); i++)
+			getShaderPermutation(StandardShading, startupShadings[i]);
+		initBenchRecorder(gBenchFrames, gBenchWarmupFrames, Bench);
+	}
 
 	// For speed computation
-	lastTime = glfwGetTime();
+	lastTime = getTime();
 	lastFrameTime = lastTime;
 	nbFrames = 0;
 	float lastFrame = 0.0f;
 	
 	do {
+		if (gBenchCameraPath != NULL)
+			beginBenchFrame(Bench);
+
+		PROFILE_SCOPE("Frame");
+		if (gHUDTextReady)
+			beginPerfHUDFrame();
+
 		// Measure speed
-		currentTime = glfwGetTime();
+		currentTime = getTime();
 		deltaTime = (float)(currentTime - lastFrameTime);
 		lastFrameTime = currentTime;
+		simDeltaTime = deltaTime * gTimeWarp;
 		nbFrames++;
+		if (gBenchCameraPath == NULL && currentTime - lastTime >= 1.0) {
+			// printf and reset timer
+			if (gGLStats)
+				printf("%f ms/frame, %u OpenGL calls, %u redundant, %u draws\n", 1000.0 / double(nbFrames),
+					LastGLStats.calls, LastGLStats.redundantCalls, LastGLStats.drawCalls);
+			else
+				printf("%f ms/frame\n", 1000.0 / double(nbFrames));
+			nbFrames = 0;
+			lastTime += 1.0;
+		}
 
-		// Clear the screen
+		// Upload the assets loaded since the last frame
+		{
+		PROFILE_GPU_SCOPE("Uploads");
+		GpuResourceOwner owner("Streaming");
+		updateAssetLoader(gAssetUploadBudget);
+		// The texture wraps once around the equator
+		setStreamedTextureSize(TextureEarth, 2.0f * 3.14159f * gSphereRadius * pixelsPerUnit(gPositionEarth, gScaleEarth));
+		setStreamedTextureSize(TextureMoon, 2.0f * 3.14159f * gSphereRadius * pixelsPerUnit(gPositionMoon, gScaleMoon));
+		setStreamedTextureSize(TextureSun, 2.0f * 3.14159f * gSphereRadius * pixelsPerUnit(gPositionSun, gScaleSun));
+		setStreamedTextureSize(TextureMercury, 2.0f * 3.14159f * gSphereRadius * pixelsPerUnit(gPositionMercury, gScaleMercury));
+		setStreamedTextureSize(TextureVenus, 2.0f * 3.14159f * gSphereRadius * pixelsPerUnit(gPositionVenus, gScaleVenus));
+		setStreamedTextureSize(TextureMars, 2.0f * 3.14159f * gSphereRadius * pixelsPerUnit(gPositionMars, gScaleMars));
+		updateTextureStreaming(deltaTime);
+		for (unsigned int i=0; i<VirtualTextures.size(); i++)
+			updateVirtualTexture(*VirtualTextures[i]);
+		}
+
+		// Clear the screen, or the offscreen framebuffer of the scene
+		beginScene();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Use our shader
-		glUseProgram(programID);
+		useShading(lightingFeatures());
 
+		{
+		PROFILE_SCOPE("Input");
 		//enables switching between lightmodes
-		switchLight();
+		if (gBenchCameraPath == NULL) {
+			switchLight();
+			toggleOverlays();
+			applyVSync();
+		}
 		
-		// Compute the MVP matrix from keyboard and mouse input
-		computeMatricesFromInputs();
+		// Compute the MVP matrix from keyboard and mouse input, or from the camera path
+		updateCamera();
+		extractFrustum(getProjectionMatrix() * getViewMatrix(), ViewFrustum);
+		}
+
+		{
+		PROFILE_SCOPE("Uniforms");
 		ProjectionMatrixEarth = getProjectionMatrix();
 		ViewMatrixEarth = getViewMatrix();
 		ModelMatrixEarth = glm::mat4(1.0);
@@ -173,605 +360,642 @@ int main(void)
 		ModelMatrixMars = glm::mat4(1.0);
 		MVPMars = ProjectionMatrixMars * ViewMatrixMars * ModelMatrixMars;
 
-		// Send our transformation to the currently bound shader, 
-		// in the "MVP" uniform
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVPEarth[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrixEarth[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixEarth[0][0]);
-
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVPMoon[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrixMoon[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixMoon[0][0]);
-
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVPSun[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrixSun[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixSun[0][0]);
-
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVPMercury[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrixMercury[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixMercury[0][0]);
-
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVPVenus[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrixVenus[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixVenus[0][0]);
-
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVPMars[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrixMars[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixMars[0][0]);
+		// The matrices are uploaded by the draw of each body, after it binds its program
 
 		//Set up the Light with lightpos,lightcolor and camerapos
 		glm::vec3 campos = getCameraPos();
-		glUniform3f(LightID, campos.x, campos.y, campos.z);
+		glm::vec3 lightColor = gLightColor;
 		
 	
 		// if discolight is activate rotate trough rgb to change light color depending on time passed
 		if (specularDisco) {
 			//Change the color  of the shader in dependency of the passed time
-			float timeValue = glfwGetTime();
+			float timeValue = (float)getTime();
 			float redValue = (tan(timeValue)/2.0f);
 			float greenValue = (sin(timeValue)/2.0f);
 			float blueValue = (cos(timeValue)/2.0f);
 
-			glUniform3f(LightColor, redValue, greenValue, blueValue);
+			lightColor = glm::vec3(redValue, greenValue, blueValue);
 
 		}
 		//if ambient light set lightcolor to white 
 		else if(ambientLight)
 		{
-		glm::vec3 lightColor = glm::vec3(1, 1, 1);
-		glUniform3f(LightColor, lightColor.x, lightColor.y, lightColor.z);
+		lightColor = glm::vec3(1, 1, 1);
 		}
 		// if specualr light is on u get somewhat like a flashlight
 		else if (specularLight)
 		{
-			glm::vec3 lightColor = glm::vec3(1, 1, 1);
-			glUniform3f(LightColor, lightColor.x, lightColor.y, lightColor.z);
+			lightColor = glm::vec3(1, 1, 1);
+		}
+		setShadingLight(campos, lightColor);
+		}
+
+		{
+		PROFILE_GPU_SCOPE("Earth");
+		// Sample the virtual texture instead, when there is one
+		if (VirtualTextureEarth.physicalTexture != 0) {
+			useShading(lightingFeatures() | SHADING_VIRTUAL_TEXTURE);
+			bindVirtualTexture(VirtualTextureEarth, VTUniformIDs, 6, 0.0f);
+		}
+		else {
+			useShading(lightingFeatures());
 		}
 
 		// Bind our texture in Texture Unit 0
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, TextureEarth);
 		// Set our "myTextureSampler" sampler to use Texture Unit 0
-		glUniform1i(TextureIDEarth, 0);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferEarth);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferEarth);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferEarth);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
+		glUniform1i(CurrentShading->TextureID, 0);
 
+		{
+		PROFILE_SCOPE("Rotate");
 		rotateEarth();
+		}
 		// Draw the triangles !
-		glDrawArrays(GL_TRIANGLES, 0, verticesEarth.size());
+		LODEarth = selectMeshLOD(MeshSphere, LODEarth, pixelsPerUnit(gPositionEarth, gScaleEarth), gLODErrorPixels, gLODHysteresis);
+		if (bodyVisible(gPositionEarth, gScaleEarth))
+			drawMesh(MeshSphere, MeshUniformIDs, LODEarth);
+		}
 	
+		{
+		PROFILE_GPU_SCOPE("Moon");
+		useShading(lightingFeatures());
+
 		// Bind our texture in Texture Unit 1
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, TextureMoon);
 		// Set our "myTextureSampler" sampler to use Texture Unit 1
-		glUniform1i(TextureIDMoon, 1);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferMoon);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferMoon);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferMoon);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
+		glUniform1i(CurrentShading->TextureID, 1);
 
+		{
+		PROFILE_SCOPE("Rotate");
 		rotateMoon();
+		}
 		
 		//// Draw the triangles !
-		glDrawArrays(GL_TRIANGLES, 0, verticesMoon.size());
+		LODMoon = selectMeshLOD(MeshMoon, LODMoon, pixelsPerUnit(gPositionMoon, gScaleMoon), gLODErrorPixels, gLODHysteresis);
+		if (bodyVisible(gPositionMoon, gScaleMoon))
+			drawMesh(MeshMoon, MeshUniformIDs, LODMoon);
+		}
 
 
+		{
+		PROFILE_GPU_SCOPE("Sun");
 		// Bind our texture in Texture Unit 2
 		glActiveTexture(GL_TEXTURE2);
 		glBindTexture(GL_TEXTURE_2D, TextureSun);
 		// Set our "myTextureSampler" sampler to use Texture Unit 2
-		glUniform1i(TextureIDSun, 2);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferSun);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferSun);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferSun);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
+		glUniform1i(CurrentShading->TextureID, 2);
 
+		{
+		PROFILE_SCOPE("Rotate");
 		rotateSun();
+		}
 		//Draw the triangles !
-		glDrawArrays(GL_TRIANGLES, 0, verticesSun.size());
+		LODSun = selectMeshLOD(MeshSphere, LODSun, pixelsPerUnit(gPositionSun, gScaleSun), gLODErrorPixels, gLODHysteresis);
+		if (bodyVisible(gPositionSun, gScaleSun))
+			drawMesh(MeshSphere, MeshUniformIDs, LODSun);
+		}
 
 
+		{
+		PROFILE_GPU_SCOPE("Mercury");
 		// Bind our texture in Texture Unit 3
 		glActiveTexture(GL_TEXTURE3);
 		glBindTexture(GL_TEXTURE_2D, TextureMercury);
 		// Set our "myTextureSampler" sampler to use Texture Unit 3
-		glUniform1i(TextureIDMercury, 3);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferMercury);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferMercury);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferMercury);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
+		glUniform1i(CurrentShading->TextureID, 3);
 
+		{
+		PROFILE_SCOPE("Rotate");
 		rotateMercury();
+		}
 		//Draw the triangles !
-		glDrawArrays(GL_TRIANGLES, 0, verticesMercury.size());
+		LODMercury = selectMeshLOD(MeshSphere, LODMercury, pixelsPerUnit(gPositionMercury, gScaleMercury), gLODErrorPixels, gLODHysteresis);
+		if (bodyVisible(gPositionMercury, gScaleMercury))
+			drawMesh(MeshSphere, MeshUniformIDs, LODMercury);
+		}
 
 
+		{
+		PROFILE_GPU_SCOPE("Venus");
 		// Bind our texture in Texture Unit 4
 		glActiveTexture(GL_TEXTURE4);
 		glBindTexture(GL_TEXTURE_2D, TextureVenus);
 		// Set our "myTextureSampler" sampler to use Texture Unit 4
-		glUniform1i(TextureIDVenus, 4);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferVenus);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferVenus);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferVenus);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
+		glUniform1i(CurrentShading->TextureID, 4);
 
+		{
+		PROFILE_SCOPE("Rotate");
 		rotateVenus();
+		}
 		//Draw the triangles !
-		glDrawArrays(GL_TRIANGLES, 0, verticesVenus.size());
+		LODVenus = selectMeshLOD(MeshSphere, LODVenus, pixelsPerUnit(gPositionVenus, gScaleVenus), gLODErrorPixels, gLODHysteresis);
+		if (bodyVisible(gPositionVenus, gScaleVenus))
+			drawMesh(MeshSphere, MeshUniformIDs, LODVenus);
+		}
+
+		{
+		PROFILE_GPU_SCOPE("Mars");
+		if (VirtualTextureMars.physicalTexture != 0) {
+			useShading(lightingFeatures() | SHADING_VIRTUAL_TEXTURE);
+			bindVirtualTexture(VirtualTextureMars, VTUniformIDs, 6, 0.0f);
+		}
 
 		// Bind our texture in Texture Unit 5
 		glActiveTexture(GL_TEXTURE5);
 		glBindTexture(GL_TEXTURE_2D, TextureMars);
 		// Set our "myTextureSampler" sampler to use Texture Unit 
-		glUniform1i(TextureIDMars, 5);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferMars);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferMars);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferMars);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
+		glUniform1i(CurrentShading->TextureID, 5);
 
+		{
+		PROFILE_SCOPE("Rotate");
 		rotateMars();
+		}
 		//Draw the triangles !
-		glDrawArrays(GL_TRIANGLES, 0, verticesMars.size());
-
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-	
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
-		} // Check if the ESC key was pressed or the window was closed
-		while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
-			glfwWindowShouldClose(window) == 0);
+		LODMars = selectMeshLOD(MeshSphere, LODMars, pixelsPerUnit(gPositionMars, gScaleMars), gLODErrorPixels, gLODHysteresis);
+		if (bodyVisible(gPositionMars, gScaleMars))
+			drawMesh(MeshSphere, MeshUniformIDs, LODMars);
+		}
 
-		// Cleanup VBO and shader
-		glDeleteBuffers(1, &vertexbufferEarth);
-		glDeleteBuffers(1, &uvbufferEarth);
-		glDeleteBuffers(1, &normalbufferEarth);
-		glDeleteProgram(programID);
-		glDeleteTextures(1, &TextureEarth);
-		glDeleteVertexArrays(1, &VertexArrayIDEarth);
-
-		glDeleteBuffers(1, &vertexbufferMoon);
-		glDeleteBuffers(1, &uvbufferMoon);
-		glDeleteBuffers(1, &normalbufferMoon);
-		glDeleteTextures(1, &TextureMoon);
-		glDeleteVertexArrays(1, &VertexArrayIDMoon);
-
-
-		glDeleteBuffers(1, &vertexbufferSun);
-		glDeleteBuffers(1, &uvbufferSun);
-		glDeleteBuffers(1, &normalbufferSun);
-		glDeleteTextures(1, &TextureSun);
-		glDeleteVertexArrays(1, &VertexArrayIDSun);
-
-		glDeleteBuffers(1, &vertexbufferMercury);
-		glDeleteBuffers(1, &uvbufferMercury);
-		glDeleteBuffers(1, &normalbufferMercury);
-		glDeleteTextures(1, &TextureMercury);
-		glDeleteVertexArrays(1, &VertexArrayIDMercury);
-
-		glDeleteBuffers(1, &vertexbufferVenus);
-		glDeleteBuffers(1, &uvbufferVenus);
-		glDeleteBuffers(1, &normalbufferVenus);
-		glDeleteTextures(1, &TextureVenus);
-		glDeleteVertexArrays(1, &VertexArrayIDVenus);
-
-		glDeleteBuffers(1, &vertexbufferMars);
-		glDeleteBuffers(1, &uvbufferMars);
-		glDeleteBuffers(1, &normalbufferMars);
-		glDeleteTextures(1, &TextureMars);
-		glDeleteVertexArrays(1, &VertexArrayIDMars);
+		if (!StressBodies.empty()) {
+			PROFILE_GPU_SCOPE("Stress bodies");
+			drawStressBodies();
+		}
 
-		// Close OpenGL window and terminate GLFW
-		glfwTerminate();
+		if (gAsteroidCount > 0 || gAsteroidBeltReady) {
+			PROFILE_GPU_SCOPE("Asteroids");
+			drawAsteroids();
+		}
 
-		return 0;
-	}
+		// After everything opaque : the particles are blended over it
+		if (gParticleBudget > 0 || ParticleBudgetReady > 0) {
+			PROFILE_GPU_SCOPE("Particles");
+			drawParticles();
+		}
 
-	bool initEarth() {
-		GLuint VertexArrayID;
-	
-		glGenVertexArrays(1, &VertexArrayID);
-		glBindVertexArray(VertexArrayID);
+		// Find out which pages of the virtual textures this frame needed
+		if (!VirtualTextures.empty()) {
+			PROFILE_GPU_SCOPE("Feedback");
+			drawVirtualTextureFeedback();
+		}
 
-		// Load the texture
-		TextureEarth = loadDDS("erde_dds.DDS");
+		// The scene is done : into the window's framebuffer, which the overlays are drawn on
+		endScene();
 
-		// Get a handle for our "myTextureSampler" uniform
-		TextureIDEarth = glGetUniformLocation(programID, "myTextureSampler");
+		// The names of the bodies, over everything
+		if (gLabels && gLabelsReady) {
+			PROFILE_GPU_SCOPE("Labels");
+			drawLabels();
+		}
 
-		bool res = loadOBJ("erde.obj", verticesEarth, uvsEarth, normalsEarth);
+		// The frame is done : the HUDs are not part of its times and counters
+		if (gHUDTextReady)
+			recordPerfHUDFrame();
+
+		// The OpenGL calls of this frame, and the HUDs, which are not counted. Their text is drawn at once.
+		if (gGLStats || gGpuMemoryHUD || gPerfHUD) {
+			if (gGLStats) {
+				LastGLStats = glStatsFrame();
+				setGLStatsCounting(false);
+				drawGLStatsHUD(LastGLStats);
+			}
+			if (gGpuMemoryHUD)
+				drawGpuMemoryHUD();
+			glDisable(GL_DEPTH_TEST);
+			if (gPerfHUD) {
+				PROFILE_GPU_SCOPE("Perf HUD");
+				drawPerfHUD(8, 8);
+			}
+			flushText2D();
+			glEnable(GL_DEPTH_TEST);
+			// The text's program is bound now
+			CurrentShading = NULL;
+			if (gGLStats)
+				setGLStatsCounting(true);
+		}
 
-		std::vector<unsigned short> indices;
-		std::vector<glm::vec3> indexed_vertices;
-		std::vector<glm::vec2> indexed_uvs;
-		std::vector<glm::vec3> indexed_normals;
-		indexVBO(verticesEarth, uvsEarth, normalsEarth, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		// The tuning panel, over the HUDs. AntTweakBar restores the state it changes.
+		if (gTuningPanel)
+			TwDraw();
 
-		glGenBuffers(1, &vertexbufferEarth);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferEarth);
-		glBufferData(GL_ARRAY_BUFFER, verticesEarth.size() * sizeof(glm::vec3), &verticesEarth[0], GL_STATIC_DRAW);
+		// The GPU times of an earlier frame
+		profilerFrame();
 
-	
-		glGenBuffers(1, &uvbufferEarth);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferEarth);
-		glBufferData(GL_ARRAY_BUFFER, uvsEarth.size() * sizeof(glm::vec2), &uvsEarth[0], GL_STATIC_DRAW);
+		if (gBenchCameraPath != NULL) {
+			endBenchFrame(Bench);
+			saveBenchScreenshot();
+			continue;
+		}
 
-		glGenBuffers(1, &normalbufferEarth);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferEarth);
-		glBufferData(GL_ARRAY_BUFFER, normalsEarth.size() * sizeof(glm::vec3), &normalsEarth[0], GL_STATIC_DRAW);
-		return true;
-	}
+		// Swap buffers
+		{
+		PROFILE_SCOPE("Swap");
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+		}
 
-	bool initMoon() {
-		GLuint VertexArrayID;
-		glGenVertexArrays(1, &VertexArrayID);
-		glBindVertexArray(VertexArrayID);
+		dumpProfilerTrace();
+		} // Check if the ESC key was pressed or the window was closed, or if the benchmark is over
+		while (gBenchCameraPath != NULL ? !benchFinished(Bench) :
+			glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS && glfwWindowShouldClose(window) == 0);
 
-		// Load the texture
-		TextureMoon = loadDDS("mond_dds.DDS");
+		if (gTracePath != NULL)
+			writeProfilerTrace(gTracePath);
+		deleteProfiler();
 
-		// Get a handle for our "myTextureSampler" uniform
-		TextureIDMoon = glGetUniformLocation(programID, "myTextureSampler");
+		if (gHUDTextReady) {
+			cleanupPerfHUD();
+			cleanupText2D();
+		}
+		if (gLabelsReady)
+			cleanupSDFText();
+		if (gBenchCameraPath == NULL)
+			TwTerminate();
+		if (gAsteroidBeltReady)
+			deleteAsteroidBelt(Asteroids);
+		if (ParticleBudgetReady > 0)
+			deleteParticles();
+		deleteSceneFramebuffer(SceneTarget);
+		if (gGLStats)
+			uninstallGLStats();
+
+		bool benchOk = true;
+		if (gBenchCameraPath != NULL) {
+			finishBenchRecorder(Bench);
+			benchOk = writeBenchReport(gBenchReport, Bench, gBenchCameraPath, gStressSceneName, gBenchWidth, gBenchHeight);
+			printf("%u frames in %.2f s, written to %s\n", (unsigned int)Bench.cpuMilliseconds.size(), Bench.totalSeconds, gBenchReport);
+		}
 
-		//use the same 3obj to scale it down
-		bool resMoon = loadOBJ("erde.obj", verticesMoon, uvsMoon, normalsMoon);
+		// Before the loader stops : a level still loading is deleted by its finish callback
+		unloadStreamedTexture(TextureEarth);
+		unloadStreamedTexture(TextureMoon);
+		unloadStreamedTexture(TextureSun);
+		unloadStreamedTexture(TextureMercury);
+		unloadStreamedTexture(TextureVenus);
+		unloadStreamedTexture(TextureMars);
+
+		stopAssetLoader();
+		stopJobSystem();
+
+		for (unsigned int i=0; i<VirtualTextures.size(); i++)
+			deleteVirtualTexture(*VirtualTextures[i]);
+		if (gVirtualTexturing){
+			deleteVirtualTextureFeedback(Feedback);
+			glDeleteProgram(feedbackProgramID);
+		}
 
-		std::vector<unsigned short> indices;
-		std::vector<glm::vec3> indexed_vertices;
-		std::vector<glm::vec2> indexed_uvs;
-		std::vector<glm::vec3> indexed_normals;
-		indexVBO(verticesMoon, uvsMoon, normalsMoon, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		// Cleanup VBO and shader
+		deleteMesh(MeshSphere);
+		deleteMesh(MeshMoon);
+		deleteShaderPermutations(StandardShading);
 
-		glGenBuffers(1, &vertexbufferMoon);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferMoon);
-		glBufferData(GL_ARRAY_BUFFER, verticesMoon.size() * sizeof(glm::vec3), &verticesMoon[0], GL_STATIC_DRAW);
+		// The textures don't read from it anymore
+		closeAssetArchive();
 
+		// Everything was deleted : what remains leaked
+		reportGpuResourceLeaks();
+		uninstallGpuResources();
 
-		glGenBuffers(1, &uvbufferMoon);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferMoon);
-		glBufferData(GL_ARRAY_BUFFER, uvsMoon.size() * sizeof(glm::vec2), &uvsMoon[0], GL_STATIC_DRAW);
+		// Close OpenGL window and terminate GLFW
+		if (gBenchCameraPath != NULL)
+			destroyHeadlessContext();
+		else
+			glfwTerminate();
 
-		glGenBuffers(1, &normalbufferMoon);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferMoon);
-		glBufferData(GL_ARRAY_BUFFER, normalsMoon.size() * sizeof(glm::vec3), &normalsMoon[0], GL_STATIC_DRAW);
-		return true;
+		return benchOk ? 0 : 1;
 	}
 
-	bool initSun() {
-		GLuint VertexArrayID;
-
-		glGenVertexArrays(1, &VertexArrayID);
-		glBindVertexArray(VertexArrayID);
-
-		// Load the texture
-		TextureSun = loadDDS("sun_dds.DDS");
-
-		// Get a handle for our "myTextureSampler" uniform
-		TextureIDSun = glGetUniformLocation(programID, "myTextureSampler");
-
-		bool resSun = loadOBJ("sun.obj", verticesSun, uvsSun, normalsSun);
+	// Loads an OBJ file, indexes it, scales it to the radius of the sphere and builds its levels of detail.
+	// Runs on a worker thread.
+	bool buildObjMesh(const char * path, MeshData & data) {
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		if (!loadOBJ(path, vertices, uvs, normals))
+			return false;
 
 		std::vector<unsigned short> indices;
 		std::vector<glm::vec3> indexed_vertices;
 		std::vector<glm::vec2> indexed_uvs;
 		std::vector<glm::vec3> indexed_normals;
-		indexVBO(verticesSun, uvsSun, normalsSun, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		indexVBO(vertices, uvs, normals, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		optimizeVertexCache(indices, indexed_vertices.size());
+		optimizeVertexFetch(indices, indexed_vertices, indexed_uvs, indexed_normals);
+
+		// Same size as the sphere, so that the scales, the culling and the labels apply unchanged
+		float radius = 0.0f;
+		for (unsigned int i=0; i<indexed_vertices.size(); i++)
+			radius = glm::max(radius, glm::length(indexed_vertices[i]));
+		if (radius > 0.0f)
+			for (unsigned int i=0; i<indexed_vertices.size(); i++)
+				indexed_vertices[i] *= gSphereRadius / radius;
+
+		// All the levels of detail share the vertices, one after the other in the index buffer
+		std::vector<unsigned short> lod_indices;
+		std::vector<MeshLOD> lods;
+		buildLODChain(indices, indexed_vertices, gLODMinTriangles, gLODMaxRelativeError * gSphereRadius, lod_indices, lods);
+
+		QuantizationError error;
+		buildMeshData(lod_indices, indexed_vertices, indexed_uvs, indexed_normals, gVertexFormat, data, &error);
+		data.lods = lods;
+		printQuantizationError(path, data, error);
+		for (unsigned int i=0; i<lods.size(); i++)
+			printf("  LOD %u : %d triangles, error %g\n", i, lods[i].indexCount / 3, lods[i].error);
+		return true;
+	}
 
-		glGenBuffers(1, &vertexbufferSun);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferSun);
-		glBufferData(GL_ARRAY_BUFFER, verticesSun.size() * sizeof(glm::vec3), &verticesSun[0], GL_STATIC_DRAW);
+	// Without the directory, nothing is baked : every run builds everything again
+	void createCacheDirectory() {
+#ifdef _WIN32
+		_mkdir(gCacheDirectory);
+#else
+		mkdir(gCacheDirectory, 0755);
+#endif
+	}
 
+	std::string cachePath(const char * name) {
+		return std::string(gCacheDirectory) + "/" + name;
+	}
 
-		glGenBuffers(1, &uvbufferSun);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferSun);
-		glBufferData(GL_ARRAY_BUFFER, uvsSun.size() * sizeof(glm::vec2), &uvsSun[0], GL_STATIC_DRAW);
+	// Reads a baked mesh, baking it from the OBJ file on the first run, or again when it has another vertex format.
+	// Runs on a worker thread.
+	bool loadBakedMesh(const char * objPath, const std::string & meshPath, MeshData & data) {
+		FILE * file = fopen(meshPath.c_str(), "rb");
+		if (file != NULL){
+			fclose(file);
+			if (loadMeshData(meshPath.c_str(), data) && data.format == gVertexFormat)
+				return true;
+		}
 
-		glGenBuffers(1, &normalbufferSun);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferSun);
-		glBufferData(GL_ARRAY_BUFFER, normalsSun.size() * sizeof(glm::vec3), &normalsSun[0], GL_STATIC_DRAW);
+		data = MeshData();
+		if (!buildObjMesh(objPath, data))
+			return false;
+		// Without the baked file, the next run builds the mesh again
+		saveMeshData(meshPath.c_str(), data);
 		return true;
 	}
 
-	bool initMercury() {
-		GLuint VertexArrayID;
+	// Generates the sphere shared by all the bodies, with its levels of detail.
+	// Runs on a worker thread.
+	bool buildSphereMesh(MeshData & data) {
+		std::vector<unsigned short> indices;
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<MeshLOD> lods;
+		buildSphereLODChain(gSphereSubdivisions, gSphereMinSubdivisions, gSphereRadius, indices, vertices, uvs, normals, lods);
+
+		QuantizationError error;
+		buildMeshData(indices, vertices, uvs, normals, gVertexFormat, data, &error);
+		data.lods = lods;
+		printQuantizationError("Sphere", data, error);
+		for (unsigned int i=0; i<lods.size(); i++)
+			printf("  LOD %u : %d triangles, error %g\n", i, lods[i].indexCount / 3, lods[i].error);
+		return true;
+	}
 
-		glGenVertexArrays(1, &VertexArrayID);
-		glBindVertexArray(VertexArrayID);
+	// Uploads the coarsest sphere right away as a placeholder, and queues the full one
+	bool initSphere() {
+		std::vector<unsigned short> indices;
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		buildSphere(gSphereMinSubdivisions, gSphereRadius, indices, vertices, uvs, normals);
 
-		// Load the texture
-		TextureMercury = loadDDS("mercury_dds.DDS");
+		MeshData data;
+		buildMeshData(indices, vertices, uvs, normals, gVertexFormat, data, NULL);
+		uploadMesh(data, MeshSphere);
 
-		// Get a handle for our "myTextureSampler" uniform
-		TextureIDMercury = glGetUniformLocation(programID, "myTextureSampler");
-		//use earth object to scale it properly
-		bool resMercury = loadOBJ("erde.obj", verticesMercury, uvsMercury, normalsMercury);
+		loadMeshAsync(buildSphereMesh, &MeshSphere);
+		return true;
+	}
 
+	// The coarsest sphere stands for the Moon until its mesh is loaded
+	bool initMoonMesh() {
 		std::vector<unsigned short> indices;
-		std::vector<glm::vec3> indexed_vertices;
-		std::vector<glm::vec2> indexed_uvs;
-		std::vector<glm::vec3> indexed_normals;
-		indexVBO(verticesMercury, uvsMercury, normalsMercury, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		buildSphere(gSphereMinSubdivisions, gSphereRadius, indices, vertices, uvs, normals);
 
-		glGenBuffers(1, &vertexbufferMercury);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferMercury);
-		glBufferData(GL_ARRAY_BUFFER, verticesMercury.size() * sizeof(glm::vec3), &verticesMercury[0], GL_STATIC_DRAW);
+		MeshData data;
+		buildMeshData(indices, vertices, uvs, normals, gVertexFormat, data, NULL);
+		uploadMesh(data, MeshMoon);
 
+		loadMeshAsync(std::bind(loadBakedMesh, "mond.obj", cachePath("mond.mesh"), std::placeholders::_1), &MeshMoon);
+		return true;
+	}
 
-		glGenBuffers(1, &uvbufferMercury);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferMercury);
-		glBufferData(GL_ARRAY_BUFFER, uvsMercury.size() * sizeof(glm::vec2), &uvsMercury[0], GL_STATIC_DRAW);
+	// Opens a page file of the cache, building it from the .DDS on the first run
+	bool loadPageFile(const char * ddsPath, const char * pageName, VirtualTexture & vt) {
+		std::string pagePath = cachePath(pageName);
+		FILE * file = fopen(pagePath.c_str(), "rb");
+		if (file != NULL)
+			fclose(file);
+		else if (!buildPageFile(ddsPath, pagePath.c_str()))
+			return false;
+		return loadVirtualTexture(pagePath.c_str(), gVirtualTextureCacheTiles, vt);
+	}
 
-		glGenBuffers(1, &normalbufferMercury);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferMercury);
-		glBufferData(GL_ARRAY_BUFFER, normalsMercury.size() * sizeof(glm::vec3), &normalsMercury[0], GL_STATIC_DRAW);
+	// The bodies seen from low orbit get virtual textures, streamed from their page files
+	bool initVirtualTextures() {
+		feedbackProgramID = LoadShaders("StandardShading.vertexshader", "VirtualTextureFeedback.fragmentshader");
+		FeedbackMatrixID = glGetUniformLocation(feedbackProgramID, "MVP");
+		FeedbackMeshUniformIDs = getMeshUniforms(feedbackProgramID);
+		VTFeedbackUniformIDs = getVirtualTextureUniforms(feedbackProgramID);
+
+		int width, height;
+		getFramebufferSize(width, height);
+		if (!initVirtualTextureFeedback(width / gFeedbackDivisor, height / gFeedbackDivisor, Feedback))
+			return false;
+
+		// Without a page file, the body keeps its regular texture
+		if (loadPageFile("erde_dds.dds", "erde.vtex", VirtualTextureEarth))
+			VirtualTextures.push_back(&VirtualTextureEarth);
+		if (loadPageFile("mars_dds.dds", "mars.vtex", VirtualTextureMars))
+			VirtualTextures.push_back(&VirtualTextureMars);
 		return true;
 	}
 
-	bool initVenus() {
-		GLuint VertexArrayID;
+	// Draws the virtual textured bodies again in the small feedback framebuffer
+	void drawVirtualTextureFeedback() {
+		beginVirtualTextureFeedback(Feedback);
+		glUseProgram(feedbackProgramID);
+		// The feedback pixels are gFeedbackDivisor times bigger : compensate in the level selection
+		float lodBias = -log2f((float)gFeedbackDivisor);
+
+		if (VirtualTextureEarth.physicalTexture != 0) {
+			glUniformMatrix4fv(FeedbackMatrixID, 1, GL_FALSE, &MVPEarth[0][0]);
+			bindVirtualTexture(VirtualTextureEarth, VTFeedbackUniformIDs, 6, lodBias);
+			if (bodyVisible(gPositionEarth, gScaleEarth))
+				drawMesh(MeshSphere, FeedbackMeshUniformIDs, LODEarth);
+		}
+		if (VirtualTextureMars.physicalTexture != 0) {
+			glUniformMatrix4fv(FeedbackMatrixID, 1, GL_FALSE, &MVPMars[0][0]);
+			bindVirtualTexture(VirtualTextureMars, VTFeedbackUniformIDs, 6, lodBias);
+			if (bodyVisible(gPositionMars, gScaleMars))
+				drawMesh(MeshSphere, FeedbackMeshUniformIDs, LODMars);
+		}
 
-		glGenVertexArrays(1, &VertexArrayID);
-		glBindVertexArray(VertexArrayID);
+		endVirtualTextureFeedback(Feedback, VirtualTextures);
+		CurrentShading = NULL;
+	}
 
-		// Load the texture
-		TextureVenus = loadDDS("venus_dds.DDS");
+	// --loose-assets, and the benchmark options
+	bool parseArguments(int argc, char ** argv) {
+		for (int i = 1; i < argc; i++) {
+			bool hasValue = i + 1 < argc;
+			if (strcmp(argv[i], "--loose-assets") == 0)
+				gLooseAssets = true;
+			else if (strcmp(argv[i], "--asset-archive") == 0 && hasValue)
+				gAssetArchive = argv[++i];
+			else if (strcmp(argv[i], "--cache") == 0 && hasValue)
+				gCacheDirectory = argv[++i];
+			else if (strcmp(argv[i], "--trace") == 0 && hasValue)
+				gTracePath = argv[++i];
+			else if (strcmp(argv[i], "--gl-stats") == 0)
+				gGLStats = true;
+			else if (strcmp(argv[i], "--gl-stats-log") == 0 && hasValue) {
+				gGLStats = true;
+				gGLStatsLog = argv[++i];
+			}
+			else if (strcmp(argv[i], "--gpu-memory") == 0)
+				gGpuMemoryHUD = true;
+			else if (strcmp(argv[i], "--gpu-budget") == 0 && hasValue)
+				gGpuBudgetMB = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--perf-hud") == 0)
+				gPerfHUD = true;
+			else if (strcmp(argv[i], "--labels") == 0)
+				gLabels = true;
+			else if (strcmp(argv[i], "--msaa") == 0 && hasValue)
+				gMSAASamples = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--render-scale") == 0 && hasValue)
+				gRenderScale = (float)atof(argv[++i]);
+			else if (strcmp(argv[i], "--asteroids") == 0 && hasValue)
+				gAsteroidCount = (unsigned int)atoi(argv[++i]);
+			else if (strcmp(argv[i], "--particles") == 0 && hasValue)
+				gParticleBudget = (unsigned int)atoi(argv[++i]);
+			else if (strcmp(argv[i], "--stress") == 0 && hasValue) {
+				if (!parseStressSceneConfig(argv[++i], gStressScene))
+					return false;
+				gStress = true;
+				snprintf(gStressSceneName, sizeof(gStressSceneName), "bodies=%u,moons=%u,asteroids=%u,seed=%u",
+					gStressScene.bodies, gStressScene.moons, gStressScene.asteroids, gStressScene.seed);
+			}
+			else if (strcmp(argv[i], "--bench") == 0 && hasValue)
+				gBenchCameraPath = argv[++i];
+			else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+				gBenchFrames = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+				gBenchWarmupFrames = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--width") == 0 && hasValue)
+				gBenchWidth = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--height") == 0 && hasValue)
+				gBenchHeight = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--report") == 0 && hasValue)
+				gBenchReport = argv[++i];
+			else if (strcmp(argv[i], "--screenshots") == 0 && hasValue) {
+				for (const char * frames = argv[++i]; *frames != '\0'; ) {
+					gScreenshotFrames.push_back((int)strtol(frames, (char **)&frames, 10));
+					while (*frames == ',' || *frames == ' ')
+						frames++;
+				}
+			}
+			else if (strcmp(argv[i], "--screenshot-prefix") == 0 && hasValue)
+				gScreenshotPrefix = argv[++i];
+			else {
+				printf("Usage : playground [--loose-assets] [--asset-archive playground.pak] [--cache directory] [--trace trace.json] [--gl-stats] [--gl-stats-log calls.csv] [--gpu-memory] [--gpu-budget MB] [--perf-hud] [--labels] [--msaa N] [--render-scale S] [--asteroids N] [--particles N] [--stress bodies=N,moons=M,asteroids=K,seed=S] [--bench camera_path.txt [--frames N] [--warmup N] [--width W] [--height H] [--report bench.json] [--screenshots 0,60,119] [--screenshot-prefix path]]\n");
+				return false;
+			}
+		}
+		if (gBenchFrames <= 0 || gBenchWarmupFrames < 0 || gBenchWidth <= 0 || gBenchHeight <= 0 || gGpuBudgetMB < 0) {
+			printf("--frames, --width and --height must be positive, --warmup and --gpu-budget can be 0\n");
+			return false;
+		}
+		if (gRenderScale < 0.25f || gRenderScale > 2.0f) {
+			printf("--render-scale must be between 0.25 and 2\n");
+			return false;
+		}
+		return true;
+	}
 
-		// Get a handle for our "myTextureSampler" uniform
-		TextureIDVenus = glGetUniformLocation(programID, "myTextureSampler");
-		//use earth object to scale it properly
-		bool resVenus = loadOBJ("erde.obj", verticesVenus, uvsVenus, normalsVenus);
+	// Seconds since the start. The benchmark runs at a fixed frame rate, so that every run simulates the same frames.
+	double getTime() {
+		if (gBenchCameraPath != NULL)
+			return ((double)Bench.frame - Bench.warmupFrames) / gBenchFrameRate;
+		return glfwGetTime();
+	}
 
-		std::vector<unsigned short> indices;
-		std::vector<glm::vec3> indexed_vertices;
-		std::vector<glm::vec2> indexed_uvs;
-		std::vector<glm::vec3> indexed_normals;
-		indexVBO(verticesVenus, uvsVenus, normalsVenus, indices, indexed_vertices, indexed_uvs, indexed_normals);
+	void getFramebufferSize(int & width, int & height) {
+		if (gBenchCameraPath != NULL) {
+			width = gBenchWidth;
+			height = gBenchHeight;
+		}
+		else {
+			glfwGetFramebufferSize(window, &width, &height);
+		}
+	}
 
-		glGenBuffers(1, &vertexbufferVenus);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferVenus);
-		glBufferData(GL_ARRAY_BUFFER, verticesVenus.size() * sizeof(glm::vec3), &verticesVenus[0], GL_STATIC_DRAW);
+	void updateCamera() {
+		if (gBenchCameraPath == NULL) {
+			// The mouse is on the tuning panel
+			if (!gTuningPanel)
+				computeMatricesFromInputs();
+			return;
+		}
+		glm::vec3 position;
+		float horizontalAngle, verticalAngle;
+		sampleCameraPath(BenchCameraPath, (float)getTime(), position, horizontalAngle, verticalAngle);
+		setCameraView(position, horizontalAngle, verticalAngle, gBenchWidth / (float)gBenchHeight);
+	}
 
+	// Size on screen, in pixels, of one model unit of a body at the given position
+	float pixelsPerUnit(vec3 position, float scale) {
+		int width, height;
+		getFramebufferSize(width, height);
+		float distance = glm::max(glm::length(getCameraPos() - position), 0.001f);
+		// ProjectionMatrix[1][1] is 1/tan(FoV/2), the scene has gRenderScale times the pixels of the framebuffer
+		return scale * getProjectionMatrix()[1][1] * height * gRenderScale * 0.5f / distance;
+	}
 
-		glGenBuffers(1, &uvbufferVenus);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferVenus);
-		glBufferData(GL_ARRAY_BUFFER, uvsVenus.size() * sizeof(glm::vec2), &uvsVenus[0], GL_STATIC_DRAW);
+	bool initEarth() {
+		// Load the texture
+		TextureEarth = loadDDSStreamed("erde_dds.dds");
 
-		glGenBuffers(1, &normalbufferVenus);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferVenus);
-		glBufferData(GL_ARRAY_BUFFER, normalsVenus.size() * sizeof(glm::vec3), &normalsVenus[0], GL_STATIC_DRAW);
 		return true;
 	}
 
-	bool initMars() {
-		GLuint VertexArrayID;
+	bool initMoon() {
+		// There is no texture of the Moon : it borrows the grey, cratered one of Mercury
+		TextureMoon = loadDDSStreamed("mercury_dds.dds");
 
-		glGenVertexArrays(1, &VertexArrayID);
-		glBindVertexArray(VertexArrayID);
+		return true;
+	}
 
+	bool initSun() {
 		// Load the texture
-		TextureMars = loadDDS("mars_dds.DDS");
-
-		// Get a handle for our "myTextureSampler" uniform
-		TextureIDMars = glGetUniformLocation(programID, "myTextureSampler");
-		//use earth object to scale it properly
-		bool resMars = loadOBJ("erde.obj", verticesMars, uvsMars, normalsMars);
+		TextureSun = loadDDSStreamed("sun_dds.dds");
 
-		std::vector<unsigned short> indices;
-		std::vector<glm::vec3> indexed_vertices;
-		std::vector<glm::vec2> indexed_uvs;
-		std::vector<glm::vec3> indexed_normals;
-		indexVBO(verticesMars, uvsMars, normalsMars, indices, indexed_vertices, indexed_uvs, indexed_normals);
-
-		glGenBuffers(1, &vertexbufferMars);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbufferMars);
-		glBufferData(GL_ARRAY_BUFFER, verticesMars.size() * sizeof(glm::vec3), &verticesMars[0], GL_STATIC_DRAW);
+		return true;
+	}
 
+	bool initMercury() {
+		// Load the texture
+		TextureMercury = loadDDSStreamed("mercury_dds.dds");
+		return true;
+	}
 
-		glGenBuffers(1, &uvbufferMars);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbufferMars);
-		glBufferData(GL_ARRAY_BUFFER, uvsMars.size() * sizeof(glm::vec2), &uvsMars[0], GL_STATIC_DRAW);
+	bool initVenus() {
+		// Load the texture
+		TextureVenus = loadDDSStreamed("venus_dds.dds");
+		return true;
+	}
 
-		glGenBuffers(1, &normalbufferMars);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbufferMars);
-		glBufferData(GL_ARRAY_BUFFER, normalsMars.size() * sizeof(glm::vec3), &normalsMars[0], GL_STATIC_DRAW);
+	bool initMars() {
+		// Load the texture
+		TextureMars = loadDDSStreamed("mars_dds.dds");
 		return true;
 	}
 
@@ -779,12 +1003,12 @@ int main(void)
 	
 		//rotate earth with 360= pi in one Minute = 60sec so 1 day = 1 Minute for full rotation around the vertcial axis
 		//need detaTime *2 to do so (at least on on my pc, can vary on otherones)
-		gOrientationEarth.y += 3.14159f * (deltaTime*2 / 60.0f);
+		gOrientationEarth.y += 3.14159f * (simDeltaTime*2 / 60.0f);
 
 		// Build the model matrix
 		glm::mat4 RotationMatrix = eulerAngleYXZ(gOrientationEarth.y, gOrientationEarth.x, gOrientationEarth.z);
 		glm::mat4 TranslationMatrix = translate(mat4(), gPositionEarth);
-		glm::mat4 ScalingMatrix = scale(mat4(), vec3(1.0f, 1.0f, 1.0f));
+		glm::mat4 ScalingMatrix = scale(mat4(), vec3(gScaleEarth));
 		ModelMatrixEarth = TranslationMatrix * RotationMatrix * ScalingMatrix;
 
 		MVPEarth = ProjectionMatrixEarth * ViewMatrixEarth * ModelMatrixEarth;
@@ -800,13 +1024,13 @@ int main(void)
 	void rotateMoon() {
 	
 		//rotate moon with 360/60 sec * 27 because it needs 27 days for one rotation
-		gOrientationMoon.y += 3.14159f * (deltaTime * 2 /(60.0f *27.0f));
+		gOrientationMoon.y += 3.14159f * (simDeltaTime * 2 /(60.0f *27.0f));
 		
 		//// Build the model matrix
 		
 		glm::mat4 TranslationMatrix = translate(mat4(), gPositionMoon); // A bit to the right so its beside the earth
 		glm::mat4 RotationMatrix = eulerAngleYXZ(gOrientationMoon.y, gOrientationMoon.x, gOrientationMoon.z);;
-		glm::mat4 ScalingMatrix = scale(mat4(), vec3(0.25f, 0.25f, 0.25f));
+		glm::mat4 ScalingMatrix = scale(mat4(), vec3(gScaleMoon));
 		ModelMatrixMoon = TranslationMatrix * RotationMatrix * ScalingMatrix ;
 
 		MVPMoon = ProjectionMatrixMoon * ViewMatrixMoon * ModelMatrixMoon;
@@ -824,12 +1048,12 @@ int main(void)
 	void rotateSun() {
 
 		//rotate sun with 360/60sec * 25 because it needs 25 days for one rotation
-		gOrientationSun.y += 3.14159f * (deltaTime * 2 / (60.0f * 25.0f));
+		gOrientationSun.y += 3.14159f * (simDeltaTime * 2 / (60.0f * 25.0f));
 
 		// Build the model matrix
 		glm::mat4 RotationMatrix = eulerAngleYXZ(gOrientationSun.y, gOrientationSun.x, gOrientationSun.z);
 		glm::mat4 TranslationMatrix = translate(mat4(), gPositionSun);
-		glm::mat4 ScalingMatrix = scale(mat4(), vec3(1.0f, 1.0f, 1.0f));
+		glm::mat4 ScalingMatrix = scale(mat4(), vec3(gScaleSun));
 		ModelMatrixSun = TranslationMatrix * RotationMatrix * ScalingMatrix;
 
 		MVPSun = ProjectionMatrixSun * ViewMatrixSun * ModelMatrixSun;
@@ -844,13 +1068,13 @@ int main(void)
 	void rotateMercury() {
 
 		//rotate Mercury with 360/60sec * 88 because its needs 88 days for one rotation
-		gOrientationMercury.y += 3.14159f * (deltaTime * 2 / (60.0f * 88.0f));
+		gOrientationMercury.y += 3.14159f * (simDeltaTime * 2 / (60.0f * 88.0f));
 
 		// Build the model matrix
 		glm::mat4 RotationMatrix = eulerAngleYXZ(gOrientationMercury.y, gOrientationMercury.x, gOrientationMercury.z);
 		glm::mat4 TranslationMatrix = translate(mat4(), gPositionMercury);
 		//scale to 0.4f to match the actual size compared to earth
-		glm::mat4 ScalingMatrix = scale(mat4(), vec3(0.4f, 0.4f, 0.4f));
+		glm::mat4 ScalingMatrix = scale(mat4(), vec3(gScaleMercury));
 		ModelMatrixMercury = TranslationMatrix * RotationMatrix * ScalingMatrix;
 
 		MVPMercury = ProjectionMatrixMercury * ViewMatrixMercury * ModelMatrixMercury;
@@ -865,14 +1089,14 @@ int main(void)
 	void rotateVenus() {
 
 		//rotate Venus with 360/60sec * 243 because it needs 243 days for one rotation
-		gOrientationVenus.y += -3.14159f * (deltaTime * 2 / (60.0f * 27.0f));;
+		gOrientationVenus.y += -3.14159f * (simDeltaTime * 2 / (60.0f * 27.0f));;
 
 		// Build the model matrix
 		glm::mat4 RotationMatrix = eulerAngleYXZ(gOrientationVenus.y, gOrientationVenus.x, gOrientationVenus.z);
 		glm::mat4 TranslationMatrix = translate(mat4(), gPositionVenus);
 
 		//scale to 0.9f to match the actual size compared to earth
-		glm::mat4 ScalingMatrix = scale(mat4(), vec3(0.9f, 0.9f, 0.9f));
+		glm::mat4 ScalingMatrix = scale(mat4(), vec3(gScaleVenus));
 		ModelMatrixVenus = TranslationMatrix * RotationMatrix * ScalingMatrix;
 
 		MVPVenus = ProjectionMatrixVenus * ViewMatrixVenus * ModelMatrixVenus;
@@ -887,14 +1111,14 @@ int main(void)
 	void rotateMars() {
 
 		//rotate Venus with 360 /60sec  because it needs 1 day for one rotation
-		gOrientationMars.y += 3.14159f * (deltaTime * 2 / (60.0f * 27.0f));
+		gOrientationMars.y += 3.14159f * (simDeltaTime * 2 / (60.0f * 27.0f));
 
 		// Build the model matrix
 		glm::mat4 RotationMatrix = eulerAngleYXZ(gOrientationMars.y, gOrientationMars.x, gOrientationMars.z);
 		glm::mat4 TranslationMatrix = translate(mat4(), gPositionMars);
 
 		//scale to 0.5f to match the actual size compared to earth
-		glm::mat4 ScalingMatrix = scale(mat4(), vec3(0.5f, 0.5f, 0.5f));
+		glm::mat4 ScalingMatrix = scale(mat4(), vec3(gScaleMars));
 		ModelMatrixMars = TranslationMatrix * RotationMatrix * ScalingMatrix;
 
 		MVPMars = ProjectionMatrixMars * ViewMatrixMars * ModelMatrixMars;
@@ -906,23 +1130,487 @@ int main(void)
 		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrixMars[0][0]);
 	}
 
+	// The ambient mode skips the diffuse and specular terms altogether
+	unsigned int lightingFeatures() {
+		return gLightMode == Mode2 ? SHADING_DIRECT_LIGHTING : 0;
+	}
+
+	// Switches to the StandardShading permutation with these features. Its uniforms are looked up
+	// the first time, and the light is sent again only when it changed since the program last had it.
+	void useShading(unsigned int features) {
+		GpuResourceOwner owner("Shaders");
+		// While a permutation compiles, one with fewer features stands in for it
+		features = readyShaderPermutation(StandardShading, features);
+		ShadingProgram & shading = ShadingPrograms[features];
+		if (shading.programID == 0) {
+			shading.programID = getShaderPermutation(StandardShading, features);
+			shading.MatrixID = glGetUniformLocation(shading.programID, "MVP");
+			shading.ViewMatrixID = glGetUniformLocation(shading.programID, "V");
+			shading.ModelMatrixID = glGetUniformLocation(shading.programID, "M");
+			shading.LightID = glGetUniformLocation(shading.programID, "LightPosition_worldspace");
+			shading.LightColorID = glGetUniformLocation(shading.programID, "LightColor");
+			shading.TextureID = glGetUniformLocation(shading.programID, "myTextureSampler");
+			shading.MeshUniformIDs = getMeshUniforms(shading.programID);
+			shading.VTUniformIDs = getVirtualTextureUniforms(shading.programID);
+			shading.lightVersion = -1;
+		}
+
+		if (CurrentShading != &shading) {
+			glUseProgram(shading.programID);
+			CurrentShading = &shading;
+			MatrixID = shading.MatrixID;
+			ViewMatrixID = shading.ViewMatrixID;
+			ModelMatrixID = shading.ModelMatrixID;
+			MeshUniformIDs = shading.MeshUniformIDs;
+			VTUniformIDs = shading.VTUniformIDs;
+		}
+
+		if (shading.lightVersion != gLightVersion) {
+			glUniform3f(shading.LightID, gLightPosition.x, gLightPosition.y, gLightPosition.z);
+			glUniform3f(shading.LightColorID, gLightColor.x, gLightColor.y, gLightColor.z);
+			shading.lightVersion = gLightVersion;
+		}
+	}
+
+	void setShadingLight(glm::vec3 position, glm::vec3 color) {
+		if (position == gLightPosition && color == gLightColor)
+			return;
+		gLightPosition = position;
+		gLightColor = color;
+		gLightVersion++;
+		if (CurrentShading != NULL)
+			useShading((unsigned int)(CurrentShading - ShadingPrograms));
+	}
+
+	// The OpenGL calls of the last frame, top left. The text is in the 800x600 space of addText2D,
+	// and drawn by the next flushText2D.
+	void drawGLStatsHUD(const GLStats & stats) {
+		char line[64];
+		int y = 580;
+		sprintf(line, "GL calls %u", stats.calls);
+		addText2D(line, 8, y, 12);
+		sprintf(line, "redundant %u", stats.redundantCalls);
+		addText2D(line, 8, y -= 14, 12);
+		sprintf(line, "draws %u", stats.drawCalls);
+		addText2D(line, 8, y -= 14, 12);
+		// Calls and redundant calls of each kind
+		for (unsigned int c = 0; c < GL_STATS_CATEGORY_COUNT; c++) {
+			sprintf(line, "%-13s %4u %4u", glStatsCategoryName((GLStatsCategory)c), stats.categoryCalls[c], stats.categoryRedundantCalls[c]);
+			addText2D(line, 8, y -= 14, 12);
+		}
+	}
+
+	// The OpenGL objects alive and their memory, top right, with the owners that use the most
+	void drawGpuMemoryHUD() {
+		char line[64];
+		int x = 528;
+		int y = 580;
+		GpuResourceTotals totals = gpuResourceTotals();
+		sprintf(line, "GPU %.1f MB", totals.totalBytes / (1024.0 * 1024.0));
+		addText2D(line, x, y, 12);
+		if (gpuMemoryBudget() != 0) {
+			sprintf(line, "budget %.1f MB", gpuMemoryBudget() / (1024.0 * 1024.0));
+			addText2D(line, x, y -= 14, 12);
+			if (gpuMemoryOverBudget())
+				addText2D("over budget", x, y -= 14, 12);
+		}
+		// Objects and MB of each kind
+		for (unsigned int t = 0; t < GPU_RESOURCE_TYPE_COUNT; t++) {
+			sprintf(line, "%-12s %4u %6.1f", gpuResourceTypeName((GpuResourceType)t), totals.count[t], totals.bytes[t] / (1024.0 * 1024.0));
+			addText2D(line, x, y -= 14, 12);
+		}
+		std::vector<GpuResourceOwnerTotal> owners;
+		gpuResourceOwnerTotals(owners);
+		for (unsigned int i = 0; i < owners.size() && i < 5; i++) {
+			sprintf(line, "%-12.12s %4u %6.1f", owners[i].owner, owners[i].count, owners[i].bytes / (1024.0 * 1024.0));
+			addText2D(line, x, y -= 14, 12);
+		}
+	}
+
+	// L shows or hides the labels, F3 the performance HUD, F4 the tuning panel
+	void toggleOverlays() {
+		static bool wasLabelsPressed = false, wasPerfHUDPressed = false, wasTuningPressed = false;
+		bool labelsPressed = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+		if (labelsPressed && !wasLabelsPressed)
+			gLabels = !gLabels;
+		wasLabelsPressed = labelsPressed;
+		bool perfHUDPressed = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+		if (perfHUDPressed && !wasPerfHUDPressed)
+			gPerfHUD = !gPerfHUD;
+		wasPerfHUDPressed = perfHUDPressed;
+		bool tuningPressed = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+		if (tuningPressed && !wasTuningPressed)
+			showTuningPanel(!gTuningPanel);
+		wasTuningPressed = tuningPressed;
+	}
+
+	// The bodies whose bounding sphere is at least partly in the view frustum
+	unsigned int countVisibleBodies() {
+		const vec3 positions[] = { gPositionSun, gPositionMercury, gPositionVenus, gPositionEarth, gPositionMoon, gPositionMars };
+		const float scales[] = { gScaleSun, gScaleMercury, gScaleVenus, gScaleEarth, gScaleMoon, gScaleMars };
+		unsigned int visible = 0;
+		for (unsigned int b = 0; b < 6; b++) {
+			if (sphereInFrustum(ViewFrustum, positions[b], gSphereRadius * scales[b]))
+				visible++;
+		}
+		return visible;
+	}
+
+	// Whether to draw a body : always without culling
+	bool bodyVisible(vec3 position, float scale) {
+		return !gCulling || sphereInFrustum(ViewFrustum, position, gSphereRadius * scale);
+	}
+
+	// The times and the counters of this frame, in the performance HUD's graph even while it is hidden
+	void recordPerfHUDFrame() {
+		PerfHUDFrame frame;
+		MeshDrawCounters draws = takeMeshDrawCounters();
+		frame.drawCalls = draws.draws;
+		frame.triangles = draws.triangles;
+		frame.visibleBodies = countVisibleBodies() + LastStressBodiesDrawn + LastAsteroidsDrawn;
+		frame.totalBodies = 6 + (unsigned int)StressBodies.size() + (unsigned int)Asteroids.positions.size();
+		frame.uploadedBytes = assetUploadedBytes() + streamedTextureUploadedBytes();
+		for (unsigned int i=0; i<VirtualTextures.size(); i++)
+			frame.uploadedBytes += VirtualTextures[i]->uploadedBytes;
+		endPerfHUDFrame(frame);
+	}
+
+	// The name of each body above it, all in one draw whatever the distance
+	void drawLabels() {
+		const float size = 16.0f;
+		const vec4 color(1.0f, 1.0f, 1.0f, 1.0f);
+		addSDFLabel("Sun", gPositionSun + vec3(0.0f, gSphereRadius * gScaleSun, 0.0f), size, color);
+		addSDFLabel("Mercury", gPositionMercury + vec3(0.0f, gSphereRadius * gScaleMercury, 0.0f), size, color);
+		addSDFLabel("Venus", gPositionVenus + vec3(0.0f, gSphereRadius * gScaleVenus, 0.0f), size, color);
+		addSDFLabel("Earth", gPositionEarth + vec3(0.0f, gSphereRadius * gScaleEarth, 0.0f), size, color);
+		addSDFLabel("Moon", gPositionMoon + vec3(0.0f, gSphereRadius * gScaleMoon, 0.0f), size, color);
+		addSDFLabel("Mars", gPositionMars + vec3(0.0f, gSphereRadius * gScaleMars, 0.0f), size, color);
+
+		int width, height;
+		getFramebufferSize(width, height);
+		glDisable(GL_DEPTH_TEST);
+		flushSDFText(getProjectionMatrix() * getViewMatrix(), width, height);
+		glEnable(GL_DEPTH_TEST);
+		// The text's program is bound now
+		CurrentShading = NULL;
+	}
+
+	// The bodies of --stress : one draw each, as the six of the solar system
+	void drawStressBodies() {
+		LastStressBodiesDrawn = 0;
+		{
+		PROFILE_SCOPE("Orbits");
+		updateStressScene(StressBodies, simDeltaTime);
+		}
+
+		useShading(lightingFeatures());
+		glm::mat4 ViewMatrix = getViewMatrix();
+		glm::mat4 ViewProjectionMatrix = getProjectionMatrix() * ViewMatrix;
+		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
+		int textureUnit = -1;
+		for (unsigned int i = 0; i < StressBodies.size(); i++) {
+			StressBody & body = StressBodies[i];
+			if (!bodyVisible(body.position, body.scale))
+				continue;
+			body.lod = selectMeshLOD(MeshSphere, body.lod, pixelsPerUnit(body.position, body.scale), gLODErrorPixels, gLODHysteresis);
+
+			glm::mat4 ModelMatrix = translate(mat4(), body.position) * eulerAngleY(body.spinAngle) * scale(mat4(), vec3(body.scale));
+			glm::mat4 MVP = ViewProjectionMatrix * ModelMatrix;
+			glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
+			glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]);
+			// The textures stay bound from the bodies of the solar system
+			if (textureUnit != StressTextureUnits[body.texture]) {
+				textureUnit = StressTextureUnits[body.texture];
+				glUniform1i(CurrentShading->TextureID, textureUnit);
+			}
+			drawMesh(MeshSphere, MeshUniformIDs, body.lod);
+			LastStressBodiesDrawn++;
+		}
+	}
+
+	// The asteroid belt : its orbits advance with the simulation, and the visible asteroids are drawn at once
+	void drawAsteroids() {
+		LastAsteroidsDrawn = 0;
+		if (!gAsteroidBeltReady) {
+			GpuResourceOwner owner("Asteroids");
+			gAsteroidBeltReady = initAsteroidBelt(gAsteroidSeed, Asteroids);
+			if (!gAsteroidBeltReady) {
+				gAsteroidCount = 0;
+				return;
+			}
+		}
+		resizeAsteroidBelt(Asteroids, gAsteroidCount);
+		{
+		PROFILE_SCOPE("Orbits");
+		stepAsteroidBelt(Asteroids, simDeltaTime, gSimSubsteps);
+		}
+		if (Asteroids.positions.empty())
+			return;
+
+		// One level of detail for the whole belt : the one of the biggest asteroids, in the middle of the belt, on the camera's side
+		vec3 camera = getCameraPos();
+		vec2 direction = vec2(camera.x, camera.z) != vec2(0.0f) ? glm::normalize(vec2(camera.x, camera.z)) : vec2(1.0f, 0.0f);
+		float middle = 0.5f * (ASTEROID_BELT_INNER_RADIUS + ASTEROID_BELT_OUTER_RADIUS);
+		vec3 nearest(direction.x * middle, 0.0f, direction.y * middle);
+		LODAsteroids = selectMeshLOD(MeshSphere, LODAsteroids, pixelsPerUnit(nearest, ASTEROID_MAX_SCALE), gLODErrorPixels, gLODHysteresis);
+
+		LastAsteroidsDrawn = drawAsteroidBelt(Asteroids, MeshSphere, LODAsteroids, getProjectionMatrix() * getViewMatrix(), gCulling ? &ViewFrustum : NULL);
+		// The belt's program is bound now
+		CurrentShading = NULL;
+	}
+
+	// The corona, the comet's tail and the ship's exhaust : their emitters move with the simulation
+	void drawParticles() {
+		LastParticlesDrawn = 0;
+		if (gParticleBudget != ParticleBudgetReady) {
+			if (ParticleBudgetReady > 0)
+				deleteParticles();
+			ParticleBudgetReady = 0;
+			if (gParticleBudget == 0)
+				return;
+			GpuResourceOwner owner("Particles");
+			if (!initParticles(gParticleBudget)) {
+				gParticleBudget = 0;
+				return;
+			}
+			ParticleBudgetReady = gParticleBudget;
+		}
+		float seconds = simDeltaTime;
+
+		// The comet : an ellipse around the Sun, from perihelion to aphelion and back in cometPeriod
+		// seconds, faster near the Sun as in Kepler's second law. A little above the planets' plane.
+		const float perihelion = 90.0f, aphelion = 300.0f, cometPeriod = 200.0f;
+		float a = 0.5f * (perihelion + aphelion);
+		float e = (aphelion - perihelion) / (aphelion + perihelion);
+		float angularMomentum = 2.0f * 3.14159f * a * a * sqrtf(1.0f - e * e) / cometPeriod;
+		float r = perihelion * (1.0f + e) / (1.0f + e * cosf(CometAngle));
+		CometAngle += angularMomentum / (r * r) * seconds;
+		CometEmitter.position = vec3(r * cosf(CometAngle), 0.15f * r * sinf(CometAngle), r * sinf(CometAngle));
+
+		// The ship : around the Earth in 30 seconds, its exhaust going backwards
+		const float shipOrbit = 1.5f, shipPeriod = 30.0f, exhaustSpeed = 2.0f;
+		float shipSpeed = 2.0f * 3.14159f / shipPeriod;
+		ShipAngle += shipSpeed * seconds;
+		vec3 shipDirection(-sinf(ShipAngle), 0.0f, cosf(ShipAngle));
+		ExhaustEmitter.position = gPositionEarth + shipOrbit * vec3(cosf(ShipAngle), 0.0f, sinf(ShipAngle));
+		ExhaustEmitter.velocity = (shipOrbit * shipSpeed - exhaustSpeed) * shipDirection;
+
+		{
+		PROFILE_SCOPE("Particle simulation");
+		updateParticleSystem(CoronaParticles, seconds);
+		updateParticleSystem(CometParticles, seconds);
+		updateParticleSystem(ExhaustParticles, seconds);
+		emitParticles(CoronaParticles, CoronaEmitter, seconds);
+		emitParticles(CometParticles, CometEmitter, seconds);
+		emitParticles(ExhaustParticles, ExhaustEmitter, seconds);
+		}
+
+		glm::mat4 ViewMatrix = getViewMatrix();
+		glm::mat4 ProjectionMatrix = getProjectionMatrix();
+		LastParticlesDrawn = drawParticleSystem(CoronaParticles, ViewMatrix, ProjectionMatrix);
+		LastParticlesDrawn += drawParticleSystem(CometParticles, ViewMatrix, ProjectionMatrix);
+		LastParticlesDrawn += drawParticleSystem(ExhaustParticles, ViewMatrix, ProjectionMatrix);
+		// The particles' program is bound now
+		CurrentShading = NULL;
+	}
+
+	// Half of the budget in the corona, 3/8 in the comet's tail, 1/8 in the exhaust. Each emitter
+	// makes about as many particles per second as its system holds divided by their mean life.
+	bool initParticles(unsigned int budget) {
+		if (!initParticleSystem(budget / 2, true, CoronaParticles))
+			return false;
+		initParticleSystem(budget * 3 / 8, false, CometParticles);
+		initParticleSystem(budget / 8, false, ExhaustParticles);
+
+		// Light rising from the surface of the Sun, falling back under its gravity : 3 units/s^2 at
+		// the surface. The more particles, the fainter each one, so that the corona looks the same.
+		float sunRadius = gSphereRadius * gScaleSun;
+		CoronaParticles.radialAcceleration = -3.0f * sunRadius * sunRadius;
+		CoronaEmitter = ParticleEmitter();
+		CoronaEmitter.position = gPositionSun;
+		CoronaEmitter.radius = sunRadius;
+		CoronaEmitter.speed = 8.0f;
+		CoronaEmitter.life = 4.0f;
+		CoronaEmitter.size = 6.0f;
+		CoronaEmitter.color = vec4(1.0f, 0.55f, 0.15f, glm::min(0.2f, 4000.0f / glm::max(CoronaParticles.capacity, 1u)));
+		CoronaEmitter.rate = CoronaParticles.capacity / (0.75f * CoronaEmitter.life);
+
+		// Dust left behind by the comet, blown away from the Sun by its wind : 1 unit/s^2 at 200 units
+		CometParticles.radialAcceleration = 1.0f * 200.0f * 200.0f;
+		CometParticles.fadeSeconds = 2.0f;
+		CometEmitter = ParticleEmitter();
+		CometEmitter.radius = 0.3f;
+		CometEmitter.speed = 0.4f;
+		CometEmitter.life = 6.0f;
+		CometEmitter.size = 1.5f;
+		CometEmitter.color = vec4(0.75f, 0.85f, 1.0f, 0.35f);
+		CometEmitter.rate = CometParticles.capacity / (0.75f * CometEmitter.life);
+
+		// Hot gas, quickly slowed down behind the ship
+		ExhaustParticles.drag = 2.0f;
+		ExhaustParticles.fadeSeconds = 0.5f;
+		ExhaustEmitter = ParticleEmitter();
+		ExhaustEmitter.radius = 0.01f;
+		ExhaustEmitter.speed = 0.1f;
+		ExhaustEmitter.life = 1.0f;
+		ExhaustEmitter.size = 0.06f;
+		ExhaustEmitter.color = vec4(1.0f, 0.6f, 0.3f, 0.8f);
+		ExhaustEmitter.rate = ExhaustParticles.capacity / (0.75f * ExhaustEmitter.life);
+		return true;
+	}
+
+	void deleteParticles() {
+		deleteParticleSystem(CoronaParticles);
+		deleteParticleSystem(CometParticles);
+		deleteParticleSystem(ExhaustParticles);
+	}
+
+	// The scene goes offscreen when its sample count or its resolution differ from the window's
+	void beginScene() {
+		int width, height;
+		getFramebufferSize(width, height);
+		bool wasOffscreen = gSceneOffscreen;
+		gSceneOffscreen = false;
+		if (gMSAASamples > 0 || gRenderScale != 1.0f) {
+			GpuResourceOwner owner("Scene");
+			gSceneOffscreen = resizeSceneFramebuffer(SceneTarget, glm::max((int)(width * gRenderScale), 1), glm::max((int)(height * gRenderScale), 1), gMSAASamples);
+			// Not again every frame
+			if (!gSceneOffscreen) {
+				gMSAASamples = 0;
+				gRenderScale = 1.0f;
+			}
+		}
+		if (gSceneOffscreen) {
+			bindSceneFramebuffer(SceneTarget);
+		}
+		else if (wasOffscreen) {
+			glBindFramebuffer(GL_FRAMEBUFFER, gBenchCameraPath != NULL ? headlessFramebuffer() : 0);
+			glViewport(0, 0, width, height);
+		}
+	}
+
+	void endScene() {
+		if (!gSceneOffscreen)
+			return;
+		PROFILE_GPU_SCOPE("Resolve");
+		int width, height;
+		getFramebufferSize(width, height);
+		resolveSceneFramebuffer(SceneTarget, gBenchCameraPath != NULL ? headlessFramebuffer() : 0, width, height);
+	}
+
+	// The knobs of the tuning panel : every frame reads them, nothing needs a restart
+	void initTuningPanel() {
+		TwInit(TW_OPENGL_CORE, NULL);
+		int width, height;
+		getFramebufferSize(width, height);
+		TwWindowSize(width, height);
+
+		TwBar * bar = TwNewBar("Tuning");
+		TwDefine(" Tuning visible=false size='260 240' position='748 16' refresh=0.2 help='F4 hides the panel' ");
+		TwAddVarRW(bar, "LOD error", TW_TYPE_FLOAT, &gLODErrorPixels, " min=0.1 max=64 step=0.1 help='Maximum error of the levels of detail on screen, in pixels' ");
+		TwAddVarRW(bar, "Culling", TW_TYPE_BOOLCPP, &gCulling, " help='Skip the bodies and the asteroids outside the view' ");
+		TwAddVarRW(bar, "Asteroids", TW_TYPE_UINT32, &gAsteroidCount, " min=0 max=131072 step=1000 ");
+		TwAddVarRW(bar, "Particles", TW_TYPE_UINT32, &gParticleBudget, " min=0 max=1048576 step=10000 help='Live particles of the corona, the comet and the exhaust' ");
+		TwAddVarRW(bar, "Substeps", TW_TYPE_INT32, &gSimSubsteps, " min=1 max=64 help='Integration steps of the orbits per frame' ");
+		TwAddVarRW(bar, "Time warp", TW_TYPE_FLOAT, &gTimeWarp, " min=0 max=1000 step=1 ");
+		TwEnumVal msaaLevels[] = { { 0, "Off" }, { 2, "2x" }, { 4, "4x" }, { 8, "8x" } };
+		TwAddVarRW(bar, "MSAA", TwDefineEnum("MSAALevel", msaaLevels, 4), &gMSAASamples, "");
+		TwAddVarRW(bar, "Render scale", TW_TYPE_FLOAT, &gRenderScale, " min=0.25 max=2 step=0.05 ");
+		TwAddVarRW(bar, "Vsync", TW_TYPE_BOOLCPP, &gVSync, "");
+
+		// The GLFW 3 events, the keys translated to AntTweakBar's
+		glfwSetMouseButtonCallback(window, (GLFWmousebuttonfun)TwEventMouseButtonGLFW);
+		glfwSetCursorPosCallback(window, (GLFWcursorposfun)TwEventMousePosGLFW);
+		glfwSetScrollCallback(window, onTuningScroll);
+		glfwSetKeyCallback(window, onTuningKey);
+		glfwSetCharCallback(window, onTuningChar);
+	}
+
+	// The cursor is free while the panel is shown
+	void showTuningPanel(bool show) {
+		gTuningPanel = show;
+		TwDefine(show ? " Tuning visible=true " : " Tuning visible=false ");
+		glfwSetInputMode(window, GLFW_CURSOR, show ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+		// The camera starts again from the center, where computeMatricesFromInputs expects the cursor
+		if (!show)
+			glfwSetCursorPos(window, 1024 / 2, 768 / 2);
+	}
+
+	void applyVSync() {
+		static int interval = -1;
+		if (interval != (gVSync ? 1 : 0)) {
+			interval = gVSync ? 1 : 0;
+			glfwSwapInterval(interval);
+		}
+	}
+
+	// The editing keys of the panel's fields : the other characters come from onTuningChar
+	void onTuningKey(GLFWwindow *, int key, int, int action, int mods) {
+		if (!gTuningPanel || action == GLFW_RELEASE)
+			return;
+		static const int keys[][2] = {
+			{ GLFW_KEY_ENTER, TW_KEY_RETURN }, { GLFW_KEY_KP_ENTER, TW_KEY_RETURN }, { GLFW_KEY_BACKSPACE, TW_KEY_BACKSPACE },
+			{ GLFW_KEY_DELETE, TW_KEY_DELETE }, { GLFW_KEY_TAB, TW_KEY_TAB }, { GLFW_KEY_LEFT, TW_KEY_LEFT },
+			{ GLFW_KEY_RIGHT, TW_KEY_RIGHT }, { GLFW_KEY_UP, TW_KEY_UP }, { GLFW_KEY_DOWN, TW_KEY_DOWN },
+			{ GLFW_KEY_HOME, TW_KEY_HOME }, { GLFW_KEY_END, TW_KEY_END } };
+		int modifiers = ((mods & GLFW_MOD_SHIFT) ? TW_KMOD_SHIFT : 0) | ((mods & GLFW_MOD_CONTROL) ? TW_KMOD_CTRL : 0) | ((mods & GLFW_MOD_ALT) ? TW_KMOD_ALT : 0);
+		for (unsigned int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+			if (keys[i][0] == key)
+				TwKeyPressed(keys[i][1], modifiers);
+		}
+	}
+
+	void onTuningChar(GLFWwindow *, unsigned int codepoint) {
+		if (gTuningPanel && codepoint < 256)
+			TwKeyPressed((int)codepoint, TW_KMOD_NONE);
+	}
+
+	// AntTweakBar wants the position of the wheel, GLFW gives its movements
+	void onTuningScroll(GLFWwindow *, double, double yoffset) {
+		if (!gTuningPanel)
+			return;
+		static double wheel = 0.0;
+		wheel += yoffset;
+		TwMouseWheel((int)wheel);
+	}
+
+	// After endBenchFrame, so that the time of the frame doesn't include it
+	void saveBenchScreenshot() {
+		if (Bench.frame <= Bench.warmupFrames)
+			return;
+		int frame = (int)(Bench.frame - 1 - Bench.warmupFrames);
+		if (std::find(gScreenshotFrames.begin(), gScreenshotFrames.end(), frame) == gScreenshotFrames.end())
+			return;
+		char path[1024];
+		snprintf(path, sizeof(path), "%s_%d.bmp", gScreenshotPrefix, frame);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, headlessFramebuffer());
+		SaveScreenshot(path);
+	}
+
+	// F2 writes the last scopes of the profiler, without waiting for the exit
+	void dumpProfilerTrace() {
+		static bool wasPressed = false;
+		bool pressed = glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS;
+		if (pressed && !wasPressed)
+			writeProfilerTrace(gTracePath != NULL ? gTracePath : gDefaultTracePath);
+		wasPressed = pressed;
+	}
+
 	void switchLight() {
-		GLuint LightColor = glGetUniformLocation(programID, "LightColor");
-		GLuint LightMode = glGetUniformLocation(programID, "LightMode");
 		//check for press and repeat to delay the input
 		if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS && GLFW_REPEAT) {
 			ambientLight = !ambientLight;
-			glUniform1i(LightMode, Mode1);
+			gLightMode = Mode1;
 		}
 		//check for press and repeat to delay the input
 		if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS && GLFW_REPEAT) {
 			specularLight = !specularLight;
-			glUniform1i(LightMode, Mode2);
+			gLightMode = Mode2;
 		}
 		//check for press and repeat to delay the input
 		if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS && GLFW_REPEAT) {
 			specularDisco = !specularDisco;
-			glUniform1i(LightMode, Mode2);
+			gLightMode = Mode2;
 		}
 
 	}
@@ -0,0 +1,330 @@
+// sdffont : turns a bitmap font into a signed distance field atlas for common/sdftext.
+//
+// Usage : sdffont [-cell N] [-spread S] [-o output.dds] input.dds
+//   input.dds : a 16x16 grid of glyphs in the alpha channel (DXT3 or DXT5), as the fonts of text2D.
+//   -cell N   : size in pixels of a glyph of the atlas, 32 by default.
+//   -spread S : distance in pixels of the atlas, on each side of the edges, that the field covers. 4 by default.
+//   -o        : output path. Otherwise input.xxx is written to inputSDF.dds.
+//
+// Each glyph is thresholded, its exact distance transform computed (Felzenszwalb & Huttenlocher)
+// on the pixels of the input, then downsampled into its cell of the atlas. 0.5 is the edge, more
+// is inside. The atlas is written mipmapped, in BC4 : one 8 bit channel, 8 bytes per 4x4 block.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <vector>
+#include <string>
+
+#include <common/bcencoder.hpp>
+
+#define FOURCC_DXT3 0x33545844 // Equivalent to "DXT3" in ASCII
+#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+#define FOURCC_BC4U 0x55344342 // Equivalent to "BC4U" in ASCII
+
+// Glyphs per row and per column of the fonts
+#define SDFFONT_GRID 16
+
+static bool readFile(const char * path, std::vector<unsigned char> & out_data){
+	FILE * file = fopen(path, "rb");
+	if (!file){
+		printf("%s could not be opened.\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	out_data.resize(size > 0 ? size : 0);
+	bool ok = size > 0 && fread(&out_data[0], 1, size, file) == (size_t)size;
+	fclose(file);
+	if (!ok)
+		printf("%s could not be read.\n", path);
+	return ok;
+}
+
+static unsigned int readLE32(const unsigned char * p){ return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
+
+// The alpha of the first level of a DXT3 or DXT5 .dds, first row at the top
+static bool decodeAlphaDDS(const std::vector<unsigned char> & file, unsigned int & out_width, unsigned int & out_height, std::vector<unsigned char> & out_alpha){
+	if (file.size() < 128 || readLE32(&file[0]) != 0x20534444){
+		printf("Not a correct DDS file\n");
+		return false;
+	}
+	unsigned int height = readLE32(&file[12]);
+	unsigned int width = readLE32(&file[16]);
+	unsigned int fourCC = readLE32(&file[84]);
+	if (fourCC != FOURCC_DXT3 && fourCC != FOURCC_DXT5){
+		printf("Only the DXT3 and DXT5 fonts are read\n");
+		return false;
+	}
+	unsigned int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+	if (file.size() < 128 + (size_t)blocksWide * blocksHigh * 16){
+		printf("Truncated DDS file\n");
+		return false;
+	}
+
+	out_width = width;
+	out_height = height;
+	out_alpha.assign((size_t)width * height, 0);
+	for (unsigned int by = 0; by < blocksHigh; by++){
+		for (unsigned int bx = 0; bx < blocksWide; bx++){
+			const unsigned char * block = &file[128 + ((size_t)by * blocksWide + bx) * 16];
+			unsigned char values[16];
+			if (fourCC == FOURCC_DXT3){
+				// 4 bits per pixel
+				for (int i = 0; i < 16; i++){
+					int nibble = (block[i / 2] >> ((i % 2) * 4)) & 0xF;
+					values[i] = (unsigned char)(nibble * 17);
+				}
+			}else{
+				// 2 endpoints, 3 bits indices
+				int palette[8];
+				palette[0] = block[0];
+				palette[1] = block[1];
+				if (palette[0] > palette[1]){
+					for (int i = 2; i < 8; i++)
+						palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+				}else{
+					for (int i = 2; i < 6; i++)
+						palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+					palette[6] = 0;
+					palette[7] = 255;
+				}
+				unsigned long long bits = 0;
+				for (int i = 0; i < 6; i++)
+					bits |= (unsigned long long)block[2 + i] << (8 * i);
+				for (int i = 0; i < 16; i++)
+					values[i] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+			}
+			for (unsigned int y = 0; y < 4; y++)
+				for (unsigned int x = 0; x < 4; x++)
+					if (by * 4 + y < height && bx * 4 + x < width)
+						out_alpha[(size_t)(by * 4 + y) * width + bx * 4 + x] = values[y * 4 + x];
+		}
+	}
+	return true;
+}
+
+// Squared distance transform of a sampled function, in one dimension :
+// out_d[q] = min over p of (q - p)^2 + f[p]. v and z are n and n + 1 long scratch arrays.
+static void distanceTransform1D(const float * f, int n, float * out_d, int * v, float * z){
+	int k = 0;
+	v[0] = 0;
+	z[0] = -HUGE_VALF;
+	z[1] = HUGE_VALF;
+	for (int q = 1; q < n; q++){
+		float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+		while (s <= z[k]){
+			k--;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = HUGE_VALF;
+	}
+	k = 0;
+	for (int q = 0; q < n; q++){
+		while (z[k + 1] < q)
+			k++;
+		out_d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+	}
+}
+
+// Squared distance of each pixel of a size x size grid to the nearest pixel where feature is true
+static void distanceTransform2D(const std::vector<bool> & feature, int size, std::vector<float> & out_distances){
+	// Far enough to stay finite in the sums, farther than any distance of the grid
+	const float far = 1e20f;
+	out_distances.resize((size_t)size * size);
+	for (size_t i = 0; i < out_distances.size(); i++)
+		out_distances[i] = feature[i] ? 0.0f : far;
+
+	std::vector<float> f(size), d(size), z(size + 1);
+	std::vector<int> v(size);
+	// Columns, then rows
+	for (int x = 0; x < size; x++){
+		for (int y = 0; y < size; y++)
+			f[y] = out_distances[(size_t)y * size + x];
+		distanceTransform1D(&f[0], size, &d[0], &v[0], &z[0]);
+		for (int y = 0; y < size; y++)
+			out_distances[(size_t)y * size + x] = d[y];
+	}
+	for (int y = 0; y < size; y++){
+		distanceTransform1D(&out_distances[(size_t)y * size], size, &d[0], &v[0], &z[0]);
+		memcpy(&out_distances[(size_t)y * size], &d[0], size * sizeof(float));
+	}
+}
+
+// Signed distance field of the glyph at (cellX, cellY) of the alpha, written in its cell of the atlas
+static void buildGlyph(const std::vector<unsigned char> & alpha, unsigned int width, unsigned int inputCell,
+	unsigned int cellX, unsigned int cellY, unsigned int outputCell, float spread, std::vector<unsigned char> & out_atlas){
+	// A border of outside pixels : the glyphs which touch the edge of their cell are closed there
+	int border = 1;
+	int size = inputCell + 2 * border;
+	std::vector<bool> inside((size_t)size * size, false), outside((size_t)size * size, true);
+	for (unsigned int y = 0; y < inputCell; y++){
+		for (unsigned int x = 0; x < inputCell; x++){
+			bool in = alpha[(size_t)(cellY * inputCell + y) * width + cellX * inputCell + x] >= 128;
+			size_t i = (size_t)(y + border) * size + x + border;
+			inside[i] = in;
+			outside[i] = !in;
+		}
+	}
+	std::vector<float> toInside, toOutside;
+	distanceTransform2D(inside, size, toInside);
+	distanceTransform2D(outside, size, toOutside);
+
+	// The edge is half way between the centers of an inside and of an outside pixel
+	float scale = (float)inputCell / outputCell;
+	unsigned int atlasWidth = outputCell * SDFFONT_GRID;
+	for (unsigned int y = 0; y < outputCell; y++){
+		for (unsigned int x = 0; x < outputCell; x++){
+			// Box filter of the input pixels under the output pixel
+			int x0 = (int)(x * scale), x1 = (int)((x + 1) * scale);
+			int y0 = (int)(y * scale), y1 = (int)((y + 1) * scale);
+			if (x1 == x0) x1++;
+			if (y1 == y0) y1++;
+			float sum = 0.0f;
+			for (int sy = y0; sy < y1; sy++){
+				for (int sx = x0; sx < x1; sx++){
+					size_t i = (size_t)(sy + border) * size + sx + border;
+					sum += inside[i] ? sqrtf(toOutside[i]) - 0.5f : 0.5f - sqrtf(toInside[i]);
+				}
+			}
+			float distance = sum / ((x1 - x0) * (y1 - y0)) / scale;   // in pixels of the atlas
+			float value = 0.5f + 0.5f * distance / spread;
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			out_atlas[(size_t)(cellY * outputCell + y) * atlasWidth + cellX * outputCell + x] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+	}
+}
+
+// Halves the level with a box filter, down to 1x1
+static void buildMipmaps(const std::vector<unsigned char> & level0, unsigned int size, std::vector<std::vector<unsigned char> > & out_levels){
+	out_levels.clear();
+	out_levels.push_back(level0);
+	while (size > 1){
+		const std::vector<unsigned char> & previous = out_levels.back();
+		unsigned int half = size / 2;
+		std::vector<unsigned char> level((size_t)half * half);
+		for (unsigned int y = 0; y < half; y++)
+			for (unsigned int x = 0; x < half; x++)
+				level[(size_t)y * half + x] = (unsigned char)((previous[(size_t)(2 * y) * size + 2 * x] + previous[(size_t)(2 * y) * size + 2 * x + 1]
+					+ previous[(size_t)(2 * y + 1) * size + 2 * x] + previous[(size_t)(2 * y + 1) * size + 2 * x + 1] + 2) / 4);
+		out_levels.push_back(level);
+		size = half;
+	}
+}
+
+// BC4 blocks of a size x size level, padded with its last pixels when smaller than a block
+static void compressLevel(const std::vector<unsigned char> & level, unsigned int size, std::vector<unsigned char> & out_data){
+	unsigned int blocks = (size + 3) / 4;
+	out_data.resize((size_t)blocks * blocks * 8);
+	unsigned char values[16];
+	for (unsigned int by = 0; by < blocks; by++){
+		for (unsigned int bx = 0; bx < blocks; bx++){
+			for (unsigned int y = 0; y < 4; y++){
+				unsigned int py = by * 4 + y < size ? by * 4 + y : size - 1;
+				for (unsigned int x = 0; x < 4; x++){
+					unsigned int px = bx * 4 + x < size ? bx * 4 + x : size - 1;
+					values[y * 4 + x] = level[(size_t)py * size + px];
+				}
+			}
+			compressBC4Block(values, &out_data[((size_t)by * blocks + bx) * 8]);
+		}
+	}
+}
+
+static bool writeDDS(const std::string & path, unsigned int size, const std::vector<std::vector<unsigned char> > & compressed){
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file){
+		printf("%s could not be written.\n", path.c_str());
+		return false;
+	}
+	unsigned int header[32];
+	memset(header, 0, sizeof(header));
+	header[0] = 0x20534444;                       // "DDS "
+	header[1] = 124;                              // size of the header
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mipmap count, linear size
+	header[3] = size;
+	header[4] = size;
+	header[5] = (unsigned int)compressed[0].size();
+	header[7] = (unsigned int)compressed.size();
+	header[19] = 32;                              // size of the pixel format
+	header[20] = 0x4;                             // four CC
+	header[21] = FOURCC_BC4U;
+	header[27] = 0x1000 | 0x8 | 0x400000;         // texture, complex, mipmap
+	bool ok = fwrite(header, 4, 32, file) == 32;
+	for (unsigned int i = 0; i < compressed.size() && ok; i++)
+		ok = fwrite(&compressed[i][0], 1, compressed[i].size(), file) == compressed[i].size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		printf("%s could not be written.\n", path.c_str());
+	return ok;
+}
+
+static void printUsage(){
+	printf("Usage : sdffont [-cell N] [-spread S] [-o output.dds] input.dds\n");
+}
+
+int main(int argc, char ** argv){
+	unsigned int outputCell = 32;
+	float spread = 4.0f;
+	std::string input, output;
+
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "-cell") == 0 && i + 1 < argc)
+			outputCell = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-spread") == 0 && i + 1 < argc)
+			spread = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (argv[i][0] == '-' || !input.empty()){
+			printUsage();
+			return 1;
+		}else
+			input = argv[i];
+	}
+	// Power of two cells : the atlas is mipmapped down to 1x1
+	if (input.empty() || outputCell < 4 || (outputCell & (outputCell - 1)) != 0 || spread <= 0.0f){
+		printUsage();
+		return 1;
+	}
+	if (output.empty()){
+		size_t dot = input.find_last_of('.');
+		size_t slash = input.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			dot = input.size();
+		output = input.substr(0, dot) + "SDF.dds";
+	}
+
+	std::vector<unsigned char> file, alpha;
+	unsigned int width, height;
+	if (!readFile(input.c_str(), file) || !decodeAlphaDDS(file, width, height, alpha))
+		return 1;
+	if (width != height || width % SDFFONT_GRID != 0 || width / SDFFONT_GRID < outputCell){
+		printf("%s : a square grid of %ux%u glyphs of at least %u pixels is expected\n", input.c_str(), SDFFONT_GRID, SDFFONT_GRID, outputCell);
+		return 1;
+	}
+
+	unsigned int inputCell = width / SDFFONT_GRID;
+	unsigned int size = outputCell * SDFFONT_GRID;
+	std::vector<unsigned char> atlas((size_t)size * size);
+	for (unsigned int cellY = 0; cellY < SDFFONT_GRID; cellY++)
+		for (unsigned int cellX = 0; cellX < SDFFONT_GRID; cellX++)
+			buildGlyph(alpha, width, inputCell, cellX, cellY, outputCell, spread, atlas);
+
+	std::vector<std::vector<unsigned char> > levels, compressed;
+	buildMipmaps(atlas, size, levels);
+	compressed.resize(levels.size());
+	for (unsigned int l = 0; l < levels.size(); l++)
+		compressLevel(levels[l], size >> l, compressed[l]);
+	if (!writeDDS(output, size, compressed))
+		return 1;
+
+	printf("%s -> %s : %ux%u, %u levels, BC4, %u pixels glyphs, spread %g\n", input.c_str(), output.c_str(),
+		size, size, (unsigned int)levels.size(), outputCell, spread);
+	return 0;
+}
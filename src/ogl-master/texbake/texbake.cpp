@@ -0,0 +1,580 @@
+// texbake : bakes BMP, TGA and PNG images into compressed, mipmapped .dds files for loadDDS.
+//
+// Usage : texbake [-bc1 | -bc3] [-linear] [-wrap | -wrapx] [-threads N] [-o output.dds] input...
+//   -bc1, -bc3  : force the format. By default, BC3 if the image has transparent pixels, BC1 otherwise.
+//   -linear     : the image is data, not colors (normal maps...) : filter it without gamma correction.
+//   -wrap       : the image repeats, in both directions ; -wrapx : horizontally only (planet maps).
+//   -threads N  : 0, the default, uses all the cores.
+//   -o          : output path, for a single input. Otherwise input.xxx is written to input.dds.
+//
+// The mipmaps are downsampled with a tent filter, in linear light and with premultiplied alpha.
+// The levels are then cut in bands of block rows, and all the bands of all the images are
+// compressed in parallel.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <zlib.h>
+
+#include <common/bcencoder.hpp>
+
+// Block rows compressed by one job
+#define TEXBAKE_BAND_ROWS 16
+
+#define FOURCC_DXT1 0x31545844 // Equivalent to "DXT1" in ASCII
+#define FOURCC_DXT5 0x35545844 // Equivalent to "DXT5" in ASCII
+
+struct Image {
+	unsigned int width, height;
+	std::vector<unsigned char> rgba;   // first row at the top, as in a .dds
+};
+
+struct BakeOptions {
+	int format;          // 0 : automatic, 1 : BC1, 3 : BC3
+	bool linear;
+	bool wrapX, wrapY;
+};
+
+struct BakeJob {
+	std::string input, output;
+	Image image;
+	bool bc3;
+	std::vector<Image> levels;
+	std::vector<std::vector<unsigned char> > compressed;
+	bool ok;
+};
+
+static bool readFile(const char * path, std::vector<unsigned char> & out_data){
+	FILE * file = fopen(path, "rb");
+	if (!file){
+		printf("%s could not be opened.\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	out_data.resize(size > 0 ? size : 0);
+	bool ok = size > 0 && fread(&out_data[0], 1, size, file) == (size_t)size;
+	fclose(file);
+	if (!ok)
+		printf("%s could not be read.\n", path);
+	return ok;
+}
+
+static unsigned int readLE16(const unsigned char * p){ return p[0] | (p[1] << 8); }
+static unsigned int readLE32(const unsigned char * p){ return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
+static unsigned int readBE32(const unsigned char * p){ return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+// 24 and 32 bits uncompressed BMPs
+static bool decodeBMP(const std::vector<unsigned char> & file, Image & out_image){
+	if (file.size() < 54 || file[0] != 'B' || file[1] != 'M'){
+		printf("Not a correct BMP file\n");
+		return false;
+	}
+	unsigned int dataPos = readLE32(&file[0x0A]);
+	int width = (int)readLE32(&file[0x12]);
+	int height = (int)readLE32(&file[0x16]);
+	unsigned int bpp = readLE16(&file[0x1C]);
+	unsigned int compression = readLE32(&file[0x1E]);
+	if ((bpp != 24 && bpp != 32) || (compression != 0 && compression != 3) || width <= 0 || height == 0){
+		printf("Only 24 and 32 bits uncompressed BMP files are supported\n");
+		return false;
+	}
+	// A negative height is a top-down BMP
+	bool topDown = height < 0;
+	if (topDown)
+		height = -height;
+	if (dataPos == 0)
+		dataPos = 54;
+	unsigned int stride = (width * (bpp / 8) + 3) & ~3u;
+	if (dataPos + (size_t)stride * height > file.size()){
+		printf("Truncated BMP file\n");
+		return false;
+	}
+
+	out_image.width = width;
+	out_image.height = height;
+	out_image.rgba.resize((size_t)width * height * 4);
+	bool hasAlpha = false;
+	for (int y = 0; y < height; y++){
+		const unsigned char * row = &file[dataPos + (size_t)stride * (topDown ? y : height - 1 - y)];
+		unsigned char * out = &out_image.rgba[(size_t)y * width * 4];
+		for (int x = 0; x < width; x++){
+			const unsigned char * bgr = row + x * (bpp / 8);
+			out[x * 4 + 0] = bgr[2];
+			out[x * 4 + 1] = bgr[1];
+			out[x * 4 + 2] = bgr[0];
+			out[x * 4 + 3] = bpp == 32 ? bgr[3] : 255;
+			hasAlpha = hasAlpha || (bpp == 32 && bgr[3] != 0);
+		}
+	}
+	// Most 32 bits BMPs leave their 4th byte to 0 : they are opaque
+	if (bpp == 32 && !hasAlpha)
+		for (size_t i = 3; i < out_image.rgba.size(); i += 4)
+			out_image.rgba[i] = 255;
+	return true;
+}
+
+// Uncompressed and RLE, 8 bits grey, 24 and 32 bits true color TGAs
+static bool decodeTGA(const std::vector<unsigned char> & file, Image & out_image){
+	if (file.size() < 18){
+		printf("Not a correct TGA file\n");
+		return false;
+	}
+	unsigned int idLength = file[0];
+	unsigned int colorMapType = file[1];
+	unsigned int imageType = file[2];
+	unsigned int width = readLE16(&file[12]);
+	unsigned int height = readLE16(&file[14]);
+	unsigned int bpp = file[16];
+	bool topDown = (file[17] & 0x20) != 0;
+	bool rle = imageType == 10 || imageType == 11;
+	bool grey = imageType == 3 || imageType == 11;
+	if (colorMapType != 0 || (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11) ||
+		(grey ? bpp != 8 : (bpp != 24 && bpp != 32)) || width == 0 || height == 0){
+		printf("Only 8 bits grey, 24 and 32 bits true color TGA files are supported\n");
+		return false;
+	}
+
+	unsigned int pixelSize = bpp / 8;
+	size_t pixelCount = (size_t)width * height;
+	std::vector<unsigned char> pixels(pixelCount * pixelSize);
+	size_t pos = 18 + idLength;
+	if (!rle){
+		if (pos + pixels.size() > file.size()){
+			printf("Truncated TGA file\n");
+			return false;
+		}
+		memcpy(&pixels[0], &file[pos], pixels.size());
+	}else{
+		size_t count = 0;
+		while (count < pixelCount){
+			if (pos >= file.size()){
+				printf("Truncated TGA file\n");
+				return false;
+			}
+			unsigned int header = file[pos++];
+			unsigned int run = (header & 0x7f) + 1;
+			if (count + run > pixelCount)
+				run = pixelCount - count;
+			bool repeat = (header & 0x80) != 0;
+			size_t needed = repeat ? pixelSize : run * pixelSize;
+			if (pos + needed > file.size()){
+				printf("Truncated TGA file\n");
+				return false;
+			}
+			for (unsigned int i = 0; i < run; i++)
+				memcpy(&pixels[(count + i) * pixelSize], &file[pos + (repeat ? 0 : i * pixelSize)], pixelSize);
+			pos += needed;
+			count += run;
+		}
+	}
+
+	out_image.width = width;
+	out_image.height = height;
+	out_image.rgba.resize(pixelCount * 4);
+	for (unsigned int y = 0; y < height; y++){
+		const unsigned char * row = &pixels[(size_t)(topDown ? y : height - 1 - y) * width * pixelSize];
+		unsigned char * out = &out_image.rgba[(size_t)y * width * 4];
+		for (unsigned int x = 0; x < width; x++){
+			const unsigned char * p = row + x * pixelSize;
+			out[x * 4 + 0] = grey ? p[0] : p[2];
+			out[x * 4 + 1] = grey ? p[0] : p[1];
+			out[x * 4 + 2] = p[0];
+			out[x * 4 + 3] = bpp == 32 ? p[3] : 255;
+		}
+	}
+	return true;
+}
+
+static unsigned char paeth(int a, int b, int c){
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return (unsigned char)a;
+	if (pb <= pc) return (unsigned char)b;
+	return (unsigned char)c;
+}
+
+// Non interlaced PNGs : 8 and 16 bits grey, grey + alpha, RGB and RGBA, and 8 bits palettes
+static bool decodePNG(const std::vector<unsigned char> & file, Image & out_image){
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	if (file.size() < 8 || memcmp(&file[0], signature, 8) != 0){
+		printf("Not a correct PNG file\n");
+		return false;
+	}
+
+	unsigned int width = 0, height = 0, bitDepth = 0, colorType = 0, interlace = 0;
+	std::vector<unsigned char> idat;
+	std::vector<unsigned char> palette(256 * 4, 255);
+	size_t pos = 8;
+	while (pos + 12 <= file.size()){
+		unsigned int length = readBE32(&file[pos]);
+		const unsigned char * type = &file[pos + 4];
+		const unsigned char * data = &file[pos + 8];
+		if (pos + 12 + (size_t)length > file.size())
+			break;
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13){
+			width = readBE32(data);
+			height = readBE32(data + 4);
+			bitDepth = data[8];
+			colorType = data[9];
+			interlace = data[12];
+		}else if (memcmp(type, "PLTE", 4) == 0){
+			for (unsigned int i = 0; i < length / 3 && i < 256; i++)
+				for (int c = 0; c < 3; c++)
+					palette[i * 4 + c] = data[i * 3 + c];
+		}else if (memcmp(type, "tRNS", 4) == 0 && colorType == 3){
+			for (unsigned int i = 0; i < length && i < 256; i++)
+				palette[i * 4 + 3] = data[i];
+		}else if (memcmp(type, "IDAT", 4) == 0){
+			idat.insert(idat.end(), data, data + length);
+		}else if (memcmp(type, "IEND", 4) == 0){
+			break;
+		}
+		pos += 12 + length;
+	}
+
+	unsigned int channels;
+	switch (colorType){
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: channels = 0;
+	}
+	if (width == 0 || height == 0 || channels == 0 || interlace != 0 || idat.empty() ||
+		!(bitDepth == 8 || (bitDepth == 16 && colorType != 3))){
+		printf("Only non interlaced, 8 and 16 bits PNG files are supported\n");
+		return false;
+	}
+
+	unsigned int pixelSize = channels * bitDepth / 8;
+	size_t stride = (size_t)width * pixelSize;
+	std::vector<unsigned char> raw(height * (stride + 1));
+	uLongf rawSize = raw.size();
+	if (uncompress(&raw[0], &rawSize, &idat[0], idat.size()) != Z_OK || rawSize != raw.size()){
+		printf("Corrupted PNG file\n");
+		return false;
+	}
+
+	// Undo the filter of each row, in place
+	for (unsigned int y = 0; y < height; y++){
+		unsigned char filter = raw[y * (stride + 1)];
+		unsigned char * row = &raw[y * (stride + 1) + 1];
+		const unsigned char * previous = y > 0 ? &raw[(y - 1) * (stride + 1) + 1] : NULL;
+		for (size_t i = 0; i < stride; i++){
+			int a = i >= pixelSize ? row[i - pixelSize] : 0;
+			int b = previous ? previous[i] : 0;
+			int c = previous && i >= pixelSize ? previous[i - pixelSize] : 0;
+			switch (filter){
+				case 1: row[i] += a; break;
+				case 2: row[i] += b; break;
+				case 3: row[i] += (a + b) / 2; break;
+				case 4: row[i] += paeth(a, b, c); break;
+			}
+		}
+	}
+
+	out_image.width = width;
+	out_image.height = height;
+	out_image.rgba.resize((size_t)width * height * 4);
+	unsigned int sampleSize = bitDepth / 8;
+	for (unsigned int y = 0; y < height; y++){
+		const unsigned char * row = &raw[y * (stride + 1) + 1];
+		unsigned char * out = &out_image.rgba[(size_t)y * width * 4];
+		for (unsigned int x = 0; x < width; x++){
+			// The high byte of the 16 bits samples
+			const unsigned char * p = row + x * pixelSize;
+			unsigned char s[4];
+			for (unsigned int c = 0; c < channels; c++)
+				s[c] = p[c * sampleSize];
+			switch (colorType){
+				case 0: out[x*4+0] = out[x*4+1] = out[x*4+2] = s[0]; out[x*4+3] = 255; break;
+				case 2: out[x*4+0] = s[0]; out[x*4+1] = s[1]; out[x*4+2] = s[2]; out[x*4+3] = 255; break;
+				case 3: memcpy(out + x * 4, &palette[s[0] * 4], 4); break;
+				case 4: out[x*4+0] = out[x*4+1] = out[x*4+2] = s[0]; out[x*4+3] = s[1]; break;
+				case 6: memcpy(out + x * 4, s, 4); break;
+			}
+		}
+	}
+	return true;
+}
+
+static bool loadImage(const char * path, Image & out_image){
+	std::vector<unsigned char> file;
+	if (!readFile(path, file))
+		return false;
+	if (file.size() >= 2 && file[0] == 'B' && file[1] == 'M')
+		return decodeBMP(file, out_image);
+	if (file.size() >= 8 && file[0] == 137 && file[1] == 'P')
+		return decodePNG(file, out_image);
+	// TGAs have no signature
+	return decodeTGA(file, out_image);
+}
+
+static float srgbToLinear(float c){
+	return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float c){
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Source texels of one destination texel, for a tent filter two destination texels wide
+static void filterTaps(unsigned int sourceSize, unsigned int destSize, unsigned int d, bool wrap,
+	std::vector<int> & out_taps, std::vector<float> & out_weights){
+	float scale = (float)sourceSize / destSize;
+	float radius = scale > 1.0f ? scale : 1.0f;
+	float center = (d + 0.5f) * scale;
+	out_taps.clear();
+	out_weights.clear();
+	float sum = 0.0f;
+	for (int s = (int)floorf(center - radius); s <= (int)ceilf(center + radius); s++){
+		float weight = 1.0f - fabsf(s + 0.5f - center) / radius;
+		if (weight <= 0.0f)
+			continue;
+		int n = (int)sourceSize;
+		int tap = wrap ? ((s % n) + n) % n : (s < 0 ? 0 : (s >= n ? n - 1 : s));
+		out_taps.push_back(tap);
+		out_weights.push_back(weight);
+		sum += weight;
+	}
+	for (unsigned int i = 0; i < out_weights.size(); i++)
+		out_weights[i] /= sum;
+}
+
+// Separable downsampling of a premultiplied linear RGBA float image
+static void downsample(const std::vector<float> & source, unsigned int sourceWidth, unsigned int sourceHeight,
+	std::vector<float> & out_dest, unsigned int destWidth, unsigned int destHeight, const BakeOptions & options){
+	std::vector<int> taps;
+	std::vector<float> weights;
+
+	std::vector<float> columns((size_t)destWidth * sourceHeight * 4, 0.0f);
+	for (unsigned int x = 0; x < destWidth; x++){
+		filterTaps(sourceWidth, destWidth, x, options.wrapX, taps, weights);
+		for (unsigned int y = 0; y < sourceHeight; y++){
+			float * out = &columns[((size_t)y * destWidth + x) * 4];
+			for (unsigned int t = 0; t < taps.size(); t++){
+				const float * in = &source[((size_t)y * sourceWidth + taps[t]) * 4];
+				for (int c = 0; c < 4; c++)
+					out[c] += in[c] * weights[t];
+			}
+		}
+	}
+
+	out_dest.assign((size_t)destWidth * destHeight * 4, 0.0f);
+	for (unsigned int y = 0; y < destHeight; y++){
+		filterTaps(sourceHeight, destHeight, y, options.wrapY, taps, weights);
+		for (unsigned int t = 0; t < taps.size(); t++){
+			const float * in = &columns[(size_t)taps[t] * destWidth * 4];
+			float * out = &out_dest[(size_t)y * destWidth * 4];
+			for (unsigned int i = 0; i < destWidth * 4; i++)
+				out[i] += in[i] * weights[t];
+		}
+	}
+}
+
+static void toFloat(const Image & image, bool linear, std::vector<float> & out_pixels){
+	out_pixels.resize(image.rgba.size());
+	for (size_t i = 0; i < image.rgba.size(); i += 4){
+		float alpha = image.rgba[i + 3] / 255.0f;
+		for (int c = 0; c < 3; c++){
+			float value = image.rgba[i + c] / 255.0f;
+			out_pixels[i + c] = (linear ? value : srgbToLinear(value)) * alpha;
+		}
+		out_pixels[i + 3] = alpha;
+	}
+}
+
+static void toImage(const std::vector<float> & pixels, unsigned int width, unsigned int height, bool linear, Image & out_image){
+	out_image.width = width;
+	out_image.height = height;
+	out_image.rgba.resize(pixels.size());
+	for (size_t i = 0; i < pixels.size(); i += 4){
+		float alpha = pixels[i + 3];
+		for (int c = 0; c < 3; c++){
+			float value = alpha > 0.0f ? pixels[i + c] / alpha : 0.0f;
+			value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+			out_image.rgba[i + c] = (unsigned char)((linear ? value : linearToSrgb(value)) * 255.0f + 0.5f);
+		}
+		out_image.rgba[i + 3] = (unsigned char)((alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha)) * 255.0f + 0.5f);
+	}
+}
+
+static void buildMipmaps(BakeJob & job, const BakeOptions & options){
+	job.levels.clear();
+	job.levels.push_back(job.image);
+	std::vector<float> current, next;
+	toFloat(job.image, options.linear, current);
+	unsigned int width = job.image.width, height = job.image.height;
+	while (width > 1 || height > 1){
+		unsigned int nextWidth = width > 1 ? width / 2 : 1;
+		unsigned int nextHeight = height > 1 ? height / 2 : 1;
+		downsample(current, width, height, next, nextWidth, nextHeight, options);
+		job.levels.push_back(Image());
+		toImage(next, nextWidth, nextHeight, options.linear, job.levels.back());
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+static bool writeDDS(const BakeJob & job){
+	FILE * file = fopen(job.output.c_str(), "wb");
+	if (!file){
+		printf("%s could not be written.\n", job.output.c_str());
+		return false;
+	}
+	unsigned int header[32];
+	memset(header, 0, sizeof(header));
+	header[0] = 0x20534444;                       // "DDS "
+	header[1] = 124;                              // size of the header
+	header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mipmap count, linear size
+	header[3] = job.image.height;
+	header[4] = job.image.width;
+	header[5] = (unsigned int)job.compressed[0].size();
+	header[7] = (unsigned int)job.levels.size();
+	header[19] = 32;                              // size of the pixel format
+	header[20] = 0x4;                             // four CC
+	header[21] = job.bc3 ? FOURCC_DXT5 : FOURCC_DXT1;
+	header[27] = 0x1000 | 0x8 | 0x400000;         // texture, complex, mipmap
+	bool ok = fwrite(header, 4, 32, file) == 32;
+	for (unsigned int i = 0; i < job.compressed.size() && ok; i++)
+		ok = fwrite(&job.compressed[i][0], 1, job.compressed[i].size(), file) == job.compressed[i].size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+		printf("%s could not be written.\n", job.output.c_str());
+	return ok;
+}
+
+// Runs task(0) ... task(count - 1) on threadCount threads
+static void parallelFor(unsigned int count, unsigned int threadCount, std::function<void(unsigned int)> task){
+	std::atomic<unsigned int> next(0);
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < threadCount; t++){
+		threads.push_back(std::thread([&](){
+			for (unsigned int i = next++; i < count; i = next++)
+				task(i);
+		}));
+	}
+	for (unsigned int t = 0; t < threads.size(); t++)
+		threads[t].join();
+}
+
+static void printUsage(){
+	printf("Usage : texbake [-bc1 | -bc3] [-linear] [-wrap | -wrapx] [-threads N] [-o output.dds] input...\n");
+}
+
+int main(int argc, char ** argv){
+	BakeOptions options;
+	options.format = 0;
+	options.linear = false;
+	options.wrapX = options.wrapY = false;
+	unsigned int threadCount = 0;
+	std::string output;
+	std::vector<BakeJob> jobs;
+
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "-bc1") == 0)
+			options.format = 1;
+		else if (strcmp(argv[i], "-bc3") == 0)
+			options.format = 3;
+		else if (strcmp(argv[i], "-linear") == 0)
+			options.linear = true;
+		else if (strcmp(argv[i], "-wrap") == 0)
+			options.wrapX = options.wrapY = true;
+		else if (strcmp(argv[i], "-wrapx") == 0)
+			options.wrapX = true;
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threadCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (argv[i][0] == '-'){
+			printUsage();
+			return 1;
+		}else{
+			jobs.push_back(BakeJob());
+			jobs.back().input = argv[i];
+		}
+	}
+	if (jobs.empty() || (!output.empty() && jobs.size() > 1)){
+		printUsage();
+		return 1;
+	}
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+
+	for (unsigned int i = 0; i < jobs.size(); i++){
+		if (!output.empty()){
+			jobs[i].output = output;
+		}else{
+			size_t dot = jobs[i].input.find_last_of('.');
+			size_t slash = jobs[i].input.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+				dot = jobs[i].input.size();
+			jobs[i].output = jobs[i].input.substr(0, dot) + ".dds";
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Decode the images and build their mipmaps, one image per thread
+	parallelFor(jobs.size(), threadCount, [&](unsigned int i){
+		BakeJob & job = jobs[i];
+		job.ok = loadImage(job.input.c_str(), job.image);
+		if (!job.ok)
+			return;
+		bool transparent = false;
+		for (size_t p = 3; p < job.image.rgba.size() && !transparent; p += 4)
+			transparent = job.image.rgba[p] != 255;
+		job.bc3 = options.format == 3 || (options.format == 0 && transparent);
+		buildMipmaps(job, options);
+		job.compressed.resize(job.levels.size());
+		for (unsigned int l = 0; l < job.levels.size(); l++)
+			job.compressed[l].resize(compressedSizeBC(job.levels[l].width, job.levels[l].height, job.bc3));
+	});
+
+	// Compress all the bands of block rows of all the levels
+	struct Band { unsigned int job, level, firstRow, lastRow; };
+	std::vector<Band> bands;
+	for (unsigned int j = 0; j < jobs.size(); j++){
+		if (!jobs[j].ok)
+			continue;
+		for (unsigned int l = 0; l < jobs[j].levels.size(); l++){
+			unsigned int rows = (jobs[j].levels[l].height + 3) / 4;
+			for (unsigned int row = 0; row < rows; row += TEXBAKE_BAND_ROWS){
+				Band band = { j, l, row, row + TEXBAKE_BAND_ROWS < rows ? row + TEXBAKE_BAND_ROWS : rows };
+				bands.push_back(band);
+			}
+		}
+	}
+	parallelFor(bands.size(), threadCount, [&](unsigned int i){
+		const Band & band = bands[i];
+		BakeJob & job = jobs[band.job];
+		const Image & level = job.levels[band.level];
+		compressImageBC(&level.rgba[0], level.width, level.height, job.bc3, band.firstRow, band.lastRow, &job.compressed[band.level][0]);
+	});
+
+	int failures = 0;
+	for (unsigned int i = 0; i < jobs.size(); i++){
+		if (jobs[i].ok && writeDDS(jobs[i]))
+			printf("%s -> %s : %ux%u, %u levels, %s\n", jobs[i].input.c_str(), jobs[i].output.c_str(),
+				jobs[i].image.width, jobs[i].image.height, (unsigned int)jobs[i].levels.size(), jobs[i].bc3 ? "BC3" : "BC1");
+		else
+			failures++;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%u textures baked in %.2f s on %u threads\n", (unsigned int)jobs.size() - failures, seconds, threadCount);
+	return failures == 0 ? 0 : 1;
+}